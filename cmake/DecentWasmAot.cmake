@@ -0,0 +1,138 @@
+# Copyright (c) 2024 Haofan Zheng
+# Use of this source code is governed by an MIT-style
+# license that can be found in the LICENSE file or at
+# https://opensource.org/licenses/MIT.
+
+
+# Compiles WASM modules to AOT blobs with wamrc, and stores them in a content
+# addressed cache directory, i.e., as
+# `<CACHE_DIR>/<SHA-256 of the .wasm>-<CACHE_KEY>.aot`, so runners can find the
+# precompiled code of a module from its bytecode.
+# The key (see decent_wasm_aot_cache_key()) changes with the wamrc binary, the
+# WAMR version, the target, and the wamrc flags, so a runner given the key of
+# its own build never picks up an artifact compiled otherwise.
+#
+# This file is used in two ways:
+#   - included by CMakeLists.txt, it provides decent_wasm_aot_cache_key() and
+#     decent_wasm_add_aot_target();
+#   - run with `cmake -P`, it compiles the modules given by the variables
+#     WAMRC, WAMRC_FLAGS, CACHE_DIR, CACHE_KEY, and WASM_FILES.
+
+
+if(CMAKE_SCRIPT_MODE_FILE)
+
+	file(MAKE_DIRECTORY ${CACHE_DIR})
+
+	foreach(wasm_file IN LISTS WASM_FILES)
+		file(SHA256 ${wasm_file} wasm_hash)
+		set(aot_file ${CACHE_DIR}/${wasm_hash}-${CACHE_KEY}.aot)
+
+		if(EXISTS ${aot_file})
+			message(STATUS "AOT cache hit: ${wasm_file}")
+			continue()
+		endif()
+
+		message(STATUS "AOT compiling: ${wasm_file} -> ${aot_file}")
+		separate_arguments(wamrc_flags UNIX_COMMAND "${WAMRC_FLAGS}")
+		execute_process(
+			COMMAND ${WAMRC} ${wamrc_flags} -o ${aot_file}.tmp ${wasm_file}
+			RESULT_VARIABLE wamrc_result
+		)
+		if(NOT wamrc_result EQUAL 0)
+			file(REMOVE ${aot_file}.tmp)
+			message(FATAL_ERROR "Failed to compile ${wasm_file} with wamrc")
+		endif()
+		# rename at the end, so an interrupted build never leaves a broken
+		# artifact in the cache
+		file(RENAME ${aot_file}.tmp ${aot_file})
+	endforeach()
+
+	return()
+
+endif(CMAKE_SCRIPT_MODE_FILE)
+
+
+set(DECENT_WASM_AOT_SCRIPT ${CMAKE_CURRENT_LIST_FILE})
+
+
+find_program(
+	DECENT_WASM_WAMRC
+	NAMES wamrc
+	DOC "Path to WAMR's AOT compiler (wamrc)"
+)
+
+
+# decent_wasm_aot_cache_key(<output variable>
+#   [FLAGS <wamrc flags>...]
+# )
+#
+# Gets the key of the artifacts compiled with the given flags, from the wamrc
+# binary, WAMR's version header (in WAMR_ROOT_DIR), the target processor, and
+# the flags. The build is re-configured when wamrc changes.
+function(decent_wasm_aot_cache_key out_var)
+	cmake_parse_arguments(
+		PARSE_ARGV 1
+		arg
+		""
+		""
+		"FLAGS"
+	)
+
+	set(wamrc_hash "")
+	if(DECENT_WASM_WAMRC)
+		file(SHA256 ${DECENT_WASM_WAMRC} wamrc_hash)
+		set_property(DIRECTORY APPEND PROPERTY
+			CMAKE_CONFIGURE_DEPENDS ${DECENT_WASM_WAMRC}
+		)
+	endif()
+
+	set(wamr_version "")
+	if(EXISTS ${WAMR_ROOT_DIR}/core/version.h)
+		file(READ ${WAMR_ROOT_DIR}/core/version.h wamr_version)
+	endif()
+
+	string(SHA256 key
+		"${wamrc_hash}\n${wamr_version}\n${CMAKE_SYSTEM_PROCESSOR}\n${arg_FLAGS}"
+	)
+	string(SUBSTRING ${key} 0 16 key)
+	set(${out_var} ${key} PARENT_SCOPE)
+endfunction()
+
+
+# decent_wasm_add_aot_target(<target name>
+#   CACHE_DIR  <dir>
+#   [FLAGS     <wamrc flags>...]
+#   WASM_FILES <wasm files>...
+# )
+function(decent_wasm_add_aot_target target_name)
+	cmake_parse_arguments(
+		PARSE_ARGV 1
+		arg
+		""
+		"CACHE_DIR"
+		"FLAGS;WASM_FILES"
+	)
+
+	if(NOT DECENT_WASM_WAMRC)
+		message(STATUS
+			"wamrc is not found (set DECENT_WASM_WAMRC); "
+			"target ${target_name} is not added"
+		)
+		return()
+	endif()
+
+	string(REPLACE ";" " " wamrc_flags "${arg_FLAGS}")
+	decent_wasm_aot_cache_key(cache_key FLAGS ${arg_FLAGS})
+
+	add_custom_target(${target_name}
+		COMMAND ${CMAKE_COMMAND}
+			-DWAMRC=${DECENT_WASM_WAMRC}
+			-DWAMRC_FLAGS=${wamrc_flags}
+			-DCACHE_DIR=${arg_CACHE_DIR}
+			-DCACHE_KEY=${cache_key}
+			"-DWASM_FILES=${arg_WASM_FILES}"
+			-P ${DECENT_WASM_AOT_SCRIPT}
+		COMMENT "Compiling AOT artifacts into ${arg_CACHE_DIR}"
+		VERBATIM
+	)
+endfunction()
@@ -0,0 +1,116 @@
+# Copyright (c) 2024 Haofan Zheng
+# Use of this source code is governed by an MIT-style
+# license that can be found in the LICENSE file or at
+# https://opensource.org/licenses/MIT.
+
+
+# Builds the list of AOT artifacts the enclave trusts into its image, by
+# generating a C++ source that defines the table `g_decentWasmTrustedAot`
+# (see src/AotAllowlist.hpp) listing the SHA-256 hashes of the artifacts,
+# each paired with the SHA-256 of the WASM bytecode it's compiled from, so an
+# artifact is only trusted in place of that bytecode.
+# The bytecode hash is taken from the artifact's file name, which is
+# `<SHA-256 of the .wasm>-<CACHE_KEY>.aot` in the cache built by
+# DecentWasmAot.cmake; artifacts with another key (i.e., compiled by another
+# wamrc, or with other flags) are refused.
+# Since the table is part of the enclave image, it's covered by MRENCLAVE.
+#
+# This file is used in two ways:
+#   - included by CMakeLists.txt, it provides decent_wasm_add_aot_allowlist();
+#   - run with `cmake -P`, it generates the source given by the variables
+#     OUTPUT, HEADER, CACHE_KEY, and AOT_FILES.
+
+
+if(CMAKE_SCRIPT_MODE_FILE)
+
+	set(entries "")
+	set(count 0)
+
+	foreach(aot_file IN LISTS AOT_FILES)
+		get_filename_component(aot_name ${aot_file} NAME_WE)
+		if(NOT aot_name MATCHES "^([0-9a-f]+)-([0-9a-f]+)$")
+			message(FATAL_ERROR
+				"${aot_file} is not named by the SHA-256 of its bytecode "
+				"(<SHA-256 of the .wasm>-<cache key>.aot)"
+			)
+		endif()
+		set(wasm_hash ${CMAKE_MATCH_1})
+		if(NOT CMAKE_MATCH_2 STREQUAL CACHE_KEY)
+			message(FATAL_ERROR
+				"${aot_file} is not compiled by the wamrc and flags of this "
+				"build (cache key ${CMAKE_MATCH_2} instead of ${CACHE_KEY})"
+			)
+		endif()
+		string(LENGTH ${wasm_hash} wasm_hash_len)
+		if(NOT wasm_hash_len EQUAL 64)
+			message(FATAL_ERROR
+				"${aot_file} is not named by the SHA-256 of its bytecode "
+				"(<SHA-256 of the .wasm>-<cache key>.aot)"
+			)
+		endif()
+
+		file(SHA256 ${aot_file} aot_hash)
+		string(APPEND entries
+			"\t{ \"${wasm_hash}\", \"${aot_hash}\" }, // ${aot_file}\n"
+		)
+		math(EXPR count "${count} + 1")
+	endforeach()
+
+	if(count EQUAL 0)
+		# zero-sized arrays are not allowed
+		set(entries "\t{ nullptr, nullptr },\n")
+	endif()
+
+	file(WRITE ${OUTPUT}.tmp
+		"// Generated by cmake/DecentWasmAotAllowlist.cmake; DO NOT EDIT.\n"
+		"\n"
+		"#include \"${HEADER}\"\n"
+		"\n"
+		"\n"
+		"const DecentWasmTrustedAot g_decentWasmTrustedAot[] = {\n"
+		"${entries}"
+		"};\n"
+		"\n"
+		"const size_t g_decentWasmTrustedAotCount = ${count};\n"
+	)
+	file(RENAME ${OUTPUT}.tmp ${OUTPUT})
+
+	return()
+
+endif(CMAKE_SCRIPT_MODE_FILE)
+
+
+set(DECENT_WASM_AOT_ALLOWLIST_SCRIPT ${CMAKE_CURRENT_LIST_FILE})
+
+
+# decent_wasm_add_aot_allowlist(
+#   OUTPUT    <generated C++ source>
+#   HEADER    <path to AotAllowlist.hpp>
+#   CACHE_KEY <key of the artifacts, see decent_wasm_aot_cache_key()>
+#   AOT_FILES <.aot files>...
+# )
+#
+# The generated source should be added to the trusted sources of the enclave
+# target in the same directory.
+function(decent_wasm_add_aot_allowlist)
+	cmake_parse_arguments(
+		PARSE_ARGV 0
+		arg
+		""
+		"OUTPUT;HEADER;CACHE_KEY"
+		"AOT_FILES"
+	)
+
+	add_custom_command(
+		OUTPUT ${arg_OUTPUT}
+		COMMAND ${CMAKE_COMMAND}
+			-DOUTPUT=${arg_OUTPUT}
+			-DHEADER=${arg_HEADER}
+			-DCACHE_KEY=${arg_CACHE_KEY}
+			"-DAOT_FILES=${arg_AOT_FILES}"
+			-P ${DECENT_WASM_AOT_ALLOWLIST_SCRIPT}
+		DEPENDS ${arg_AOT_FILES} ${DECENT_WASM_AOT_ALLOWLIST_SCRIPT}
+		COMMENT "Building the trusted AOT artifact list into ${arg_OUTPUT}"
+		VERBATIM
+	)
+endfunction()
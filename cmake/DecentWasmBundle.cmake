@@ -0,0 +1,107 @@
+# Copyright (c) 2024 Haofan Zheng
+# Use of this source code is governed by an MIT-style
+# license that can be found in the LICENSE file or at
+# https://opensource.org/licenses/MIT.
+
+
+# Embeds WASM (or AOT) modules into a binary, by generating a C++ source that
+# defines them as byte arrays, and the table `g_decentWasmBundledModules`
+# (see src/ModuleBundle.hpp) listing their names and SHA-256 hashes.
+#
+# This file is used in two ways:
+#   - included by CMakeLists.txt, it provides decent_wasm_add_module_bundle();
+#   - run with `cmake -P`, it generates the source given by the variables
+#     OUTPUT, HEADER, and MODULES.
+
+
+if(CMAKE_SCRIPT_MODE_FILE)
+
+	set(arrays "")
+	set(entries "")
+	set(index 0)
+
+	foreach(module_file IN LISTS MODULES)
+		get_filename_component(module_name ${module_file} NAME)
+		string(REGEX REPLACE "\\.(wasm|aot)$" "" module_name ${module_name})
+		file(SHA256 ${module_file} module_hash)
+
+		file(READ ${module_file} module_hex HEX)
+		# 16 bytes per line
+		string(REGEX REPLACE "([0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f])" "\\1\n\t" module_hex "${module_hex}")
+		string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," module_bytes "${module_hex}")
+
+		# const, so it's never loaded in place; WAMR may modify the buffer it
+		# loads a module from
+		string(APPEND arrays
+			"// ${module_file}\n"
+			"alignas(8) const uint8_t gs_module${index}[] = {\n\t${module_bytes}\n};\n\n"
+		)
+		string(APPEND entries
+			"\t{ \"${module_name}\", \"${module_hash}\", gs_module${index}, sizeof(gs_module${index}) },\n"
+		)
+		math(EXPR index "${index} + 1")
+	endforeach()
+
+	if(index EQUAL 0)
+		# zero-sized arrays are not allowed
+		set(entries "\t{ nullptr, nullptr, nullptr, 0 },\n")
+	endif()
+
+	file(WRITE ${OUTPUT}.tmp
+		"// Generated by cmake/DecentWasmBundle.cmake; DO NOT EDIT.\n"
+		"\n"
+		"#include \"${HEADER}\"\n"
+		"\n"
+		"\n"
+		"namespace\n"
+		"{\n"
+		"\n"
+		"${arrays}"
+		"} // namespace\n"
+		"\n"
+		"\n"
+		"const DecentWasmBundledModule g_decentWasmBundledModules[] = {\n"
+		"${entries}"
+		"};\n"
+		"\n"
+		"const size_t g_decentWasmBundledModuleCount = ${index};\n"
+	)
+	file(RENAME ${OUTPUT}.tmp ${OUTPUT})
+
+	return()
+
+endif(CMAKE_SCRIPT_MODE_FILE)
+
+
+set(DECENT_WASM_BUNDLE_SCRIPT ${CMAKE_CURRENT_LIST_FILE})
+
+
+# decent_wasm_add_module_bundle(
+#   OUTPUT  <generated C++ source>
+#   HEADER  <path to ModuleBundle.hpp>
+#   MODULES <.wasm or .aot files>...
+# )
+#
+# The generated source should be added to the sources of the target (e.g.,
+# TRUSTED_SOURCE of decent_enclave_add_target_sgx) in the same directory.
+function(decent_wasm_add_module_bundle)
+	cmake_parse_arguments(
+		PARSE_ARGV 0
+		arg
+		""
+		"OUTPUT;HEADER"
+		"MODULES"
+	)
+
+	add_custom_command(
+		OUTPUT ${arg_OUTPUT}
+		COMMAND ${CMAKE_COMMAND}
+			-DOUTPUT=${arg_OUTPUT}
+			-DHEADER=${arg_HEADER}
+			"-DMODULES=${arg_MODULES}"
+			-P ${DECENT_WASM_BUNDLE_SCRIPT}
+		DEPENDS ${arg_MODULES} ${DECENT_WASM_BUNDLE_SCRIPT}
+		COMMENT "Embedding WASM modules into ${arg_OUTPUT}"
+		VERBATIM
+	)
+endfunction()
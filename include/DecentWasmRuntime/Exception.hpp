@@ -33,5 +33,31 @@ public:
 }; // class WasmRuntimeException
 
 
+/**
+ * @brief A run terminated for passing its deadline (see Watchdog).
+ */
+class WasmTimeoutException : public WasmRuntimeException
+{
+public:
+	WasmTimeoutException(const char* msg) : WasmRuntimeException(msg) {}
+	WasmTimeoutException(const std::string& msg) : WasmRuntimeException(msg) {}
+
+	virtual ~WasmTimeoutException() noexcept {}
+}; // class WasmTimeoutException
+
+
+/**
+ * @brief A run cancelled through its RunFuture.
+ */
+class WasmCancelledException : public WasmRuntimeException
+{
+public:
+	WasmCancelledException(const char* msg) : WasmRuntimeException(msg) {}
+	WasmCancelledException(const std::string& msg) : WasmRuntimeException(msg) {}
+
+	virtual ~WasmCancelledException() noexcept {}
+}; // class WasmCancelledException
+
+
 } // namespace DecentWasmRuntime
 
@@ -6,6 +6,7 @@
 #pragma once
 
 
+#include <limits>
 #include <memory>
 #include <type_traits>
 
@@ -77,6 +78,7 @@ public: // static members:
 			throw Exception("Failed to allocate memory in WASM");
 		}
 		nativePtr = reinterpret_cast<pointer>(rawNativePtr);
+		modInst->OnAppHeapAlloc(wasmSize);
 
 		return Self(
 			wasmPtr,
@@ -159,6 +161,7 @@ public:
 		{
 			// ensure this pointer had not been emptied by a move operation
 			wasm_runtime_module_free(m_modInst->get(), m_wasmPtr);
+			m_modInst->OnAppHeapFree(m_wasmSize);
 			m_wasmPtr = 0;
 			m_nativePtr = nullptr;
 		}
@@ -0,0 +1,304 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstddef>
+#include <cstdint>
+
+#include <memory>
+
+#include "../Exception.hpp"
+#include "make_unique.hpp"
+
+#if !defined(DECENT_ENCLAVE_PLATFORM_SGX_TRUSTED) && defined(__linux__)
+#	include <sys/mman.h>
+#	define DECENTWASMRUNTIME_POOL_MMAP_SUPPORTED
+#endif // !DECENT_ENCLAVE_PLATFORM_SGX_TRUSTED && __linux__
+
+
+namespace DecentWasmRuntime
+{
+namespace Internal
+{
+
+
+/**
+ * @brief Touch every page in the given memory region once (reading and
+ *        writing back one byte per page), so that page faults, and EPC
+ *        page-ins in the enclave, happen now rather than in timed runs.
+ *
+ * @param ptr  Pointer to the beginning of the memory region.
+ * @param size Size of the memory region.
+ */
+inline void PrefaultPages(uint8_t* ptr, size_t size) noexcept
+{
+	static constexpr size_t sk_pageSize = 4 * 1024;
+
+	volatile uint8_t* vPtr = ptr;
+	for (size_t i = 0; i < size; i += sk_pageSize)
+	{
+		vPtr[i] = vPtr[i];
+	}
+}
+
+
+/**
+ * @brief Advise the kernel to back the given memory region with transparent
+ *        huge pages (`MADV_HUGEPAGE`); the region is widened to whole pages.
+ *        It's only a hint, so a failure only means regular pages.
+ *
+ * @param ptr  Pointer to the beginning of the memory region.
+ * @param size Size of the memory region.
+ * @return False if the advice is not taken, which is always the case in the
+ *         trusted build, and on platforms other than Linux.
+ */
+inline bool AdviseHugePages(uint8_t* ptr, size_t size) noexcept
+{
+#ifdef DECENTWASMRUNTIME_POOL_MMAP_SUPPORTED
+	static constexpr uintptr_t sk_pageSize = 4 * 1024;
+
+	const uintptr_t begin = reinterpret_cast<uintptr_t>(ptr) & ~(sk_pageSize - 1);
+	const uintptr_t end = reinterpret_cast<uintptr_t>(ptr) + size;
+	return madvise(
+		reinterpret_cast<void*>(begin),
+		static_cast<size_t>(end - begin),
+		MADV_HUGEPAGE
+	) == 0;
+#else // !DECENTWASMRUNTIME_POOL_MMAP_SUPPORTED
+	(void)ptr;
+	(void)size;
+	return false;
+#endif // DECENTWASMRUNTIME_POOL_MMAP_SUPPORTED
+}
+
+
+/**
+ * @brief What kind of memory backs a pool buffer.
+ *
+ */
+enum class PoolBacking
+{
+	/**
+	 * @brief Allocated from the heap, with regular pages.
+	 */
+	Heap,
+
+	/**
+	 * @brief Anonymous mapping, with regular pages.
+	 */
+	Mapped,
+
+	/**
+	 * @brief Anonymous mapping, advised for transparent huge pages
+	 *        (the kernel may still back it partially with regular pages).
+	 */
+	MappedThp,
+
+	/**
+	 * @brief Anonymous mapping backed by explicit huge pages (hugetlbfs).
+	 */
+	MappedHugeTlb,
+}; // enum class PoolBacking
+
+
+inline const char* GetPoolBackingName(PoolBacking backing) noexcept
+{
+	switch (backing)
+	{
+	case PoolBacking::Mapped:
+		return "mapped";
+	case PoolBacking::MappedThp:
+		return "thp";
+	case PoolBacking::MappedHugeTlb:
+		return "hugetlb";
+	case PoolBacking::Heap:
+	default:
+		return "heap";
+	}
+}
+
+
+/**
+ * @brief The memory buffer given to WAMR as the memory pool.
+ *
+ */
+class PoolBuffer
+{
+public: // static members
+
+	/**
+	 * @brief Size of the explicit huge pages requested by `AllocateHugeTlb`
+	 *        (the default huge page size on x86-64).
+	 */
+	static constexpr size_t sk_hugePageSize = 2 * 1024 * 1024;
+
+	/**
+	 * @brief Allocate a new pool buffer.
+	 *
+	 * @param size          Size of the buffer.
+	 * @param populate      Populate the pages at allocation (`MAP_POPULATE`);
+	 *                      only supported by the untrusted build on Linux.
+	 * @param hugePageHint  Hint the kernel to back the buffer with
+	 *                      transparent huge pages (`MADV_HUGEPAGE`);
+	 *                      only supported by the untrusted build on Linux.
+	 * @return The allocated buffer.
+	 */
+	static PoolBuffer Allocate(size_t size, bool populate, bool hugePageHint)
+	{
+#ifdef DECENTWASMRUNTIME_POOL_MMAP_SUPPORTED
+		if (populate || hugePageHint)
+		{
+			// Align to huge pages, so the tail can be backed by one as well
+			size_t mapSize = hugePageHint ?
+				RoundUpToHugePage(size) : size;
+			void* ptr = Map(mapSize, populate ? MAP_POPULATE : 0);
+			if (ptr == nullptr)
+			{
+				throw Exception("Failed to map memory for the memory pool");
+			}
+			PoolBacking backing = PoolBacking::Mapped;
+			// it's only a hint, so the failure only means regular pages
+			if (hugePageHint && (madvise(ptr, mapSize, MADV_HUGEPAGE) == 0))
+			{
+				backing = PoolBacking::MappedThp;
+			}
+			return PoolBuffer(static_cast<uint8_t*>(ptr), mapSize, backing);
+		}
+#else // !DECENTWASMRUNTIME_POOL_MMAP_SUPPORTED
+		(void)populate;
+		(void)hugePageHint;
+#endif // DECENTWASMRUNTIME_POOL_MMAP_SUPPORTED
+
+		std::unique_ptr<uint8_t[]> buf = make_unique<uint8_t[]>(size);
+		return PoolBuffer(buf.release(), size, PoolBacking::Heap);
+	}
+
+	/**
+	 * @brief Try to allocate a new pool buffer backed by explicit huge pages
+	 *        (`MAP_HUGETLB`), which needs huge pages to be reserved in
+	 *        advance (e.g., via `/proc/sys/vm/nr_hugepages`).
+	 *
+	 * @param size      Size of the buffer; rounded up to huge pages.
+	 * @param populate  Populate the pages at allocation (`MAP_POPULATE`).
+	 * @return The allocated buffer, or an empty one (`get() == nullptr`)
+	 *         if explicit huge pages are not available (including in the
+	 *         trusted build).
+	 */
+	static PoolBuffer AllocateHugeTlb(size_t size, bool populate) noexcept
+	{
+#if defined(DECENTWASMRUNTIME_POOL_MMAP_SUPPORTED) && defined(MAP_HUGETLB)
+		size_t mapSize = RoundUpToHugePage(size);
+		void* ptr = Map(mapSize, MAP_HUGETLB | (populate ? MAP_POPULATE : 0));
+		if (ptr == nullptr)
+		{
+			return PoolBuffer();
+		}
+		return PoolBuffer(
+			static_cast<uint8_t*>(ptr),
+			mapSize,
+			PoolBacking::MappedHugeTlb
+		);
+#else // !(DECENTWASMRUNTIME_POOL_MMAP_SUPPORTED && MAP_HUGETLB)
+		(void)size;
+		(void)populate;
+		return PoolBuffer();
+#endif // DECENTWASMRUNTIME_POOL_MMAP_SUPPORTED && MAP_HUGETLB
+	}
+
+private:
+
+	static size_t RoundUpToHugePage(size_t size) noexcept
+	{
+		return ((size + (sk_hugePageSize - 1)) / sk_hugePageSize) *
+			sk_hugePageSize;
+	}
+
+#ifdef DECENTWASMRUNTIME_POOL_MMAP_SUPPORTED
+	static void* Map(size_t size, int extraFlags) noexcept
+	{
+		void* ptr = mmap(
+			nullptr,
+			size,
+			PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | extraFlags,
+			-1,
+			0
+		);
+		return ptr == MAP_FAILED ? nullptr : ptr;
+	}
+#endif // DECENTWASMRUNTIME_POOL_MMAP_SUPPORTED
+
+public:
+
+	PoolBuffer() noexcept :
+		m_ptr(nullptr),
+		m_size(0),
+		m_backing(PoolBacking::Heap)
+	{}
+
+	PoolBuffer(uint8_t* ptr, size_t size, PoolBacking backing) noexcept :
+		m_ptr(ptr),
+		m_size(size),
+		m_backing(backing)
+	{}
+
+	PoolBuffer(const PoolBuffer&) = delete;
+
+	PoolBuffer(PoolBuffer&& other) noexcept :
+		m_ptr(other.m_ptr),
+		m_size(other.m_size),
+		m_backing(other.m_backing)
+	{
+		other.m_ptr = nullptr;
+		other.m_size = 0;
+	}
+
+	~PoolBuffer()
+	{
+		reset();
+	}
+
+	PoolBuffer& operator=(const PoolBuffer&) = delete;
+
+	PoolBuffer& operator=(PoolBuffer&&) = delete;
+
+	void reset() noexcept
+	{
+		if (m_ptr != nullptr)
+		{
+#ifdef DECENTWASMRUNTIME_POOL_MMAP_SUPPORTED
+			if (m_backing != PoolBacking::Heap)
+			{
+				munmap(m_ptr, m_size);
+			}
+			else
+#endif // DECENTWASMRUNTIME_POOL_MMAP_SUPPORTED
+			{
+				delete[] m_ptr;
+			}
+			m_ptr = nullptr;
+			m_size = 0;
+		}
+	}
+
+	uint8_t* get() noexcept { return m_ptr; }
+
+	size_t size() const noexcept { return m_size; }
+
+	PoolBacking backing() const noexcept { return m_backing; }
+
+private:
+
+	uint8_t* m_ptr;
+	size_t m_size;
+	PoolBacking m_backing;
+
+}; // class PoolBuffer
+
+
+} // namespace Internal
+} // namespace DecentWasmRuntime
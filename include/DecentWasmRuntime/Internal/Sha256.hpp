@@ -0,0 +1,226 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <array>
+#include <string>
+#include <vector>
+
+
+namespace DecentWasmRuntime
+{
+namespace Internal
+{
+
+
+/**
+ * @brief A minimal streaming SHA-256 implementation (FIPS 180-4), used to
+ *        key cached artifacts by the content of the WASM module.
+ *        It's meant for content addressing, not for performance.
+ *
+ */
+class Sha256
+{
+public: // static members
+
+	static constexpr size_t sk_digestSize = 32;
+	static constexpr size_t sk_blockSize = 64;
+
+	using Digest = std::array<uint8_t, sk_digestSize>;
+
+	static Digest Hash(const uint8_t* data, size_t size)
+	{
+		Sha256 ctx;
+		ctx.Update(data, size);
+		return ctx.Finalize();
+	}
+
+	static Digest Hash(const std::vector<uint8_t>& data)
+	{
+		return Hash(data.data(), data.size());
+	}
+
+	static std::string ToHex(const Digest& digest)
+	{
+		static constexpr char sk_hexChars[] = "0123456789abcdef";
+
+		std::string res;
+		res.reserve(digest.size() * 2);
+		for (uint8_t b : digest)
+		{
+			res.push_back(sk_hexChars[b >> 4]);
+			res.push_back(sk_hexChars[b & 0x0F]);
+		}
+		return res;
+	}
+
+public:
+
+	Sha256() noexcept :
+		m_state{
+			0x6a09e667U, 0xbb67ae85U, 0x3c6ef372U, 0xa54ff53aU,
+			0x510e527fU, 0x9b05688cU, 0x1f83d9abU, 0x5be0cd19U,
+		},
+		m_buf(),
+		m_bufLen(0),
+		m_totalLen(0)
+	{}
+
+	void Update(const uint8_t* data, size_t size) noexcept
+	{
+		m_totalLen += size;
+
+		if (m_bufLen > 0)
+		{
+			size_t fill = sk_blockSize - m_bufLen;
+			fill = fill < size ? fill : size;
+			std::memcpy(m_buf + m_bufLen, data, fill);
+			m_bufLen += fill;
+			data += fill;
+			size -= fill;
+			if (m_bufLen < sk_blockSize)
+			{
+				return;
+			}
+			Transform(m_buf);
+			m_bufLen = 0;
+		}
+
+		for (; size >= sk_blockSize; data += sk_blockSize, size -= sk_blockSize)
+		{
+			Transform(data);
+		}
+
+		std::memcpy(m_buf, data, size);
+		m_bufLen = size;
+	}
+
+	Digest Finalize() noexcept
+	{
+		uint64_t bitLen = m_totalLen * 8;
+
+		m_buf[m_bufLen++] = 0x80;
+		if (m_bufLen > (sk_blockSize - 8))
+		{
+			std::memset(m_buf + m_bufLen, 0, sk_blockSize - m_bufLen);
+			Transform(m_buf);
+			m_bufLen = 0;
+		}
+		std::memset(m_buf + m_bufLen, 0, (sk_blockSize - 8) - m_bufLen);
+		for (size_t i = 0; i < 8; ++i)
+		{
+			m_buf[sk_blockSize - 1 - i] = static_cast<uint8_t>(bitLen >> (i * 8));
+		}
+		Transform(m_buf);
+
+		Digest res;
+		for (size_t i = 0; i < 8; ++i)
+		{
+			res[(i * 4) + 0] = static_cast<uint8_t>(m_state[i] >> 24);
+			res[(i * 4) + 1] = static_cast<uint8_t>(m_state[i] >> 16);
+			res[(i * 4) + 2] = static_cast<uint8_t>(m_state[i] >> 8);
+			res[(i * 4) + 3] = static_cast<uint8_t>(m_state[i]);
+		}
+		return res;
+	}
+
+private:
+
+	static uint32_t RotR(uint32_t x, uint32_t n) noexcept
+	{
+		return (x >> n) | (x << (32 - n));
+	}
+
+	void Transform(const uint8_t* block) noexcept
+	{
+		static constexpr uint32_t sk_k[64] = {
+			0x428a2f98U, 0x71374491U, 0xb5c0fbcfU, 0xe9b5dba5U,
+			0x3956c25bU, 0x59f111f1U, 0x923f82a4U, 0xab1c5ed5U,
+			0xd807aa98U, 0x12835b01U, 0x243185beU, 0x550c7dc3U,
+			0x72be5d74U, 0x80deb1feU, 0x9bdc06a7U, 0xc19bf174U,
+			0xe49b69c1U, 0xefbe4786U, 0x0fc19dc6U, 0x240ca1ccU,
+			0x2de92c6fU, 0x4a7484aaU, 0x5cb0a9dcU, 0x76f988daU,
+			0x983e5152U, 0xa831c66dU, 0xb00327c8U, 0xbf597fc7U,
+			0xc6e00bf3U, 0xd5a79147U, 0x06ca6351U, 0x14292967U,
+			0x27b70a85U, 0x2e1b2138U, 0x4d2c6dfcU, 0x53380d13U,
+			0x650a7354U, 0x766a0abbU, 0x81c2c92eU, 0x92722c85U,
+			0xa2bfe8a1U, 0xa81a664bU, 0xc24b8b70U, 0xc76c51a3U,
+			0xd192e819U, 0xd6990624U, 0xf40e3585U, 0x106aa070U,
+			0x19a4c116U, 0x1e376c08U, 0x2748774cU, 0x34b0bcb5U,
+			0x391c0cb3U, 0x4ed8aa4aU, 0x5b9cca4fU, 0x682e6ff3U,
+			0x748f82eeU, 0x78a5636fU, 0x84c87814U, 0x8cc70208U,
+			0x90befffaU, 0xa4506cebU, 0xbef9a3f7U, 0xc67178f2U,
+		};
+
+		uint32_t w[64];
+		for (size_t i = 0; i < 16; ++i)
+		{
+			w[i] = (static_cast<uint32_t>(block[(i * 4) + 0]) << 24) |
+				(static_cast<uint32_t>(block[(i * 4) + 1]) << 16) |
+				(static_cast<uint32_t>(block[(i * 4) + 2]) << 8) |
+				(static_cast<uint32_t>(block[(i * 4) + 3]));
+		}
+		for (size_t i = 16; i < 64; ++i)
+		{
+			uint32_t s0 = RotR(w[i - 15], 7) ^ RotR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+			uint32_t s1 = RotR(w[i - 2], 17) ^ RotR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+			w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+		}
+
+		uint32_t a = m_state[0];
+		uint32_t b = m_state[1];
+		uint32_t c = m_state[2];
+		uint32_t d = m_state[3];
+		uint32_t e = m_state[4];
+		uint32_t f = m_state[5];
+		uint32_t g = m_state[6];
+		uint32_t h = m_state[7];
+
+		for (size_t i = 0; i < 64; ++i)
+		{
+			uint32_t s1 = RotR(e, 6) ^ RotR(e, 11) ^ RotR(e, 25);
+			uint32_t ch = (e & f) ^ ((~e) & g);
+			uint32_t t1 = h + s1 + ch + sk_k[i] + w[i];
+			uint32_t s0 = RotR(a, 2) ^ RotR(a, 13) ^ RotR(a, 22);
+			uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+			uint32_t t2 = s0 + maj;
+
+			h = g;
+			g = f;
+			f = e;
+			e = d + t1;
+			d = c;
+			c = b;
+			b = a;
+			a = t1 + t2;
+		}
+
+		m_state[0] += a;
+		m_state[1] += b;
+		m_state[2] += c;
+		m_state[3] += d;
+		m_state[4] += e;
+		m_state[5] += f;
+		m_state[6] += g;
+		m_state[7] += h;
+	}
+
+	uint32_t m_state[8];
+	uint8_t m_buf[sk_blockSize];
+	size_t m_bufLen;
+	uint64_t m_totalLen;
+
+}; // class Sha256
+
+
+} // namespace Internal
+} // namespace DecentWasmRuntime
+
@@ -12,10 +12,14 @@
 #include <vector>
 
 #include "ExecEnvUserData.hpp"
+#include "MemUsage.hpp"
+#include "RunExecutor.hpp"
+#include "RunningMode.hpp"
 #include "SharedWasmExecEnv.hpp"
 #include "SharedWasmModule.hpp"
 #include "SharedWasmModuleInstance.hpp"
 #include "SharedWasmRuntime.hpp"
+#include "Watchdog.hpp"
 
 
 namespace DecentWasmRuntime
@@ -38,18 +42,46 @@ public: // static members:
 		return sk_globalThresholdName;
 	}
 
-public:
-	MainRunner(
+	static SharedWasmModule LoadModule(
+		SharedWasmRuntime& wasmRt,
+		const std::vector<uint8_t>& wasmBytecode,
+		uint32_t initLinearMemSize
+	)
+	{
+		SharedWasmModule mod = wasmRt.LoadModule(wasmBytecode);
+		mod->SetInitLinearMemSize(initLinearMemSize);
+		return mod;
+	}
+
+	static SharedWasmModule LoadModule(
 		SharedWasmRuntime& wasmRt,
 		const std::vector<uint8_t>& wasmBytecode,
+		uint32_t initLinearMemSize,
+		RunningMode runningMode
+	)
+	{
+		SharedWasmModule mod = LoadModule(wasmRt, wasmBytecode, initLinearMemSize);
+		mod->SetRunningMode(runningMode);
+		return mod;
+	}
+
+public:
+
+	/**
+	 * @brief Construct a new runner on a new instance of a loaded module,
+	 *        so that multiple runners can share the same module.
+	 *
+	 */
+	MainRunner(
+		SharedWasmModule module,
 		const std::vector<uint8_t>& eventId,
 		const std::vector<uint8_t>& msgContent,
 		uint32_t modStackSize,
 		uint32_t modHeapSize,
 		uint32_t execStackSize
 	) :
-		m_printFunc(wasmRt->GetPrintFunc()),
-		m_module(wasmRt.LoadModule(wasmBytecode)),
+		m_printFunc(module->GetRuntime().GetPrintFunc()),
+		m_module(std::move(module)),
 		m_modInst(m_module.Instantiate(modStackSize, modHeapSize)),
 		m_execEnv(m_modInst.CreateExecEnv(execStackSize))
 	{
@@ -60,41 +92,232 @@ public:
 		m_execEnv->SetUserData(std::move(execEnvUserData));
 	}
 
+	MainRunner(
+		SharedWasmRuntime& wasmRt,
+		const std::vector<uint8_t>& wasmBytecode,
+		const std::vector<uint8_t>& eventId,
+		const std::vector<uint8_t>& msgContent,
+		uint32_t modStackSize,
+		uint32_t modHeapSize,
+		uint32_t execStackSize,
+		uint32_t initLinearMemSize = 0
+	) :
+		MainRunner(
+			LoadModule(wasmRt, wasmBytecode, initLinearMemSize),
+			eventId,
+			msgContent,
+			modStackSize,
+			modHeapSize,
+			execStackSize
+		)
+	{}
+
+	MainRunner(
+		SharedWasmRuntime& wasmRt,
+		const std::vector<uint8_t>& wasmBytecode,
+		const std::vector<uint8_t>& eventId,
+		const std::vector<uint8_t>& msgContent,
+		const InstanceSizing& sizing
+	) :
+		MainRunner(
+			wasmRt,
+			wasmBytecode,
+			eventId,
+			msgContent,
+			sizing.modStackSize,
+			sizing.modHeapSize,
+			sizing.execStackSize,
+			sizing.initLinearMemSize
+		)
+	{}
+
+	/**
+	 * @brief Move is only allowed while no run is in flight, since the
+	 *        submitted run refers to this runner.
+	 *
+	 */
+	MainRunner(MainRunner&&) = default;
+
+	/**
+	 * @brief Waits for the run in flight, if any, so that it never
+	 *        outlives the instance it runs on.
+	 *
+	 */
+	~MainRunner()
+	{
+		if (m_inFlight.IsValid())
+		{
+			m_inFlight.Wait();
+		}
+	}
+
+	/**
+	 * @brief Replace the event given to the following runs, so that the
+	 *        same instance can serve another event.
+	 *
+	 */
+	void SetEvent(
+		const std::vector<uint8_t>& eventId,
+		const std::vector<uint8_t>& msgContent
+	)
+	{
+		m_execEnv->GetUserData().SetEventId(eventId);
+		m_execEnv->GetUserData().SetEventData(msgContent);
+	}
+
 	int32_t RunPlain()
 	{
 		using MainRetType = std::tuple<int32_t>;
 
-		auto mainRetVals = m_execEnv->ExecFunc<MainRetType>(
-			"decent_wasm_main",
-			static_cast<uint32_t>(m_execEnv->GetUserData().GetEventId().size()),
-			static_cast<uint32_t>(m_execEnv->GetUserData().GetEventData().size())
-		);
+		MainRetType mainRetVals;
+		try
+		{
+			mainRetVals = m_execEnv->ExecFunc<MainRetType>(
+				"decent_wasm_main",
+				static_cast<uint32_t>(m_execEnv->GetUserData().GetEventId().size()),
+				static_cast<uint32_t>(m_execEnv->GetUserData().GetEventData().size())
+			);
+		}
+		catch (...)
+		{
+			m_modInst->UpdateLinearMemStats();
+			throw;
+		}
+		m_modInst->UpdateLinearMemStats();
 
 		return std::get<0>(mainRetVals);
 	}
 
+	/**
+	 * @brief Run the plain program, terminated by the watchdog if it's still
+	 *        running after the given timeout; a terminated run may leave the
+	 *        linear memory at any point of the program.
+	 *
+	 * @exception WasmTimeoutException The run has been terminated.
+	 * @exception Exception The instance can't be terminated
+	 *                      (see WasmModuleInstance::IsTerminable).
+	 */
+	int32_t RunPlain(Watchdog& watchdog, uint64_t timeoutUs)
+	{
+		const Watchdog::Ticket ticket = watchdog.Arm(
+			*m_modInst.get(),
+			m_module->GetRuntime().GetTimestampUs() + timeoutUs
+		);
+
+		int32_t ret = 0;
+		try
+		{
+			ret = RunPlain();
+		}
+		catch (...)
+		{
+			if (watchdog.Disarm(ticket))
+			{
+				// so that the instance can run again
+				m_modInst->ClearException();
+				throw WasmTimeoutException(
+					"The run was terminated after the timeout of " +
+					std::to_string(timeoutUs) + " us"
+				);
+			}
+			throw;
+		}
+
+		if (watchdog.Disarm(ticket))
+		{
+			// terminated right after it had returned
+			m_modInst->ClearException();
+		}
+		return ret;
+	}
+
 	int32_t RunInstrumented(uint64_t threshold)
 	{
 		using MainRetType = std::tuple<int32_t>;
 
 		m_threshold = threshold;
 
-		auto mainRetVals = m_execEnv->ExecFunc<MainRetType>(
-			"decent_wasm_injected_main",
-			static_cast<uint32_t>(m_execEnv->GetUserData().GetEventId().size()),
-			static_cast<uint32_t>(m_execEnv->GetUserData().GetEventData().size()),
-			static_cast<uint64_t>(threshold)
-		);
+		MainRetType mainRetVals;
+		try
+		{
+			mainRetVals = m_execEnv->ExecFunc<MainRetType>(
+				"decent_wasm_injected_main",
+				static_cast<uint32_t>(m_execEnv->GetUserData().GetEventId().size()),
+				static_cast<uint32_t>(m_execEnv->GetUserData().GetEventData().size()),
+				static_cast<uint64_t>(threshold)
+			);
+		}
+		catch (...)
+		{
+			m_modInst->UpdateLinearMemStats();
+			throw;
+		}
+		m_modInst->UpdateLinearMemStats();
 
 		m_counter = m_modInst->GetGlobal<uint64_t>(sk_globalCounterName());
-		m_printFunc((
-			"Threshold: " + std::to_string(m_threshold) + ", "
-			"Counter: "   + std::to_string(m_counter) + "\n"
-		).c_str());
+		if (m_printCounter)
+		{
+			m_printFunc((
+				"Threshold: " + std::to_string(m_threshold) + ", "
+				"Counter: "   + std::to_string(m_counter) + "\n"
+			).c_str());
+		}
 
 		return std::get<0>(mainRetVals);
 	}
 
+	/**
+	 * @brief Submit a run of the plain program to the executor, without
+	 *        waiting for it. No other run of this runner may be started
+	 *        until the returned future is ready, and the runner must not be
+	 *        moved meanwhile (its destructor waits for the run); cancelling
+	 *        it terminates the run, like the watchdog does, if the instance
+	 *        can be terminated (see WasmModuleInstance::IsTerminable).
+	 *
+	 */
+	RunFuture RunPlainAsync(RunExecutor& executor)
+	{
+		return SubmitAsync(
+			executor,
+			[this](RunResult& res) {
+				res.retVal = RunPlain();
+			}
+		);
+	}
+
+	/**
+	 * @brief Submit a run to the executor of the runtime.
+	 *
+	 */
+	RunFuture RunPlainAsync()
+	{
+		return RunPlainAsync(m_module->GetRuntime().GetExecutor());
+	}
+
+	/**
+	 * @brief Like RunPlainAsync, but for the instrumented program; the
+	 *        result carries the counter.
+	 *
+	 */
+	RunFuture RunInstrumentedAsync(uint64_t threshold, RunExecutor& executor)
+	{
+		return SubmitAsync(
+			executor,
+			[this, threshold](RunResult& res) {
+				res.retVal = RunInstrumented(threshold);
+				res.counter = m_counter;
+			}
+		);
+	}
+
+	RunFuture RunInstrumentedAsync(uint64_t threshold)
+	{
+		return RunInstrumentedAsync(
+			threshold,
+			m_module->GetRuntime().GetExecutor()
+		);
+	}
+
 	uint64_t GetThreshold() const noexcept
 	{
 		return m_threshold;
@@ -105,14 +328,106 @@ public:
 		return m_counter;
 	}
 
+	/**
+	 * @brief Whether RunInstrumented prints the threshold and the counter
+	 *        (on by default); e.g., off when running many events.
+	 *
+	 */
+	void SetPrintCounter(bool printCounter) noexcept
+	{
+		m_printCounter = printCounter;
+	}
+
 	void ResetThresholdAndCounter()
 	{
 		m_modInst->SetGlobal<uint64_t>(sk_globalCounterName(), 0);
 		m_modInst->SetGlobal<uint64_t>(sk_globalThresholdName(), 0);
 	}
 
+	/**
+	 * @brief Get the memory usage of the instance and the execution
+	 *        environment used by this runner.
+	 *
+	 */
+	InstanceMemUsage GetMemUsage() const
+	{
+		InstanceMemUsage res = m_modInst->GetMemUsage();
+		res.execEnvPoolSize = m_execEnv->GetPoolSize();
+		return res;
+	}
+
+#ifdef DECENTWASMRUNTIME_MEMORY_PROFILING
+	void DumpMemConsumption()
+	{
+		m_execEnv->DumpMemConsumption();
+	}
+#endif // DECENTWASMRUNTIME_MEMORY_PROFILING
+
+	/**
+	 * @brief Switch the running mode of the instance used by this runner.
+	 *
+	 */
+	void SetRunningMode(RunningMode mode)
+	{
+		m_modInst->SetRunningMode(mode);
+	}
+
+	RunningMode GetRunningMode() const noexcept
+	{
+		return m_modInst->GetRunningMode();
+	}
+
+	const SharedWasmModule& GetModule() const noexcept
+	{
+		return m_module;
+	}
+
+	SharedWasmModuleInstance& GetModuleInstance() noexcept
+	{
+		return m_modInst;
+	}
+
+	const SharedWasmModuleInstance& GetModuleInstance() const noexcept
+	{
+		return m_modInst;
+	}
+
 private:
 
+	template<typename _RunFunc>
+	RunFuture SubmitAsync(RunExecutor& executor, _RunFunc runFunc)
+	{
+		if (m_inFlight.IsValid() && !m_inFlight.IsReady())
+		{
+			throw Exception("A run of this runner is still in flight");
+		}
+
+		const WasmRuntime& rt = m_module->GetRuntime();
+		const uint64_t submitUs = rt.GetTimestampUs();
+
+		RunJob job;
+		job.run = [&rt, submitUs, runFunc](RunResult& res) {
+			res.submitUs = submitUs;
+			res.startUs = rt.GetTimestampUs();
+			runFunc(res);
+			res.endUs = rt.GetTimestampUs();
+		};
+		// left empty if the run can't be terminated, so a running one is
+		// never reported as cancelled (see RunFuture::Cancel)
+		if (m_modInst->IsTerminable())
+		{
+			job.terminate = [this]() {
+				m_modInst->Terminate();
+			};
+			job.clearTermination = [this]() {
+				m_modInst->ClearException();
+			};
+		}
+
+		m_inFlight = executor.Submit(std::move(job));
+		return m_inFlight;
+	}
+
 	os_print_function_t m_printFunc;
 	SharedWasmModule m_module;
 	SharedWasmModuleInstance m_modInst;
@@ -120,6 +435,9 @@ private:
 
 	uint64_t m_threshold = 0;
 	uint64_t m_counter = 0;
+	bool m_printCounter = true;
+	// the last run submitted by RunPlainAsync or RunInstrumentedAsync
+	RunFuture m_inFlight;
 }; // class MainRunner
 
 
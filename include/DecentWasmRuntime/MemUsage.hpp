@@ -0,0 +1,161 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <limits>
+
+
+namespace DecentWasmRuntime
+{
+
+
+/**
+ * @brief Usage of the memory pool that WAMR allocates everything from
+ *        (module, instances, linear memories, execution environments, etc.)
+ *
+ */
+struct MemPoolUsage
+{
+	uint64_t totalSize = 0;
+	uint64_t usedSize = 0;
+
+	/**
+	 * @brief The high-water mark of the pool usage since the runtime
+	 *        has been initialized.
+	 */
+	uint64_t peakSize = 0;
+}; // struct MemPoolUsage
+
+
+/**
+ * @brief Memory used by a single module instance and its execution
+ *        environment.
+ *
+ */
+struct InstanceMemUsage
+{
+	/**
+	 * @brief Bytes taken from the pool by the instantiation, including the
+	 *        initial linear memory and the app heap.
+	 *        NOTE: WAMR only reports the usage of the whole pool, so this is
+	 *        the growth of the pool usage across the instantiation; it's only
+	 *        accurate if nothing else allocates from (or frees to) the pool
+	 *        at the same time, e.g., on another thread.
+	 */
+	uint64_t instPoolSize = 0;
+
+	/**
+	 * @brief Bytes taken from the pool by the execution environment,
+	 *        including the execution stack; measured the same way as
+	 *        instPoolSize, with the same limit.
+	 */
+	uint64_t execEnvPoolSize = 0;
+
+	/**
+	 * @brief Size of the linear memory; since linear memory never shrinks,
+	 *        this is also its high-water mark.
+	 */
+	uint64_t linearMemSize = 0;
+
+	/**
+	 * @brief High-water mark of the app heap allocated by the host
+	 *        (i.e., via InstMemPtr).
+	 *        NOTE: a module's own malloc allocates from its linear memory,
+	 *        not from the app heap, so this is the whole app heap peak,
+	 *        unless the module imports malloc from the host (e.g., WAMR's
+	 *        libc-builtin), whose allocations are not seen here.
+	 */
+	uint64_t appHeapPeak = 0;
+}; // struct InstanceMemUsage
+
+
+/**
+ * @brief Sizes given to a module instance and its execution environment.
+ *
+ */
+struct InstanceSizing
+{
+	uint32_t modStackSize = 0;
+	uint32_t modHeapSize = 0;
+	uint32_t execStackSize = 0;
+	uint32_t initLinearMemSize = 0;
+}; // struct InstanceSizing
+
+
+namespace Internal
+{
+
+inline uint64_t RoundUpSize(uint64_t size, uint64_t align)
+{
+	return ((size + (align - 1)) / align) * align;
+}
+
+inline uint32_t AddSizeMargin(uint64_t size, uint32_t marginPercent)
+{
+	static constexpr uint64_t sk_pageSize = 4 * 1024;
+
+	uint64_t res = RoundUpSize(size + ((size * marginPercent) / 100), sk_pageSize);
+	return res > std::numeric_limits<uint32_t>::max() ?
+		std::numeric_limits<uint32_t>::max() :
+		static_cast<uint32_t>(res);
+}
+
+/**
+ * @brief The smallest app heap given by AutoSizeInstance, which leaves room
+ *        for the allocator's own bookkeeping.
+ */
+static constexpr uint32_t sk_minAutoAppHeapSize = 64 * 1024; // 64 KB
+
+} // namespace Internal
+
+
+/**
+ * @brief Pick the sizes for new instances of a module based on the memory
+ *        usage observed on an instance created with `curr` sizes.
+ *
+ *        The linear memory is reserved up to its observed peak, and the app
+ *        heap is sized to its observed peak (see
+ *        InstanceMemUsage::appHeapPeak), both plus the given safety margin;
+ *        the app heap is never grown past `curr`, nor shrunk below
+ *        Internal::sk_minAutoAppHeapSize.
+ *        Stack high-water marks are not exposed by WAMR's public API, so the
+ *        stack sizes are carried over.
+ *
+ * @param curr          The sizes used by the observed instance.
+ * @param usage         The memory usage observed.
+ * @param marginPercent The safety margin, in percentage of the observed peak.
+ * @return The suggested sizes.
+ */
+inline InstanceSizing AutoSizeInstance(
+	const InstanceSizing& curr,
+	const InstanceMemUsage& usage,
+	uint32_t marginPercent
+)
+{
+	InstanceSizing res = curr;
+
+	res.initLinearMemSize =
+		Internal::AddSizeMargin(usage.linearMemSize, marginPercent);
+
+	uint32_t appHeapSize =
+		Internal::AddSizeMargin(usage.appHeapPeak, marginPercent);
+	if (appHeapSize < Internal::sk_minAutoAppHeapSize)
+	{
+		appHeapSize = Internal::sk_minAutoAppHeapSize;
+	}
+	if (appHeapSize < res.modHeapSize)
+	{
+		res.modHeapSize = appHeapSize;
+	}
+
+	return res;
+}
+
+
+} // namespace DecentWasmRuntime
@@ -0,0 +1,96 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstddef>
+
+#include "Internal/PoolBuffer.hpp"
+
+
+namespace DecentWasmRuntime
+{
+
+
+/**
+ * @brief Options on how the memory pool is allocated and warmed up.
+ *
+ */
+struct PoolOptions
+{
+	/**
+	 * @brief Touch every page of the pool once at initialization.
+	 */
+	bool prefault = false;
+
+	/**
+	 * @brief Map the pool with `MAP_POPULATE` (untrusted build only).
+	 */
+	bool populate = false;
+
+	/**
+	 * @brief Advise transparent huge pages for the pool
+	 *        (untrusted build only).
+	 */
+	bool hugePageHint = false;
+}; // struct PoolOptions
+
+
+/**
+ * @brief The default pool allocation policy, which uses regular pages,
+ *        unless it's asked to map the pool by the options.
+ *
+ */
+struct DefaultPoolAllocator
+{
+	static Internal::PoolBuffer Allocate(size_t size, const PoolOptions& opts)
+	{
+		return Internal::PoolBuffer::Allocate(
+			size,
+			opts.populate,
+			opts.hugePageHint
+		);
+	}
+}; // struct DefaultPoolAllocator
+
+
+/**
+ * @brief A pool allocation policy that backs the pool with huge pages, to
+ *        reduce dTLB misses of kernels walking through large linear memory.
+ *
+ *        NOTE: WAMR only allocates linear memory from the pool when hardware
+ *        bounds checks are disabled (`WAMR_DISABLE_HW_BOUND_CHECK`). With
+ *        them (WAMR's default on 64-bit Linux, see
+ *        `DECENT_WASM_HW_BOUND_CHECK`), each linear memory is mapped on its
+ *        own, outside the pool, and this policy only covers the modules,
+ *        the instances' metadata, and the stacks; see
+ *        `WasmModule::SetHugePageLinearMem` for the linear memories.
+ *
+ *        It tries explicit huge pages (`MAP_HUGETLB`) first, then falls back
+ *        to a mapping advised for transparent huge pages, and eventually to
+ *        regular pages.
+ *        The trusted build doesn't control the page size, so it always gets
+ *        regular pages.
+ *
+ */
+struct HugePagePoolAllocator
+{
+	static Internal::PoolBuffer Allocate(size_t size, const PoolOptions& opts)
+	{
+		Internal::PoolBuffer buf =
+			Internal::PoolBuffer::AllocateHugeTlb(size, opts.populate);
+		if (buf.get() != nullptr)
+		{
+			return buf;
+		}
+
+		return Internal::PoolBuffer::Allocate(size, opts.populate, true);
+	}
+}; // struct HugePagePoolAllocator
+
+
+} // namespace DecentWasmRuntime
+
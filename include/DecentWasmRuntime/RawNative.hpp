@@ -0,0 +1,239 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <type_traits>
+
+#include <wasm_export.h>
+
+
+namespace DecentWasmRuntime
+{
+
+
+/**
+ * @brief A pointer argument of a raw native, i.e., an offset in the linear
+ *        memory of the calling module instance.
+ *        Unlike natives registered with signature strings, WAMR neither
+ *        validates nor converts the arguments of raw natives, so the buffer
+ *        must be checked with `ToNative` before it's accessed.
+ *
+ */
+struct AppPtr
+{
+	uint32_t offset;
+
+	/**
+	 * @brief Validate that `size` bytes at this offset are in the linear
+	 *        memory, and convert it to a native pointer.
+	 *
+	 * @return The native pointer, or nullptr (with an exception set on the
+	 *         module instance) if the buffer is out of bounds.
+	 */
+	void* ToNative(wasm_exec_env_t execEnv, uint32_t size) const noexcept
+	{
+		wasm_module_inst_t moduleInst = wasm_runtime_get_module_inst(execEnv);
+		if (!wasm_runtime_validate_app_addr(moduleInst, offset, size))
+		{
+			// the exception has been set by WAMR
+			return nullptr;
+		}
+		return wasm_runtime_addr_app_to_native(moduleInst, offset);
+	}
+}; // struct AppPtr
+
+
+/**
+ * @brief How a type is passed to, or returned from, a raw native; each
+ *        argument takes one 64-bit slot of the argument array, and the
+ *        return value is written to the first slot.
+ *
+ */
+template<typename _T, char _SigChar>
+struct RawNativeTypeImpl
+{
+	static constexpr char sk_sigChar = _SigChar;
+
+	static _T Read(const uint64_t* slot) noexcept
+	{
+		_T val;
+		std::memcpy(&val, slot, sizeof(_T));
+		return val;
+	}
+
+	static void Write(uint64_t* slot, const _T& val) noexcept
+	{
+		std::memcpy(slot, &val, sizeof(_T));
+	}
+}; // struct RawNativeTypeImpl
+
+
+template<typename _T>
+struct RawNativeType;
+
+template<>
+struct RawNativeType<int32_t> : RawNativeTypeImpl<int32_t, 'i'> {};
+
+template<>
+struct RawNativeType<uint32_t> : RawNativeTypeImpl<uint32_t, 'i'> {};
+
+template<>
+struct RawNativeType<int64_t> : RawNativeTypeImpl<int64_t, 'I'> {};
+
+template<>
+struct RawNativeType<uint64_t> : RawNativeTypeImpl<uint64_t, 'I'> {};
+
+template<>
+struct RawNativeType<float> : RawNativeTypeImpl<float, 'f'> {};
+
+template<>
+struct RawNativeType<double> : RawNativeTypeImpl<double, 'F'> {};
+
+template<>
+struct RawNativeType<AppPtr> : RawNativeTypeImpl<AppPtr, 'i'> {};
+
+
+namespace Internal
+{
+
+
+template<size_t... _Idx>
+struct IndexSeq {};
+
+
+template<size_t _N, size_t... _Idx>
+struct MakeIndexSeq : MakeIndexSeq<_N - 1, _N - 1, _Idx...> {};
+
+
+template<size_t... _Idx>
+struct MakeIndexSeq<0, _Idx...>
+{
+	using type = IndexSeq<_Idx...>;
+};
+
+
+template<typename _Ret, typename... _Args>
+struct RawNativeSignature
+{
+	static constexpr char sk_value[] = {
+		'(', RawNativeType<_Args>::sk_sigChar..., ')',
+		RawNativeType<_Ret>::sk_sigChar,
+		'\0'
+	};
+}; // struct RawNativeSignature
+
+template<typename _Ret, typename... _Args>
+constexpr char RawNativeSignature<_Ret, _Args...>::sk_value[];
+
+
+template<typename... _Args>
+struct RawNativeSignature<void, _Args...>
+{
+	static constexpr char sk_value[] = {
+		'(', RawNativeType<_Args>::sk_sigChar..., ')',
+		'\0'
+	};
+}; // struct RawNativeSignature<void, _Args...>
+
+template<typename... _Args>
+constexpr char RawNativeSignature<void, _Args...>::sk_value[];
+
+
+} // namespace Internal
+
+
+/**
+ * @brief Generates, at compile time, the raw native wrapper of a native
+ *        function `_Ret func(wasm_exec_env_t, _Args...)`, which unpacks the
+ *        arguments from the raw argument array and calls the function
+ *        directly, without WAMR marshalling them by the signature string.
+ *        Supported argument and return types are 32/64-bit integers, float,
+ *        double, and `AppPtr`.
+ *
+ *        The native must be registered with `wasm_runtime_register_natives_raw`,
+ *        see `MakeRawNativeSymbol`.
+ *
+ */
+template<typename _FuncType, _FuncType _func>
+struct RawNative;
+
+
+template<
+	typename _Ret,
+	typename... _Args,
+	_Ret (*_func)(wasm_exec_env_t, _Args...)
+>
+struct RawNative<_Ret (*)(wasm_exec_env_t, _Args...), _func>
+{
+	using IndexSeqType = typename Internal::MakeIndexSeq<sizeof...(_Args)>::type;
+
+	static const char* GetSignature() noexcept
+	{
+		return Internal::RawNativeSignature<_Ret, _Args...>::sk_value;
+	}
+
+	static void Invoke(wasm_exec_env_t execEnv, uint64_t* args)
+	{
+		Call(execEnv, args, IndexSeqType(), std::is_void<_Ret>());
+	}
+
+private:
+
+	template<size_t... _Idx>
+	static void Call(
+		wasm_exec_env_t execEnv,
+		uint64_t* args,
+		Internal::IndexSeq<_Idx...>,
+		std::false_type
+	)
+	{
+		_Ret ret = _func(execEnv, RawNativeType<_Args>::Read(args + _Idx)...);
+		RawNativeType<_Ret>::Write(args, ret);
+	}
+
+	template<size_t... _Idx>
+	static void Call(
+		wasm_exec_env_t execEnv,
+		uint64_t* args,
+		Internal::IndexSeq<_Idx...>,
+		std::true_type
+	)
+	{
+		(void)args;
+		_func(execEnv, RawNativeType<_Args>::Read(args + _Idx)...);
+	}
+}; // struct RawNative
+
+
+template<typename _FuncType, _FuncType _func>
+inline NativeSymbol MakeRawNativeSymbol(const char* name) noexcept
+{
+	using RawNativeType = RawNative<_FuncType, _func>;
+
+	NativeSymbol sym;
+	sym.symbol = name;
+	sym.func_ptr = reinterpret_cast<void*>(&RawNativeType::Invoke);
+	sym.signature = RawNativeType::GetSignature();
+	sym.attachment = nullptr;
+	return sym;
+}
+
+
+} // namespace DecentWasmRuntime
+
+
+/**
+ * @brief The `NativeSymbol` of the raw native wrapping `func`, to be
+ *        registered with `wasm_runtime_register_natives_raw`.
+ */
+#define DECENTWASMRUNTIME_RAW_NATIVE(name, func) \
+	DecentWasmRuntime::MakeRawNativeSymbol<decltype(&func), &func>(name)
+
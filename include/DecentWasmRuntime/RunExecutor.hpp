@@ -0,0 +1,471 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#ifndef DECENT_ENCLAVE_PLATFORM_SGX_TRUSTED
+#include <chrono>
+#include <thread>
+#endif // !DECENT_ENCLAVE_PLATFORM_SGX_TRUSTED
+
+#include <wasm_export.h>
+
+#include "Exception.hpp"
+#include "ThreadEnvGuard.hpp"
+
+
+namespace DecentWasmRuntime
+{
+
+
+/**
+ * @brief The result of a run submitted to a RunExecutor.
+ *
+ */
+struct RunResult
+{
+	int32_t retVal = 0;
+	// the instruction counter at the end of an instrumented run;
+	// 0 for a plain run
+	uint64_t counter = 0;
+
+	uint64_t submitUs = 0;
+	uint64_t startUs = 0;
+	uint64_t endUs = 0;
+
+	uint64_t GetQueueUs() const noexcept
+	{
+		return startUs - submitUs;
+	}
+
+	uint64_t GetRunUs() const noexcept
+	{
+		return endUs - startUs;
+	}
+}; // struct RunResult
+
+
+/**
+ * @brief A run to be submitted to a RunExecutor.
+ *
+ */
+struct RunJob
+{
+	// runs the program on a worker thread, and fills in the result
+	std::function<void(RunResult&)> run;
+	// terminates the program while it's running; called from another thread;
+	// empty if the program can't be terminated, so it can only be cancelled
+	// while it's queued
+	std::function<void()> terminate;
+	// clears the exception left by terminate, so the instance can run again
+	std::function<void()> clearTermination;
+}; // struct RunJob
+
+
+class RunExecutor;
+
+
+/**
+ * @brief The future result of a run submitted to a RunExecutor.
+ *
+ */
+class RunFuture
+{
+public:
+
+	RunFuture() :
+		m_state()
+	{}
+
+	bool IsValid() const noexcept
+	{
+		return m_state != nullptr;
+	}
+
+	bool IsReady() const
+	{
+		std::lock_guard<std::mutex> lock(GetState().mutex);
+		return m_state->status == Status::Done;
+	}
+
+	void Wait() const
+	{
+		State& state = GetState();
+		std::unique_lock<std::mutex> lock(state.mutex);
+		state.cond.wait(lock, [&state]() {
+			return state.status == Status::Done;
+		});
+	}
+
+#ifndef DECENT_ENCLAVE_PLATFORM_SGX_TRUSTED
+	/**
+	 * @return true if the run is done.
+	 */
+	bool WaitFor(uint64_t timeoutUs) const
+	{
+		State& state = GetState();
+		std::unique_lock<std::mutex> lock(state.mutex);
+		return state.cond.wait_for(
+			lock,
+			std::chrono::microseconds(timeoutUs),
+			[&state]() {
+				return state.status == Status::Done;
+			}
+		);
+	}
+#endif // !DECENT_ENCLAVE_PLATFORM_SGX_TRUSTED
+
+	/**
+	 * @brief Wait for the run, and get its result.
+	 *
+	 * @exception WasmCancelledException The run has been cancelled.
+	 * @exception ...                    Whatever the run has thrown.
+	 */
+	RunResult Get() const
+	{
+		Wait();
+		if (m_state->error != nullptr)
+		{
+			std::rethrow_exception(m_state->error);
+		}
+		return m_state->result;
+	}
+
+	/**
+	 * @brief Cancel the run: a queued run is dropped, and a running one is
+	 *        terminated (see Watchdog for when that takes effect).
+	 *
+	 * @return false if the run is already done, or if it's running and
+	 *         can't be terminated (see WasmModuleInstance::IsTerminable),
+	 *         in which case it runs to its end.
+	 */
+	bool Cancel()
+	{
+		State& state = GetState();
+		{
+			std::lock_guard<std::mutex> lock(state.mutex);
+			switch (state.status)
+			{
+			case Status::Queued:
+				// the executor skips it
+				state.status = Status::Done;
+				state.error = std::make_exception_ptr(
+					WasmCancelledException("The run was cancelled before it started")
+				);
+				break;
+			case Status::Running:
+				if (!state.job.terminate)
+				{
+					return false;
+				}
+				if (!state.cancelled)
+				{
+					state.cancelled = true;
+					state.job.terminate();
+				}
+				return true;
+			case Status::Done:
+			default:
+				return false;
+			}
+		}
+		state.cond.notify_all();
+		return true;
+	}
+
+private:
+
+	friend class RunExecutor;
+
+	enum class Status
+	{
+		Queued,
+		Running,
+		Done,
+	}; // enum class Status
+
+	struct State
+	{
+		explicit State(RunJob j) :
+			mutex(),
+			cond(),
+			job(std::move(j)),
+			status(Status::Queued),
+			cancelled(false),
+			result(),
+			error()
+		{}
+
+		std::mutex mutex;
+		std::condition_variable cond;
+		RunJob job;
+		Status status;
+		// set once terminate is called on the running job
+		bool cancelled;
+		RunResult result;
+		std::exception_ptr error;
+	}; // struct State
+
+	explicit RunFuture(std::shared_ptr<State> state) :
+		m_state(std::move(state))
+	{}
+
+	State& GetState() const
+	{
+		if (m_state == nullptr)
+		{
+			throw Exception("The run future is not valid");
+		}
+		return *m_state;
+	}
+
+	std::shared_ptr<State> m_state;
+}; // class RunFuture
+
+
+/**
+ * @brief Runs submitted jobs on worker threads, so one thread can keep many
+ *        runs in flight, and do other work (e.g., read the next events)
+ *        while they run.
+ *
+ *        On the untrusted side, Start creates worker threads owned by the
+ *        executor. In the enclave, threads can only be created by the host,
+ *        so host threads ecall into Work instead. Each worker sets up its
+ *        WAMR thread env, if it hasn't been.
+ *
+ *        The executor only orders jobs (first come, first served); a job
+ *        must not be submitted while another job using the same instance is
+ *        in flight (see MainRunner::RunPlainAsync).
+ *
+ */
+class RunExecutor
+{
+public:
+
+	RunExecutor() :
+		m_mutex(),
+		m_cond(),
+		m_queue(),
+		m_numRunning(0),
+		m_closed(false)
+#ifndef DECENT_ENCLAVE_PLATFORM_SGX_TRUSTED
+		,
+		m_threads()
+#endif // !DECENT_ENCLAVE_PLATFORM_SGX_TRUSTED
+	{}
+
+	RunExecutor(const RunExecutor&) = delete;
+
+	RunExecutor& operator=(const RunExecutor&) = delete;
+
+	~RunExecutor() noexcept
+	{
+		Shutdown();
+	}
+
+	RunFuture Submit(RunJob job)
+	{
+		std::shared_ptr<RunFuture::State> state =
+			std::make_shared<RunFuture::State>(std::move(job));
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_closed)
+			{
+				throw Exception("The run executor has been shut down");
+			}
+			m_queue.push_back(state);
+		}
+		m_cond.notify_one();
+		return RunFuture(std::move(state));
+	}
+
+	/**
+	 * @brief Run jobs on the calling thread until Shutdown is called.
+	 *
+	 * @return false if the thread env can't be set up.
+	 */
+	bool Work()
+	{
+		// WAMR needs every thread running WASM code to set up its own env
+		ThreadEnvGuard threadEnv;
+		if (!threadEnv.IsInited())
+		{
+			return false;
+		}
+
+		std::shared_ptr<RunFuture::State> state;
+		while (Take(state))
+		{
+			Execute(state);
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				--m_numRunning;
+			}
+			// Shutdown may be waiting for it
+			m_cond.notify_all();
+		}
+
+		return true;
+	}
+
+#ifndef DECENT_ENCLAVE_PLATFORM_SGX_TRUSTED
+	/**
+	 * @brief Start worker threads owned by the executor, which run until
+	 *        Shutdown is called.
+	 *
+	 */
+	void Start(size_t numThreads)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (size_t i = 0; i < numThreads; ++i)
+		{
+			m_threads.emplace_back([this]() {
+				// if its thread env can't be set up, the other workers take
+				// the jobs
+				Work();
+			});
+		}
+	}
+#endif // !DECENT_ENCLAVE_PLATFORM_SGX_TRUSTED
+
+	/**
+	 * @brief Stop taking jobs: the queued jobs are cancelled, and the
+	 *        running ones are waited for; then the workers return from Work,
+	 *        and the executor's own threads are joined. Must not be called by
+	 *        a worker.
+	 *
+	 */
+	void Shutdown() noexcept
+	{
+		std::deque<std::shared_ptr<RunFuture::State> > queued;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_closed = true;
+			queued.swap(m_queue);
+		}
+		m_cond.notify_all();
+
+		for (auto& state : queued)
+		{
+			RunFuture(std::move(state)).Cancel();
+		}
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cond.wait(lock, [this]() {
+				return m_numRunning == 0;
+			});
+		}
+
+#ifndef DECENT_ENCLAVE_PLATFORM_SGX_TRUSTED
+		std::vector<std::thread> threads;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			threads.swap(m_threads);
+		}
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+#endif // !DECENT_ENCLAVE_PLATFORM_SGX_TRUSTED
+	}
+
+	size_t GetNumQueued() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_queue.size();
+	}
+
+private:
+
+	using Status = RunFuture::Status;
+
+	bool Take(std::shared_ptr<RunFuture::State>& state)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (true)
+		{
+			m_cond.wait(lock, [this]() {
+				return !m_queue.empty() || m_closed;
+			});
+			if (m_queue.empty())
+			{
+				return false;
+			}
+
+			state = std::move(m_queue.front());
+			m_queue.pop_front();
+
+			std::lock_guard<std::mutex> stateLock(state->mutex);
+			if (state->status == Status::Queued)
+			{
+				state->status = Status::Running;
+				++m_numRunning;
+				return true;
+			}
+			// cancelled while it was queued
+		}
+	}
+
+	static void Execute(std::shared_ptr<RunFuture::State>& state)
+	{
+		RunResult result;
+		std::exception_ptr error;
+		try
+		{
+			state->job.run(result);
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(state->mutex);
+			if (state->cancelled)
+			{
+				// so that the instance can run again; if the run has
+				// returned before it was terminated, its result is kept
+				if (state->job.clearTermination)
+				{
+					state->job.clearTermination();
+				}
+				if (error != nullptr)
+				{
+					error = std::make_exception_ptr(
+						WasmCancelledException("The run was cancelled while running")
+					);
+				}
+			}
+			state->result = result;
+			state->error = error;
+			state->status = Status::Done;
+		}
+		state->cond.notify_all();
+	}
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::deque<std::shared_ptr<RunFuture::State> > m_queue;
+	size_t m_numRunning;
+	bool m_closed;
+#ifndef DECENT_ENCLAVE_PLATFORM_SGX_TRUSTED
+	std::vector<std::thread> m_threads;
+#endif // !DECENT_ENCLAVE_PLATFORM_SGX_TRUSTED
+}; // class RunExecutor
+
+
+} // namespace DecentWasmRuntime
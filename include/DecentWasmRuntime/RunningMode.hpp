@@ -0,0 +1,72 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <string>
+
+#include <wasm_export.h>
+
+#include "Exception.hpp"
+
+
+namespace DecentWasmRuntime
+{
+
+
+/**
+ * @brief Get the name of a running mode, as it's printed in the benchmark
+ *        output and accepted by `ParseRunningMode`.
+ *
+ */
+inline const char* GetRunningModeName(RunningMode mode) noexcept
+{
+	switch (mode)
+	{
+	case Mode_Interp:
+		return "interp";
+	case Mode_Fast_JIT:
+		return "fast-jit";
+	case Mode_LLVM_JIT:
+		return "llvm-jit";
+	case Mode_Multi_Tier_JIT:
+		return "multi-tier-jit";
+	default:
+		return "unknown";
+	}
+}
+
+
+inline RunningMode ParseRunningMode(const std::string& name)
+{
+	if (name == "interp")
+	{
+		return Mode_Interp;
+	}
+	else if (name == "fast-jit")
+	{
+		return Mode_Fast_JIT;
+	}
+	else if (name == "llvm-jit")
+	{
+		return Mode_LLVM_JIT;
+	}
+	else if (name == "multi-tier-jit")
+	{
+		return Mode_Multi_Tier_JIT;
+	}
+	throw Exception("Unknown running mode " + name);
+}
+
+
+inline bool IsRunningModeSupported(RunningMode mode) noexcept
+{
+	return wasm_runtime_is_running_mode_supported(mode);
+}
+
+
+} // namespace DecentWasmRuntime
+
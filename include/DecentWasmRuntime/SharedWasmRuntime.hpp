@@ -11,6 +11,7 @@
 #include <memory>
 
 #include "Internal/make_unique.hpp"
+#include "RunningMode.hpp"
 #include "WasmRuntime.hpp"
 #include "SharedWasmModule.hpp"
 
@@ -38,6 +39,47 @@ public:
 		);
 	}
 
+	/**
+	 * @brief Load a module from the given buffer, which is moved into the
+	 *        module instead of copied.
+	 *
+	 */
+	SharedWasmModule LoadModule(std::vector<uint8_t>&& bytecode)
+	{
+		WasmModule mod = WasmModule::Load(get(), std::move(bytecode));
+		return SharedWasmModule(
+			Internal::make_unique<WasmModule>(std::move(mod))
+		);
+	}
+
+	/**
+	 * @brief Load a module from the given buffer without copying it;
+	 *        see WasmModule::LoadInPlace for the requirements on the buffer.
+	 *
+	 */
+	SharedWasmModule LoadModuleInPlace(uint8_t* buf, size_t size)
+	{
+		WasmModule mod = WasmModule::LoadInPlace(get(), buf, size);
+		return SharedWasmModule(
+			Internal::make_unique<WasmModule>(std::move(mod))
+		);
+	}
+
+	/**
+	 * @brief Load a module whose instances run in the given running mode,
+	 *        regardless of the runtime's default.
+	 *
+	 */
+	SharedWasmModule LoadModule(
+		const std::vector<uint8_t>& bytecode,
+		RunningMode runningMode
+	)
+	{
+		SharedWasmModule mod = LoadModule(bytecode);
+		mod->SetRunningMode(runningMode);
+		return mod;
+	}
+
 }; // class SharedWasmRuntime
 
 
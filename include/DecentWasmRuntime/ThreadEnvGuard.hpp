@@ -0,0 +1,75 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <wasm_export.h>
+
+
+namespace DecentWasmRuntime
+{
+
+
+/**
+ * @brief Sets up the WAMR thread env of the calling thread, which every
+ *        thread running WASM code needs, and destroys it when the guard goes
+ *        out of scope (including by an exception).
+ *        An env that was set up before the guard is left alone.
+ *
+ */
+class ThreadEnvGuard
+{
+public:
+
+	ThreadEnvGuard() noexcept :
+		m_owned(false),
+		m_inited(wasm_runtime_thread_env_inited())
+	{
+		if (!m_inited)
+		{
+			m_inited = wasm_runtime_init_thread_env();
+			m_owned = m_inited;
+		}
+	}
+
+	/**
+	 * @brief Copy is prohibited.
+	 *
+	 */
+	ThreadEnvGuard(const ThreadEnvGuard&) = delete;
+
+	~ThreadEnvGuard()
+	{
+		if (m_owned)
+		{
+			wasm_runtime_destroy_thread_env();
+		}
+	}
+
+	/**
+	 * @brief Copy is prohibited.
+	 *
+	 */
+	ThreadEnvGuard& operator=(const ThreadEnvGuard&) = delete;
+
+	/**
+	 * @brief Check if the calling thread has a thread env.
+	 *
+	 * @return false if it couldn't be set up.
+	 */
+	bool IsInited() const noexcept
+	{
+		return m_inited;
+	}
+
+private:
+
+	bool m_owned;
+	bool m_inited;
+}; // class ThreadEnvGuard
+
+
+} // namespace DecentWasmRuntime
@@ -53,6 +53,9 @@ public: // static members
 		uint32_t stackSize
 	)
 	{
+		uint64_t poolUsedBefore =
+			moduleInst->GetRuntime().GetMemPoolUsage().usedSize;
+
 		wasm_exec_env_t ptr = wasm_runtime_create_exec_env(
 			moduleInst->get(),
 			stackSize
@@ -63,7 +66,15 @@ public: // static members
 			throw Exception("Failed to create execution environment");
 		}
 
-		return WasmExecEnv(ptr, moduleInst);
+		WasmExecEnv execEnv(ptr, moduleInst);
+		// only accurate if nothing else uses the pool meanwhile
+		// (see InstanceMemUsage::execEnvPoolSize)
+		uint64_t poolUsedAfter =
+			moduleInst->GetRuntime().GetMemPoolUsage().usedSize;
+		execEnv.m_poolSize = poolUsedAfter > poolUsedBefore ?
+			(poolUsedAfter - poolUsedBefore) : 0;
+
+		return execEnv;
 	}
 
 	static Self& FromUserData(pointer exec_env)
@@ -90,7 +101,8 @@ public:
 	) noexcept :
 		Base(ptr), // base constructor is noexcept
 		m_moduleInst(moduleInst), // shared_ptr copy is noexcept
-		m_userData()
+		m_userData(),
+		m_poolSize(0)
 	{
 		wasm_runtime_set_user_data(get(), this);
 	}
@@ -109,7 +121,8 @@ public:
 	WasmExecEnv(WasmExecEnv&& other) noexcept :
 		Base(std::move(other)), // base move is noexcept
 		m_moduleInst(std::move(other.m_moduleInst)), // shared_ptr move is noexcept
-		m_userData(std::move(other.m_userData))
+		m_userData(std::move(other.m_userData)),
+		m_poolSize(other.m_poolSize)
 	{
 		wasm_runtime_set_user_data(get(), this);
 	}
@@ -139,6 +152,7 @@ public:
 			// free the current object and then move the other object
 			m_moduleInst = std::move(other.m_moduleInst); // shared_ptr move is noexcept
 			m_userData = std::move(other.m_userData);
+			m_poolSize = other.m_poolSize;
 
 			wasm_runtime_set_user_data(get(), this);
 		}
@@ -211,10 +225,34 @@ public:
 		return *m_moduleInst;
 	}
 
+	/**
+	 * @brief Get the number of bytes taken from the memory pool when this
+	 *        execution environment was created.
+	 *
+	 */
+	uint64_t GetPoolSize() const noexcept
+	{
+		return m_poolSize;
+	}
+
+#ifdef DECENTWASMRUNTIME_MEMORY_PROFILING
+	/**
+	 * @brief Print the memory consumption of this execution environment and
+	 *        its module instance (incl. the stack high-water marks),
+	 *        via WAMR's print function.
+	 *
+	 */
+	void DumpMemConsumption()
+	{
+		wasm_runtime_dump_mem_consumption(get());
+	}
+#endif // DECENTWASMRUNTIME_MEMORY_PROFILING
+
 private:
 
 	std::shared_ptr<WasmModuleInstance> m_moduleInst;
 	std::unique_ptr<ExecEnvUserData> m_userData;
+	uint64_t m_poolSize;
 
 }; // class WasmExecEnv
 
@@ -10,6 +10,7 @@
 
 #include <cstdint>
 
+#include <limits>
 #include <memory>
 #include <vector>
 
@@ -17,6 +18,7 @@
 
 #include "Internal/make_unique.hpp"
 #include "Exception.hpp"
+#include "RunningMode.hpp"
 #include "WasmRuntime.hpp"
 
 
@@ -53,14 +55,102 @@ public: // static members
 		const std::vector<uint8_t>& wasm
 	)
 	{
-		char errorBuf[512];
-
 		std::unique_ptr<std::vector<uint8_t> > wasmCopy =
 			Internal::make_unique<std::vector<uint8_t> >(wasm);
 
+		uint8_t* buf = wasmCopy->data();
+		size_t size = wasmCopy->size();
+		return LoadBuffer(std::move(runtime), buf, size, std::move(wasmCopy));
+	}
+
+	/**
+	 * @brief Load a module from the given buffer, which is taken over by
+	 *        the module, instead of copied.
+	 *
+	 */
+	static WasmModule Load(
+		std::shared_ptr<WasmRuntime> runtime,
+		std::vector<uint8_t>&& wasm
+	)
+	{
+		std::unique_ptr<std::vector<uint8_t> > wasmOwned =
+			Internal::make_unique<std::vector<uint8_t> >(std::move(wasm));
+
+		uint8_t* buf = wasmOwned->data();
+		size_t size = wasmOwned->size();
+		return LoadBuffer(std::move(runtime), buf, size, std::move(wasmOwned));
+	}
+
+	/**
+	 * @brief Load a module directly from the given buffer, without copying
+	 *        it, e.g., for modules embedded in the binary.
+	 *        NOTE: WAMR keeps referring to the buffer after loading, and may
+	 *        modify its content, so the buffer must be writable and must
+	 *        outlive the module; it also shouldn't be loaded by two modules
+	 *        at the same time.
+	 *
+	 * @param runtime The runtime.
+	 * @param buf     The buffer holding the WASM bytecode or AOT blob.
+	 * @param size    Size of the buffer.
+	 * @return The loaded module.
+	 */
+	static WasmModule LoadInPlace(
+		std::shared_ptr<WasmRuntime> runtime,
+		uint8_t* buf,
+		size_t size
+	)
+	{
+		return LoadBuffer(std::move(runtime), buf, size, nullptr);
+	}
+
+	/**
+	 * @brief Get the package type of a module by its magic number.
+	 *
+	 * @param wasm The content of the module.
+	 * @return `Wasm_Module_Bytecode`, `Wasm_Module_AoT`, or
+	 *         `Package_Type_Unknown`.
+	 */
+	static package_type_t GetPackageType(const uint8_t* wasm, size_t size)
+	{
+		if (size > std::numeric_limits<uint32_t>::max())
+		{
+			return Package_Type_Unknown;
+		}
+		return get_package_type(wasm, static_cast<uint32_t>(size));
+	}
+
+	static package_type_t GetPackageType(const std::vector<uint8_t>& wasm)
+	{
+		return GetPackageType(wasm.data(), wasm.size());
+	}
+
+	static bool IsAot(const std::vector<uint8_t>& wasm)
+	{
+		return GetPackageType(wasm) == Wasm_Module_AoT;
+	}
+
+private:
+
+	static WasmModule LoadBuffer(
+		std::shared_ptr<WasmRuntime> runtime,
+		uint8_t* buf,
+		size_t size,
+		std::unique_ptr<std::vector<uint8_t> > owner
+	)
+	{
+		char errorBuf[512];
+
+		// Both WASM bytecode and AOT blobs (compiled by wamrc) are accepted;
+		// WAMR tells them apart by their magic numbers as well
+		package_type_t pkgType = GetPackageType(buf, size);
+		if (pkgType == Package_Type_Unknown)
+		{
+			throw Exception("The given module is neither WASM bytecode nor AOT");
+		}
+
 		wasm_module_t ptr = wasm_runtime_load(
-			wasmCopy->data(),
-			wasmCopy->size(),
+			buf,
+			static_cast<uint32_t>(size),
 			errorBuf,
 			sizeof(errorBuf)
 		);
@@ -70,7 +160,9 @@ public: // static members
 			throw Exception(errorBuf);
 		}
 
-		return WasmModule(ptr, std::move(wasmCopy), runtime);
+		WasmModule res(ptr, std::move(owner), std::move(runtime));
+		res.m_packageType = pkgType;
+		return res;
 	}
 
 public:
@@ -82,7 +174,13 @@ public:
 	) noexcept :
 		Base(ptr),
 		m_wasm(std::move(wasm)), // unique_ptr move is noexcept
-		m_runtime(std::move(runtime)) // shared_ptr move is noexcept
+		m_runtime(std::move(runtime)), // shared_ptr move is noexcept
+		m_packageType(Wasm_Module_Bytecode),
+		m_initLinearMemSize(0),
+		m_prefaultLinearMem(false),
+		m_hugePageLinearMem(false),
+		m_hasRunningMode(false),
+		m_runningMode(Mode_Interp)
 	{}
 
 	/**
@@ -99,7 +197,13 @@ public:
 	WasmModule(WasmModule&& other) noexcept :
 		Base(std::forward<Base>(other)), // base move is noexcept
 		m_wasm(std::move(other.m_wasm)), // unique_ptr move is noexcept
-		m_runtime(std::move(other.m_runtime)) // shared_ptr move is noexcept
+		m_runtime(std::move(other.m_runtime)), // shared_ptr move is noexcept
+		m_packageType(other.m_packageType),
+		m_initLinearMemSize(other.m_initLinearMemSize),
+		m_prefaultLinearMem(other.m_prefaultLinearMem),
+		m_hugePageLinearMem(other.m_hugePageLinearMem),
+		m_hasRunningMode(other.m_hasRunningMode),
+		m_runningMode(other.m_runningMode)
 	{}
 
 	virtual ~WasmModule()
@@ -124,13 +228,141 @@ public:
 		Base::operator=(std::forward<Base>(other));
 		m_wasm = std::move(other.m_wasm); // unique_ptr move is noexcept
 		m_runtime = std::move(other.m_runtime); // shared_ptr move is noexcept
+		m_packageType = other.m_packageType;
+		m_initLinearMemSize = other.m_initLinearMemSize;
+		m_prefaultLinearMem = other.m_prefaultLinearMem;
+		m_hugePageLinearMem = other.m_hugePageLinearMem;
+		m_hasRunningMode = other.m_hasRunningMode;
+		m_runningMode = other.m_runningMode;
 		return *this;
 	}
 
+	package_type_t GetPackageType() const noexcept
+	{
+		return m_packageType;
+	}
+
+	/**
+	 * @brief Check if this module is loaded from an AOT blob, i.e.,
+	 *        it runs precompiled native code regardless of the running mode.
+	 *
+	 */
+	bool IsAot() const noexcept
+	{
+		return m_packageType == Wasm_Module_AoT;
+	}
+
+	/**
+	 * @brief Set the size of linear memory, in bytes, that every instance
+	 *        of this module should have right after instantiation.
+	 *        Reserving it up front avoids the step-by-step `memory.grow`
+	 *        during the first runs.
+	 *
+	 * @param size The initial linear memory size in bytes;
+	 *             0 means to keep the size declared by the module.
+	 */
+	void SetInitLinearMemSize(uint32_t size) noexcept
+	{
+		m_initLinearMemSize = size;
+	}
+
+	uint32_t GetInitLinearMemSize() const noexcept
+	{
+		return m_initLinearMemSize;
+	}
+
+	/**
+	 * @brief Set whether every page of the linear memory should be touched
+	 *        right after instantiation, so that the page faults are paid
+	 *        before the first run rather than during it.
+	 *
+	 * @param prefault True to pre-fault the linear memory.
+	 */
+	void SetPrefaultLinearMem(bool prefault) noexcept
+	{
+		m_prefaultLinearMem = prefault;
+	}
+
+	bool GetPrefaultLinearMem() const noexcept
+	{
+		return m_prefaultLinearMem;
+	}
+
+	/**
+	 * @brief Set whether the linear memory of every instance should be
+	 *        advised for transparent huge pages, right after instantiation
+	 *        and whenever it's seen grown (see
+	 *        `WasmModuleInstance::AdviseHugePageLinearMem`).
+	 *        Unlike a huge-page pool, this also covers linear memories that
+	 *        WAMR maps on their own, i.e., with hardware bounds checks.
+	 *        It only has an effect on the untrusted side on Linux.
+	 *
+	 * @param hugePage True to advise huge pages for the linear memory.
+	 */
+	void SetHugePageLinearMem(bool hugePage) noexcept
+	{
+		m_hugePageLinearMem = hugePage;
+	}
+
+	bool GetHugePageLinearMem() const noexcept
+	{
+		return m_hugePageLinearMem;
+	}
+
+	/**
+	 * @brief Set the running mode (i.e., the execution tier) used by every
+	 *        new instance of this module, instead of the runtime's default.
+	 *        It has no effect on AOT modules.
+	 *
+	 * @param mode The running mode.
+	 */
+	void SetRunningMode(RunningMode mode)
+	{
+		if (!IsRunningModeSupported(mode))
+		{
+			throw Exception(
+				std::string("Running mode ") + GetRunningModeName(mode) +
+				" is not supported by this runtime"
+			);
+		}
+		m_hasRunningMode = true;
+		m_runningMode = mode;
+	}
+
+	/**
+	 * @brief Use the runtime's default running mode for new instances.
+	 *
+	 */
+	void ResetRunningMode() noexcept
+	{
+		m_hasRunningMode = false;
+	}
+
+	bool HasRunningMode() const noexcept
+	{
+		return m_hasRunningMode;
+	}
+
+	RunningMode GetRunningMode() const noexcept
+	{
+		return m_runningMode;
+	}
+
+	const WasmRuntime& GetRuntime() const noexcept
+	{
+		return *m_runtime;
+	}
+
 private:
 
 	std::unique_ptr<std::vector<uint8_t> > m_wasm;
 	std::shared_ptr<WasmRuntime> m_runtime;
+	package_type_t m_packageType;
+	uint32_t m_initLinearMemSize;
+	bool m_prefaultLinearMem;
+	bool m_hugePageLinearMem;
+	bool m_hasRunningMode;
+	RunningMode m_runningMode;
 
 }; // class WasmModule
 
@@ -13,9 +13,22 @@
 #include <wasm_export.h>
 
 #include "Exception.hpp"
+#include "Internal/PoolBuffer.hpp"
+#include "RunningMode.hpp"
 #include "WasmModule.hpp"
 
 
+extern "C" {
+
+// Not declared in wasm_export.h, but exported by iwasm
+extern bool wasm_runtime_enlarge_memory(
+	wasm_module_inst_t module_inst,
+	uint32_t inc_page_count
+);
+
+} // extern "C"
+
+
 namespace DecentWasmRuntime
 {
 
@@ -106,6 +119,36 @@ struct WasmModuleInstanceGlobalGetter<uint32_t>
 }; // struct WasmModuleInstanceGlobalGetter<uint32_t>
 
 
+/**
+ * @brief Statistics about the growth of an instance's linear memory.
+ *        WAMR does not notify the host on `memory.grow`, so growth done by
+ *        the module itself is observed by sampling the linear memory size
+ *        (see WasmModuleInstance::UpdateLinearMemStats), while growth
+ *        requested by the host is counted and timed directly.
+ */
+struct LinearMemStats
+{
+	/**
+	 * @brief Number of runs (and of growths requested by the host) after
+	 *        which the linear memory has been found grown; a run that grew
+	 *        it several times is counted once, since the individual
+	 *        `memory.grow` instructions are not observed.
+	 */
+	uint64_t numRunsGrown = 0;
+
+	/**
+	 * @brief Total number of bytes the linear memory has grown
+	 */
+	uint64_t bytesGrown = 0;
+
+	/**
+	 * @brief Time spent, in microseconds, on growing the linear memory
+	 *        on host's requests (e.g., reservation at instantiation)
+	 */
+	uint64_t growTimeUs = 0;
+}; // struct LinearMemStats
+
+
 struct WasmModuleDeinstantiate
 {
 	void operator()(wasm_module_inst_t ptr) noexcept
@@ -135,6 +178,8 @@ public: // static members
 	template<typename _ValType>
 	friend class InstMemPtrBase;
 
+	static constexpr uint32_t sk_wasmPageSize = 64 * 1024;
+
 	static  WasmModuleInstance Instantiate(
 		std::shared_ptr<WasmModule> module,
 		uint32_t stackSize,
@@ -143,6 +188,8 @@ public: // static members
 	{
 		char errorBuf[512];
 
+		uint64_t poolUsedBefore = module->GetRuntime().GetMemPoolUsage().usedSize;
+
 		wasm_module_inst_t ptr = wasm_runtime_instantiate(
 			module->get(),
 			stackSize,
@@ -156,7 +203,33 @@ public: // static members
 			throw Exception(errorBuf);
 		}
 
-		return WasmModuleInstance(ptr, module);
+		WasmModuleInstance inst(ptr, module);
+		// AOT modules always run the precompiled code
+		if (module->HasRunningMode() && !module->IsAot())
+		{
+			inst.SetRunningMode(module->GetRunningMode());
+		}
+		if (module->GetInitLinearMemSize() > 0)
+		{
+			inst.ReserveLinearMem(module->GetInitLinearMemSize());
+		}
+		// before pre-faulting, so the faults can already get huge pages
+		if (module->GetHugePageLinearMem())
+		{
+			inst.AdviseHugePageLinearMem();
+		}
+		if (module->GetPrefaultLinearMem())
+		{
+			inst.PrefaultLinearMem();
+		}
+
+		// only accurate if nothing else uses the pool meanwhile
+		// (see InstanceMemUsage::instPoolSize)
+		uint64_t poolUsedAfter = module->GetRuntime().GetMemPoolUsage().usedSize;
+		inst.m_poolSize = poolUsedAfter > poolUsedBefore ?
+			(poolUsedAfter - poolUsedBefore) : 0;
+
+		return inst;
 	}
 
 public:
@@ -166,7 +239,13 @@ public:
 		std::shared_ptr<WasmModule> module
 	) noexcept :
 		Base(ptr), // base constructor is noexcept
-		m_module(module) // shared_ptr copy is noexcept
+		m_module(module), // shared_ptr copy is noexcept
+		m_memStats(),
+		m_memSizeMark(GetLinearMemSize()),
+		m_poolSize(0),
+		m_appHeapUsed(0),
+		m_appHeapPeak(0),
+		m_prefaultTimeUs(0)
 	{}
 
 	/**
@@ -182,7 +261,13 @@ public:
 	 */
 	WasmModuleInstance(WasmModuleInstance&& other) noexcept :
 		Base(std::forward<Base>(other)), // base move is noexcept
-		m_module(std::move(other.m_module)) // shared_ptr move is noexcept
+		m_module(std::move(other.m_module)), // shared_ptr move is noexcept
+		m_memStats(other.m_memStats),
+		m_memSizeMark(other.m_memSizeMark),
+		m_poolSize(other.m_poolSize),
+		m_appHeapUsed(other.m_appHeapUsed),
+		m_appHeapPeak(other.m_appHeapPeak),
+		m_prefaultTimeUs(other.m_prefaultTimeUs)
 	{}
 
 	virtual ~WasmModuleInstance()
@@ -207,6 +292,12 @@ public:
 	{
 		Base::operator=(std::forward<Base>(other));
 		m_module = std::move(other.m_module);
+		m_memStats = other.m_memStats;
+		m_memSizeMark = other.m_memSizeMark;
+		m_poolSize = other.m_poolSize;
+		m_appHeapUsed = other.m_appHeapUsed;
+		m_appHeapPeak = other.m_appHeapPeak;
+		m_prefaultTimeUs = other.m_prefaultTimeUs;
 		return *this;
 	}
 
@@ -246,9 +337,247 @@ public:
 		return wasm_runtime_get_exception(ptr);
 	}
 
+	void ClearException() noexcept
+	{
+		wasm_runtime_clear_exception(get());
+	}
+
+	/**
+	 * @brief Check if a run on this instance can be terminated by
+	 *        `Terminate`, which needs WAMR's thread manager
+	 *        (`DECENTWASMRUNTIME_TERMINATION`), and, for AOT modules, the
+	 *        artifacts compiled by wamrc with `--enable-multi-thread`
+	 *        (`DECENTWASMRUNTIME_AOT_TERMINATION`); otherwise the run just
+	 *        goes on to its end.
+	 *
+	 */
+	bool IsTerminable() const noexcept
+	{
+#if !defined(DECENTWASMRUNTIME_TERMINATION)
+		return false;
+#elif !defined(DECENTWASMRUNTIME_AOT_TERMINATION)
+		return !m_module->IsAot();
+#else
+		return true;
+#endif
+	}
+
+	/**
+	 * @brief Terminate the program running on this instance; may be called
+	 *        from any thread (see Watchdog). It has no effect unless
+	 *        `IsTerminable()`.
+	 *
+	 */
+	void Terminate() noexcept
+	{
+		wasm_runtime_terminate(get());
+	}
+
+	/**
+	 * @brief Switch the running mode of this instance.
+	 *
+	 * @param mode The running mode.
+	 */
+	void SetRunningMode(RunningMode mode)
+	{
+		if (!wasm_runtime_set_running_mode(get(), mode))
+		{
+			throw Exception(
+				std::string("Failed to set running mode to ") +
+				GetRunningModeName(mode)
+			);
+		}
+	}
+
+	/**
+	 * @brief Get the running mode actually used by this instance.
+	 *
+	 */
+	RunningMode GetRunningMode() const noexcept
+	{
+		pointer ptr = const_cast<pointer>(get());
+		return wasm_runtime_get_running_mode(ptr);
+	}
+
+	/**
+	 * @brief Get the current size of the default linear memory.
+	 *
+	 * @return The size in bytes, or 0 if the instance has no linear memory.
+	 */
+	uint32_t GetLinearMemSize() const noexcept
+	{
+		pointer ptr = const_cast<pointer>(get());
+		uint32_t startOffset = 0;
+		uint32_t endOffset = 0;
+		if (!wasm_runtime_get_app_addr_range(ptr, 0, &startOffset, &endOffset))
+		{
+			return 0;
+		}
+		return endOffset;
+	}
+
+	/**
+	 * @brief Grow the linear memory by the given number of WASM pages,
+	 *        the same way as the `memory.grow` instruction does.
+	 *
+	 * @param incPages Number of 64 KiB pages to grow.
+	 */
+	void EnlargeLinearMem(uint32_t incPages)
+	{
+		UpdateLinearMemStats();
+
+		uint64_t startUs = m_module->GetRuntime().GetTimestampUs();
+		bool res = wasm_runtime_enlarge_memory(get(), incPages);
+		uint64_t endUs = m_module->GetRuntime().GetTimestampUs();
+
+		if (!res)
+		{
+			throw Exception("Failed to enlarge the linear memory");
+		}
+
+		m_memStats.growTimeUs += endUs - startUs;
+		UpdateLinearMemStats();
+	}
+
+	/**
+	 * @brief Make sure the linear memory is at least the given size.
+	 *
+	 * @param size The minimum size of linear memory, in bytes.
+	 */
+	void ReserveLinearMem(uint32_t size)
+	{
+		uint32_t currSize = GetLinearMemSize();
+		if (size > currSize)
+		{
+			uint32_t incSize = size - currSize;
+			EnlargeLinearMem((incSize + (sk_wasmPageSize - 1)) / sk_wasmPageSize);
+		}
+	}
+
+	/**
+	 * @brief Touch every page of the current linear memory once, so that
+	 *        the page faults (and EPC page-ins, in the enclave) are paid
+	 *        now rather than during the first runs.
+	 *        The time spent is accumulated in `GetPrefaultTimeUs()`.
+	 *
+	 */
+	void PrefaultLinearMem()
+	{
+		uint32_t size = GetLinearMemSize();
+		if (size == 0)
+		{
+			return;
+		}
+
+		uint8_t* ptr = static_cast<uint8_t*>(
+			wasm_runtime_addr_app_to_native(get(), 0)
+		);
+		if (ptr == nullptr)
+		{
+			throw Exception("Failed to get the native address of linear memory");
+		}
+
+		uint64_t startUs = m_module->GetRuntime().GetTimestampUs();
+		Internal::PrefaultPages(ptr, size);
+		m_prefaultTimeUs += m_module->GetRuntime().GetTimestampUs() - startUs;
+	}
+
+	uint64_t GetPrefaultTimeUs() const noexcept
+	{
+		return m_prefaultTimeUs;
+	}
+
+	/**
+	 * @brief Advise the current linear memory for transparent huge pages.
+	 *        Memory grown afterwards is advised when the growth is seen by
+	 *        `UpdateLinearMemStats`, so pages the module touches within the
+	 *        run that grows it may still get regular pages at first.
+	 *
+	 * @return False if the advice is not taken (e.g., in the enclave).
+	 */
+	bool AdviseHugePageLinearMem() noexcept
+	{
+		uint32_t size = GetLinearMemSize();
+		if (size == 0)
+		{
+			return false;
+		}
+
+		uint8_t* ptr = static_cast<uint8_t*>(
+			wasm_runtime_addr_app_to_native(get(), 0)
+		);
+		return (ptr != nullptr) && Internal::AdviseHugePages(ptr, size);
+	}
+
+	/**
+	 * @brief Check the linear memory size against the last one observed,
+	 *        and account any growth into the linear memory statistics.
+	 *        This should be called after each execution in the instance.
+	 */
+	void UpdateLinearMemStats() noexcept
+	{
+		uint32_t currSize = GetLinearMemSize();
+		if (currSize > m_memSizeMark)
+		{
+			++m_memStats.numRunsGrown;
+			m_memStats.bytesGrown += currSize - m_memSizeMark;
+			if (m_module->GetHugePageLinearMem())
+			{
+				AdviseHugePageLinearMem();
+			}
+		}
+		m_memSizeMark = currSize;
+	}
+
+	const LinearMemStats& GetLinearMemStats() const noexcept
+	{
+		return m_memStats;
+	}
+
+	/**
+	 * @brief Get the memory usage of this instance.
+	 *        NOTE: the execution environment part is not filled in here,
+	 *        since it's owned by WasmExecEnv.
+	 *
+	 * @return The memory usage of this instance.
+	 */
+	InstanceMemUsage GetMemUsage() const noexcept
+	{
+		InstanceMemUsage res;
+		res.instPoolSize = m_poolSize;
+		res.linearMemSize = GetLinearMemSize();
+		res.appHeapPeak = m_appHeapPeak;
+		return res;
+	}
+
+	const WasmRuntime& GetRuntime() const noexcept
+	{
+		return m_module->GetRuntime();
+	}
+
 private:
 
+	void OnAppHeapAlloc(uint64_t size) noexcept
+	{
+		m_appHeapUsed += size;
+		if (m_appHeapUsed > m_appHeapPeak)
+		{
+			m_appHeapPeak = m_appHeapUsed;
+		}
+	}
+
+	void OnAppHeapFree(uint64_t size) noexcept
+	{
+		m_appHeapUsed -= size;
+	}
+
 	std::shared_ptr<WasmModule> m_module;
+	LinearMemStats m_memStats;
+	uint32_t m_memSizeMark;
+	uint64_t m_poolSize;
+	uint64_t m_appHeapUsed;
+	uint64_t m_appHeapPeak;
+	uint64_t m_prefaultTimeUs;
 
 }; // class WasmModuleInstance
 
@@ -6,7 +6,18 @@
 #pragma once
 
 
+#include <cstdint>
+
+#include <wasm_export.h>
+
+#include "Exception.hpp"
+#include "MemUsage.hpp"
+#include "RunExecutor.hpp"
+#include "RunningMode.hpp"
+
+
 typedef void (*os_print_function_t)(const char *message);
+typedef uint64_t (*os_timestamp_function_t)(void);
 
 
 namespace DecentWasmRuntime
@@ -17,8 +28,13 @@ class WasmRuntime
 {
 public:
 
-	WasmRuntime(os_print_function_t printFunc) :
-		m_printFunc(printFunc)
+	WasmRuntime(
+		os_print_function_t printFunc,
+		os_timestamp_function_t timestampFunc = nullptr
+	) :
+		m_printFunc(printFunc),
+		m_timestampFunc(timestampFunc),
+		m_executor()
 	{}
 
 	WasmRuntime(const WasmRuntime&) = delete;
@@ -26,7 +42,9 @@ public:
 	WasmRuntime(WasmRuntime&&) = delete;
 
 	virtual ~WasmRuntime() noexcept
-	{}
+	{
+		m_executor.Shutdown();
+	}
 
 	WasmRuntime& operator=(const WasmRuntime&) = delete;
 
@@ -37,9 +55,82 @@ public:
 		return m_printFunc;
 	}
 
+	/**
+	 * @brief Get the current timestamp, in microseconds, from the
+	 *        timestamp function given at construction.
+	 *
+	 * @return The current timestamp, or 0 if no timestamp function is given.
+	 */
+	uint64_t GetTimestampUs() const
+	{
+		return m_timestampFunc == nullptr ? 0 : m_timestampFunc();
+	}
+
+	/**
+	 * @brief Set the running mode used by the instances of modules that
+	 *        don't ask for a specific one (see WasmModule::SetRunningMode).
+	 *
+	 * @param mode The running mode.
+	 */
+	void SetDefaultRunningMode(RunningMode mode)
+	{
+		if (!wasm_runtime_set_default_running_mode(mode))
+		{
+			throw Exception(
+				std::string("Running mode ") + GetRunningModeName(mode) +
+				" is not supported by this runtime"
+			);
+		}
+	}
+
+	/**
+	 * @brief Get the usage of the memory pool used by WAMR.
+	 *
+	 * @return The pool usage, or all zeros if WAMR is not allocating
+	 *         memory from a pool.
+	 */
+	virtual MemPoolUsage GetMemPoolUsage() const
+	{
+		MemPoolUsage res;
+		mem_alloc_info_t info;
+		if (wasm_runtime_get_mem_alloc_info(&info))
+		{
+			res.totalSize = info.total_size;
+			res.usedSize = info.total_size - info.total_free_size;
+			res.peakSize = info.highmark_size;
+		}
+		return res;
+	}
+
+	/**
+	 * @brief Get the executor of the asynchronous runs of this runtime's
+	 *        instances (see MainRunner::RunPlainAsync); it has no workers
+	 *        until RunExecutor::Start is called, or threads call Work.
+	 *
+	 */
+	RunExecutor& GetExecutor() const noexcept
+	{
+		return m_executor;
+	}
+
+protected:
+
+	/**
+	 * @brief Must be called by the destructor of the derived class, before
+	 *        the WAMR runtime is destroyed, so no run is left in flight.
+	 *
+	 */
+	void ShutdownExecutor() noexcept
+	{
+		m_executor.Shutdown();
+	}
+
 private:
 
 	os_print_function_t m_printFunc;
+	os_timestamp_function_t m_timestampFunc;
+	// it's thread-safe, and used through const references to the runtime
+	mutable RunExecutor m_executor;
 }; // class WasmRuntime
 
 
@@ -8,12 +8,16 @@
 
 #include "WasmRuntime.hpp"
 
+#include <cstring>
+
 #include <memory>
 
 #include <wasm_export.h>
 
 #include "Exception.hpp"
 #include "Internal/make_unique.hpp"
+#include "Internal/PoolBuffer.hpp"
+#include "PoolAllocator.hpp"
 
 
 extern "C" {
@@ -29,23 +33,41 @@ namespace DecentWasmRuntime
 {
 
 
-class WasmRuntimeStaticHeap :
+/**
+ * @brief WASM runtime that allocates everything from a single memory pool.
+ *
+ * @tparam _PoolAllocator The policy allocating the pool buffer
+ *                        (see PoolAllocator.hpp).
+ */
+template<typename _PoolAllocator = DefaultPoolAllocator>
+class BasicWasmRuntimeStaticHeap :
 	public WasmRuntime
 {
 public:
 
 	using Base = WasmRuntime;
+	using PoolAllocator = _PoolAllocator;
 
 public:
 
-	WasmRuntimeStaticHeap(
+	BasicWasmRuntimeStaticHeap(
 		os_print_function_t pf,
-		uint32_t heapSize
+		uint32_t heapSize,
+		os_timestamp_function_t tf = nullptr,
+		const PoolOptions& poolOpts = PoolOptions()
 	) :
-		Base(pf),
+		Base(pf, tf),
 		m_heapSize(heapSize),
-		m_heap(Internal::make_unique<uint8_t[]>(heapSize))
+		m_heap(PoolAllocator::Allocate(heapSize, poolOpts)),
+		m_prefaultTimeUs(0)
 	{
+		if (poolOpts.prefault)
+		{
+			uint64_t startUs = GetTimestampUs();
+			Internal::PrefaultPages(m_heap.get(), m_heap.size());
+			m_prefaultTimeUs = GetTimestampUs() - startUs;
+		}
+
 		RuntimeInitArgs init_args;
 		std::memset(&init_args, 0, sizeof(RuntimeInitArgs));
 
@@ -64,27 +86,53 @@ public:
 		decent_wasm_reg_natives();
 	}
 
-	WasmRuntimeStaticHeap(const WasmRuntimeStaticHeap&) = delete;
+	BasicWasmRuntimeStaticHeap(const BasicWasmRuntimeStaticHeap&) = delete;
 
-	WasmRuntimeStaticHeap(WasmRuntimeStaticHeap&& other) = delete;
+	BasicWasmRuntimeStaticHeap(BasicWasmRuntimeStaticHeap&& other) = delete;
 
-	virtual ~WasmRuntimeStaticHeap() noexcept
+	virtual ~BasicWasmRuntimeStaticHeap() noexcept
 	{
+		ShutdownExecutor();
 		//wasm_runtime_memory_destroy();
 		wasm_runtime_destroy();
 		m_heap.reset();
 	}
 
-	WasmRuntimeStaticHeap& operator=(const WasmRuntimeStaticHeap&) = delete;
+	BasicWasmRuntimeStaticHeap& operator=(const BasicWasmRuntimeStaticHeap&) = delete;
 
-	WasmRuntimeStaticHeap& operator=(WasmRuntimeStaticHeap&&) = delete;
+	BasicWasmRuntimeStaticHeap& operator=(BasicWasmRuntimeStaticHeap&&) = delete;
+
+	/**
+	 * @brief Get the time spent, in microseconds, on pre-faulting the pool.
+	 *
+	 */
+	uint64_t GetPrefaultTimeUs() const noexcept
+	{
+		return m_prefaultTimeUs;
+	}
+
+	/**
+	 * @brief Get what kind of memory actually backs the pool,
+	 *        since the allocator may fall back to regular pages.
+	 *
+	 */
+	Internal::PoolBacking GetPoolBacking() const noexcept
+	{
+		return m_heap.backing();
+	}
 
 private:
 
 	uint32_t m_heapSize;
-	std::unique_ptr<uint8_t[]> m_heap;
+	Internal::PoolBuffer m_heap;
+	uint64_t m_prefaultTimeUs;
+
+}; // class BasicWasmRuntimeStaticHeap
+
+
+using WasmRuntimeStaticHeap = BasicWasmRuntimeStaticHeap<DefaultPoolAllocator>;
 
-}; // class WasmRuntimeStaticHeap
+using WasmRuntimeHugePageHeap = BasicWasmRuntimeStaticHeap<HugePagePoolAllocator>;
 
 
 } // namespace DecentWasmRuntime
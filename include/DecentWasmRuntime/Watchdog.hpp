@@ -0,0 +1,246 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <condition_variable>
+#include <functional>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#ifndef DECENT_ENCLAVE_PLATFORM_SGX_TRUSTED
+#include <chrono>
+#endif // !DECENT_ENCLAVE_PLATFORM_SGX_TRUSTED
+
+#include "Exception.hpp"
+#include "WasmModuleInstance.hpp"
+#include "WasmRuntime.hpp"
+
+
+namespace DecentWasmRuntime
+{
+
+
+/**
+ * @brief Terminates WASM runs that pass their deadlines, with
+ *        `wasm_runtime_terminate`, so plain (uninstrumented) runs can be
+ *        bounded in wall-clock time.
+ *
+ *        Runs are armed with their deadlines, which are kept in a timer heap;
+ *        an armed instance must stay alive until it's disarmed;
+ *        a disarmed run stays in the heap until its deadline comes up, and
+ *        is skipped then. One watchdog can be shared by any number of
+ *        threads running WASM code.
+ *
+ *        Expired runs are terminated by Expire, which is called by the thread
+ *        in Run on the untrusted side; in the enclave, where a thread can't
+ *        wait for a given time, it's called periodically instead, e.g., by
+ *        an ecall from a host thread.
+ *
+ *        Termination takes effect at the next check of the instance's
+ *        exception; WAMR checks it at loop back-edges only when built with
+ *        the thread manager (`WAMR_BUILD_THREAD_MGR`), and AOT code only
+ *        when compiled by wamrc with `--enable-multi-thread`; arming an
+ *        instance that can't be terminated (see
+ *        `WasmModuleInstance::IsTerminable`) throws.
+ *
+ */
+class Watchdog
+{
+public: // static members
+
+	using Ticket = uint64_t;
+
+	static constexpr uint64_t sk_noDeadline =
+		std::numeric_limits<uint64_t>::max();
+
+public:
+
+	Watchdog() :
+		m_mutex(),
+		m_cond(),
+		m_heap(),
+		m_armed(),
+		m_nextTicket(1),
+		m_stop(false)
+	{}
+
+	Watchdog(const Watchdog&) = delete;
+
+	Watchdog& operator=(const Watchdog&) = delete;
+
+	/**
+	 * @brief Arm the watchdog for a run of the given instance.
+	 *
+	 * @param deadlineUs The deadline, in the clock given to Run or Expire.
+	 * @return The ticket to disarm it with, once the run returns.
+	 * @exception Exception The instance can't be terminated.
+	 */
+	Ticket Arm(WasmModuleInstance& moduleInst, uint64_t deadlineUs)
+	{
+		if (!moduleInst.IsTerminable())
+		{
+			throw Exception(
+				"Runs of this instance can't be terminated; WAMR must be "
+				"built with the thread manager, and AOT modules compiled with "
+				"--enable-multi-thread"
+			);
+		}
+
+		bool isEarliest = false;
+		Ticket ticket = 0;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			ticket = m_nextTicket++;
+			m_armed.emplace(ticket, Armed(&moduleInst));
+			m_heap.emplace(deadlineUs, ticket);
+			isEarliest = (m_heap.top().second == ticket);
+		}
+		if (isEarliest)
+		{
+			// the thread in Run has to wake up earlier
+			m_cond.notify_all();
+		}
+		return ticket;
+	}
+
+	/**
+	 * @brief Disarm the watchdog for a run, which must be done whether the
+	 *        run succeeded or not, before running the instance again.
+	 *
+	 * @return true if the run has been terminated.
+	 */
+	bool Disarm(Ticket ticket)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_armed.find(ticket);
+		if (it == m_armed.end())
+		{
+			return false;
+		}
+		const bool terminated = it->second.terminated;
+		m_armed.erase(it);
+		return terminated;
+	}
+
+	/**
+	 * @brief Terminate every armed run whose deadline has passed.
+	 *
+	 * @return The next deadline, or sk_noDeadline if nothing is armed.
+	 */
+	uint64_t Expire(uint64_t nowUs)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return ExpireLocked(nowUs);
+	}
+
+	size_t GetNumArmed() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_armed.size();
+	}
+
+#ifndef DECENT_ENCLAVE_PLATFORM_SGX_TRUSTED
+
+	/**
+	 * @brief Terminate expired runs on the calling thread, waiting for the
+	 *        next deadline in between, until Stop is called.
+	 *
+	 * @param timestampFunc The clock the deadlines are given in.
+	 */
+	void Run(os_timestamp_function_t timestampFunc)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (!m_stop)
+		{
+			const uint64_t nowUs = timestampFunc();
+			const uint64_t nextUs = ExpireLocked(nowUs);
+			if (nextUs == sk_noDeadline)
+			{
+				m_cond.wait(lock);
+			}
+			else
+			{
+				m_cond.wait_for(lock, std::chrono::microseconds(nextUs - nowUs));
+			}
+		}
+	}
+
+	void Stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		m_cond.notify_all();
+	}
+
+#endif // !DECENT_ENCLAVE_PLATFORM_SGX_TRUSTED
+
+private:
+
+	struct Armed
+	{
+		explicit Armed(WasmModuleInstance* inst) :
+			moduleInst(inst),
+			terminated(false)
+		{}
+
+		WasmModuleInstance* moduleInst;
+		bool terminated;
+	}; // struct Armed
+
+	// (deadline, ticket), the earliest deadline on top
+	using HeapEntry = std::pair<uint64_t, Ticket>;
+	using TimerHeap = std::priority_queue<
+		HeapEntry,
+		std::vector<HeapEntry>,
+		std::greater<HeapEntry>
+	>;
+
+	// must be called with m_mutex held, so a run can't be disarmed (and its
+	// instance run again) while it's being terminated
+	uint64_t ExpireLocked(uint64_t nowUs)
+	{
+		while (!m_heap.empty())
+		{
+			const HeapEntry entry = m_heap.top();
+			auto it = m_armed.find(entry.second);
+			if (it == m_armed.end())
+			{
+				// already disarmed
+				m_heap.pop();
+				continue;
+			}
+			if (entry.first > nowUs)
+			{
+				return entry.first;
+			}
+
+			it->second.moduleInst->Terminate();
+			it->second.terminated = true;
+			m_heap.pop();
+		}
+		return sk_noDeadline;
+	}
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_cond;
+	TimerHeap m_heap;
+	std::map<Ticket, Armed> m_armed;
+	Ticket m_nextTicket;
+	bool m_stop;
+}; // class Watchdog
+
+
+} // namespace DecentWasmRuntime
+
@@ -0,0 +1,35 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstddef>
+
+
+/**
+ * @brief An AOT artifact the enclave trusts, and the WASM bytecode it's
+ *        trusted to run in place of, both by their SHA-256 (in hex).
+ *
+ */
+struct DecentWasmTrustedAot
+{
+	const char* wasmHash;
+	const char* aotHash;
+}; // struct DecentWasmTrustedAot
+
+
+/**
+ * @brief The AOT artifacts the enclave trusts to run in place of their
+ *        bytecode. The table is generated by
+ *        `decent_wasm_add_aot_allowlist()`
+ *        (see cmake/DecentWasmAotAllowlist.cmake), from
+ *        `DECENT_WASM_SGX_AOT_TRUSTED`, and is only built with
+ *        `DECENT_WASM_SGX_AOT`.
+ *
+ */
+extern const DecentWasmTrustedAot g_decentWasmTrustedAot[];
+
+extern const size_t g_decentWasmTrustedAotCount;
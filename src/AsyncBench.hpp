@@ -0,0 +1,358 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <DecentWasmRuntime/Exception.hpp>
+#include <DecentWasmRuntime/Internal/make_unique.hpp>
+#include <DecentWasmRuntime/MainRunner.hpp>
+#include <DecentWasmRuntime/RunExecutor.hpp>
+#include <DecentWasmRuntime/ThreadEnvGuard.hpp>
+#include <DecentWasmRuntime/WasmRuntimeStaticHeap.hpp>
+
+#include "BenchUtils.hpp"
+#include "SystemIO.hpp"
+#include "decent_wasm_config.h"
+
+
+/**
+ * @brief Run a module the same number of times, first one run after
+ *        another on the calling thread, then with one run of each runner
+ *        kept in flight on the runtime's executor, and compare the
+ *        throughputs; then check that cancelled runs leave their instances
+ *        usable.
+ *
+ *        On the untrusted side, the executor starts its own workers; in the
+ *        enclave, the workers are host threads calling Work.
+ *
+ */
+class DecentWasmAsyncBench
+{
+public:
+
+	DecentWasmAsyncBench(
+		const uint8_t* wasmFile, size_t wasmFileSize,
+		const decent_wasm_async_config_t& config
+	) :
+		m_config(config),
+		m_wasmRt(
+			DecentWasmRuntime::Internal::make_unique<
+				DecentWasmRuntime::WasmRuntimeStaticHeap
+			>(
+				PrintCStr,
+				config.pool_size,
+				GetTimestampUs
+			)
+		),
+		m_runners()
+	{
+		using namespace DecentWasmRuntime;
+
+		static const std::vector<uint8_t>& sk_eventId = GetDefaultEventId();
+		static const std::vector<uint8_t>& sk_eventData = GetDefaultEventData();
+
+		if ((config.num_workers == 0) || (config.num_runners == 0))
+		{
+			throw std::invalid_argument(
+				"The async benchmark needs workers and runners");
+		}
+
+		SharedWasmModule mod = m_wasmRt.LoadModule(
+			std::vector<uint8_t>(wasmFile, wasmFile + wasmFileSize)
+		);
+		for (uint32_t i = 0; i < config.num_runners; ++i)
+		{
+			m_runners.push_back(Internal::make_unique<MainRunner>(
+				mod,
+				sk_eventId,
+				sk_eventData,
+				config.mod_stack_size,
+				config.mod_heap_size,
+				config.exec_stack_size
+			));
+		}
+
+#ifndef DECENT_ENCLAVE_PLATFORM_SGX_TRUSTED
+		m_wasmRt->GetExecutor().Start(config.num_workers);
+#endif // !DECENT_ENCLAVE_PLATFORM_SGX_TRUSTED
+	}
+
+	DecentWasmAsyncBench(const DecentWasmAsyncBench&) = delete;
+
+	DecentWasmAsyncBench& operator=(const DecentWasmAsyncBench&) = delete;
+
+	/**
+	 * @brief Run as one of the executor's workers, until Close is called.
+	 *
+	 */
+	void Work()
+	{
+		if (!m_wasmRt->GetExecutor().Work())
+		{
+			PrintStr("Failed to init the thread env of a worker\n");
+		}
+	}
+
+	/**
+	 * @brief Run the benchmark on the calling thread, which submits the
+	 *        runs, and print the results.
+	 *
+	 */
+	void Run()
+	{
+		// the baseline runs on the calling thread, which may not be the one
+		// that created the runtime
+		DecentWasmRuntime::ThreadEnvGuard threadEnv;
+		if (!threadEnv.IsInited())
+		{
+			PrintStr("Failed to init the thread env of the submitting thread\n");
+			return;
+		}
+
+		RunAll();
+	}
+
+	/**
+	 * @brief Stop the executor, so the workers return from Work.
+	 *
+	 */
+	void Close()
+	{
+		m_wasmRt->GetExecutor().Shutdown();
+	}
+
+private:
+
+	void RunAll()
+	{
+		using namespace DecentWasmRuntime;
+
+		const size_t numRunners = m_runners.size();
+		const size_t numEvents = m_config.num_events;
+
+		// one run after another
+		uint64_t syncStartUs = GetTimestampUs();
+		for (size_t i = 0; i < numEvents; ++i)
+		{
+			m_runners[i % numRunners]->RunPlain();
+		}
+		const uint64_t syncUs = GetTimestampUs() - syncStartUs;
+
+		// one run of each runner in flight; the results are collected in
+		// submission order, so a runner is waited for right before it's
+		// given its next run
+		std::vector<RunFuture> inFlight(numRunners);
+		std::vector<uint64_t> latencyUs;
+		std::vector<uint64_t> queueUs;
+		std::vector<uint64_t> runUs;
+		uint64_t numFailed = 0;
+		auto collect = [&](RunFuture& future) {
+			if (!future.IsValid())
+			{
+				return;
+			}
+			try
+			{
+				const RunResult res = future.Get();
+				latencyUs.push_back(res.endUs - res.submitUs);
+				queueUs.push_back(res.GetQueueUs());
+				runUs.push_back(res.GetRunUs());
+			}
+			catch (const std::exception& e)
+			{
+				PrintStr(std::string("Async run failed: ") + e.what() + "\n");
+				++numFailed;
+			}
+			future = RunFuture();
+		};
+
+		uint64_t asyncStartUs = GetTimestampUs();
+		for (size_t i = 0; i < numEvents; ++i)
+		{
+			const size_t runnerIdx = i % numRunners;
+			collect(inFlight[runnerIdx]);
+			inFlight[runnerIdx] = m_runners[runnerIdx]->RunPlainAsync();
+		}
+		for (auto& future : inFlight)
+		{
+			collect(future);
+		}
+		const uint64_t asyncUs = GetTimestampUs() - asyncStartUs;
+
+		// cancel a run of every runner right after submitting it; some are
+		// still queued, and some may already be running
+		uint64_t numCancelled = 0;
+		for (size_t i = 0; i < numRunners; ++i)
+		{
+			inFlight[i] = m_runners[i]->RunPlainAsync();
+		}
+		for (auto& future : inFlight)
+		{
+			future.Cancel();
+		}
+		for (auto& future : inFlight)
+		{
+			try
+			{
+				future.Get();
+			}
+			catch (const WasmCancelledException&)
+			{
+				++numCancelled;
+			}
+		}
+		// the cancelled instances must be able to run again
+		uint64_t numReusable = 0;
+		for (auto& runner : m_runners)
+		{
+			try
+			{
+				runner->RunPlain();
+				++numReusable;
+			}
+			catch (const std::exception& e)
+			{
+				PrintStr(std::string("Run after cancelling failed: ") + e.what() + "\n");
+			}
+		}
+
+		PrintStr(
+			"Async bench: "
+			"Workers: "         + std::to_string(m_config.num_workers) + ", "
+			"Runners: "         + std::to_string(numRunners) + ", "
+			"Runs: "            + std::to_string(numEvents) + ", "
+			"Failed: "          + std::to_string(numFailed) + ", "
+			"Sync time: "       + std::to_string(syncUs) + " us, "
+			"Sync throughput: " + std::to_string(
+				syncUs == 0 ? 0 : (numEvents * 1000000 / syncUs)) + " runs/s, "
+			"Async time: "      + std::to_string(asyncUs) + " us, "
+			"Async throughput: " + std::to_string(
+				asyncUs == 0 ? 0 : (runUs.size() * 1000000 / asyncUs)) + " runs/s, "
+			"Latency p50: "     + std::to_string(
+				GetPercentile(latencyUs, 50)) + " us, "
+			"Latency p99: "     + std::to_string(
+				GetPercentile(latencyUs, 99)) + " us, "
+			"Queue p50: "       + std::to_string(
+				GetPercentile(queueUs, 50)) + " us, "
+			"Run p50: "         + std::to_string(
+				GetPercentile(runUs, 50)) + " us, "
+			"Cancelled: "       + std::to_string(numCancelled) + "/" +
+				std::to_string(numRunners) + ", "
+			"Reusable after cancel: " + std::to_string(numReusable) + "/" +
+				std::to_string(numRunners) + "\n"
+		);
+	}
+
+	decent_wasm_async_config_t m_config;
+	DecentWasmRuntime::SharedWasmRuntime m_wasmRt;
+	std::vector<std::unique_ptr<DecentWasmRuntime::MainRunner> > m_runners;
+}; // class DecentWasmAsyncBench
+
+
+/**
+ * @brief The async benchmark of this side of the enclave boundary;
+ *        there is at most one, created by DecentWasmAsyncBenchStart.
+ */
+inline std::unique_ptr<DecentWasmAsyncBench>& GetDecentWasmAsyncBench()
+{
+	static std::unique_ptr<DecentWasmAsyncBench> s_bench;
+	return s_bench;
+}
+
+
+inline std::mutex& GetDecentWasmAsyncBenchMutex()
+{
+	static std::mutex s_mutex;
+	return s_mutex;
+}
+
+
+inline bool DecentWasmAsyncBenchStart(
+	const uint8_t* wasmFile, size_t wasmFileSize,
+	const decent_wasm_async_config_t& config
+)
+{
+	std::lock_guard<std::mutex> lock(GetDecentWasmAsyncBenchMutex());
+	try
+	{
+		// the previous runtime must be gone before a new one is created
+		GetDecentWasmAsyncBench().reset();
+		GetDecentWasmAsyncBench() =
+			DecentWasmRuntime::Internal::make_unique<DecentWasmAsyncBench>(
+				wasmFile, wasmFileSize, config
+			);
+		return true;
+	}
+	catch(const std::exception& e)
+	{
+		PrintStr(e.what());
+		PrintStr("\n");
+		return false;
+	}
+}
+
+
+/**
+ * @brief Work, Run and Close don't take the lock, since the benchmark stays
+ *        until DecentWasmAsyncBenchFinish, which must only be called after
+ *        all of them have returned.
+ *
+ */
+inline void DecentWasmAsyncBenchWork()
+{
+	DecentWasmAsyncBench* bench = GetDecentWasmAsyncBench().get();
+	if (bench == nullptr)
+	{
+		PrintStr("The async benchmark has not been started\n");
+		return;
+	}
+	bench->Work();
+}
+
+
+inline void DecentWasmAsyncBenchRun()
+{
+	DecentWasmAsyncBench* bench = GetDecentWasmAsyncBench().get();
+	if (bench == nullptr)
+	{
+		PrintStr("The async benchmark has not been started\n");
+		return;
+	}
+	try
+	{
+		bench->Run();
+	}
+	catch(const std::exception& e)
+	{
+		PrintStr(e.what());
+		PrintStr("\n");
+	}
+}
+
+
+inline void DecentWasmAsyncBenchClose()
+{
+	DecentWasmAsyncBench* bench = GetDecentWasmAsyncBench().get();
+	if (bench != nullptr)
+	{
+		bench->Close();
+	}
+}
+
+
+inline void DecentWasmAsyncBenchFinish()
+{
+	std::lock_guard<std::mutex> lock(GetDecentWasmAsyncBenchMutex());
+	GetDecentWasmAsyncBench().reset();
+}
@@ -0,0 +1,184 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sgx_urts.h>
+
+#include "AsyncBench.hpp"
+#include "HostUtils.hpp"
+#include "decent_wasm_config.h"
+
+
+extern "C" {
+
+extern sgx_status_t ecall_decent_wasm_async_start(
+	sgx_enclave_id_t eid,
+	int *retval,
+	const uint8_t *wasm_file, size_t wasm_file_size,
+	const decent_wasm_async_config_t *config
+);
+
+extern sgx_status_t ecall_decent_wasm_async_work(sgx_enclave_id_t eid);
+
+extern sgx_status_t ecall_decent_wasm_async_run(sgx_enclave_id_t eid);
+
+extern sgx_status_t ecall_decent_wasm_async_close(sgx_enclave_id_t eid);
+
+extern sgx_status_t ecall_decent_wasm_async_finish(sgx_enclave_id_t eid);
+
+} // extern "C"
+
+
+inline decent_wasm_async_config_t ParseAsyncConfig(
+	int argc, char** argv, int startIdx
+)
+{
+	decent_wasm_async_config_t config;
+	config.pool_size       = 64 * 1024 * 1024; // 64 MB
+	config.num_workers     = 4;
+	config.num_runners     = 8;
+	config.num_events      = 0;
+	config.mod_stack_size  = 64 * 1024;        // 64 KB
+	config.mod_heap_size   = 1 * 1024 * 1024;  //  1 MB
+	config.exec_stack_size = 64 * 1024;        // 64 KB
+
+	for (int i = startIdx; i < argc; ++i)
+	{
+		const std::string opt = argv[i];
+		if ((i + 1) >= argc)
+		{
+			throw std::invalid_argument("Missing value for option " + opt);
+		}
+
+		uint32_t val = static_cast<uint32_t>(std::stoul(argv[++i]));
+		if (opt == "--workers")
+		{
+			config.num_workers = val;
+		}
+		else if (opt == "--runners")
+		{
+			config.num_runners = val;
+		}
+		else if (opt == "--pool")
+		{
+			config.pool_size = val;
+		}
+		else if (opt == "--mod-stack")
+		{
+			config.mod_stack_size = val;
+		}
+		else if (opt == "--mod-heap")
+		{
+			config.mod_heap_size = val;
+		}
+		else if (opt == "--exec-stack")
+		{
+			config.exec_stack_size = val;
+		}
+		else
+		{
+			throw std::invalid_argument("Unknown option " + opt);
+		}
+	}
+
+	return config;
+}
+
+/**
+ * @brief Compare runs one after another with runs kept in flight on the
+ *        runtime's executor (MainRunner::RunPlainAsync), on the untrusted
+ *        side and in the enclave.
+ *
+ */
+inline int AsyncMain(int argc, char**argv)
+{
+	if (argc < 3)
+	{
+		std::cerr << "Usage: "
+			<< argv[0] << " <wasm file> <num runs>"
+			<< " [--workers <num>] [--runners <num>]"
+			<< " [--pool <bytes>] [--mod-stack <bytes>] [--mod-heap <bytes>]"
+			<< " [--exec-stack <bytes>]" << std::endl;
+		return -1;
+	}
+
+	const std::string wasmFilenamePath = argv[1];
+	decent_wasm_async_config_t config = ParseAsyncConfig(argc, argv, 3);
+	config.num_events = static_cast<uint32_t>(std::stoul(argv[2]));
+	// the submitting thread calls into the enclave while the workers run
+	if (!CheckEnclaveWorkers(config.num_workers, 1))
+	{
+		return -1;
+	}
+
+	auto wasmBytecode = ReadFile2Buffer(wasmFilenamePath);
+
+	// the executor starts its own workers on this side
+	if (!DecentWasmAsyncBenchStart(
+		wasmBytecode.data(), wasmBytecode.size(), config
+	))
+	{
+		return -1;
+	}
+	DecentWasmAsyncBenchRun();
+	DecentWasmAsyncBenchClose();
+	DecentWasmAsyncBenchFinish();
+
+	sgx_enclave_id_t eid = 0;
+	enclave_init(&eid);
+
+	int retval = -1;
+	auto ret = ecall_decent_wasm_async_start(
+		eid,
+		&retval,
+		wasmBytecode.data(), wasmBytecode.size(),
+		&config
+	);
+	if ((ret != SGX_SUCCESS) || (retval != 0))
+	{
+		std::cerr << "ERROR: "
+			<< "Failed to run ecall_decent_wasm_async_start." << std::endl;
+	}
+	else
+	{
+		// the enclave can't create threads, so the workers are ours
+		std::vector<std::thread> workers;
+		for (uint32_t i = 0; i < config.num_workers; ++i)
+		{
+			workers.emplace_back([eid]() {
+				if (ecall_decent_wasm_async_work(eid) != SGX_SUCCESS)
+				{
+					std::cerr << "ERROR: "
+						<< "Failed to run ecall_decent_wasm_async_work." << std::endl;
+				}
+			});
+		}
+		if (ecall_decent_wasm_async_run(eid) != SGX_SUCCESS)
+		{
+			std::cerr << "ERROR: "
+				<< "Failed to run ecall_decent_wasm_async_run." << std::endl;
+		}
+		ecall_decent_wasm_async_close(eid);
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+		ecall_decent_wasm_async_finish(eid);
+	}
+
+	sgx_destroy_enclave(eid);
+
+	return 0;
+}
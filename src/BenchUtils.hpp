@@ -0,0 +1,72 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <vector>
+
+
+/**
+ * @brief The event id given to the programs by the benchmarks, unless they
+ *        are asked for other ones.
+ *
+ */
+inline const std::vector<uint8_t>& GetDefaultEventId()
+{
+	static const std::vector<uint8_t> sk_eventId = {
+		'D', 'e', 'c', 'e', 'n', 't', '\0'
+	};
+	return sk_eventId;
+}
+
+/**
+ * @brief The event data given to the programs by the benchmarks, unless they
+ *        are asked for other ones.
+ *
+ */
+inline const std::vector<uint8_t>& GetDefaultEventData()
+{
+	static const std::vector<uint8_t> sk_eventData = {
+		'E', 'v', 'e', 'n', 't', 'M', 'e', 's', 's', 'a', 'g', 'e', '\0'
+	};
+	return sk_eventData;
+}
+
+/**
+ * @brief Weights of `num` indices, with the k-th picked 1/k as often as the
+ *        first, so a few of them are hot.
+ *
+ */
+inline std::vector<double> GetZipfWeights(size_t num)
+{
+	std::vector<double> weights;
+	weights.reserve(num);
+	for (size_t i = 0; i < num; ++i)
+	{
+		weights.push_back(1.0 / (i + 1));
+	}
+	return weights;
+}
+
+/**
+ * @brief The value below which the given percent of the values fall.
+ *
+ * @return 0 if there's no value.
+ */
+inline uint64_t GetPercentile(std::vector<uint64_t> values, double percent)
+{
+	if (values.empty())
+	{
+		return 0;
+	}
+	std::sort(values.begin(), values.end());
+	size_t idx = static_cast<size_t>(values.size() * percent / 100.0);
+	return values[std::min(idx, values.size() - 1)];
+}
@@ -0,0 +1,70 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <iostream>
+#include <string>
+
+#include <sgx_urts.h>
+
+#include "HostUtils.hpp"
+#include "MainDriver.hpp"
+#include "decent_wasm_config.h"
+
+
+extern "C" {
+
+extern sgx_status_t ecall_decent_wasm_list_bundled(sgx_enclave_id_t eid);
+
+extern sgx_status_t ecall_decent_wasm_run_bundled(
+	sgx_enclave_id_t eid,
+	int *retval,
+	uint32_t module_id,
+	const decent_wasm_main_config_t *config
+);
+
+} // extern "C"
+
+
+/**
+ * @brief Run a module embedded into the enclave image, or list them if no
+ *        module ID is given.
+ *
+ */
+inline int BundleMain(int argc, char**argv)
+{
+	sgx_enclave_id_t eid = 0;
+	enclave_init(&eid);
+
+	sgx_status_t ret = SGX_SUCCESS;
+	int retval = 0;
+	if ((argc < 2) || (std::string(argv[1]).rfind("--", 0) == 0))
+	{
+		ret = ecall_decent_wasm_list_bundled(eid);
+	}
+	else
+	{
+		const uint32_t moduleId = static_cast<uint32_t>(std::stoul(argv[1]));
+		HostOptions hostOpts;
+		const decent_wasm_main_config_t config =
+			ParseMainConfig(argc, argv, 2, hostOpts);
+
+		ret = ecall_decent_wasm_run_bundled(eid, &retval, moduleId, &config);
+	}
+	if(ret != SGX_SUCCESS)
+	{
+		std::cerr << "ERROR: "
+			<< "Failed to run the bundled module ecall." << std::endl;
+		retval = -1;
+	}
+
+	sgx_destroy_enclave(eid);
+
+	return retval;
+}
@@ -0,0 +1,101 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <DecentWasmRuntime/MainRunner.hpp>
+
+#include "DecentMain.hpp"
+#include "ModuleBundle.hpp"
+#include "SystemIO.hpp"
+#include "decent_wasm_config.h"
+
+
+inline void DecentWasmListBundled()
+{
+	for (size_t i = 0; i < g_decentWasmBundledModuleCount; ++i)
+	{
+		const DecentWasmBundledModule& bundled = g_decentWasmBundledModules[i];
+		PrintStr(
+			"Bundled module: "
+			"Id: "     + std::to_string(i) + ", "
+			"Name: "   + bundled.name + ", "
+			"SHA256: " + bundled.sha256 + ", "
+			"Size: "   + std::to_string(bundled.size) + " bytes\n"
+		);
+	}
+}
+
+
+/**
+ * @brief Run the plain program of a module bundled in the binary, loading it
+ *        from a copy of the embedded bytes, since WAMR may modify the buffer
+ *        it loads a module from, and the bundled module must stay intact for
+ *        the later loads.
+ *
+ */
+inline bool DecentWasmRunBundled(
+	uint32_t moduleId,
+	const decent_wasm_main_config_t& config
+)
+{
+	using namespace DecentWasmRuntime;
+	static constexpr size_t sk_repeatTime = 5;
+
+	if (moduleId >= g_decentWasmBundledModuleCount)
+	{
+		PrintStr(
+			"Bundled module " + std::to_string(moduleId) + " doesn't exist\n"
+		);
+		return false;
+	}
+	const DecentWasmBundledModule& bundled = g_decentWasmBundledModules[moduleId];
+
+	try
+	{
+		if (!IsMainRunningModeSupported(config))
+		{
+			return true;
+		}
+
+		auto wasmRt = CreateMainRuntime(config);
+
+		InstanceSizing sizing = GetDefaultInstanceSizing(config);
+
+		// copied outside of the load time, so the load is timed the same way
+		// as the other ones
+		std::vector<uint8_t> wasm(bundled.data, bundled.data + bundled.size);
+		uint64_t startUs = GetTimestampUs();
+		SharedWasmModule mod = wasmRt.LoadModule(std::move(wasm));
+		uint64_t endUs = GetTimestampUs();
+		mod->SetInitLinearMemSize(sizing.initLinearMemSize);
+		mod->SetPrefaultLinearMem(config.prefault != 0);
+		mod->SetHugePageLinearMem(config.pool_huge_pages != 0);
+		PrintStr(
+			"Bundled module: "
+			"Id: "   + std::to_string(moduleId) + ", "
+			"Name: " + bundled.name + "\n"
+		);
+		PrintModuleLoad("plain", mod, endUs - startUs);
+
+		RunPlainOnly(wasmRt, std::move(mod), sizing, sk_repeatTime);
+
+		return true;
+	}
+	catch(const std::exception& e)
+	{
+		PrintStr(e.what());
+		PrintStr("\n");
+		return false;
+	}
+}
+
@@ -0,0 +1,446 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <DecentWasmRuntime/Internal/make_unique.hpp>
+#include <DecentWasmRuntime/MainRunner.hpp>
+#include <DecentWasmRuntime/ThreadEnvGuard.hpp>
+#include <DecentWasmRuntime/WasmRuntimeStaticHeap.hpp>
+
+#include "BenchUtils.hpp"
+#include "DeadlineScheduler.hpp"
+#include "SystemIO.hpp"
+#include "decent_wasm_config.h"
+
+
+/**
+ * @brief Run events with deadlines, submitted by a load generator, on a set
+ *        of worker threads scheduled by the given policy, and report how
+ *        many of them miss their deadlines.
+ *
+ *        The modules must be instrumented, since the scheduler predicts the
+ *        time of a run from the instruction counter of the previous runs.
+ *        Each module is run once at the start, to seed the predictions.
+ *
+ *        The worker threads and the load generator are given by the caller:
+ *        each worker calls Work once, which returns after Close is called
+ *        and all the accepted events have run.
+ *
+ */
+class DecentWasmDeadlineBench
+{
+public: // static members
+
+	struct Event
+	{
+		uint64_t submitUs = 0;
+	}; // struct Event
+
+	using Scheduler = DeadlineScheduler<Event>;
+
+	static const char* GetPolicyName(uint32_t policy)
+	{
+		switch (policy)
+		{
+		case DECENT_WASM_DEADLINE_EARLIEST_DEADLINE:
+			return "edf";
+		case DECENT_WASM_DEADLINE_SHORTEST_PREDICTED:
+			return "spjf";
+		case DECENT_WASM_DEADLINE_FIFO:
+		default:
+			return "fifo";
+		}
+	}
+
+	static Scheduler::Policy GetPolicy(uint32_t policy)
+	{
+		switch (policy)
+		{
+		case DECENT_WASM_DEADLINE_EARLIEST_DEADLINE:
+			return Scheduler::Policy::EarliestDeadline;
+		case DECENT_WASM_DEADLINE_SHORTEST_PREDICTED:
+			return Scheduler::Policy::ShortestPredicted;
+		case DECENT_WASM_DEADLINE_FIFO:
+		default:
+			return Scheduler::Policy::Fifo;
+		}
+	}
+
+	// e.g., 1234 out of 10000 -> "12.34%"
+	static std::string FormatPercent(uint64_t num, uint64_t den)
+	{
+		const uint64_t hundredths = (den == 0) ? 0 : (num * 10000 / den);
+		const uint64_t frac = hundredths % 100;
+		return std::to_string(hundredths / 100) + "." +
+			(frac < 10 ? "0" : "") + std::to_string(frac) + "%";
+	}
+
+public:
+
+	/**
+	 * @param wasmFiles The instrumented modules, one after another.
+	 * @param fileSizes The size of each module.
+	 */
+	DecentWasmDeadlineBench(
+		const uint8_t* wasmFiles,
+		const uint64_t* fileSizes, size_t numFiles,
+		const decent_wasm_deadline_config_t& config
+	) :
+		m_config(config),
+		m_wasmRt(
+			DecentWasmRuntime::Internal::make_unique<
+				DecentWasmRuntime::WasmRuntimeStaticHeap
+			>(
+				PrintCStr,
+				config.pool_size,
+				GetTimestampUs
+			)
+		),
+		m_modules(),
+		m_sched(
+			config.num_workers,
+			numFiles,
+			GetPolicy(config.policy),
+			config.unknown_cost_us
+		),
+		m_workers(config.num_workers),
+		m_startUs(0)
+	{
+		using namespace DecentWasmRuntime;
+
+		if ((numFiles == 0) || (config.num_workers == 0))
+		{
+			throw std::invalid_argument(
+				"The deadline benchmark needs modules and workers");
+		}
+
+		for (size_t i = 0; i < numFiles; ++i)
+		{
+			m_modules.push_back(m_wasmRt.LoadModule(
+				std::vector<uint8_t>(wasmFiles, wasmFiles + fileSizes[i])
+			));
+			wasmFiles += fileSizes[i];
+		}
+
+		// one run of each module, so the first events aren't admitted blind
+		for (size_t i = 0; config.calibrate && (i < m_modules.size()); ++i)
+		{
+			std::unique_ptr<MainRunner> runner = CreateRunner(i);
+			uint64_t startUs = GetTimestampUs();
+			runner->RunInstrumented(sk_threshold);
+			const uint64_t runUs = GetTimestampUs() - startUs;
+			m_sched.UpdateCost(i, runner->GetCounter(), runUs);
+			PrintStr(
+				"Deadline bench calibration: "
+				"Module: "  + std::to_string(i) + ", "
+				"Counter: " + std::to_string(runner->GetCounter()) + ", "
+				"Run: "     + std::to_string(runUs) + " us\n"
+			);
+		}
+
+		m_startUs = GetTimestampUs();
+	}
+
+	DecentWasmDeadlineBench(const DecentWasmDeadlineBench&) = delete;
+
+	DecentWasmDeadlineBench& operator=(const DecentWasmDeadlineBench&) = delete;
+
+	/**
+	 * @param deadlineUs The deadline, relative to now.
+	 *
+	 * @return false if the event is rejected.
+	 */
+	bool Submit(size_t moduleIdx, uint64_t deadlineUs)
+	{
+		if (moduleIdx >= m_modules.size())
+		{
+			PrintStr("Invalid module index " + std::to_string(moduleIdx) + "\n");
+			return false;
+		}
+
+		Event event;
+		event.submitUs = GetTimestampUs();
+		return m_sched.Submit(
+			moduleIdx,
+			event.submitUs,
+			event.submitUs + deadlineUs,
+			event
+		);
+	}
+
+	/**
+	 * @brief No more events will be submitted.
+	 *
+	 */
+	void Close()
+	{
+		m_sched.Close();
+	}
+
+	/**
+	 * @brief Run events on the calling thread as the given worker, until
+	 *        the benchmark is closed and all the accepted events have run.
+	 *
+	 */
+	void Work(size_t workerIdx)
+	{
+		using namespace DecentWasmRuntime;
+
+		if (workerIdx >= m_workers.size())
+		{
+			PrintStr("Invalid worker index " + std::to_string(workerIdx) + "\n");
+			return;
+		}
+
+		// WAMR needs every thread running WASM code to set up its own env
+		ThreadEnvGuard threadEnv;
+		if (!threadEnv.IsInited())
+		{
+			PrintStr("Failed to init the thread env of a worker\n");
+			return;
+		}
+
+		WorkerResult& res = m_workers[workerIdx];
+		{
+			// an instance of each module, created on its first event
+			std::vector<std::unique_ptr<MainRunner> > runners(m_modules.size());
+
+			Scheduler::Taken taken;
+			while (m_sched.Next(taken))
+			{
+				try
+				{
+					std::unique_ptr<MainRunner>& runner = runners[taken.moduleIdx];
+					if (runner == nullptr)
+					{
+						runner = CreateRunner(taken.moduleIdx);
+					}
+
+					uint64_t runStartUs = GetTimestampUs();
+					runner->RunInstrumented(sk_threshold);
+					uint64_t endUs = GetTimestampUs();
+					const uint64_t counter = runner->GetCounter();
+					runner->ResetThresholdAndCounter();
+
+					m_sched.Done(taken, counter, endUs - runStartUs);
+					res.latencyUs.push_back(endUs - taken.event.submitUs);
+					if (endUs > taken.deadlineUs)
+					{
+						++res.numMissed;
+					}
+					res.endUs = std::max(res.endUs, endUs);
+				}
+				catch (const std::exception& e)
+				{
+					// a trap can leave the instance in any state
+					runners[taken.moduleIdx].reset();
+					m_sched.Done(taken);
+					PrintStr(
+						"Event of module " + std::to_string(taken.moduleIdx) +
+						" failed: " + e.what() + "\n"
+					);
+					++res.numFailed;
+				}
+			}
+		}
+	}
+
+	/**
+	 * @brief Print the results; must only be called after every worker has
+	 *        returned from Work.
+	 *
+	 */
+	void Report() const
+	{
+		std::vector<uint64_t> latencyUs;
+		uint64_t numMissed = 0;
+		uint64_t numFailed = 0;
+		uint64_t endUs = m_startUs;
+		for (const auto& res : m_workers)
+		{
+			latencyUs.insert(latencyUs.end(), res.latencyUs.begin(), res.latencyUs.end());
+			numMissed += res.numMissed;
+			numFailed += res.numFailed;
+			endUs = std::max(endUs, res.endUs);
+		}
+
+		const Scheduler::Stats stats = m_sched.GetStats();
+		const uint64_t timeUs = endUs - m_startUs;
+
+		PrintStr(
+			"Deadline bench: "
+			"Policy: "          + std::string(GetPolicyName(m_config.policy)) + ", "
+			"Workers: "         + std::to_string(m_config.num_workers) + ", "
+			"Modules: "         + std::to_string(m_modules.size()) + ", "
+			"Submitted: "       + std::to_string(stats.numSubmitted) + ", "
+			"Rejected: "        + std::to_string(stats.numRejected) + ", "
+			"Rejected overtaking: " + std::to_string(
+				stats.numRejectedOvertaking) + ", "
+			"Unknown cost: "    + std::to_string(stats.numUnknownCost) + ", "
+			"Completed: "       + std::to_string(latencyUs.size()) + ", "
+			"Missed: "          + std::to_string(numMissed) + ", "
+			"Failed: "          + std::to_string(numFailed) + ", "
+			// an event counts as missed if it's rejected, late, or failed
+			"Miss rate: "       + FormatPercent(
+				stats.numRejected + numMissed + numFailed, stats.numSubmitted) + ", "
+			"Time: "            + std::to_string(timeUs) + " us, "
+			"Latency p50: "     + std::to_string(
+				GetPercentile(latencyUs, 50)) + " us, "
+			"Latency p99: "     + std::to_string(
+				GetPercentile(latencyUs, 99)) + " us, "
+			"Queue depth max: " + std::to_string(stats.maxQueueDepth) + "\n"
+		);
+	}
+
+private:
+
+	// no limit; only the counter is used
+	static constexpr uint64_t sk_threshold =
+		std::numeric_limits<uint64_t>::max() / 2;
+
+	// only touched by the worker's own thread, until Report
+	struct WorkerResult
+	{
+		std::vector<uint64_t> latencyUs;
+		uint64_t numMissed = 0;
+		uint64_t numFailed = 0;
+		uint64_t endUs = 0;
+	}; // struct WorkerResult
+
+	std::unique_ptr<DecentWasmRuntime::MainRunner> CreateRunner(size_t moduleIdx)
+	{
+		static const std::vector<uint8_t>& sk_eventId = GetDefaultEventId();
+		static const std::vector<uint8_t>& sk_eventData = GetDefaultEventData();
+
+		auto runner = DecentWasmRuntime::Internal::make_unique<
+			DecentWasmRuntime::MainRunner
+		>(
+			m_modules[moduleIdx],
+			sk_eventId,
+			sk_eventData,
+			m_config.mod_stack_size,
+			m_config.mod_heap_size,
+			m_config.exec_stack_size
+		);
+		runner->SetPrintCounter(false);
+		return runner;
+	}
+
+	decent_wasm_deadline_config_t m_config;
+	DecentWasmRuntime::SharedWasmRuntime m_wasmRt;
+	std::vector<DecentWasmRuntime::SharedWasmModule> m_modules;
+	Scheduler m_sched;
+	std::vector<WorkerResult> m_workers;
+	uint64_t m_startUs;
+}; // class DecentWasmDeadlineBench
+
+
+/**
+ * @brief The deadline benchmark of this side of the enclave boundary;
+ *        there is at most one, created by DecentWasmDeadlineBenchStart.
+ */
+inline std::unique_ptr<DecentWasmDeadlineBench>& GetDecentWasmDeadlineBench()
+{
+	static std::unique_ptr<DecentWasmDeadlineBench> s_bench;
+	return s_bench;
+}
+
+
+inline std::mutex& GetDecentWasmDeadlineBenchMutex()
+{
+	static std::mutex s_mutex;
+	return s_mutex;
+}
+
+
+inline bool DecentWasmDeadlineBenchStart(
+	const uint8_t* wasmFiles,
+	const uint64_t* fileSizes, size_t numFiles,
+	const decent_wasm_deadline_config_t& config
+)
+{
+	std::lock_guard<std::mutex> lock(GetDecentWasmDeadlineBenchMutex());
+	try
+	{
+		// the previous runtime must be gone before a new one is created
+		GetDecentWasmDeadlineBench().reset();
+		GetDecentWasmDeadlineBench() =
+			DecentWasmRuntime::Internal::make_unique<DecentWasmDeadlineBench>(
+				wasmFiles, fileSizes, numFiles, config
+			);
+		return true;
+	}
+	catch(const std::exception& e)
+	{
+		PrintStr(e.what());
+		PrintStr("\n");
+		return false;
+	}
+}
+
+
+/**
+ * @brief Submit an event; like the workers, the load generator doesn't take
+ *        the lock, since the benchmark stays until
+ *        DecentWasmDeadlineBenchFinish.
+ *
+ * @return false if the event is rejected.
+ */
+inline bool DecentWasmDeadlineBenchSubmit(size_t moduleIdx, uint64_t deadlineUs)
+{
+	DecentWasmDeadlineBench* bench = GetDecentWasmDeadlineBench().get();
+	return (bench != nullptr) && bench->Submit(moduleIdx, deadlineUs);
+}
+
+
+inline void DecentWasmDeadlineBenchWork(size_t workerIdx)
+{
+	DecentWasmDeadlineBench* bench = GetDecentWasmDeadlineBench().get();
+	if (bench == nullptr)
+	{
+		PrintStr("The deadline benchmark has not been started\n");
+		return;
+	}
+	bench->Work(workerIdx);
+}
+
+
+inline void DecentWasmDeadlineBenchClose()
+{
+	DecentWasmDeadlineBench* bench = GetDecentWasmDeadlineBench().get();
+	if (bench != nullptr)
+	{
+		bench->Close();
+	}
+}
+
+
+/**
+ * @brief Report and destroy the benchmark; must only be called after all
+ *        the workers have returned.
+ *
+ */
+inline void DecentWasmDeadlineBenchFinish()
+{
+	std::lock_guard<std::mutex> lock(GetDecentWasmDeadlineBenchMutex());
+	if (GetDecentWasmDeadlineBench() != nullptr)
+	{
+		GetDecentWasmDeadlineBench()->Report();
+		GetDecentWasmDeadlineBench().reset();
+	}
+}
+
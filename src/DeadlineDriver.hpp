@@ -0,0 +1,345 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sgx_urts.h>
+
+#include "BenchUtils.hpp"
+#include "DeadlineBench.hpp"
+#include "HostUtils.hpp"
+#include "decent_wasm_config.h"
+
+
+extern "C" {
+
+extern sgx_status_t ecall_decent_wasm_deadline_start(
+	sgx_enclave_id_t eid,
+	int *retval,
+	const uint8_t *wasm_files, size_t wasm_files_size,
+	const uint64_t *file_sizes, size_t num_files,
+	const decent_wasm_deadline_config_t *config
+);
+
+extern sgx_status_t ecall_decent_wasm_deadline_submit(
+	sgx_enclave_id_t eid,
+	int *retval,
+	uint32_t module_idx,
+	uint64_t deadline_us
+);
+
+extern sgx_status_t ecall_decent_wasm_deadline_work(
+	sgx_enclave_id_t eid,
+	uint32_t worker_idx
+);
+
+extern sgx_status_t ecall_decent_wasm_deadline_close(sgx_enclave_id_t eid);
+
+extern sgx_status_t ecall_decent_wasm_deadline_finish(sgx_enclave_id_t eid);
+
+} // extern "C"
+
+
+struct DeadlineLoad
+{
+	// events per second, on average
+	double rate = 100.0;
+	uint32_t numEvents = 1000;
+	// deadlines, relative to the arrival, are picked uniformly in this range
+	uint64_t deadlineMinUs = 10000;
+	uint64_t deadlineMaxUs = 100000;
+	uint32_t seed = 0;
+}; // struct DeadlineLoad
+
+struct DeadlineArrival
+{
+	// relative to the start of the load
+	uint64_t arrivalUs = 0;
+	uint32_t moduleIdx = 0;
+	uint64_t deadlineUs = 0;
+}; // struct DeadlineArrival
+
+inline decent_wasm_deadline_config_t ParseDeadlineConfig(
+	int argc, char** argv, int startIdx,
+	DeadlineLoad& load
+)
+{
+	decent_wasm_deadline_config_t config;
+	config.pool_size       = 64 * 1024 * 1024; // 64 MB
+	config.num_workers     = 1;
+	config.policy          = DECENT_WASM_DEADLINE_FIFO;
+	config.mod_stack_size  = 64 * 1024;        // 64 KB
+	config.mod_heap_size   = 1 * 1024 * 1024;  //  1 MB
+	config.exec_stack_size = 64 * 1024;        // 64 KB
+	config.unknown_cost_us = 0;
+	config.calibrate       = 1;
+
+	for (int i = startIdx; i < argc; ++i)
+	{
+		const std::string opt = argv[i];
+		if ((i + 1) >= argc)
+		{
+			throw std::invalid_argument("Missing value for option " + opt);
+		}
+
+		const std::string val = argv[++i];
+		if (opt == "--pool")
+		{
+			config.pool_size = static_cast<uint32_t>(std::stoul(val));
+		}
+		else if (opt == "--mod-stack")
+		{
+			config.mod_stack_size = static_cast<uint32_t>(std::stoul(val));
+		}
+		else if (opt == "--mod-heap")
+		{
+			config.mod_heap_size = static_cast<uint32_t>(std::stoul(val));
+		}
+		else if (opt == "--exec-stack")
+		{
+			config.exec_stack_size = static_cast<uint32_t>(std::stoul(val));
+		}
+		else if (opt == "--unknown-cost")
+		{
+			config.unknown_cost_us = static_cast<uint32_t>(std::stoul(val));
+		}
+		else if (opt == "--calibrate")
+		{
+			config.calibrate = static_cast<uint32_t>(std::stoul(val));
+		}
+		else if (opt == "--deadline-min")
+		{
+			load.deadlineMinUs = std::stoull(val);
+		}
+		else if (opt == "--deadline-max")
+		{
+			load.deadlineMaxUs = std::stoull(val);
+		}
+		else if (opt == "--seed")
+		{
+			load.seed = static_cast<uint32_t>(std::stoul(val));
+		}
+		else
+		{
+			throw std::invalid_argument("Unknown option " + opt);
+		}
+	}
+
+	if (load.deadlineMaxUs < load.deadlineMinUs)
+	{
+		throw std::invalid_argument("--deadline-max is less than --deadline-min");
+	}
+
+	return config;
+}
+
+/**
+ * @brief Generate an open-loop load: Poisson arrivals at the given rate, the
+ *        k-th module picked 1/k as often as the first, and deadlines picked
+ *        uniformly in the given range.
+ *
+ */
+inline std::vector<DeadlineArrival> GenerateDeadlineLoad(
+	const DeadlineLoad& load,
+	size_t numModules
+)
+{
+	const std::vector<double> weights = GetZipfWeights(numModules);
+
+	std::mt19937 rng(load.seed);
+	std::exponential_distribution<double> interArrival(load.rate / 1e6);
+	std::discrete_distribution<uint32_t> pick(weights.begin(), weights.end());
+	std::uniform_int_distribution<uint64_t> deadline(
+		load.deadlineMinUs,
+		load.deadlineMaxUs
+	);
+
+	std::vector<DeadlineArrival> arrivals(load.numEvents);
+	double arrivalUs = 0.0;
+	for (auto& arrival : arrivals)
+	{
+		arrivalUs += interArrival(rng);
+		arrival.arrivalUs = static_cast<uint64_t>(arrivalUs);
+		arrival.moduleIdx = pick(rng);
+		arrival.deadlineUs = deadline(rng);
+	}
+	return arrivals;
+}
+
+/**
+ * @brief Start the workers, submit the arrivals on time from this thread,
+ *        and wait for the workers to run all the accepted events.
+ *
+ */
+inline void RunDeadlineLoad(
+	const std::vector<DeadlineArrival>& arrivals,
+	uint32_t numWorkers,
+	const std::function<void(uint32_t)>& work,
+	const std::function<void(const DeadlineArrival&)>& submit,
+	const std::function<void()>& close
+)
+{
+	std::vector<std::thread> workers;
+	for (uint32_t i = 0; i < numWorkers; ++i)
+	{
+		workers.emplace_back(work, i);
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	for (const auto& arrival : arrivals)
+	{
+		std::this_thread::sleep_until(
+			start + std::chrono::microseconds(arrival.arrivalUs)
+		);
+		submit(arrival);
+	}
+	close();
+
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+/**
+ * @brief Run the same synthetic load of events with deadlines under each
+ *        scheduling policy (FIFO first, as the baseline), on the untrusted
+ *        side and in the enclave, and report the deadline miss rates and
+ *        latencies.
+ *
+ */
+inline int DeadlineMain(int argc, char**argv)
+{
+	if (argc < 5)
+	{
+		std::cerr << "Usage: "
+			<< argv[0] << " <num workers> <events per second> <num events>"
+			<< " <instrumented wasm file> [<instrumented wasm file>...]"
+			<< " [--pool <bytes>] [--mod-stack <bytes>] [--mod-heap <bytes>]"
+			<< " [--exec-stack <bytes>]"
+			<< " [--deadline-min <us>] [--deadline-max <us>] [--seed <seed>]"
+			<< " [--unknown-cost <us>] [--calibrate <0|1>]"
+			<< std::endl;
+		return -1;
+	}
+
+	int optIdx = 4;
+	std::vector<std::string> modulePaths;
+	for (; (optIdx < argc) && (std::string(argv[optIdx]).rfind("--", 0) != 0); ++optIdx)
+	{
+		modulePaths.push_back(argv[optIdx]);
+	}
+	DeadlineLoad load;
+	decent_wasm_deadline_config_t config =
+		ParseDeadlineConfig(argc, argv, optIdx, load);
+	config.num_workers = std::max<uint32_t>(std::stoul(argv[1]), 1);
+	load.rate = std::stod(argv[2]);
+	load.numEvents = static_cast<uint32_t>(std::stoul(argv[3]));
+	if (load.rate <= 0.0)
+	{
+		std::cerr << "ERROR: " << "The rate must be positive." << std::endl;
+		return -1;
+	}
+	// the submitting thread calls into the enclave while the workers run
+	if (!CheckEnclaveWorkers(config.num_workers, 1))
+	{
+		return -1;
+	}
+
+	std::vector<uint8_t> wasmFiles;
+	std::vector<uint64_t> fileSizes;
+	ReadFiles2Buffer(modulePaths, wasmFiles, fileSizes);
+
+	// the same load for every policy
+	const std::vector<DeadlineArrival> arrivals =
+		GenerateDeadlineLoad(load, modulePaths.size());
+
+	static const uint32_t sk_policies[] = {
+		DECENT_WASM_DEADLINE_FIFO,
+		DECENT_WASM_DEADLINE_EARLIEST_DEADLINE,
+		DECENT_WASM_DEADLINE_SHORTEST_PREDICTED,
+	};
+
+	for (uint32_t policy : sk_policies)
+	{
+		config.policy = policy;
+		if (!DecentWasmDeadlineBenchStart(
+			wasmFiles.data(), fileSizes.data(), fileSizes.size(), config
+		))
+		{
+			return -1;
+		}
+		RunDeadlineLoad(
+			arrivals,
+			config.num_workers,
+			DecentWasmDeadlineBenchWork,
+			[](const DeadlineArrival& arrival) {
+				DecentWasmDeadlineBenchSubmit(arrival.moduleIdx, arrival.deadlineUs);
+			},
+			DecentWasmDeadlineBenchClose
+		);
+		DecentWasmDeadlineBenchFinish();
+	}
+
+	sgx_enclave_id_t eid = 0;
+	enclave_init(&eid);
+
+	for (uint32_t policy : sk_policies)
+	{
+		config.policy = policy;
+		int retval = -1;
+		auto ret = ecall_decent_wasm_deadline_start(
+			eid,
+			&retval,
+			wasmFiles.data(), wasmFiles.size(),
+			fileSizes.data(), fileSizes.size(),
+			&config
+		);
+		if ((ret != SGX_SUCCESS) || (retval != 0))
+		{
+			std::cerr << "ERROR: "
+				<< "Failed to run ecall_decent_wasm_deadline_start." << std::endl;
+			break;
+		}
+		RunDeadlineLoad(
+			arrivals,
+			config.num_workers,
+			[eid](uint32_t workerIdx) {
+				if (ecall_decent_wasm_deadline_work(eid, workerIdx) != SGX_SUCCESS)
+				{
+					std::cerr << "ERROR: "
+						<< "Failed to run ecall_decent_wasm_deadline_work." << std::endl;
+				}
+			},
+			[eid](const DeadlineArrival& arrival) {
+				int accepted = 0;
+				ecall_decent_wasm_deadline_submit(
+					eid, &accepted, arrival.moduleIdx, arrival.deadlineUs
+				);
+			},
+			[eid]() {
+				ecall_decent_wasm_deadline_close(eid);
+			}
+		);
+		ecall_decent_wasm_deadline_finish(eid);
+	}
+
+	sgx_destroy_enclave(eid);
+
+	return 0;
+}
@@ -0,0 +1,411 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <utility>
+#include <vector>
+
+
+/**
+ * @brief Predicts how long a run of each module takes, from the instruction
+ *        counters and the times of its previous runs.
+ *
+ *        Both the counter per run and the time per counted instruction are
+ *        moving averages (EWMA). The counter says how much work a run of the
+ *        module does, and barely changes between runs of the same input;
+ *        the time per instruction says how fast that work runs here, which
+ *        depends on the module's memory behaviour and on the side of the
+ *        enclave boundary it runs on.
+ *
+ */
+class ModuleCostModel
+{
+public: // static members
+
+	// weight of the newest sample in the moving averages
+	static constexpr double sk_weight = 0.125;
+
+public:
+
+	explicit ModuleCostModel(size_t numModules) :
+		m_costs(numModules)
+	{}
+
+	void Update(size_t moduleIdx, uint64_t counter, uint64_t timeUs)
+	{
+		Cost& cost = m_costs[moduleIdx];
+		const double counterSample = static_cast<double>(counter);
+		// a run too short to count still takes time
+		const double usPerCountSample = static_cast<double>(timeUs) /
+			static_cast<double>(counter > 0 ? counter : 1);
+
+		if (cost.numSamples == 0)
+		{
+			cost.counter = counterSample;
+			cost.usPerCount = usPerCountSample;
+		}
+		else
+		{
+			cost.counter += sk_weight * (counterSample - cost.counter);
+			cost.usPerCount += sk_weight * (usPerCountSample - cost.usPerCount);
+		}
+		++cost.numSamples;
+	}
+
+	/**
+	 * @return true if the module has been run, so it can be predicted.
+	 */
+	bool HasSamples(size_t moduleIdx) const
+	{
+		return m_costs[moduleIdx].numSamples > 0;
+	}
+
+	/**
+	 * @return The predicted time of a run of the module;
+	 *         0 if it has no samples (see HasSamples).
+	 */
+	uint64_t PredictUs(size_t moduleIdx) const
+	{
+		const Cost& cost = m_costs[moduleIdx];
+		return static_cast<uint64_t>(cost.counter * cost.usPerCount);
+	}
+
+private:
+
+	struct Cost
+	{
+		double counter = 0.0;
+		double usPerCount = 0.0;
+		uint64_t numSamples = 0;
+	}; // struct Cost
+
+	std::vector<Cost> m_costs;
+}; // class ModuleCostModel
+
+
+/**
+ * @brief A queue of events with deadlines, shared by a fixed set of worker
+ *        threads, which orders the events by the given policy.
+ *
+ *        Except in Fifo mode, an event is rejected when it's submitted, if
+ *        it's predicted to miss its deadline: i.e., if the predicted time of
+ *        the events running and of those queued ahead of it, spread over the
+ *        workers, plus its own predicted time, ends after its deadline.
+ *        It's also rejected if it would overtake a queued event which is
+ *        predicted to make its deadline, and push it past that deadline;
+ *        so an admitted event is never made late by a later one, only by
+ *        mispredictions.
+ *        Rejecting it right away lets the sender act on it, and keeps it from
+ *        delaying events which can still make it.
+ *        A module which hasn't been run yet is predicted to take the given
+ *        prior; without one (0), its events are always admitted, since
+ *        nothing tells they would miss their deadlines.
+ *
+ *        Like WorkStealingScheduler, it doesn't create threads.
+ *
+ */
+template<typename _EventType>
+class DeadlineScheduler
+{
+public: // static members
+
+	enum class Policy
+	{
+		// first come, first served; nothing is rejected
+		Fifo,
+		// earliest deadline first, then shortest predicted time
+		EarliestDeadline,
+		// shortest predicted time first, then earliest deadline
+		ShortestPredicted,
+	}; // enum class Policy
+
+	/**
+	 * @brief An event taken by a worker, which is given back to Done.
+	 */
+	struct Taken
+	{
+		size_t moduleIdx = 0;
+		uint64_t deadlineUs = 0;
+		uint64_t predictedUs = 0;
+		_EventType event;
+	}; // struct Taken
+
+	struct Stats
+	{
+		uint64_t numSubmitted = 0;
+		uint64_t numRejected = 0;
+		// of the rejected, those which would have made a queued event late
+		uint64_t numRejectedOvertaking = 0;
+		// submitted while their modules had no cost samples
+		uint64_t numUnknownCost = 0;
+		uint64_t maxQueueDepth = 0;
+	}; // struct Stats
+
+public:
+
+	/**
+	 * @param unknownCostUs The predicted time of a run of a module which
+	 *                      hasn't been run yet; 0 to always admit its events.
+	 */
+	DeadlineScheduler(
+		size_t numWorkers,
+		size_t numModules,
+		Policy policy,
+		uint64_t unknownCostUs
+	) :
+		m_numWorkers(numWorkers),
+		m_policy(policy),
+		m_unknownCostUs(unknownCostUs),
+		m_mutex(),
+		m_cond(),
+		m_queue(),
+		m_model(numModules),
+		m_nextSeq(0),
+		m_runningUs(0),
+		m_stats(),
+		m_closed(false)
+	{}
+
+	DeadlineScheduler(const DeadlineScheduler&) = delete;
+
+	DeadlineScheduler& operator=(const DeadlineScheduler&) = delete;
+
+	/**
+	 * @brief Seed the cost model, e.g., with a calibration run.
+	 *
+	 */
+	void UpdateCost(size_t moduleIdx, uint64_t counter, uint64_t timeUs)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_model.Update(moduleIdx, counter, timeUs);
+	}
+
+	/**
+	 * @return false if the event is rejected.
+	 */
+	bool Submit(
+		size_t moduleIdx,
+		uint64_t nowUs,
+		uint64_t deadlineUs,
+		_EventType event
+	)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			++m_stats.numSubmitted;
+
+			Item item;
+			item.seq = m_nextSeq++;
+			item.taken.moduleIdx = moduleIdx;
+			item.taken.deadlineUs = deadlineUs;
+			const bool hasCost = m_model.HasSamples(moduleIdx);
+			if (!hasCost)
+			{
+				++m_stats.numUnknownCost;
+			}
+			item.taken.predictedUs = hasCost ?
+				m_model.PredictUs(moduleIdx) : m_unknownCostUs;
+			switch (m_policy)
+			{
+			case Policy::EarliestDeadline:
+				item.primaryKey = deadlineUs;
+				item.secondaryKey = item.taken.predictedUs;
+				break;
+			case Policy::ShortestPredicted:
+				item.primaryKey = item.taken.predictedUs;
+				item.secondaryKey = deadlineUs;
+				break;
+			case Policy::Fifo:
+			default:
+				item.primaryKey = item.seq;
+				item.secondaryKey = 0;
+				break;
+			}
+
+			if (m_policy != Policy::Fifo)
+			{
+				if ((hasCost || (m_unknownCostUs != 0)) &&
+					(GetPredictedEndUs(item, nowUs) > deadlineUs))
+				{
+					++m_stats.numRejected;
+					return false;
+				}
+				if (DelaysQueuedPastDeadline(item, nowUs))
+				{
+					++m_stats.numRejected;
+					++m_stats.numRejectedOvertaking;
+					return false;
+				}
+			}
+
+			item.taken.event = std::move(event);
+			m_queue.insert(std::move(item));
+			if (m_queue.size() > m_stats.maxQueueDepth)
+			{
+				m_stats.maxQueueDepth = m_queue.size();
+			}
+		}
+		m_cond.notify_one();
+		return true;
+	}
+
+	/**
+	 * @brief No more events will be submitted; workers return from Next
+	 *        once all the queued events are taken.
+	 *
+	 */
+	void Close()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_closed = true;
+		}
+		m_cond.notify_all();
+	}
+
+	/**
+	 * @brief Take the next event, waiting for one if needed; the worker must
+	 *        call Done once it has run.
+	 *
+	 * @return false once the scheduler is closed and no event is left.
+	 */
+	bool Next(Taken& taken)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cond.wait(lock, [this]() {
+			return !m_queue.empty() || m_closed;
+		});
+		if (m_queue.empty())
+		{
+			return false;
+		}
+
+		auto it = m_queue.begin();
+		taken = std::move(it->taken);
+		m_queue.erase(it);
+		m_runningUs += taken.predictedUs;
+		return true;
+	}
+
+	/**
+	 * @param counter The instruction counter of the run.
+	 * @param runUs   The time of the run.
+	 */
+	void Done(const Taken& taken, uint64_t counter, uint64_t runUs)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_runningUs -= taken.predictedUs;
+		m_model.Update(taken.moduleIdx, counter, runUs);
+	}
+
+	/**
+	 * @brief For an event which failed to run, thus says nothing about the
+	 *        cost of its module.
+	 *
+	 */
+	void Done(const Taken& taken)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_runningUs -= taken.predictedUs;
+	}
+
+	Stats GetStats() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_stats;
+	}
+
+private:
+
+	struct Item
+	{
+		uint64_t primaryKey = 0;
+		uint64_t secondaryKey = 0;
+		// keeps equal keys in submission order
+		uint64_t seq = 0;
+		// mutable so it can be moved out of the set before erasing it
+		mutable Taken taken;
+
+		bool operator<(const Item& other) const
+		{
+			if (primaryKey != other.primaryKey)
+			{
+				return primaryKey < other.primaryKey;
+			}
+			if (secondaryKey != other.secondaryKey)
+			{
+				return secondaryKey < other.secondaryKey;
+			}
+			return seq < other.seq;
+		}
+	}; // struct Item
+
+	// must be called with m_mutex held
+	uint64_t GetPredictedEndUs(const Item& item, uint64_t nowUs) const
+	{
+		uint64_t aheadUs = m_runningUs;
+		for (auto it = m_queue.begin(); (it != m_queue.end()) && (*it < item); ++it)
+		{
+			aheadUs += it->taken.predictedUs;
+		}
+		return nowUs + (aheadUs / m_numWorkers) + item.taken.predictedUs;
+	}
+
+	/**
+	 * @brief Check if queueing the item would push an event queued behind
+	 *        it past its deadline, when that event is predicted to make it
+	 *        without the item. Must be called with m_mutex held.
+	 *
+	 */
+	bool DelaysQueuedPastDeadline(const Item& item, uint64_t nowUs) const
+	{
+		if (item.taken.predictedUs == 0)
+		{
+			return false;
+		}
+
+		uint64_t aheadUs = m_runningUs;
+		for (const Item& queued : m_queue)
+		{
+			if (item < queued)
+			{
+				const uint64_t endUs = nowUs + (aheadUs / m_numWorkers) +
+					queued.taken.predictedUs;
+				const uint64_t delayedEndUs = nowUs +
+					((aheadUs + item.taken.predictedUs) / m_numWorkers) +
+					queued.taken.predictedUs;
+				if ((endUs <= queued.taken.deadlineUs) &&
+					(delayedEndUs > queued.taken.deadlineUs))
+				{
+					return true;
+				}
+			}
+			aheadUs += queued.taken.predictedUs;
+		}
+		return false;
+	}
+
+	size_t m_numWorkers;
+	Policy m_policy;
+	uint64_t m_unknownCostUs;
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::set<Item> m_queue;
+	ModuleCostModel m_model;
+	uint64_t m_nextSeq;
+	// predicted time of the events being run
+	uint64_t m_runningUs;
+	Stats m_stats;
+	bool m_closed;
+}; // class DeadlineScheduler
+
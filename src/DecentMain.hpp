@@ -16,11 +16,452 @@
 #include <DecentWasmRuntime/WasmRuntimeStaticHeap.hpp>
 
 #include "SystemIO.hpp"
+#include "decent_wasm_config.h"
+
+
+inline void PrintLinearMemStats(
+	const DecentWasmRuntime::MainRunner& runner,
+	const DecentWasmRuntime::LinearMemStats& prevStats
+)
+{
+	const auto& stats = runner.GetModuleInstance()->GetLinearMemStats();
+	PrintStr(
+		"Linear memory: "
+		"Size: "      + std::to_string(runner.GetModuleInstance()->GetLinearMemSize()) + " bytes, "
+		"Runs grown: " + std::to_string(
+			stats.numRunsGrown - prevStats.numRunsGrown) + ", "
+		"Grown: "     + std::to_string(stats.bytesGrown - prevStats.bytesGrown) + " bytes, "
+		"Grow time: " + std::to_string(stats.growTimeUs - prevStats.growTimeUs) + " us\n"
+	);
+}
+
+
+inline void PrintMemUsage(
+	const std::string& type,
+	const DecentWasmRuntime::SharedWasmRuntime& wasmRt,
+	const DecentWasmRuntime::MainRunner& runner
+)
+{
+	const auto poolUsage = wasmRt->GetMemPoolUsage();
+	const auto instUsage = runner.GetMemUsage();
+	PrintStr(
+		"Memory usage (type=" + type + "): "
+		"Pool total: "    + std::to_string(poolUsage.totalSize) + " bytes, "
+		"Pool used: "     + std::to_string(poolUsage.usedSize) + " bytes, "
+		"Pool peak: "     + std::to_string(poolUsage.peakSize) + " bytes, "
+		"Instance: "      + std::to_string(instUsage.instPoolSize) + " bytes, "
+		"Exec env: "      + std::to_string(instUsage.execEnvPoolSize) + " bytes, "
+		"Linear memory: " + std::to_string(instUsage.linearMemSize) + " bytes, "
+		"App heap peak: " + std::to_string(instUsage.appHeapPeak) + " bytes\n"
+	);
+}
+
+
+inline void PrintRunningMode(
+	const std::string& type,
+	const DecentWasmRuntime::MainRunner& runner
+)
+{
+	PrintStr(
+		"Running mode (type=" + type + "): " +
+		(
+			runner.GetModule()->IsAot() ?
+				std::string("aot") :
+				std::string(
+					DecentWasmRuntime::GetRunningModeName(runner.GetRunningMode())
+				)
+		) + "\n"
+	);
+}
+
+
+inline void PrintPrefaultCost(
+	const std::string& type,
+	const DecentWasmRuntime::MainRunner& runner
+)
+{
+	PrintStr(
+		"Pre-fault (type=" + type + "): "
+		"Instance: " + std::to_string(runner.GetModuleInstance()->GetPrefaultTimeUs()) + " us\n"
+	);
+}
+
+
+inline DecentWasmRuntime::PoolOptions GetPoolOptions(
+	const decent_wasm_main_config_t& config
+)
+{
+	DecentWasmRuntime::PoolOptions opts;
+	opts.prefault     = config.prefault != 0;
+	opts.populate     = config.pool_populate != 0;
+	opts.hugePageHint = config.pool_huge_page_hint != 0;
+	return opts;
+}
+
+
+/**
+ * @brief Create the runtime used by the main benchmark, and report
+ *        how its pool is backed and the time spent on pre-faulting it.
+ *
+ */
+template<typename _PoolAllocator>
+inline DecentWasmRuntime::SharedWasmRuntime CreateMainRuntime(
+	const decent_wasm_main_config_t& config
+)
+{
+	using namespace DecentWasmRuntime;
+	using RuntimeType = BasicWasmRuntimeStaticHeap<_PoolAllocator>;
+
+	std::unique_ptr<RuntimeType> rt = Internal::make_unique<RuntimeType>(
+		PrintCStr,
+		70 * 1024 * 1024, // 70 MB
+		GetTimestampUs,
+		GetPoolOptions(config)
+	);
+	PrintStr(
+		"Pool backing: " +
+		std::string(Internal::GetPoolBackingName(rt->GetPoolBacking())) + "\n"
+	);
+	PrintStr(
+		"Pre-fault (type=pool): "
+		"Pool: " + std::to_string(rt->GetPrefaultTimeUs()) + " us\n"
+	);
+	return SharedWasmRuntime(std::move(rt));
+}
+
+
+/**
+ * @brief How accesses to the linear memories are bounds checked in this
+ *        build; only the untrusted runtime can use hardware (guard page)
+ *        checks, and "default" means WAMR's own default was kept.
+ *
+ */
+inline const char* GetBoundCheckName() noexcept
+{
+#if defined(DECENT_ENCLAVE_PLATFORM_SGX_TRUSTED)
+	return "sw";
+#elif !defined(DECENT_WASM_HW_BOUND_CHECK)
+	return "default";
+#elif DECENT_WASM_HW_BOUND_CHECK
+	return "hw";
+#else
+	return "sw";
+#endif
+}
+
+
+/**
+ * @brief Check if the running mode asked by the config is available in
+ *        this build; if not, a note is printed.
+ *
+ */
+inline bool IsMainRunningModeSupported(const decent_wasm_main_config_t& config)
+{
+	using namespace DecentWasmRuntime;
+
+	if (config.running_mode != 0)
+	{
+		RunningMode mode = static_cast<RunningMode>(config.running_mode);
+		if (!IsRunningModeSupported(mode))
+		{
+			PrintStr(
+				std::string("Running mode ") + GetRunningModeName(mode) +
+				" is not supported; skipped\n"
+			);
+			return false;
+		}
+	}
+	return true;
+}
+
+
+inline DecentWasmRuntime::SharedWasmRuntime CreateMainRuntime(
+	const decent_wasm_main_config_t& config
+)
+{
+	using namespace DecentWasmRuntime;
+
+	auto wasmRt = config.pool_huge_pages ?
+		CreateMainRuntime<HugePagePoolAllocator>(config) :
+		CreateMainRuntime<DefaultPoolAllocator>(config);
+	PrintStr(std::string("Bound check: ") + GetBoundCheckName() + "\n");
+	if (config.running_mode != 0)
+	{
+		wasmRt->SetDefaultRunningMode(
+			static_cast<RunningMode>(config.running_mode)
+		);
+	}
+	return wasmRt;
+}
+
+
+inline void PrintModuleLoad(
+	const std::string& type,
+	const DecentWasmRuntime::SharedWasmModule& mod,
+	uint64_t loadTimeUs
+)
+{
+	PrintStr(
+		"Module load (type=" + type + "): "
+		"Format: " + (mod->IsAot() ? "aot" : "bytecode") + ", "
+		"Time: "   + std::to_string(loadTimeUs) + " us\n"
+	);
+}
+
+
+/**
+ * @brief The bytes of a module to run, either copied for every load, or
+ *        loaded in place, with no copy at all.
+ *
+ *        A buffer loaded in place must be writable, must outlive the module
+ *        loaded from it, and must be loaded only once (see
+ *        WasmModule::LoadInPlace); e.g., a private file mapping, or a buffer
+ *        the enclave has just copied the module into.
+ *
+ *        A buffer holding an AOT artifact can carry the bytecode it's
+ *        compiled from (see WithFallback), which is loaded instead if the
+ *        artifact is rejected by the loader (e.g., compiled by another
+ *        WAMR version, or for another target).
+ *
+ */
+class MainModuleBuffer
+{
+public: // static members
+
+	static MainModuleBuffer Copied(const uint8_t* data, size_t size)
+	{
+		return MainModuleBuffer(data, nullptr, size);
+	}
+
+	static MainModuleBuffer InPlace(uint8_t* data, size_t size)
+	{
+		return MainModuleBuffer(data, data, size);
+	}
+
+public:
+
+	/**
+	 * @brief Get a copy of this buffer that falls back to the given bytecode
+	 *        if this one fails to load.
+	 *
+	 */
+	MainModuleBuffer WithFallback(const MainModuleBuffer& bytecode) const
+	{
+		MainModuleBuffer res = *this;
+		res.m_fallbackData = bytecode.m_data;
+		res.m_fallbackInPlaceData = bytecode.m_inPlaceData;
+		res.m_fallbackSize = bytecode.m_size;
+		return res;
+	}
+
+	/**
+	 * @brief Load the module from this buffer, or from the fallback one if
+	 *        that fails.
+	 *
+	 */
+	DecentWasmRuntime::SharedWasmModule Load(
+		DecentWasmRuntime::SharedWasmRuntime& wasmRt
+	) const
+	{
+		try
+		{
+			return Load(wasmRt, m_data, m_inPlaceData, m_size);
+		}
+		catch(const std::exception& e)
+		{
+			if (m_fallbackData == nullptr)
+			{
+				throw;
+			}
+			PrintStr(
+				std::string("Failed to load the AOT module (") + e.what() +
+				"); loading the bytecode instead\n"
+			);
+		}
+		return Load(wasmRt, m_fallbackData, m_fallbackInPlaceData, m_fallbackSize);
+	}
+
+	/**
+	 * @brief The same as above, but the buffers are always copied, so it can
+	 *        be called any number of times.
+	 *
+	 */
+	DecentWasmRuntime::SharedWasmModule LoadCopy(
+		DecentWasmRuntime::SharedWasmRuntime& wasmRt
+	) const
+	{
+		MainModuleBuffer copied = Copied(m_data, m_size);
+		if (m_fallbackData != nullptr)
+		{
+			copied = copied.WithFallback(Copied(m_fallbackData, m_fallbackSize));
+		}
+		return copied.Load(wasmRt);
+	}
+
+private:
+
+	static DecentWasmRuntime::SharedWasmModule Load(
+		DecentWasmRuntime::SharedWasmRuntime& wasmRt,
+		const uint8_t* data, uint8_t* inPlaceData, size_t size
+	)
+	{
+		return inPlaceData != nullptr ?
+			wasmRt.LoadModuleInPlace(inPlaceData, size) :
+			wasmRt.LoadModule(std::vector<uint8_t>(data, data + size));
+	}
+
+	MainModuleBuffer(const uint8_t* data, uint8_t* inPlaceData, size_t size) :
+		m_data(data),
+		m_inPlaceData(inPlaceData),
+		m_size(size),
+		m_fallbackData(nullptr),
+		m_fallbackInPlaceData(nullptr),
+		m_fallbackSize(0)
+	{}
+
+	const uint8_t* m_data;
+	uint8_t* m_inPlaceData;
+	size_t m_size;
+	const uint8_t* m_fallbackData;
+	uint8_t* m_fallbackInPlaceData;
+	size_t m_fallbackSize;
+}; // class MainModuleBuffer
+
+
+inline DecentWasmRuntime::SharedWasmModule LoadMainModule(
+	const std::string& type,
+	DecentWasmRuntime::SharedWasmRuntime& wasmRt,
+	const MainModuleBuffer& wasmBuf,
+	const DecentWasmRuntime::InstanceSizing& sizing,
+	const decent_wasm_main_config_t& config
+)
+{
+	uint64_t startUs = GetTimestampUs();
+	auto mod = wasmBuf.Load(wasmRt);
+	mod->SetInitLinearMemSize(sizing.initLinearMemSize);
+	uint64_t endUs = GetTimestampUs();
+	mod->SetPrefaultLinearMem(config.prefault != 0);
+	mod->SetHugePageLinearMem(config.pool_huge_pages != 0);
+
+	PrintModuleLoad(type, mod, endUs - startUs);
+	return mod;
+}
+
+
+inline DecentWasmRuntime::InstanceSizing GetDefaultInstanceSizing(
+	const decent_wasm_main_config_t& config
+)
+{
+	DecentWasmRuntime::InstanceSizing sizing;
+	sizing.modStackSize      = 1 * 1024 * 1024;  // mod stack:  1 MB
+	sizing.modHeapSize       = 64 * 1024 * 1024; // mod heap:  64 MB
+	sizing.execStackSize     = 1 * 1024 * 1024;  // exec stack: 1 MB
+	sizing.initLinearMemSize = config.init_linear_mem_size;
+	return sizing;
+}
+
+
+/**
+ * @brief Run only the plain program of a loaded module, for modules that
+ *        have no instrumented build (e.g., bundled modules and
+ *        microbenchmarks).
+ *
+ */
+inline void RunPlainOnly(
+	DecentWasmRuntime::SharedWasmRuntime& wasmRt,
+	DecentWasmRuntime::SharedWasmModule mod,
+	const DecentWasmRuntime::InstanceSizing& sizing,
+	size_t repeatTime
+)
+{
+	using namespace DecentWasmRuntime;
+
+	std::vector<uint8_t> eventId = {
+		'D', 'e', 'c', 'e', 'n', 't', '\0'
+	};
+	std::vector<uint8_t> msgContent = {
+		'E', 'v', 'e', 'n', 't', 'M', 'e', 's', 's', 'a', 'g', 'e', '\0'
+	};
+
+	auto runner = MainRunner(
+		std::move(mod),
+		eventId,
+		msgContent,
+		sizing.modStackSize,
+		sizing.modHeapSize,
+		sizing.execStackSize
+	);
+	PrintRunningMode("plain", runner);
+	PrintPrefaultCost("plain", runner);
+	PrintLinearMemStats(runner, LinearMemStats());
+	for (size_t i = 0; i < repeatTime; ++i)
+	{
+		LinearMemStats prevStats =
+			runner.GetModuleInstance()->GetLinearMemStats();
+		PrintCStr("\n\nStarting to run Decent WASM program (type=plain)...\n");
+		runner.RunPlain();
+		PrintLinearMemStats(runner, prevStats);
+		PrintCStr("Finished to run Decent WASM program (type=plain)...\n");
+	}
+	PrintMemUsage("plain", wasmRt, runner);
+}
+
+
+/**
+ * @brief Run the program once with the given sizes, and pick the sizes
+ *        for the following runs from the memory usage observed.
+ *
+ */
+template<typename _RunFunc>
+inline DecentWasmRuntime::InstanceSizing AutoSizeInstance(
+	const std::string& type,
+	DecentWasmRuntime::SharedWasmRuntime& wasmRt,
+	const MainModuleBuffer& wasmBuf,
+	const std::vector<uint8_t>& eventId,
+	const std::vector<uint8_t>& msgContent,
+	const DecentWasmRuntime::InstanceSizing& sizing,
+	uint32_t marginPercent,
+	_RunFunc runFunc
+)
+{
+	using namespace DecentWasmRuntime;
+
+	InstanceMemUsage usage;
+	{
+		auto mod = wasmBuf.LoadCopy(wasmRt);
+		mod->SetInitLinearMemSize(sizing.initLinearMemSize);
+		auto runner = MainRunner(
+			std::move(mod),
+			eventId,
+			msgContent,
+			sizing.modStackSize,
+			sizing.modHeapSize,
+			sizing.execStackSize
+		);
+		runFunc(runner);
+		usage = runner.GetMemUsage();
+	}
+
+	InstanceSizing res = DecentWasmRuntime::AutoSizeInstance(
+		sizing,
+		usage,
+		marginPercent
+	);
+	PrintStr(
+		"Auto-sized instance (type=" + type + "): "
+		"Mod stack: "          + std::to_string(res.modStackSize) + " bytes, "
+		"Mod heap: "           + std::to_string(res.modHeapSize) + " bytes, "
+		"Exec stack: "         + std::to_string(res.execStackSize) + " bytes, "
+		"Init linear memory: " + std::to_string(res.initLinearMemSize) + " bytes\n"
+	);
+	return res;
+}
 
 
 inline bool DecentWasmMain(
-	const uint8_t *wasm_file, size_t wasm_file_size,
-	const uint8_t *wasm_nopt_file, size_t wasm_nopt_file_size
+	const MainModuleBuffer& wasmBuf,
+	const MainModuleBuffer& instWasmBuf,
+	const decent_wasm_main_config_t& config
 )
 {
 	using namespace DecentWasmRuntime;
@@ -28,21 +469,12 @@ inline bool DecentWasmMain(
 
 	try
 	{
-		std::vector<uint8_t> wasmBytecode(
-			wasm_file,
-			wasm_file + wasm_file_size
-		);
-		std::vector<uint8_t> instWasmBytecode(
-			wasm_nopt_file,
-			wasm_nopt_file + wasm_nopt_file_size
-		);
+		if (!IsMainRunningModeSupported(config))
+		{
+			return true;
+		}
 
-		auto wasmRt = SharedWasmRuntime(
-			Internal::make_unique<WasmRuntimeStaticHeap>(
-				PrintCStr,
-				70 * 1024 * 1024 // 70 MB
-			)
-		);
+		auto wasmRt = CreateMainRuntime(config);
 
 		std::vector<uint8_t> eventId = {
 			'D', 'e', 'c', 'e', 'n', 't', '\0'
@@ -53,42 +485,142 @@ inline bool DecentWasmMain(
 		uint64_t threshold = std::numeric_limits<uint64_t>::max() / 2;
 
 		{
+			InstanceSizing sizing = GetDefaultInstanceSizing(config);
+			if (config.auto_size)
+			{
+				sizing = AutoSizeInstance(
+					"plain",
+					wasmRt,
+					wasmBuf,
+					eventId,
+					msgContent,
+					sizing,
+					config.auto_size_margin,
+					[](MainRunner& runner) { runner.RunPlain(); }
+				);
+			}
+
 			auto runner = MainRunner(
-				wasmRt,
-				wasmBytecode,
+				LoadMainModule("plain", wasmRt, wasmBuf, sizing, config),
 				eventId,
 				msgContent,
-				1 * 1024 * 1024,  // mod stack:  1 MB
-				64 * 1024 * 1024, // mod heap:  64 MB
-				1 * 1024 * 1024   // exec stack: 1 MB
+				sizing.modStackSize,
+				sizing.modHeapSize,
+				sizing.execStackSize
 			);
+			PrintRunningMode("plain", runner);
+			PrintPrefaultCost("plain", runner);
+			PrintLinearMemStats(runner, LinearMemStats());
 			for (size_t i = 0; i < sk_repeatTime; ++i)
 			{
+				LinearMemStats prevStats =
+					runner.GetModuleInstance()->GetLinearMemStats();
 				PrintCStr("\n\nStarting to run Decent WASM program (type=plain)...\n");
 				runner.RunPlain();
+				PrintLinearMemStats(runner, prevStats);
 				PrintCStr("Finished to run Decent WASM program (type=plain)...\n");
 			}
+			PrintMemUsage("plain", wasmRt, runner);
 		}
 
 		{
+			InstanceSizing sizing = GetDefaultInstanceSizing(config);
+			if (config.auto_size)
+			{
+				sizing = AutoSizeInstance(
+					"instrumented",
+					wasmRt,
+					instWasmBuf,
+					eventId,
+					msgContent,
+					sizing,
+					config.auto_size_margin,
+					[threshold](MainRunner& runner) {
+						runner.RunInstrumented(threshold);
+						runner.ResetThresholdAndCounter();
+					}
+				);
+			}
+
 			auto runner = MainRunner(
-				wasmRt,
-				instWasmBytecode,
+				LoadMainModule("instrumented", wasmRt, instWasmBuf, sizing, config),
 				eventId,
 				msgContent,
-				1 * 1024 * 1024,  // mod stack:  1 MB
-				64 * 1024 * 1024, // mod heap:  64 MB
-				1 * 1024 * 1024   // exec stack: 1 MB
+				sizing.modStackSize,
+				sizing.modHeapSize,
+				sizing.execStackSize
 			);
+			PrintRunningMode("instrumented", runner);
+			PrintPrefaultCost("instrumented", runner);
+			PrintLinearMemStats(runner, LinearMemStats());
 			for (size_t i = 0; i < sk_repeatTime; ++i)
 			{
+				LinearMemStats prevStats =
+					runner.GetModuleInstance()->GetLinearMemStats();
 				PrintCStr("\n\nStarting to run Decent WASM program (type=instrumented)...\n");
 				runner.RunInstrumented(threshold);
 				runner.ResetThresholdAndCounter();
+				PrintLinearMemStats(runner, prevStats);
 				PrintCStr("Finished to run Decent WASM program (type=instrumented)...\n");
 			}
+			PrintMemUsage("instrumented", wasmRt, runner);
+		}
+
+		return true;
+	}
+	catch(const std::exception& e)
+	{
+		PrintStr(e.what());
+		PrintStr("\n");
+		return false;
+	}
+}
+
+
+inline bool DecentWasmMain(
+	const uint8_t *wasm_file, size_t wasm_file_size,
+	const uint8_t *wasm_nopt_file, size_t wasm_nopt_file_size,
+	const decent_wasm_main_config_t& config
+)
+{
+	return DecentWasmMain(
+		MainModuleBuffer::Copied(wasm_file, wasm_file_size),
+		MainModuleBuffer::Copied(wasm_nopt_file, wasm_nopt_file_size),
+		config
+	);
+}
+
+
+/**
+ * @brief Run a microbenchmark module (e.g., test/wasm/test-05), which has
+ *        only the plain program, and reports its measurements by itself.
+ *
+ */
+inline bool DecentWasmMicroMain(
+	const MainModuleBuffer& wasmBuf,
+	const decent_wasm_main_config_t& config
+)
+{
+	using namespace DecentWasmRuntime;
+	static constexpr size_t sk_repeatTime = 3;
+
+	try
+	{
+		if (!IsMainRunningModeSupported(config))
+		{
+			return true;
 		}
 
+		auto wasmRt = CreateMainRuntime(config);
+
+		InstanceSizing sizing = GetDefaultInstanceSizing(config);
+		RunPlainOnly(
+			wasmRt,
+			LoadMainModule("plain", wasmRt, wasmBuf, sizing, config),
+			sizing,
+			sk_repeatTime
+		);
+
 		return true;
 	}
 	catch(const std::exception& e)
@@ -99,3 +631,15 @@ inline bool DecentWasmMain(
 	}
 }
 
+
+inline bool DecentWasmMicroMain(
+	const uint8_t *wasm_file, size_t wasm_file_size,
+	const decent_wasm_main_config_t& config
+)
+{
+	return DecentWasmMicroMain(
+		MainModuleBuffer::Copied(wasm_file, wasm_file_size),
+		config
+	);
+}
+
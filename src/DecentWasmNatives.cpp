@@ -8,20 +8,85 @@
 
 #include <wasm_export.h>
 
+#include <DecentWasmRuntime/RawNative.hpp>
 #include <DecentWasmRuntime/WasmExecEnv.hpp>
 
+#include "HostMemOps.hpp"
 #include "SystemIO.hpp"
 
+#ifdef DECENT_WASM_HOST_KERNELS
+#	include "HostKernels.hpp"
+#endif
 
-extern "C" void emscripten_memcpy_js(
+
+/**
+ * @brief Check that a whole destination buffer is in the linear memory;
+ *        the `*~` signature only checks the buffer right before the length.
+ *
+ */
+static bool ValidateDestBuf(wasm_exec_env_t exec_env, void* dest, uint32_t n)
+{
+	wasm_module_inst_t module_inst = wasm_runtime_get_module_inst(exec_env);
+	if (!wasm_runtime_validate_native_addr(module_inst, dest, n))
+	{
+		wasm_runtime_set_exception(module_inst, "out of bounds memory access");
+		return false;
+	}
+	return true;
+}
+
+
+extern "C" void decent_wasm_memcpy(
 	wasm_exec_env_t exec_env,
 	void* dest,
 	const void* src,
-	size_t n
+	uint32_t n
+)
+{
+	if (!ValidateDestBuf(exec_env, dest, n))
+	{
+		return;
+	}
+	HostMemOps::Copy(dest, src, n);
+}
+
+
+extern "C" void decent_wasm_memmove(
+	wasm_exec_env_t exec_env,
+	void* dest,
+	const void* src,
+	uint32_t n
+)
+{
+	if (!ValidateDestBuf(exec_env, dest, n))
+	{
+		return;
+	}
+	HostMemOps::Move(dest, src, n);
+}
+
+
+extern "C" void decent_wasm_memset(
+	wasm_exec_env_t exec_env,
+	void* dest,
+	int val,
+	uint32_t n
 )
+{
+	// in the C library's order, so the length doesn't follow the buffer
+	// and isn't checked by the signature
+	if (!ValidateDestBuf(exec_env, dest, n))
+	{
+		return;
+	}
+	HostMemOps::Fill(dest, static_cast<uint8_t>(val), n);
+}
+
+
+extern "C" uint64_t decent_wasm_timestamp_us(wasm_exec_env_t exec_env)
 {
 	(void)exec_env;
-	std::memcpy(dest, src, n);
+	return GetTimestampUs();
 }
 
 extern "C" int decent_wasm_sum(wasm_exec_env_t exec_env, int a, int b)
@@ -31,6 +96,47 @@ extern "C" int decent_wasm_sum(wasm_exec_env_t exec_env, int a, int b)
 }
 
 
+// Natives for measuring the cost of host calls (see test/wasm/test-06)
+
+
+extern "C" void decent_wasm_noop(wasm_exec_env_t exec_env)
+{
+	(void)exec_env;
+}
+
+
+extern "C" uint32_t decent_wasm_buf_peek(
+	wasm_exec_env_t exec_env,
+	const void* buf,
+	uint32_t len
+)
+{
+	(void)exec_env;
+	return len > 0 ? static_cast<const uint8_t*>(buf)[0] : 0;
+}
+
+
+extern "C" uint32_t decent_wasm_strlen(wasm_exec_env_t exec_env, const char* str)
+{
+	(void)exec_env;
+	return static_cast<uint32_t>(std::strlen(str));
+}
+
+
+extern "C" void decent_wasm_ocall_noop(wasm_exec_env_t exec_env)
+{
+	try
+	{
+		CallUntrustedNoop();
+	}
+	catch (const std::exception& e)
+	{
+		wasm_module_inst_t module_inst = wasm_runtime_get_module_inst(exec_env);
+		wasm_runtime_set_exception(module_inst, e.what());
+	}
+}
+
+
 extern "C" void decent_wasm_print_string(wasm_exec_env_t exec_env, const char * msg)
 {
 	(void)exec_env;
@@ -179,3 +285,259 @@ extern "C" void decent_wasm_counter_exceed(wasm_exec_env_t exec_env)
 	}
 }
 
+
+// Raw natives; see decent_wasm_reg_raw_natives
+
+
+static void emscripten_memcpy_js(
+	wasm_exec_env_t exec_env,
+	DecentWasmRuntime::AppPtr dest,
+	DecentWasmRuntime::AppPtr src,
+	uint32_t n
+)
+{
+	void* nativeDest = dest.ToNative(exec_env, n);
+	const void* nativeSrc = src.ToNative(exec_env, n);
+	if ((nativeDest == nullptr) || (nativeSrc == nullptr))
+	{
+		return;
+	}
+	HostMemOps::Copy(nativeDest, nativeSrc, n);
+}
+
+
+static NativeSymbol gs_DecentWasmRawNatives[] =
+{
+	// hot natives, called by every module
+	DECENTWASMRUNTIME_RAW_NATIVE("emscripten_memcpy_js", emscripten_memcpy_js),
+	DECENTWASMRUNTIME_RAW_NATIVE("decent_wasm_get_event_id_len", decent_wasm_get_event_id_len),
+	DECENTWASMRUNTIME_RAW_NATIVE("decent_wasm_get_event_data_len", decent_wasm_get_event_data_len),
+	DECENTWASMRUNTIME_RAW_NATIVE("decent_wasm_counter_exceed", decent_wasm_counter_exceed),
+	// raw counterparts of the host call benchmark natives
+	DECENTWASMRUNTIME_RAW_NATIVE("decent_wasm_sum_raw", decent_wasm_sum),
+	DECENTWASMRUNTIME_RAW_NATIVE("decent_wasm_noop_raw", decent_wasm_noop),
+};
+
+
+// Register the natives that are called through WAMR's raw API, i.e., with
+// the arguments unpacked by RawNative instead of by WAMR per call
+
+
+extern "C" void decent_wasm_reg_raw_natives(void (*os_print)(const char *message))
+{
+	const uint32_t symNum = sizeof(gs_DecentWasmRawNatives) / sizeof(NativeSymbol);
+	if (!wasm_runtime_register_natives_raw("env",
+		gs_DecentWasmRawNatives, symNum))
+	{
+		os_print("ERROR: Failed to register Decent WASM raw native symbols!");
+	}
+}
+
+
+#ifdef DECENT_WASM_HOST_KERNELS
+
+
+// Host kernel natives; dense double-precision kernels run natively on
+// regions of the linear memory (see HostKernels.hpp)
+
+
+/**
+ * @brief Validate an array of `count` doubles in the linear memory, and
+ *        convert it to a native pointer.
+ *
+ * @return The native pointer, or nullptr (with an exception set on the
+ *         module instance) if the array is out of bounds, or misaligned.
+ */
+static double* ToNativeDoubles(
+	wasm_exec_env_t exec_env,
+	DecentWasmRuntime::AppPtr ptr,
+	uint64_t count
+)
+{
+	wasm_module_inst_t module_inst = wasm_runtime_get_module_inst(exec_env);
+	if (count > (UINT32_MAX / sizeof(double)))
+	{
+		wasm_runtime_set_exception(module_inst, "out of bounds memory access");
+		return nullptr;
+	}
+	if ((ptr.offset % alignof(double)) != 0)
+	{
+		wasm_runtime_set_exception(module_inst, "unaligned host kernel argument");
+		return nullptr;
+	}
+	return static_cast<double*>(
+		ptr.ToNative(exec_env, static_cast<uint32_t>(count * sizeof(double)))
+	);
+}
+
+
+/**
+ * @brief Check that the output array of a kernel doesn't overlap an input,
+ *        since the kernels read inputs that they have already written to.
+ */
+static bool CheckNoOverlap(
+	wasm_exec_env_t exec_env,
+	const double* out,
+	uint64_t outCount,
+	const double* in,
+	uint64_t inCount
+)
+{
+	if ((out + outCount <= in) || (in + inCount <= out))
+	{
+		return true;
+	}
+	wasm_module_inst_t module_inst = wasm_runtime_get_module_inst(exec_env);
+	wasm_runtime_set_exception(module_inst, "overlapping host kernel arguments");
+	return false;
+}
+
+
+static void decent_wasm_dgemm(
+	wasm_exec_env_t exec_env,
+	uint32_t m,
+	uint32_t n,
+	uint32_t k,
+	double alpha,
+	DecentWasmRuntime::AppPtr a,
+	DecentWasmRuntime::AppPtr b,
+	double beta,
+	DecentWasmRuntime::AppPtr c
+)
+{
+	const uint64_t aCount = static_cast<uint64_t>(m) * k;
+	const uint64_t bCount = static_cast<uint64_t>(k) * n;
+	const uint64_t cCount = static_cast<uint64_t>(m) * n;
+
+	const double* nativeA = ToNativeDoubles(exec_env, a, aCount);
+	const double* nativeB = ToNativeDoubles(exec_env, b, bCount);
+	double* nativeC = ToNativeDoubles(exec_env, c, cCount);
+	if ((nativeA == nullptr) || (nativeB == nullptr) || (nativeC == nullptr) ||
+		!CheckNoOverlap(exec_env, nativeC, cCount, nativeA, aCount) ||
+		!CheckNoOverlap(exec_env, nativeC, cCount, nativeB, bCount))
+	{
+		return;
+	}
+	HostKernels::Gemm(m, n, k, alpha, nativeA, nativeB, beta, nativeC);
+}
+
+
+static void decent_wasm_dgemv(
+	wasm_exec_env_t exec_env,
+	uint32_t trans,
+	uint32_t m,
+	uint32_t n,
+	double alpha,
+	DecentWasmRuntime::AppPtr a,
+	DecentWasmRuntime::AppPtr x,
+	double beta,
+	DecentWasmRuntime::AppPtr y
+)
+{
+	const uint64_t aCount = static_cast<uint64_t>(m) * n;
+	const uint64_t xCount = (trans != 0) ? m : n;
+	const uint64_t yCount = (trans != 0) ? n : m;
+
+	const double* nativeA = ToNativeDoubles(exec_env, a, aCount);
+	const double* nativeX = ToNativeDoubles(exec_env, x, xCount);
+	double* nativeY = ToNativeDoubles(exec_env, y, yCount);
+	if ((nativeA == nullptr) || (nativeX == nullptr) || (nativeY == nullptr) ||
+		!CheckNoOverlap(exec_env, nativeY, yCount, nativeA, aCount) ||
+		!CheckNoOverlap(exec_env, nativeY, yCount, nativeX, xCount))
+	{
+		return;
+	}
+	HostKernels::Gemv(trans != 0, m, n, alpha, nativeA, nativeX, beta, nativeY);
+}
+
+
+static double decent_wasm_ddot(
+	wasm_exec_env_t exec_env,
+	uint32_t n,
+	DecentWasmRuntime::AppPtr x,
+	DecentWasmRuntime::AppPtr y
+)
+{
+	const double* nativeX = ToNativeDoubles(exec_env, x, n);
+	const double* nativeY = ToNativeDoubles(exec_env, y, n);
+	if ((nativeX == nullptr) || (nativeY == nullptr))
+	{
+		return 0.0;
+	}
+	return HostKernels::Dot(n, nativeX, nativeY);
+}
+
+
+static void decent_wasm_daxpy(
+	wasm_exec_env_t exec_env,
+	uint32_t n,
+	double alpha,
+	DecentWasmRuntime::AppPtr x,
+	DecentWasmRuntime::AppPtr y
+)
+{
+	const double* nativeX = ToNativeDoubles(exec_env, x, n);
+	double* nativeY = ToNativeDoubles(exec_env, y, n);
+	if ((nativeX == nullptr) || (nativeY == nullptr))
+	{
+		return;
+	}
+	// y += a * y is fine element-wise, any other overlap is not
+	if ((nativeX != nativeY) &&
+		!CheckNoOverlap(exec_env, nativeY, n, nativeX, n))
+	{
+		return;
+	}
+	HostKernels::Axpy(n, alpha, nativeX, nativeY);
+}
+
+
+static void decent_wasm_dstencil2d(
+	wasm_exec_env_t exec_env,
+	uint32_t rows,
+	uint32_t cols,
+	double coef,
+	DecentWasmRuntime::AppPtr in,
+	DecentWasmRuntime::AppPtr out
+)
+{
+	const uint64_t count = static_cast<uint64_t>(rows) * cols;
+
+	const double* nativeIn = ToNativeDoubles(exec_env, in, count);
+	double* nativeOut = ToNativeDoubles(exec_env, out, count);
+	if ((nativeIn == nullptr) || (nativeOut == nullptr) ||
+		!CheckNoOverlap(exec_env, nativeOut, count, nativeIn, count))
+	{
+		return;
+	}
+	HostKernels::Stencil2d(rows, cols, coef, nativeIn, nativeOut);
+}
+
+
+static NativeSymbol gs_DecentWasmKernelNatives[] =
+{
+	DECENTWASMRUNTIME_RAW_NATIVE("decent_wasm_dgemm", decent_wasm_dgemm),
+	DECENTWASMRUNTIME_RAW_NATIVE("decent_wasm_dgemv", decent_wasm_dgemv),
+	DECENTWASMRUNTIME_RAW_NATIVE("decent_wasm_ddot", decent_wasm_ddot),
+	DECENTWASMRUNTIME_RAW_NATIVE("decent_wasm_daxpy", decent_wasm_daxpy),
+	DECENTWASMRUNTIME_RAW_NATIVE("decent_wasm_dstencil2d", decent_wasm_dstencil2d),
+};
+
+
+// Register the host kernel natives; they are raw natives too, since their
+// arrays are sized by the other arguments, and have to be validated by hand
+// anyway
+
+
+extern "C" void decent_wasm_reg_kernel_natives(void (*os_print)(const char *message))
+{
+	const uint32_t symNum = sizeof(gs_DecentWasmKernelNatives) / sizeof(NativeSymbol);
+	if (!wasm_runtime_register_natives_raw("env",
+		gs_DecentWasmKernelNatives, symNum))
+	{
+		os_print("ERROR: Failed to register Decent WASM host kernel native symbols!");
+	}
+}
+
+
+#endif // DECENT_WASM_HOST_KERNELS
@@ -0,0 +1,139 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <DecentWasmRuntime/Internal/make_unique.hpp>
+#include <DecentWasmRuntime/MainRunner.hpp>
+#include <DecentWasmRuntime/WasmRuntimeStaticHeap.hpp>
+
+#include "BenchUtils.hpp"
+#include "SystemIO.hpp"
+#include "decent_wasm_config.h"
+
+
+/**
+ * @brief Instantiate increasing numbers of instances from one module, and
+ *        run one event on each instance at every density level, to see
+ *        how latency and pool usage change as instances are added.
+ *
+ */
+inline bool DecentWasmDensityBench(
+	const uint8_t *wasm_file, size_t wasm_file_size,
+	const decent_wasm_density_config_t& config
+)
+{
+	using namespace DecentWasmRuntime;
+
+	try
+	{
+		std::vector<uint8_t> wasmBytecode(
+			wasm_file,
+			wasm_file + wasm_file_size
+		);
+
+		auto wasmRt = SharedWasmRuntime(
+			Internal::make_unique<WasmRuntimeStaticHeap>(
+				PrintCStr,
+				config.pool_size,
+				GetTimestampUs
+			)
+		);
+
+		const std::vector<uint8_t>& eventId = GetDefaultEventId();
+		const std::vector<uint8_t>& msgContent = GetDefaultEventData();
+
+		SharedWasmModule module = wasmRt.LoadModule(wasmBytecode);
+		std::vector<std::unique_ptr<MainRunner> > runners;
+
+		PrintStr(
+			"Density benchmark: "
+			"Pool: "       + std::to_string(config.pool_size) + " bytes, "
+			"Mod stack: "  + std::to_string(config.mod_stack_size) + " bytes, "
+			"Mod heap: "   + std::to_string(config.mod_heap_size) + " bytes, "
+			"Exec stack: " + std::to_string(config.exec_stack_size) + " bytes\n"
+		);
+
+		size_t level = 0;
+		while (level < config.max_instances)
+		{
+			level = std::min<size_t>(
+				(level == 0) ? 1 : (level * 2),
+				config.max_instances
+			);
+
+			// Add instances to reach the current density level
+			uint64_t instTotalUs = 0;
+			uint64_t instMaxUs = 0;
+			size_t numNewInst = level - runners.size();
+			while (runners.size() < level)
+			{
+				uint64_t startUs = GetTimestampUs();
+				try
+				{
+					runners.emplace_back(Internal::make_unique<MainRunner>(
+						module,
+						eventId,
+						msgContent,
+						config.mod_stack_size,
+						config.mod_heap_size,
+						config.exec_stack_size
+					));
+				}
+				catch (const std::exception& e)
+				{
+					PrintStr(
+						"Density limit reached at " +
+						std::to_string(runners.size()) + " instances (" +
+						e.what() + ")\n"
+					);
+					return true;
+				}
+				uint64_t durationUs = GetTimestampUs() - startUs;
+				instTotalUs += durationUs;
+				instMaxUs = std::max(instMaxUs, durationUs);
+			}
+
+			// Run one event on each of the instances
+			uint64_t runTotalUs = 0;
+			uint64_t runMaxUs = 0;
+			for (auto& runner : runners)
+			{
+				uint64_t startUs = GetTimestampUs();
+				runner->RunPlain();
+				uint64_t durationUs = GetTimestampUs() - startUs;
+				runTotalUs += durationUs;
+				runMaxUs = std::max(runMaxUs, durationUs);
+			}
+
+			const auto poolUsage = wasmRt->GetMemPoolUsage();
+			PrintStr(
+				"Density level: "
+				"Instances: "        + std::to_string(runners.size()) + ", "
+				"Instantiate avg: "  + std::to_string(instTotalUs / numNewInst) + " us, "
+				"Instantiate max: "  + std::to_string(instMaxUs) + " us, "
+				"Run avg: "          + std::to_string(runTotalUs / runners.size()) + " us, "
+				"Run max: "          + std::to_string(runMaxUs) + " us, "
+				"Pool used: "        + std::to_string(poolUsage.usedSize) + " bytes, "
+				"Pool peak: "        + std::to_string(poolUsage.peakSize) + " bytes\n"
+			);
+		}
+
+		return true;
+	}
+	catch(const std::exception& e)
+	{
+		PrintStr(e.what());
+		PrintStr("\n");
+		return false;
+	}
+}
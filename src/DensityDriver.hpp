@@ -0,0 +1,125 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sgx_urts.h>
+
+#include "DensityBench.hpp"
+#include "HostUtils.hpp"
+#include "decent_wasm_config.h"
+
+
+extern "C" {
+
+extern sgx_status_t ecall_decent_wasm_density(
+	sgx_enclave_id_t eid,
+	const uint8_t *wasm_file, size_t wasm_file_size,
+	const decent_wasm_density_config_t *config
+);
+
+} // extern "C"
+
+
+inline decent_wasm_density_config_t ParseDensityConfig(
+	int argc, char** argv, int startIdx
+)
+{
+	decent_wasm_density_config_t config;
+	config.pool_size       = 70 * 1024 * 1024; // 70 MB
+	config.max_instances   = 1024;
+	config.mod_stack_size  = 64 * 1024;        // 64 KB
+	config.mod_heap_size   = 1 * 1024 * 1024;  //  1 MB
+	config.exec_stack_size = 64 * 1024;        // 64 KB
+
+	for (int i = startIdx; i < argc; ++i)
+	{
+		const std::string opt = argv[i];
+		if ((i + 1) >= argc)
+		{
+			throw std::invalid_argument("Missing value for option " + opt);
+		}
+
+		uint32_t val = static_cast<uint32_t>(std::stoul(argv[++i]));
+		if (opt == "--pool")
+		{
+			config.pool_size = val;
+		}
+		else if (opt == "--max-inst")
+		{
+			config.max_instances = val;
+		}
+		else if (opt == "--mod-stack")
+		{
+			config.mod_stack_size = val;
+		}
+		else if (opt == "--mod-heap")
+		{
+			config.mod_heap_size = val;
+		}
+		else if (opt == "--exec-stack")
+		{
+			config.exec_stack_size = val;
+		}
+		else
+		{
+			throw std::invalid_argument("Unknown option " + opt);
+		}
+	}
+
+	return config;
+}
+
+inline int DensityMain(int argc, char**argv)
+{
+	if (argc < 2)
+	{
+		std::cerr << "Usage: "
+			<< argv[0] << " <wasm file>"
+			<< " [--pool <bytes>]"
+			<< " [--max-inst <num>]"
+			<< " [--mod-stack <bytes>]"
+			<< " [--mod-heap <bytes>]"
+			<< " [--exec-stack <bytes>]" << std::endl;
+		return -1;
+	}
+
+	const std::string wasmFilenamePath = argv[1];
+	const decent_wasm_density_config_t config =
+		ParseDensityConfig(argc, argv, 2);
+
+	auto wasmBytecode = ReadFile2Buffer(wasmFilenamePath);
+
+	if (!DecentWasmDensityBench(wasmBytecode.data(), wasmBytecode.size(), config))
+	{
+		return -1;
+	}
+
+	sgx_enclave_id_t eid = 0;
+	enclave_init(&eid);
+
+	auto ret = ecall_decent_wasm_density(
+		eid,
+		wasmBytecode.data(), wasmBytecode.size(),
+		&config
+	);
+	if(ret != SGX_SUCCESS)
+	{
+		std::cerr << "ERROR: "
+			<< "Failed to run ecall_decent_wasm_density." << std::endl;
+	}
+
+	sgx_destroy_enclave(eid);
+
+	return 0;
+}
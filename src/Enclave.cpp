@@ -3,19 +3,581 @@
 // license that can be found in the LICENSE file or at
 // https://opensource.org/licenses/MIT.
 
+#include <algorithm>
+#include <memory>
+#include <mutex>
+
+#include "AsyncBench.hpp"
+#include "BundleMain.hpp"
+#include "DeadlineBench.hpp"
 #include "DecentMain.hpp"
+#include "DensityBench.hpp"
+#include "LoadGenBench.hpp"
+#include "ModuleReceiver.hpp"
+#include "SchedBench.hpp"
+#include "SealedAotCache.hpp"
+#include "ServerMain.hpp"
+#include "WatchdogBench.hpp"
+
+
+/**
+ * @brief Copy a module from untrusted memory into the enclave, and pick what
+ *        to run for it: the AOT artifact if the cache has one (copied for the
+ *        load, since it stays in the cache), or otherwise the copied bytes,
+ *        loaded in place; they are also the fallback if the artifact fails
+ *        to load.
+ *
+ * @param wasm Set to the copied module, which must outlive the module
+ *             loaded from the returned buffer.
+ * @param aot  Set to the AOT artifact, if it's used.
+ */
+static MainModuleBuffer ReceiveMainModule(
+	const uint8_t* untrusted, size_t size,
+	bool useAotCache,
+	std::vector<uint8_t>& wasm,
+	std::shared_ptr<const std::vector<uint8_t> >& aot
+)
+{
+	ModuleReceiver receiver(size);
+	receiver.AppendUntrusted(untrusted, size);
+
+	ModuleReceiver::Digest hash;
+	wasm = receiver.Finalize(hash);
+	if (useAotCache)
+	{
+		aot = SealedAotCache::GetInstance().Find(hash);
+	}
+
+	MainModuleBuffer wasmBuf = MainModuleBuffer::InPlace(wasm.data(), wasm.size());
+	return aot ?
+		MainModuleBuffer::Copied(aot->data(), aot->size()).WithFallback(wasmBuf) :
+		wasmBuf;
+}
+
+
+/**
+ * @brief Get the buffer of a module given by the untrusted side, which is
+ *        its AOT artifact from the cache if there is one, falling back to
+ *        the bytecode if the artifact fails to load.
+ *
+ */
+static MainModuleBuffer GetCachedModuleBuffer(
+	const uint8_t* wasm, size_t wasmSize,
+	const std::shared_ptr<const std::vector<uint8_t> >& aot
+)
+{
+	MainModuleBuffer wasmBuf = MainModuleBuffer::Copied(wasm, wasmSize);
+	return aot ?
+		MainModuleBuffer::Copied(aot->data(), aot->size()).WithFallback(wasmBuf) :
+		wasmBuf;
+}
+
+
+/**
+ * @brief The module being uploaded to the server in chunks; there is at most
+ *        one upload at a time, since jobs are served one at a time.
+ */
+static std::unique_ptr<ModuleReceiver> gs_serverUpload;
+static std::mutex gs_serverUploadMutex;
+
+
+/**
+ * @brief The watchdog of the runs in the enclave, driven by
+ *        ecall_decent_wasm_watchdog_tick.
+ */
+static DecentWasmRuntime::Watchdog gs_watchdog;
 
 
 extern "C" {
 
 void ecall_decent_wasm_main(
 	const uint8_t *wasm_file, size_t wasm_file_size,
-	const uint8_t *wasm_nopt_file, size_t wasm_nopt_file_size
+	const uint8_t *wasm_nopt_file, size_t wasm_nopt_file_size,
+	const decent_wasm_main_config_t *config
 )
 {
+	// run the AOT artifacts instead, if they have been loaded into the cache
+	// (unless a specific running mode is asked)
+	std::shared_ptr<const std::vector<uint8_t> > aot;
+	std::shared_ptr<const std::vector<uint8_t> > noptAot;
+	if (config->running_mode == 0)
+	{
+		aot = SealedAotCache::GetInstance().Find(wasm_file, wasm_file_size);
+		noptAot = SealedAotCache::GetInstance().Find(
+			wasm_nopt_file,
+			wasm_nopt_file_size
+		);
+	}
+
 	DecentWasmMain(
+		GetCachedModuleBuffer(wasm_file, wasm_file_size, aot),
+		GetCachedModuleBuffer(wasm_nopt_file, wasm_nopt_file_size, noptAot),
+		*config
+	);
+}
+
+void ecall_decent_wasm_main_mapped(
+	const uint8_t *wasm_file, size_t wasm_file_size,
+	const uint8_t *wasm_nopt_file, size_t wasm_nopt_file_size,
+	const decent_wasm_main_config_t *config
+)
+{
+	std::vector<uint8_t> wasm;
+	std::vector<uint8_t> noptWasm;
+	std::shared_ptr<const std::vector<uint8_t> > aot;
+	std::shared_ptr<const std::vector<uint8_t> > noptAot;
+	try
+	{
+		MainModuleBuffer wasmBuf = ReceiveMainModule(
+			wasm_file, wasm_file_size,
+			config->running_mode == 0,
+			wasm, aot
+		);
+		MainModuleBuffer noptWasmBuf = ReceiveMainModule(
+			wasm_nopt_file, wasm_nopt_file_size,
+			config->running_mode == 0,
+			noptWasm, noptAot
+		);
+
+		DecentWasmMain(wasmBuf, noptWasmBuf, *config);
+	}
+	catch(const std::exception& e)
+	{
+		PrintStr(e.what());
+		PrintStr("\n");
+	}
+}
+
+void ecall_decent_wasm_micro(
+	const uint8_t *wasm_file, size_t wasm_file_size,
+	const decent_wasm_main_config_t *config
+)
+{
+	std::shared_ptr<const std::vector<uint8_t> > aot;
+	if (config->running_mode == 0)
+	{
+		aot = SealedAotCache::GetInstance().Find(wasm_file, wasm_file_size);
+	}
+
+	DecentWasmMicroMain(
+		GetCachedModuleBuffer(wasm_file, wasm_file_size, aot),
+		*config
+	);
+}
+
+void ecall_decent_wasm_density(
+	const uint8_t *wasm_file, size_t wasm_file_size,
+	const decent_wasm_density_config_t *config
+)
+{
+	DecentWasmDensityBench(
 		wasm_file, wasm_file_size,
-		wasm_nopt_file, wasm_nopt_file_size
+		*config
+	);
+}
+
+/**
+ * @brief Check that the sizes of modules given one after another in a
+ *        buffer add up to the size of the buffer; the sizes come from the
+ *        untrusted side.
+ *
+ */
+static bool CheckModuleSizes(
+	size_t wasm_files_size,
+	const uint64_t *file_sizes, size_t num_files
+)
+{
+	uint64_t totalSize = 0;
+	for (size_t i = 0; i < num_files; ++i)
+	{
+		if (file_sizes[i] > (wasm_files_size - totalSize))
+		{
+			PrintStr("The module sizes exceed the buffer\n");
+			return false;
+		}
+		totalSize += file_sizes[i];
+	}
+	if (totalSize != wasm_files_size)
+	{
+		PrintStr("The module sizes don't match the buffer\n");
+		return false;
+	}
+	return true;
+}
+
+int ecall_decent_wasm_sched_start(
+	const uint8_t *wasm_files, size_t wasm_files_size,
+	const uint64_t *file_sizes, size_t num_files,
+	const decent_wasm_sched_config_t *config
+)
+{
+	if (!CheckModuleSizes(wasm_files_size, file_sizes, num_files))
+	{
+		return -1;
+	}
+
+	return DecentWasmSchedBenchStart(
+		wasm_files, file_sizes, num_files,
+		*config
+	) ? 0 : -1;
+}
+
+void ecall_decent_wasm_sched_work(uint32_t worker_idx)
+{
+	DecentWasmSchedBenchWork(worker_idx);
+}
+
+void ecall_decent_wasm_sched_finish(void)
+{
+	DecentWasmSchedBenchFinish();
+}
+
+int ecall_decent_wasm_deadline_start(
+	const uint8_t *wasm_files, size_t wasm_files_size,
+	const uint64_t *file_sizes, size_t num_files,
+	const decent_wasm_deadline_config_t *config
+)
+{
+	if (!CheckModuleSizes(wasm_files_size, file_sizes, num_files))
+	{
+		return -1;
+	}
+
+	return DecentWasmDeadlineBenchStart(
+		wasm_files, file_sizes, num_files,
+		*config
+	) ? 0 : -1;
+}
+
+int ecall_decent_wasm_deadline_submit(uint32_t module_idx, uint64_t deadline_us)
+{
+	return DecentWasmDeadlineBenchSubmit(module_idx, deadline_us) ? 1 : 0;
+}
+
+void ecall_decent_wasm_deadline_work(uint32_t worker_idx)
+{
+	DecentWasmDeadlineBenchWork(worker_idx);
+}
+
+void ecall_decent_wasm_deadline_close(void)
+{
+	DecentWasmDeadlineBenchClose();
+}
+
+void ecall_decent_wasm_deadline_finish(void)
+{
+	DecentWasmDeadlineBenchFinish();
+}
+
+int ecall_decent_wasm_async_start(
+	const uint8_t *wasm_file, size_t wasm_file_size,
+	const decent_wasm_async_config_t *config
+)
+{
+	return DecentWasmAsyncBenchStart(
+		wasm_file, wasm_file_size,
+		*config
+	) ? 0 : -1;
+}
+
+void ecall_decent_wasm_async_work(void)
+{
+	DecentWasmAsyncBenchWork();
+}
+
+void ecall_decent_wasm_async_run(void)
+{
+	DecentWasmAsyncBenchRun();
+}
+
+void ecall_decent_wasm_async_close(void)
+{
+	DecentWasmAsyncBenchClose();
+}
+
+void ecall_decent_wasm_async_finish(void)
+{
+	DecentWasmAsyncBenchFinish();
+}
+
+int ecall_decent_wasm_loadgen_start(
+	const uint8_t *wasm_files, size_t wasm_files_size,
+	const uint64_t *file_sizes, size_t num_files,
+	const decent_wasm_loadgen_config_t *config
+)
+{
+	if (!CheckModuleSizes(wasm_files_size, file_sizes, num_files))
+	{
+		return -1;
+	}
+
+	return DecentWasmLoadGenBenchStart(
+		wasm_files, file_sizes, num_files,
+		*config
+	) ? 0 : -1;
+}
+
+int ecall_decent_wasm_loadgen_submit(
+	uint32_t module_idx,
+	const uint8_t *event_id, size_t event_id_size,
+	const uint8_t *event_data, size_t event_data_size,
+	uint64_t arrival_us
+)
+{
+	return DecentWasmLoadGenBenchSubmit(
+		module_idx,
+		event_id, event_id_size,
+		event_data, event_data_size,
+		arrival_us
+	) ? 1 : 0;
+}
+
+void ecall_decent_wasm_loadgen_work(uint32_t worker_idx)
+{
+	DecentWasmLoadGenBenchWork(worker_idx);
+}
+
+void ecall_decent_wasm_loadgen_close(void)
+{
+	DecentWasmLoadGenBenchClose();
+}
+
+void ecall_decent_wasm_loadgen_finish(void)
+{
+	DecentWasmLoadGenBenchFinish();
+}
+
+void ecall_decent_wasm_watchdog_bench(
+	const uint8_t *wasm_file, size_t wasm_file_size,
+	const uint8_t *wasm_nopt_file, size_t wasm_nopt_file_size,
+	const decent_wasm_watchdog_config_t *config
+)
+{
+	DecentWasmWatchdogBench(
+		wasm_file, wasm_file_size,
+		wasm_nopt_file, wasm_nopt_file_size,
+		*config,
+		gs_watchdog
+	);
+}
+
+void ecall_decent_wasm_watchdog_tick(void)
+{
+	gs_watchdog.Expire(GetTimestampUs());
+}
+
+size_t ecall_decent_wasm_aot_sealed_size(size_t aot_file_size)
+{
+	return SealedAotCache::GetSealedSize(aot_file_size);
+}
+
+int ecall_decent_wasm_aot_seal(
+	const uint8_t *wasm_file, size_t wasm_file_size,
+	const uint8_t *aot_file, size_t aot_file_size,
+	uint8_t *sealed_buf, size_t sealed_buf_size
+)
+{
+	try
+	{
+		std::vector<uint8_t> sealed = SealedAotCache::GetInstance().Seal(
+			std::vector<uint8_t>(wasm_file, wasm_file + wasm_file_size),
+			std::vector<uint8_t>(aot_file, aot_file + aot_file_size)
+		);
+		if (sealed.size() != sealed_buf_size)
+		{
+			PrintStr("The buffer size doesn't match the sealed AOT artifact\n");
+			return -1;
+		}
+		std::copy(sealed.begin(), sealed.end(), sealed_buf);
+		return 0;
+	}
+	catch(const std::exception& e)
+	{
+		PrintStr(e.what());
+		PrintStr("\n");
+		return -1;
+	}
+}
+
+int ecall_decent_wasm_aot_load_sealed(
+	const uint8_t *sealed, size_t sealed_size
+)
+{
+	try
+	{
+		SealedAotCache::GetInstance().LoadSealed(sealed, sealed_size);
+		return 0;
+	}
+	catch(const std::exception& e)
+	{
+		PrintStr(e.what());
+		PrintStr("\n");
+		return -1;
+	}
+}
+
+void ecall_decent_wasm_list_bundled(void)
+{
+	DecentWasmListBundled();
+}
+
+int ecall_decent_wasm_run_bundled(
+	uint32_t module_id,
+	const decent_wasm_main_config_t *config
+)
+{
+	return DecentWasmRunBundled(module_id, *config) ? 0 : -1;
+}
+
+int ecall_decent_wasm_server_start(const decent_wasm_main_config_t *config)
+{
+	return DecentWasmServerStart(*config) ? 0 : -1;
+}
+
+void ecall_decent_wasm_server_stop(void)
+{
+	DecentWasmServerStop();
+}
+
+int ecall_decent_wasm_server_load(
+	const uint8_t *wasm_file, size_t wasm_file_size,
+	uint32_t *handle
+)
+{
+	using Sha256 = DecentWasmRuntime::Internal::Sha256;
+
+	// run the AOT artifact instead, if it has been loaded into the cache
+	// (and it loads); the module is still keyed by its bytecode
+	std::shared_ptr<const std::vector<uint8_t> > aot =
+		SealedAotCache::GetInstance().Find(wasm_file, wasm_file_size);
+	const std::string key = Sha256::ToHex(Sha256::Hash(wasm_file, wasm_file_size));
+
+	if (aot && DecentWasmServerLoad(key, aot->data(), aot->size(), *handle))
+	{
+		return 0;
+	}
+	return DecentWasmServerLoad(key, wasm_file, wasm_file_size, *handle) ? 0 : -1;
+}
+
+int ecall_decent_wasm_server_upload_begin(size_t wasm_file_size)
+{
+	std::lock_guard<std::mutex> lock(gs_serverUploadMutex);
+	try
+	{
+		// an unfinished upload is abandoned
+		gs_serverUpload.reset();
+		gs_serverUpload =
+			DecentWasmRuntime::Internal::make_unique<ModuleReceiver>(wasm_file_size);
+		return 0;
+	}
+	catch(const std::exception& e)
+	{
+		PrintStr(e.what());
+		PrintStr("\n");
+		return -1;
+	}
+}
+
+int ecall_decent_wasm_server_upload_append(
+	const uint8_t *chunk, size_t chunk_size
+)
+{
+	std::lock_guard<std::mutex> lock(gs_serverUploadMutex);
+	try
+	{
+		if (gs_serverUpload == nullptr)
+		{
+			PrintStr("No module is being uploaded\n");
+			return -1;
+		}
+		gs_serverUpload->Append(chunk, chunk_size);
+		return 0;
+	}
+	catch(const std::exception& e)
+	{
+		gs_serverUpload.reset();
+		PrintStr(e.what());
+		PrintStr("\n");
+		return -1;
+	}
+}
+
+int ecall_decent_wasm_server_upload_finalize(uint32_t *handle)
+{
+	using Sha256 = DecentWasmRuntime::Internal::Sha256;
+
+	std::unique_ptr<ModuleReceiver> upload;
+	{
+		std::lock_guard<std::mutex> lock(gs_serverUploadMutex);
+		upload = std::move(gs_serverUpload);
+	}
+	if (upload == nullptr)
+	{
+		PrintStr("No module is being uploaded\n");
+		return -1;
+	}
+
+	try
+	{
+		ModuleReceiver::Digest hash;
+		std::vector<uint8_t> wasm = upload->Finalize(hash);
+		upload.reset();
+
+		// the same as ecall_decent_wasm_server_load, but the bytecode is
+		// hashed while received, and moved into the module if it's loaded
+		std::shared_ptr<const std::vector<uint8_t> > aot =
+			SealedAotCache::GetInstance().Find(hash);
+		if (aot && DecentWasmServerLoad(
+				Sha256::ToHex(hash), aot->data(), aot->size(), *handle
+			))
+		{
+			return 0;
+		}
+		return DecentWasmServerLoad(
+			Sha256::ToHex(hash), std::move(wasm), *handle
+		) ? 0 : -1;
+	}
+	catch(const std::exception& e)
+	{
+		PrintStr(e.what());
+		PrintStr("\n");
+		return -1;
+	}
+}
+
+int ecall_decent_wasm_server_load_bundled(uint32_t module_id, uint32_t *handle)
+{
+	if (module_id >= g_decentWasmBundledModuleCount)
+	{
+		PrintStr(
+			"Bundled module " + std::to_string(module_id) + " doesn't exist\n"
+		);
+		return -1;
+	}
+	const DecentWasmBundledModule& bundled = g_decentWasmBundledModules[module_id];
+
+	// loaded from a copy, since the module stays loaded across jobs
+	return DecentWasmServerLoad(
+		std::string("bundle:") + bundled.sha256,
+		bundled.data, bundled.size,
+		*handle
+	) ? 0 : -1;
+}
+
+void ecall_decent_wasm_server_run(
+	uint32_t handle,
+	const uint8_t *event_id, size_t event_id_size,
+	const uint8_t *event_data, size_t event_data_size,
+	uint64_t threshold,
+	decent_wasm_job_result_t *result
+)
+{
+	DecentWasmServerRun(
+		handle,
+		std::vector<uint8_t>(event_id, event_id + event_id_size),
+		std::vector<uint8_t>(event_data, event_data + event_data_size),
+		threshold,
+		*result
 	);
 }
 
@@ -0,0 +1,310 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sgx_urts.h>
+
+
+/**
+ * @brief A pool of enclaves created from the same image, each of which is
+ *        driven by its own thread (untrusted side only).
+ *
+ *        Jobs are routed by module affinity: every job of a module goes to
+ *        the enclave the module was first routed to, where the module and
+ *        its instance stay warm. A module new to the pool goes to the
+ *        enclave with the shortest queue. A module moves to the enclave with
+ *        the shortest queue if its own enclave's queue gets longer than that
+ *        by more than sk_maxImbalance jobs.
+ *        An exception thrown by a job is kept in the future of that job, so
+ *        the enclave's thread goes on with the next one.
+ *
+ */
+class EnclavePool
+{
+public: // static members
+
+	static constexpr size_t sk_maxImbalance = 4;
+
+	/**
+	 * @brief Runs a job on the thread of the enclave it's routed to.
+	 */
+	using Task = std::function<void(size_t shardIdx, sgx_enclave_id_t eid)>;
+
+	struct Stats
+	{
+		uint64_t numJobs = 0;
+		// jobs sent to the enclave their module already stays in
+		uint64_t numAffinityHits = 0;
+		// modules moved to another enclave because of the queue lengths
+		uint64_t numMigrations = 0;
+		std::vector<uint64_t> shardJobs;
+	}; // struct Stats
+
+public:
+
+	/**
+	 * @param createEnclave  Creates one enclave; called once per shard. If
+	 *                       it throws, the enclaves created so far are
+	 *                       destroyed before the exception is passed on.
+	 * @param destroyEnclave Destroys one enclave, when the pool is destroyed.
+	 */
+	EnclavePool(
+		size_t numShards,
+		std::function<sgx_enclave_id_t()> createEnclave,
+		std::function<void(sgx_enclave_id_t)> destroyEnclave
+	) :
+		m_destroyEnclave(std::move(destroyEnclave)),
+		m_mutex(),
+		m_idleCond(),
+		m_shards(numShards),
+		m_affinity(),
+		m_stats(),
+		m_stop(false)
+	{
+		m_stats.shardJobs.resize(numShards, 0);
+		size_t numCreated = 0;
+		try
+		{
+			for (auto& shard : m_shards)
+			{
+				shard.eid = createEnclave();
+				++numCreated;
+			}
+			for (size_t i = 0; i < m_shards.size(); ++i)
+			{
+				m_shards[i].worker = std::thread(&EnclavePool::Work, this, i);
+			}
+		}
+		catch (...)
+		{
+			StopWorkers();
+			for (size_t i = 0; i < numCreated; ++i)
+			{
+				m_destroyEnclave(m_shards[i].eid);
+			}
+			throw;
+		}
+	}
+
+	EnclavePool(const EnclavePool&) = delete;
+
+	~EnclavePool()
+	{
+		StopWorkers();
+		for (auto& shard : m_shards)
+		{
+			m_destroyEnclave(shard.eid);
+		}
+	}
+
+	EnclavePool& operator=(const EnclavePool&) = delete;
+
+	size_t GetNumShards() const noexcept
+	{
+		return m_shards.size();
+	}
+
+	/**
+	 * @brief Run a task on every enclave, e.g., to set it up, and wait for
+	 *        all of them to finish.
+	 *
+	 * @return The exception thrown by the task on each enclave; null for
+	 *         those where it succeeded.
+	 */
+	std::vector<std::exception_ptr> Broadcast(const Task& task)
+	{
+		std::vector<std::exception_ptr> errors(m_shards.size());
+		std::vector<std::thread> threads;
+		for (size_t i = 0; i < m_shards.size(); ++i)
+		{
+			const sgx_enclave_id_t eid = m_shards[i].eid;
+			std::exception_ptr& error = errors[i];
+			threads.emplace_back([&task, i, eid, &error]() {
+				try
+				{
+					task(i, eid);
+				}
+				catch (...)
+				{
+					error = std::current_exception();
+				}
+			});
+		}
+		for (auto& t : threads)
+		{
+			t.join();
+		}
+		return errors;
+	}
+
+	/**
+	 * @brief Queue a job of the given module.
+	 *
+	 * @return The future of the job, which holds the exception it threw,
+	 *         if any.
+	 */
+	std::future<void> Submit(const std::string& moduleKey, Task task)
+	{
+		PackagedTask packaged(std::move(task));
+		std::future<void> future = packaged.get_future();
+
+		size_t shardIdx = 0;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			shardIdx = Route(moduleKey);
+
+			Shard& shard = m_shards[shardIdx];
+			shard.queue.push_back(std::move(packaged));
+			++shard.depth;
+			++m_stats.numJobs;
+			++m_stats.shardJobs[shardIdx];
+		}
+		m_shards[shardIdx].cond.notify_one();
+		return future;
+	}
+
+	/**
+	 * @brief Wait until every job queued so far has finished.
+	 *
+	 */
+	void Drain()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_idleCond.wait(lock, [this]() {
+			for (const auto& shard : m_shards)
+			{
+				if (shard.depth > 0)
+				{
+					return false;
+				}
+			}
+			return true;
+		});
+	}
+
+	Stats GetStats() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_stats;
+	}
+
+private:
+
+	using PackagedTask =
+		std::packaged_task<void(size_t shardIdx, sgx_enclave_id_t eid)>;
+
+	struct Shard
+	{
+		sgx_enclave_id_t eid = 0;
+		std::thread worker;
+		std::condition_variable cond;
+		std::deque<PackagedTask> queue;
+		// jobs queued plus the one running
+		size_t depth = 0;
+	}; // struct Shard
+
+	// must be called with m_mutex held
+	size_t Route(const std::string& moduleKey)
+	{
+		size_t shortest = 0;
+		for (size_t i = 1; i < m_shards.size(); ++i)
+		{
+			if (m_shards[i].depth < m_shards[shortest].depth)
+			{
+				shortest = i;
+			}
+		}
+
+		auto it = m_affinity.find(moduleKey);
+		if (it == m_affinity.end())
+		{
+			m_affinity[moduleKey] = shortest;
+			return shortest;
+		}
+		if (m_shards[it->second].depth > m_shards[shortest].depth + sk_maxImbalance)
+		{
+			it->second = shortest;
+			++m_stats.numMigrations;
+			return shortest;
+		}
+		++m_stats.numAffinityHits;
+		return it->second;
+	}
+
+	void StopWorkers()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		for (auto& shard : m_shards)
+		{
+			shard.cond.notify_all();
+		}
+		for (auto& shard : m_shards)
+		{
+			if (shard.worker.joinable())
+			{
+				shard.worker.join();
+			}
+		}
+	}
+
+	void Work(size_t shardIdx)
+	{
+		Shard& shard = m_shards[shardIdx];
+		while (true)
+		{
+			PackagedTask task;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				shard.cond.wait(lock, [this, &shard]() {
+					return m_stop || !shard.queue.empty();
+				});
+				if (shard.queue.empty())
+				{
+					return; // stopped
+				}
+				task = std::move(shard.queue.front());
+				shard.queue.pop_front();
+			}
+
+			// an exception is stored in the job's future
+			task(shardIdx, shard.eid);
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				--shard.depth;
+			}
+			m_idleCond.notify_all();
+		}
+	}
+
+	std::function<void(sgx_enclave_id_t)> m_destroyEnclave;
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_idleCond;
+	std::vector<Shard> m_shards;
+	// module key -> index of the enclave it stays in
+	std::map<std::string, size_t> m_affinity;
+	Stats m_stats;
+	bool m_stop;
+}; // class EnclavePool
+
@@ -0,0 +1,249 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstddef>
+
+#ifdef __SSE2__
+#	define DECENT_WASM_HOST_KERNEL_SSE2 1
+#	include <emmintrin.h>
+#endif
+
+
+/**
+ * @brief Dense double-precision kernels run by the host on behalf of a
+ *        module (see the `decent_wasm_d*` natives). Matrices are row-major
+ *        and contiguous.
+ *
+ *        Loops are vectorized with SSE2 when it's available (it's part of
+ *        x86-64, so on both sides of the enclave boundary), and fall back to
+ *        scalar code otherwise. Element-wise kernels (axpy, stencil) and
+ *        gemm accumulate in the same order as the textbook loops, so their
+ *        results match a plain scalar implementation bit-for-bit; dot and
+ *        the non-transposed gemv use two partial sums.
+ *
+ */
+namespace HostKernels
+{
+
+
+/**
+ * @brief Block sizes of Gemm: rows of C, columns of A (rows of B), and
+ *        columns of C; a block of B (128 x 256 doubles, 256 KB) stays in L2,
+ *        and a row of the C block (2 KB) in L1.
+ */
+static constexpr size_t sk_gemmBlockM = 64;
+static constexpr size_t sk_gemmBlockK = 128;
+static constexpr size_t sk_gemmBlockN = 256;
+
+/**
+ * @brief Columns of A (and elements of y) per block of the transposed Gemv,
+ *        so that the block of y stays in L1.
+ */
+static constexpr size_t sk_gemvBlockN = 2048;
+
+
+/**
+ * @brief y[i] += a * x[i]
+ */
+inline void Axpy(size_t n, double a, const double* x, double* y) noexcept
+{
+	size_t i = 0;
+#ifdef DECENT_WASM_HOST_KERNEL_SSE2
+	const __m128d va = _mm_set1_pd(a);
+	for (; i + 4 <= n; i += 4)
+	{
+		__m128d y0 = _mm_loadu_pd(y + i);
+		__m128d y1 = _mm_loadu_pd(y + i + 2);
+		y0 = _mm_add_pd(y0, _mm_mul_pd(va, _mm_loadu_pd(x + i)));
+		y1 = _mm_add_pd(y1, _mm_mul_pd(va, _mm_loadu_pd(x + i + 2)));
+		_mm_storeu_pd(y + i, y0);
+		_mm_storeu_pd(y + i + 2, y1);
+	}
+#endif // DECENT_WASM_HOST_KERNEL_SSE2
+	for (; i < n; ++i)
+	{
+		y[i] += a * x[i];
+	}
+}
+
+
+/**
+ * @brief y[i] *= a; with a == 0, y is cleared, so that NaNs in y don't
+ *        propagate (as in BLAS).
+ */
+inline void Scale(size_t n, double a, double* y) noexcept
+{
+	if (a == 1.0)
+	{
+		return;
+	}
+	for (size_t i = 0; i < n; ++i)
+	{
+		y[i] = (a == 0.0) ? 0.0 : (y[i] * a);
+	}
+}
+
+
+inline double Dot(size_t n, const double* x, const double* y) noexcept
+{
+	size_t i = 0;
+	double sum = 0.0;
+#ifdef DECENT_WASM_HOST_KERNEL_SSE2
+	__m128d acc0 = _mm_setzero_pd();
+	__m128d acc1 = _mm_setzero_pd();
+	for (; i + 4 <= n; i += 4)
+	{
+		acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+		acc1 = _mm_add_pd(
+			acc1,
+			_mm_mul_pd(_mm_loadu_pd(x + i + 2), _mm_loadu_pd(y + i + 2))
+		);
+	}
+	double lanes[2];
+	_mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+	sum = lanes[0] + lanes[1];
+#endif // DECENT_WASM_HOST_KERNEL_SSE2
+	for (; i < n; ++i)
+	{
+		sum += x[i] * y[i];
+	}
+	return sum;
+}
+
+
+/**
+ * @brief C = alpha * A * B + beta * C, where A is m x k, B is k x n, and C is
+ *        m x n.
+ *
+ */
+inline void Gemm(
+	size_t m,
+	size_t n,
+	size_t k,
+	double alpha,
+	const double* a,
+	const double* b,
+	double beta,
+	double* c
+) noexcept
+{
+	for (size_t i = 0; i < m; ++i)
+	{
+		Scale(n, beta, c + (i * n));
+	}
+
+	for (size_t jj = 0; jj < n; jj += sk_gemmBlockN)
+	{
+		const size_t nb = (n - jj) < sk_gemmBlockN ? (n - jj) : sk_gemmBlockN;
+		for (size_t kk = 0; kk < k; kk += sk_gemmBlockK)
+		{
+			const size_t kb = (k - kk) < sk_gemmBlockK ? (k - kk) : sk_gemmBlockK;
+			for (size_t ii = 0; ii < m; ii += sk_gemmBlockM)
+			{
+				const size_t mb = (m - ii) < sk_gemmBlockM ? (m - ii) : sk_gemmBlockM;
+				for (size_t i = ii; i < ii + mb; ++i)
+				{
+					double* cRow = c + (i * n) + jj;
+					for (size_t p = kk; p < kk + kb; ++p)
+					{
+						Axpy(nb, alpha * a[(i * k) + p], b + (p * n) + jj, cRow);
+					}
+				}
+			}
+		}
+	}
+}
+
+
+/**
+ * @brief y = alpha * op(A) * x + beta * y, where A is m x n, and op(A) is A
+ *        (x has n elements and y m), or A^T if `trans` (x has m elements and
+ *        y n).
+ *
+ */
+inline void Gemv(
+	bool trans,
+	size_t m,
+	size_t n,
+	double alpha,
+	const double* a,
+	const double* x,
+	double beta,
+	double* y
+) noexcept
+{
+	if (!trans)
+	{
+		for (size_t i = 0; i < m; ++i)
+		{
+			double ax = alpha * Dot(n, a + (i * n), x);
+			y[i] = ((beta == 0.0) ? 0.0 : (beta * y[i])) + ax;
+		}
+		return;
+	}
+
+	Scale(n, beta, y);
+	for (size_t jj = 0; jj < n; jj += sk_gemvBlockN)
+	{
+		const size_t nb = (n - jj) < sk_gemvBlockN ? (n - jj) : sk_gemvBlockN;
+		for (size_t i = 0; i < m; ++i)
+		{
+			Axpy(nb, alpha * x[i], a + (i * n) + jj, y + jj);
+		}
+	}
+}
+
+
+/**
+ * @brief One sweep of a 5-point stencil over the interior of a rows x cols
+ *        grid, i.e., out[i][j] = coef * (in[i][j] + in[i][j-1] + in[i][j+1] +
+ *        in[i+1][j] + in[i-1][j]); the border of `out` is left untouched.
+ *
+ */
+inline void Stencil2d(
+	size_t rows,
+	size_t cols,
+	double coef,
+	const double* in,
+	double* out
+) noexcept
+{
+	if ((rows < 3) || (cols < 3))
+	{
+		return;
+	}
+
+	for (size_t i = 1; i < rows - 1; ++i)
+	{
+		const double* up = in + ((i - 1) * cols);
+		const double* mid = in + (i * cols);
+		const double* down = in + ((i + 1) * cols);
+		double* dst = out + (i * cols);
+
+		size_t j = 1;
+#ifdef DECENT_WASM_HOST_KERNEL_SSE2
+		const __m128d vc = _mm_set1_pd(coef);
+		for (; j + 2 <= cols - 1; j += 2)
+		{
+			__m128d v = _mm_add_pd(_mm_loadu_pd(mid + j), _mm_loadu_pd(mid + j - 1));
+			v = _mm_add_pd(v, _mm_loadu_pd(mid + j + 1));
+			v = _mm_add_pd(v, _mm_loadu_pd(down + j));
+			v = _mm_add_pd(v, _mm_loadu_pd(up + j));
+			_mm_storeu_pd(dst + j, _mm_mul_pd(vc, v));
+		}
+#endif // DECENT_WASM_HOST_KERNEL_SSE2
+		for (; j < cols - 1; ++j)
+		{
+			dst[j] = coef * (mid[j] + mid[j - 1] + mid[j + 1] + down[j] + up[j]);
+		}
+	}
+}
+
+
+} // namespace HostKernels
+
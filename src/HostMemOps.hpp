@@ -0,0 +1,143 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#ifdef __SSE2__
+#	define DECENT_WASM_HOST_SSE2 1
+#	include <emmintrin.h>
+#endif
+
+
+/**
+ * @brief Memory operations used by the natives that copy or fill linear
+ *        memory on behalf of a module, picked by the size of the operation.
+ *
+ *        Small and medium sizes go to the C library, which is already tuned
+ *        for them. Very large ones, which would evict the whole cache
+ *        anyway, are done with non-temporal (streaming) stores when SSE2 is
+ *        available (it's part of x86-64, so on both sides of the enclave
+ *        boundary), and by the C library otherwise. In the enclave, this
+ *        also keeps a large copy from pushing the rest of the working set
+ *        out of the cache, which then has to be decrypted from the EPC again.
+ *
+ */
+namespace HostMemOps
+{
+
+
+/**
+ * @brief Sizes from which streaming stores are used.
+ */
+static constexpr size_t sk_streamMinSize = 1024 * 1024; // 1 MB
+
+
+#ifdef DECENT_WASM_HOST_SSE2
+
+inline void StreamCopy(uint8_t* dest, const uint8_t* src, size_t n) noexcept
+{
+	// align the destination, since streaming stores need aligned addresses
+	size_t head = (16 - (reinterpret_cast<uintptr_t>(dest) & 15)) & 15;
+	std::memcpy(dest, src, head);
+	dest += head;
+	src += head;
+	n -= head;
+
+	for (; n >= 64; dest += 64, src += 64, n -= 64)
+	{
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+		__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 32));
+		__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 48));
+		_mm_stream_si128(reinterpret_cast<__m128i*>(dest),      a);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(dest + 16), b);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(dest + 32), c);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(dest + 48), d);
+	}
+	// order the streaming stores before any later ones
+	_mm_sfence();
+
+	std::memcpy(dest, src, n);
+}
+
+inline void StreamFill(uint8_t* dest, uint8_t val, size_t n) noexcept
+{
+	size_t head = (16 - (reinterpret_cast<uintptr_t>(dest) & 15)) & 15;
+	std::memset(dest, val, head);
+	dest += head;
+	n -= head;
+
+	const __m128i v = _mm_set1_epi8(static_cast<char>(val));
+	for (; n >= 64; dest += 64, n -= 64)
+	{
+		_mm_stream_si128(reinterpret_cast<__m128i*>(dest),      v);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(dest + 16), v);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(dest + 32), v);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(dest + 48), v);
+	}
+	_mm_sfence();
+
+	std::memset(dest, val, n);
+}
+
+#endif // DECENT_WASM_HOST_SSE2
+
+
+/**
+ * @brief Copy between two buffers that don't overlap.
+ */
+inline void Copy(void* dest, const void* src, size_t n) noexcept
+{
+#ifdef DECENT_WASM_HOST_SSE2
+	if (n >= sk_streamMinSize)
+	{
+		StreamCopy(
+			static_cast<uint8_t*>(dest),
+			static_cast<const uint8_t*>(src),
+			n
+		);
+		return;
+	}
+#endif // DECENT_WASM_HOST_SSE2
+	std::memcpy(dest, src, n);
+}
+
+
+/**
+ * @brief Copy between two buffers that may overlap.
+ */
+inline void Move(void* dest, const void* src, size_t n) noexcept
+{
+	const uint8_t* d = static_cast<const uint8_t*>(dest);
+	const uint8_t* s = static_cast<const uint8_t*>(src);
+	if ((d + n <= s) || (s + n <= d))
+	{
+		Copy(dest, src, n);
+		return;
+	}
+	std::memmove(dest, src, n);
+}
+
+
+inline void Fill(void* dest, uint8_t val, size_t n) noexcept
+{
+#ifdef DECENT_WASM_HOST_SSE2
+	if (n >= sk_streamMinSize)
+	{
+		StreamFill(static_cast<uint8_t*>(dest), val, n);
+		return;
+	}
+#endif // DECENT_WASM_HOST_SSE2
+	std::memset(dest, val, n);
+}
+
+
+} // namespace HostMemOps
+
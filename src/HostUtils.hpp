@@ -0,0 +1,158 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstdint>
+#include <cstdio>
+
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sgx_urts.h>
+
+
+inline std::vector<uint8_t> ReadFile2Buffer(const std::string& filename)
+{
+	FILE *file;
+	size_t file_size, read_size;
+
+	if ((file = fopen(filename.c_str(), "rb")) == nullptr)
+	{
+		throw std::runtime_error(
+			"Read file to buffer failed: open file " + filename + " failed");
+	}
+
+	fseek(file, 0, SEEK_END);
+	file_size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	std::vector<uint8_t> buffer(file_size);
+
+	read_size = fread(buffer.data(), 1, file_size, file);
+	fclose(file);
+
+	if (read_size < file_size)
+	{
+		throw std::runtime_error(
+			"Read file " + filename + " to buffer failed: read file content failed");
+	}
+
+	return buffer;
+}
+
+inline void WriteBuffer2File(
+	const std::string& filename, const std::vector<uint8_t>& buffer)
+{
+	FILE *file;
+	size_t writeSize = 0;
+
+	if ((file = fopen(filename.c_str(), "wb")) == nullptr)
+	{
+		throw std::runtime_error(
+			"write buffer to file failed: open file " + filename + " failed");
+	}
+
+	writeSize = fwrite(buffer.data(), 1, buffer.size(), file);
+	fclose(file);
+
+	if(writeSize < buffer.size())
+	{
+		throw std::runtime_error(
+			"write buffer to file " + filename + " failed: write file content failed");
+	}
+}
+
+inline void enclave_init(sgx_enclave_id_t *p_eid)
+{
+	sgx_launch_token_t token = { 0 };
+	sgx_status_t ret = SGX_ERROR_UNEXPECTED;
+	int updated = 0;
+
+	std::vector<uint8_t> tokenBuf;
+	try
+	{
+		tokenBuf = ReadFile2Buffer(DECENT_ENCLAVE_PLATFORM_SGX_TOKEN);
+	}
+	catch(const std::runtime_error&)
+	{}
+
+	ret = sgx_create_enclave(
+		DECENT_ENCLAVE_PLATFORM_SGX_IMAGE,
+		1 /*SGX_DEBUG_FLAG*/,
+		&token,
+		&updated,
+		p_eid,
+		nullptr);
+
+	if (ret != SGX_SUCCESS) {
+		throw std::runtime_error("Failed to create enclave");
+	}
+
+	if (updated == 1)
+	{
+		tokenBuf.resize(std::distance(std::begin(token), std::end(token)));
+		std::copy(std::begin(token), std::end(token), tokenBuf.begin());
+		WriteBuffer2File(DECENT_ENCLAVE_PLATFORM_SGX_TOKEN, tokenBuf);
+	}
+}
+
+#ifndef DECENT_WASM_ENCLAVE_TCS_NUM
+#error "DECENT_WASM_ENCLAVE_TCS_NUM must be set to the TCSNum in Enclave.config.xml"
+#endif // !DECENT_WASM_ENCLAVE_TCS_NUM
+
+/**
+ * @brief Check that the given workers, plus the other threads calling into
+ *        the enclave at the same time, fit in the enclave's TCSs; each thread
+ *        in the enclave takes one, and an ecall without a free one fails.
+ *
+ */
+inline bool CheckEnclaveWorkers(uint32_t numWorkers, uint32_t numOtherThreads)
+{
+	static constexpr uint32_t sk_tcsNum = DECENT_WASM_ENCLAVE_TCS_NUM;
+
+	if (numWorkers > sk_tcsNum - numOtherThreads)
+	{
+		std::cerr << "ERROR: " << "At most "
+			<< (sk_tcsNum - numOtherThreads)
+			<< " workers can run in the enclave (TCSNum is "
+			<< sk_tcsNum << ")." << std::endl;
+		return false;
+	}
+	return true;
+}
+
+inline uint64_t GetSteadyTimeUs()
+{
+	auto now = std::chrono::steady_clock::now();
+	return static_cast<uint64_t>(
+		std::chrono::duration_cast<std::chrono::microseconds>(
+			now.time_since_epoch()
+		).count()
+	);
+}
+
+/**
+ * @brief Read files one after another into one buffer, e.g., so that
+ *        several modules can be given in one ecall.
+ *
+ */
+inline void ReadFiles2Buffer(
+	const std::vector<std::string>& filenames,
+	std::vector<uint8_t>& buf,
+	std::vector<uint64_t>& fileSizes
+)
+{
+	for (const auto& filename : filenames)
+	{
+		std::vector<uint8_t> file = ReadFile2Buffer(filename);
+		buf.insert(buf.end(), file.begin(), file.end());
+		fileSizes.push_back(file.size());
+	}
+}
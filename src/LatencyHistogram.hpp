@@ -0,0 +1,160 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstddef>
+#include <cstdint>
+
+#include <vector>
+
+
+/**
+ * @brief A histogram of latencies with HDR-style log-linear buckets: values
+ *        below 2^sk_subBucketBits are counted exactly, and larger ones in
+ *        buckets as wide as 1/2^(sk_subBucketBits - 1) of their magnitude,
+ *        so every value is kept with the same relative precision (under 2%)
+ *        in a fixed amount of memory, whatever the range.
+ *
+ *        Percentiles are given as the highest value of their buckets (capped
+ *        at the maximum recorded), so they are never under-reported.
+ *
+ */
+class LatencyHistogram
+{
+public: // static members
+
+	static constexpr uint32_t sk_subBucketBits = 7;
+	static constexpr uint64_t sk_subBucketCount = 1ULL << sk_subBucketBits;
+	static constexpr uint64_t sk_halfCount = sk_subBucketCount / 2;
+
+	static constexpr size_t sk_numBuckets = static_cast<size_t>(
+		sk_subBucketCount + (64 - sk_subBucketBits) * sk_halfCount
+	);
+
+	static size_t GetIndex(uint64_t value) noexcept
+	{
+		if (value < sk_subBucketCount)
+		{
+			return static_cast<size_t>(value);
+		}
+
+		uint32_t msb = 0;
+		for (uint64_t v = value; v > 1; v >>= 1)
+		{
+			++msb;
+		}
+		// value >> shift is in [sk_halfCount, sk_subBucketCount)
+		const uint32_t shift = msb - sk_subBucketBits + 1;
+		const uint64_t sub = value >> shift;
+		return static_cast<size_t>(
+			sk_subBucketCount + (shift - 1) * sk_halfCount + (sub - sk_halfCount)
+		);
+	}
+
+	/**
+	 * @return The highest value counted in the bucket at the given index.
+	 */
+	static uint64_t GetHighestEquivalent(size_t idx) noexcept
+	{
+		if (idx < sk_subBucketCount)
+		{
+			return idx;
+		}
+
+		const uint64_t k = idx - sk_subBucketCount;
+		const uint32_t shift = static_cast<uint32_t>(k / sk_halfCount) + 1;
+		const uint64_t sub = (k % sk_halfCount) + sk_halfCount;
+		// wraps to the maximum for the last bucket
+		return ((sub + 1) << shift) - 1;
+	}
+
+public:
+
+	LatencyHistogram() :
+		m_counts(sk_numBuckets, 0),
+		m_count(0),
+		m_sum(0),
+		m_max(0)
+	{}
+
+	void Record(uint64_t value)
+	{
+		++m_counts[GetIndex(value)];
+		++m_count;
+		m_sum += value;
+		if (value > m_max)
+		{
+			m_max = value;
+		}
+	}
+
+	void Merge(const LatencyHistogram& other)
+	{
+		for (size_t i = 0; i < sk_numBuckets; ++i)
+		{
+			m_counts[i] += other.m_counts[i];
+		}
+		m_count += other.m_count;
+		m_sum += other.m_sum;
+		if (other.m_max > m_max)
+		{
+			m_max = other.m_max;
+		}
+	}
+
+	uint64_t GetCount() const noexcept
+	{
+		return m_count;
+	}
+
+	uint64_t GetMax() const noexcept
+	{
+		return m_max;
+	}
+
+	uint64_t GetMean() const noexcept
+	{
+		return m_count == 0 ? 0 : (m_sum / m_count);
+	}
+
+	/**
+	 * @param percent e.g., 99.9
+	 * @return 0 if nothing has been recorded.
+	 */
+	uint64_t GetPercentile(double percent) const noexcept
+	{
+		if (m_count == 0)
+		{
+			return 0;
+		}
+
+		// the rank of the value, counting from 1
+		uint64_t rank = static_cast<uint64_t>(
+			(percent / 100.0) * static_cast<double>(m_count) + 0.5
+		);
+		rank = (rank == 0) ? 1 : (rank > m_count ? m_count : rank);
+
+		uint64_t seen = 0;
+		for (size_t i = 0; i < sk_numBuckets; ++i)
+		{
+			seen += m_counts[i];
+			if (seen >= rank)
+			{
+				const uint64_t highest = GetHighestEquivalent(i);
+				return highest < m_max ? highest : m_max;
+			}
+		}
+		return m_max;
+	}
+
+private:
+
+	std::vector<uint64_t> m_counts;
+	uint64_t m_count;
+	uint64_t m_sum;
+	uint64_t m_max;
+}; // class LatencyHistogram
@@ -0,0 +1,445 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <DecentWasmRuntime/Internal/make_unique.hpp>
+#include <DecentWasmRuntime/MainRunner.hpp>
+#include <DecentWasmRuntime/ThreadEnvGuard.hpp>
+#include <DecentWasmRuntime/WasmRuntimeStaticHeap.hpp>
+
+#include "LatencyHistogram.hpp"
+#include "SystemIO.hpp"
+#include "decent_wasm_config.h"
+
+
+/**
+ * @brief Run the events of an open-loop load, submitted by a load generator
+ *        at their arrival times, on a set of worker threads, and report the
+ *        throughput and the latency percentiles.
+ *
+ *        The latency of an event is measured from the time it was meant to
+ *        arrive, given by the generator, rather than from the time it was
+ *        submitted, so a late generator doesn't hide queueing delays
+ *        (coordinated omission). Both sides of the enclave boundary read the
+ *        same untrusted clock, so the arrival times can be compared.
+ *
+ *        The worker threads and the load generator are given by the caller,
+ *        as in DecentWasmDeadlineBench.
+ *
+ */
+class DecentWasmLoadGenBench
+{
+public: // static members
+
+	static const char* GetBackEndName() noexcept
+	{
+#ifdef DECENT_ENCLAVE_PLATFORM_SGX_TRUSTED
+		return "enclave";
+#else
+		return "untrusted";
+#endif
+	}
+
+public:
+
+	/**
+	 * @param wasmFiles The modules, one after another.
+	 * @param fileSizes The size of each module.
+	 */
+	DecentWasmLoadGenBench(
+		const uint8_t* wasmFiles,
+		const uint64_t* fileSizes, size_t numFiles,
+		const decent_wasm_loadgen_config_t& config
+	) :
+		m_config(config),
+		m_wasmRt(
+			DecentWasmRuntime::Internal::make_unique<
+				DecentWasmRuntime::WasmRuntimeStaticHeap
+			>(
+				PrintCStr,
+				config.pool_size,
+				GetTimestampUs
+			)
+		),
+		m_modules(),
+		m_mutex(),
+		m_cond(),
+		m_queue(),
+		m_closed(false),
+		m_numSubmitted(0),
+		m_maxQueueDepth(0),
+		m_firstArrivalUs(0),
+		m_submitLagUs(),
+		m_workers(config.num_workers)
+	{
+		if ((numFiles == 0) || (config.num_workers == 0))
+		{
+			throw std::invalid_argument(
+				"The load generator needs modules and workers");
+		}
+
+		for (size_t i = 0; i < numFiles; ++i)
+		{
+			m_modules.push_back(m_wasmRt.LoadModule(
+				std::vector<uint8_t>(wasmFiles, wasmFiles + fileSizes[i])
+			));
+			wasmFiles += fileSizes[i];
+		}
+	}
+
+	DecentWasmLoadGenBench(const DecentWasmLoadGenBench&) = delete;
+
+	DecentWasmLoadGenBench& operator=(const DecentWasmLoadGenBench&) = delete;
+
+	/**
+	 * @param arrivalUs The time the event was meant to arrive.
+	 * @return false if the event is invalid, or the load is closed.
+	 */
+	bool Submit(
+		uint32_t moduleIdx,
+		const uint8_t* eventId, size_t eventIdSize,
+		const uint8_t* eventData, size_t eventDataSize,
+		uint64_t arrivalUs
+	)
+	{
+		if (moduleIdx >= m_modules.size())
+		{
+			return false;
+		}
+
+		Event event;
+		event.moduleIdx = moduleIdx;
+		event.eventId.assign(eventId, eventId + eventIdSize);
+		event.eventData.assign(eventData, eventData + eventDataSize);
+		event.arrivalUs = arrivalUs;
+		event.submitUs = GetTimestampUs();
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_closed)
+			{
+				return false;
+			}
+			if (m_numSubmitted == 0)
+			{
+				m_firstArrivalUs = arrivalUs;
+			}
+			++m_numSubmitted;
+			m_submitLagUs.Record(
+				event.submitUs > arrivalUs ? (event.submitUs - arrivalUs) : 0
+			);
+
+			m_queue.push_back(std::move(event));
+			if (m_queue.size() > m_maxQueueDepth)
+			{
+				m_maxQueueDepth = m_queue.size();
+			}
+		}
+		m_cond.notify_one();
+		return true;
+	}
+
+	/**
+	 * @brief No more events will be submitted; workers return from Work
+	 *        once all the queued events have run.
+	 *
+	 */
+	void Close()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_closed = true;
+		}
+		m_cond.notify_all();
+	}
+
+	/**
+	 * @brief Run events on the calling thread as the given worker, until
+	 *        the load is closed and all the events have run.
+	 *
+	 */
+	void Work(size_t workerIdx)
+	{
+		using namespace DecentWasmRuntime;
+
+		if (workerIdx >= m_workers.size())
+		{
+			PrintStr("Invalid worker index " + std::to_string(workerIdx) + "\n");
+			return;
+		}
+
+		// WAMR needs every thread running WASM code to set up its own env
+		ThreadEnvGuard threadEnv;
+		if (!threadEnv.IsInited())
+		{
+			PrintStr("Failed to init the thread env of a worker\n");
+			return;
+		}
+
+		WorkerResult& res = m_workers[workerIdx];
+		{
+			// instances of this worker, by module; only used by this thread
+			std::vector<std::unique_ptr<MainRunner> > runners(m_modules.size());
+
+			Event event;
+			while (Take(event))
+			{
+				try
+				{
+					std::unique_ptr<MainRunner>& runner = runners[event.moduleIdx];
+					if (runner == nullptr)
+					{
+						runner = Internal::make_unique<MainRunner>(
+							m_modules[event.moduleIdx],
+							event.eventId,
+							event.eventData,
+							m_config.mod_stack_size,
+							m_config.mod_heap_size,
+							m_config.exec_stack_size
+						);
+					}
+					else
+					{
+						runner->SetEvent(event.eventId, event.eventData);
+					}
+
+					uint64_t startUs = GetTimestampUs();
+					runner->RunPlain();
+					uint64_t endUs = GetTimestampUs();
+
+					// the clock is the wall clock, which may step back
+					res.latencyUs.Record(
+						endUs > event.arrivalUs ? (endUs - event.arrivalUs) : 0
+					);
+					res.runUs.Record(endUs > startUs ? (endUs - startUs) : 0);
+					res.queueUs.Record(
+						startUs > event.submitUs ? (startUs - event.submitUs) : 0
+					);
+					res.endUs = std::max(res.endUs, endUs);
+				}
+				catch (const std::exception& e)
+				{
+					PrintStr(
+						"Event of module " + std::to_string(event.moduleIdx) +
+						" failed: " + e.what() + "\n"
+					);
+					// the instance may be left in any state
+					runners[event.moduleIdx].reset();
+					++res.numFailed;
+				}
+			}
+		}
+	}
+
+	/**
+	 * @brief Print the results; must only be called after every worker has
+	 *        returned from Work.
+	 *
+	 */
+	void Report() const
+	{
+		LatencyHistogram latencyUs;
+		LatencyHistogram runUs;
+		LatencyHistogram queueUs;
+		uint64_t numFailed = 0;
+		uint64_t endUs = m_firstArrivalUs;
+		for (const auto& res : m_workers)
+		{
+			latencyUs.Merge(res.latencyUs);
+			runUs.Merge(res.runUs);
+			queueUs.Merge(res.queueUs);
+			numFailed += res.numFailed;
+			endUs = std::max(endUs, res.endUs);
+		}
+
+		const uint64_t timeUs = endUs - m_firstArrivalUs;
+		const uint64_t numDone = latencyUs.GetCount();
+
+		PrintStr(
+			"Load gen: "
+			"Back end: "        + std::string(GetBackEndName()) + ", "
+			"Workers: "         + std::to_string(m_config.num_workers) + ", "
+			"Modules: "         + std::to_string(m_modules.size()) + ", "
+			"Events: "          + std::to_string(m_numSubmitted) + ", "
+			"Failed: "          + std::to_string(numFailed) + ", "
+			"Time: "            + std::to_string(timeUs) + " us, "
+			"Throughput: "      + std::to_string(
+				timeUs == 0 ? 0 : (numDone * 1000000 / timeUs)) + " events/s, "
+			"Latency mean: "    + std::to_string(latencyUs.GetMean()) + " us, "
+			"Latency p50: "     + std::to_string(latencyUs.GetPercentile(50.0)) + " us, "
+			"Latency p99: "     + std::to_string(latencyUs.GetPercentile(99.0)) + " us, "
+			"Latency p99.9: "   + std::to_string(latencyUs.GetPercentile(99.9)) + " us, "
+			"Latency max: "     + std::to_string(latencyUs.GetMax()) + " us, "
+			"Run p50: "         + std::to_string(runUs.GetPercentile(50.0)) + " us, "
+			"Run p99: "         + std::to_string(runUs.GetPercentile(99.0)) + " us, "
+			"Queue wait p99: "  + std::to_string(queueUs.GetPercentile(99.0)) + " us, "
+			"Submit lag p99: "  + std::to_string(m_submitLagUs.GetPercentile(99.0)) + " us, "
+			"Queue depth max: " + std::to_string(m_maxQueueDepth) + "\n"
+		);
+	}
+
+private:
+
+	struct Event
+	{
+		uint32_t moduleIdx = 0;
+		std::vector<uint8_t> eventId;
+		std::vector<uint8_t> eventData;
+		uint64_t arrivalUs = 0;
+		uint64_t submitUs = 0;
+	}; // struct Event
+
+	// only touched by the worker's own thread, until Report
+	struct WorkerResult
+	{
+		LatencyHistogram latencyUs;
+		LatencyHistogram runUs;
+		LatencyHistogram queueUs;
+		uint64_t numFailed = 0;
+		uint64_t endUs = 0;
+	}; // struct WorkerResult
+
+	bool Take(Event& event)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cond.wait(lock, [this]() {
+			return !m_queue.empty() || m_closed;
+		});
+		if (m_queue.empty())
+		{
+			return false;
+		}
+		event = std::move(m_queue.front());
+		m_queue.pop_front();
+		return true;
+	}
+
+	decent_wasm_loadgen_config_t m_config;
+	DecentWasmRuntime::SharedWasmRuntime m_wasmRt;
+	std::vector<DecentWasmRuntime::SharedWasmModule> m_modules;
+
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::deque<Event> m_queue;
+	bool m_closed;
+	uint64_t m_numSubmitted;
+	uint64_t m_maxQueueDepth;
+	uint64_t m_firstArrivalUs;
+	LatencyHistogram m_submitLagUs;
+
+	std::vector<WorkerResult> m_workers;
+}; // class DecentWasmLoadGenBench
+
+
+/**
+ * @brief The load generator run of this side of the enclave boundary;
+ *        there is at most one, created by DecentWasmLoadGenBenchStart.
+ */
+inline std::unique_ptr<DecentWasmLoadGenBench>& GetDecentWasmLoadGenBench()
+{
+	static std::unique_ptr<DecentWasmLoadGenBench> s_bench;
+	return s_bench;
+}
+
+
+inline std::mutex& GetDecentWasmLoadGenBenchMutex()
+{
+	static std::mutex s_mutex;
+	return s_mutex;
+}
+
+
+inline bool DecentWasmLoadGenBenchStart(
+	const uint8_t* wasmFiles,
+	const uint64_t* fileSizes, size_t numFiles,
+	const decent_wasm_loadgen_config_t& config
+)
+{
+	std::lock_guard<std::mutex> lock(GetDecentWasmLoadGenBenchMutex());
+	try
+	{
+		// the previous runtime must be gone before a new one is created
+		GetDecentWasmLoadGenBench().reset();
+		GetDecentWasmLoadGenBench() =
+			DecentWasmRuntime::Internal::make_unique<DecentWasmLoadGenBench>(
+				wasmFiles, fileSizes, numFiles, config
+			);
+		return true;
+	}
+	catch(const std::exception& e)
+	{
+		PrintStr(e.what());
+		PrintStr("\n");
+		return false;
+	}
+}
+
+
+/**
+ * @brief Submit, Work and Close don't take the lock, since the run stays
+ *        until DecentWasmLoadGenBenchFinish, which must only be called after
+ *        all of them have returned.
+ *
+ */
+inline bool DecentWasmLoadGenBenchSubmit(
+	uint32_t moduleIdx,
+	const uint8_t* eventId, size_t eventIdSize,
+	const uint8_t* eventData, size_t eventDataSize,
+	uint64_t arrivalUs
+)
+{
+	DecentWasmLoadGenBench* bench = GetDecentWasmLoadGenBench().get();
+	return (bench != nullptr) && bench->Submit(
+		moduleIdx,
+		eventId, eventIdSize,
+		eventData, eventDataSize,
+		arrivalUs
+	);
+}
+
+
+inline void DecentWasmLoadGenBenchWork(size_t workerIdx)
+{
+	DecentWasmLoadGenBench* bench = GetDecentWasmLoadGenBench().get();
+	if (bench == nullptr)
+	{
+		PrintStr("The load generator has not been started\n");
+		return;
+	}
+	bench->Work(workerIdx);
+}
+
+
+inline void DecentWasmLoadGenBenchClose()
+{
+	DecentWasmLoadGenBench* bench = GetDecentWasmLoadGenBench().get();
+	if (bench != nullptr)
+	{
+		bench->Close();
+	}
+}
+
+
+inline void DecentWasmLoadGenBenchFinish()
+{
+	std::lock_guard<std::mutex> lock(GetDecentWasmLoadGenBenchMutex());
+	if (GetDecentWasmLoadGenBench() != nullptr)
+	{
+		GetDecentWasmLoadGenBench()->Report();
+		GetDecentWasmLoadGenBench().reset();
+	}
+}
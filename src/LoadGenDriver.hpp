@@ -0,0 +1,534 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sgx_urts.h>
+
+#include "BenchUtils.hpp"
+#include "HostUtils.hpp"
+#include "LoadGenBench.hpp"
+#include "decent_wasm_config.h"
+
+
+extern "C" {
+
+extern sgx_status_t ecall_decent_wasm_loadgen_start(
+	sgx_enclave_id_t eid,
+	int *retval,
+	const uint8_t *wasm_files, size_t wasm_files_size,
+	const uint64_t *file_sizes, size_t num_files,
+	const decent_wasm_loadgen_config_t *config
+);
+
+extern sgx_status_t ecall_decent_wasm_loadgen_submit(
+	sgx_enclave_id_t eid,
+	int *retval,
+	uint32_t module_idx,
+	const uint8_t *event_id, size_t event_id_size,
+	const uint8_t *event_data, size_t event_data_size,
+	uint64_t arrival_us
+);
+
+extern sgx_status_t ecall_decent_wasm_loadgen_work(
+	sgx_enclave_id_t eid,
+	uint32_t worker_idx
+);
+
+extern sgx_status_t ecall_decent_wasm_loadgen_close(sgx_enclave_id_t eid);
+
+extern sgx_status_t ecall_decent_wasm_loadgen_finish(sgx_enclave_id_t eid);
+
+} // extern "C"
+
+
+struct LoadGenLoad
+{
+	// events per second, on average, when there is no trace
+	double rate = 100.0;
+	uint32_t numEvents = 1000;
+	// lines of `<arrival us> [<module idx> [<event id idx> [<payload bytes>]]]`;
+	// the fields left out are picked as below
+	std::string tracePath;
+	bool moduleZipf = false;
+	uint32_t numEventIds = 1;
+	bool eventIdZipf = false;
+	// payload sizes, including the terminating '\0', are picked uniformly in
+	// this range, or from an exponential distribution starting at the
+	// minimum, with a quarter of the range as the mean, capped at the maximum
+	uint32_t payloadMinBytes = 16;
+	uint32_t payloadMaxBytes = 1024;
+	bool payloadExp = false;
+	uint32_t seed = 0;
+}; // struct LoadGenLoad
+
+struct LoadGenArrival
+{
+	// relative to the start of the load
+	uint64_t arrivalUs = 0;
+	uint32_t moduleIdx = 0;
+	uint32_t eventIdIdx = 0;
+	uint32_t payloadSize = 1;
+}; // struct LoadGenArrival
+
+inline bool ParseZipfOption(const std::string& opt, const std::string& val)
+{
+	if (val == "uniform")
+	{
+		return false;
+	}
+	else if (val == "zipf")
+	{
+		return true;
+	}
+	throw std::invalid_argument("Invalid value for option " + opt + ": " + val);
+}
+
+inline decent_wasm_loadgen_config_t ParseLoadGenConfig(
+	int argc, char** argv, int startIdx,
+	LoadGenLoad& load
+)
+{
+	decent_wasm_loadgen_config_t config;
+	config.pool_size       = 64 * 1024 * 1024; // 64 MB
+	config.num_workers     = 1;
+	config.mod_stack_size  = 64 * 1024;        // 64 KB
+	config.mod_heap_size   = 1 * 1024 * 1024;  //  1 MB
+	config.exec_stack_size = 64 * 1024;        // 64 KB
+
+	for (int i = startIdx; i < argc; ++i)
+	{
+		const std::string opt = argv[i];
+		if ((i + 1) >= argc)
+		{
+			throw std::invalid_argument("Missing value for option " + opt);
+		}
+
+		const std::string val = argv[++i];
+		if (opt == "--rate")
+		{
+			load.rate = std::stod(val);
+		}
+		else if (opt == "--events")
+		{
+			load.numEvents = static_cast<uint32_t>(std::stoul(val));
+		}
+		else if (opt == "--trace")
+		{
+			load.tracePath = val;
+		}
+		else if (opt == "--module-dist")
+		{
+			load.moduleZipf = ParseZipfOption(opt, val);
+		}
+		else if (opt == "--event-ids")
+		{
+			load.numEventIds = std::max<uint32_t>(std::stoul(val), 1);
+		}
+		else if (opt == "--event-id-dist")
+		{
+			load.eventIdZipf = ParseZipfOption(opt, val);
+		}
+		else if (opt == "--payload-min")
+		{
+			load.payloadMinBytes = std::max<uint32_t>(std::stoul(val), 1);
+		}
+		else if (opt == "--payload-max")
+		{
+			load.payloadMaxBytes = std::max<uint32_t>(std::stoul(val), 1);
+		}
+		else if (opt == "--payload-dist")
+		{
+			if (val == "uniform")
+			{
+				load.payloadExp = false;
+			}
+			else if (val == "exp")
+			{
+				load.payloadExp = true;
+			}
+			else
+			{
+				throw std::invalid_argument(
+					"Invalid value for option " + opt + ": " + val);
+			}
+		}
+		else if (opt == "--seed")
+		{
+			load.seed = static_cast<uint32_t>(std::stoul(val));
+		}
+		else if (opt == "--pool")
+		{
+			config.pool_size = static_cast<uint32_t>(std::stoul(val));
+		}
+		else if (opt == "--mod-stack")
+		{
+			config.mod_stack_size = static_cast<uint32_t>(std::stoul(val));
+		}
+		else if (opt == "--mod-heap")
+		{
+			config.mod_heap_size = static_cast<uint32_t>(std::stoul(val));
+		}
+		else if (opt == "--exec-stack")
+		{
+			config.exec_stack_size = static_cast<uint32_t>(std::stoul(val));
+		}
+		else
+		{
+			throw std::invalid_argument("Unknown option " + opt);
+		}
+	}
+
+	if (load.payloadMaxBytes < load.payloadMinBytes)
+	{
+		throw std::invalid_argument("--payload-max is less than --payload-min");
+	}
+	if (load.tracePath.empty() && (load.rate <= 0.0))
+	{
+		throw std::invalid_argument("The rate must be positive");
+	}
+
+	return config;
+}
+
+/**
+ * @brief Pick one of `num` indices, uniformly, or with the k-th picked 1/k as
+ *        often as the first.
+ *
+ */
+inline std::discrete_distribution<uint32_t> MakeIndexDistribution(
+	size_t num,
+	bool zipf
+)
+{
+	const std::vector<double> weights =
+		zipf ? GetZipfWeights(num) : std::vector<double>(num, 1.0);
+	return std::discrete_distribution<uint32_t>(weights.begin(), weights.end());
+}
+
+/**
+ * @brief Generate an open-loop load: arrivals read from the trace, if one is
+ *        given, or Poisson arrivals at the given rate; the fields the trace
+ *        leaves out are picked from the given distributions.
+ *
+ */
+inline std::vector<LoadGenArrival> GenerateLoadGenLoad(
+	LoadGenLoad& load,
+	size_t numModules
+)
+{
+	std::mt19937 rng(load.seed);
+	std::discrete_distribution<uint32_t> pickModule =
+		MakeIndexDistribution(numModules, load.moduleZipf);
+	std::uniform_int_distribution<uint32_t> uniformPayload(
+		load.payloadMinBytes,
+		load.payloadMaxBytes
+	);
+	std::exponential_distribution<double> expPayload(
+		4.0 / std::max<uint32_t>(load.payloadMaxBytes - load.payloadMinBytes, 1)
+	);
+	auto pickPayload = [&]() -> uint32_t {
+		if (!load.payloadExp)
+		{
+			return uniformPayload(rng);
+		}
+		const double size = load.payloadMinBytes + expPayload(rng);
+		return static_cast<uint32_t>(
+			std::min<double>(size, load.payloadMaxBytes)
+		);
+	};
+
+	std::vector<LoadGenArrival> arrivals;
+	std::vector<bool> hasEventId;
+	if (!load.tracePath.empty())
+	{
+		std::ifstream trace(load.tracePath);
+		if (!trace)
+		{
+			throw std::runtime_error("Failed to open trace " + load.tracePath);
+		}
+
+		std::string line;
+		while (std::getline(trace, line))
+		{
+			std::istringstream fields(line.substr(0, line.find('#')));
+			LoadGenArrival arrival;
+			if (!(fields >> arrival.arrivalUs))
+			{
+				// blank or comment
+				continue;
+			}
+			arrival.moduleIdx = std::numeric_limits<uint32_t>::max();
+			arrival.eventIdIdx = std::numeric_limits<uint32_t>::max();
+			arrival.payloadSize = 0;
+			fields >> arrival.moduleIdx >> arrival.eventIdIdx >> arrival.payloadSize;
+
+			if (arrival.moduleIdx == std::numeric_limits<uint32_t>::max())
+			{
+				arrival.moduleIdx = pickModule(rng);
+			}
+			else if (arrival.moduleIdx >= numModules)
+			{
+				throw std::invalid_argument(
+					"The trace has an invalid module index: " + line);
+			}
+			if (arrival.eventIdIdx != std::numeric_limits<uint32_t>::max())
+			{
+				load.numEventIds = std::max(load.numEventIds, arrival.eventIdIdx + 1);
+			}
+			if (arrival.payloadSize == 0)
+			{
+				arrival.payloadSize = pickPayload();
+			}
+			load.payloadMaxBytes = std::max(load.payloadMaxBytes, arrival.payloadSize);
+			arrivals.push_back(arrival);
+		}
+		// the event ids left out are picked once the number of ids is known
+		std::discrete_distribution<uint32_t> pickEventId =
+			MakeIndexDistribution(load.numEventIds, load.eventIdZipf);
+		for (auto& arrival : arrivals)
+		{
+			if (arrival.eventIdIdx == std::numeric_limits<uint32_t>::max())
+			{
+				arrival.eventIdIdx = pickEventId(rng);
+			}
+		}
+
+		std::stable_sort(
+			arrivals.begin(),
+			arrivals.end(),
+			[](const LoadGenArrival& a, const LoadGenArrival& b) {
+				return a.arrivalUs < b.arrivalUs;
+			}
+		);
+		load.numEvents = static_cast<uint32_t>(arrivals.size());
+		return arrivals;
+	}
+
+	std::exponential_distribution<double> interArrival(load.rate / 1e6);
+	std::discrete_distribution<uint32_t> pickEventId =
+		MakeIndexDistribution(load.numEventIds, load.eventIdZipf);
+
+	arrivals.resize(load.numEvents);
+	double arrivalUs = 0.0;
+	for (auto& arrival : arrivals)
+	{
+		arrivalUs += interArrival(rng);
+		arrival.arrivalUs = static_cast<uint64_t>(arrivalUs);
+		arrival.moduleIdx = pickModule(rng);
+		arrival.eventIdIdx = pickEventId(rng);
+		arrival.payloadSize = pickPayload();
+	}
+	return arrivals;
+}
+
+/**
+ * @brief Start the workers, submit the arrivals on time from this thread,
+ *        each with the timestamp it was meant to arrive at, and wait for the
+ *        workers to run all the accepted events.
+ *
+ *        The timestamps are taken from the clock the enclave reads as well
+ *        (GetTimestampUs), so the latencies are measured the same way on
+ *        both sides.
+ *
+ */
+inline void RunLoadGenLoad(
+	const std::vector<LoadGenArrival>& arrivals,
+	uint32_t numWorkers,
+	const std::function<void(uint32_t)>& work,
+	const std::function<void(const LoadGenArrival&, uint64_t)>& submit,
+	const std::function<void()>& close
+)
+{
+	std::vector<std::thread> workers;
+	for (uint32_t i = 0; i < numWorkers; ++i)
+	{
+		workers.emplace_back(work, i);
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	const uint64_t startUs = GetTimestampUs();
+	for (const auto& arrival : arrivals)
+	{
+		std::this_thread::sleep_until(
+			start + std::chrono::microseconds(arrival.arrivalUs)
+		);
+		submit(arrival, startUs + arrival.arrivalUs);
+	}
+	close();
+
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+/**
+ * @brief Run the same open-loop load of events, with their ids and payload
+ *        sizes picked from the given distributions, on the untrusted side
+ *        and in the enclave, and report the throughput and the latency
+ *        percentiles of each.
+ *
+ *        In the enclave, the workers and the generator are the threads
+ *        calling into it, so the number of workers must be lower than the
+ *        enclave's TCSNum; larger ones are rejected.
+ *
+ */
+inline int LoadGenMain(int argc, char**argv)
+{
+	if (argc < 3)
+	{
+		std::cerr << "Usage: "
+			<< argv[0] << " <num workers> <wasm file> [<wasm file>...]"
+			<< " [--rate <events per second>] [--events <num>] [--trace <file>]"
+			<< " [--module-dist <uniform|zipf>]"
+			<< " [--event-ids <num>] [--event-id-dist <uniform|zipf>]"
+			<< " [--payload-min <bytes>] [--payload-max <bytes>]"
+			<< " [--payload-dist <uniform|exp>] [--seed <seed>]"
+			<< " [--pool <bytes>] [--mod-stack <bytes>] [--mod-heap <bytes>]"
+			<< " [--exec-stack <bytes>]"
+			<< std::endl;
+		return -1;
+	}
+
+	int optIdx = 2;
+	std::vector<std::string> modulePaths;
+	for (; (optIdx < argc) && (std::string(argv[optIdx]).rfind("--", 0) != 0); ++optIdx)
+	{
+		modulePaths.push_back(argv[optIdx]);
+	}
+	if (modulePaths.empty())
+	{
+		std::cerr << "ERROR: " << "No wasm file is given." << std::endl;
+		return -1;
+	}
+	LoadGenLoad load;
+	decent_wasm_loadgen_config_t config =
+		ParseLoadGenConfig(argc, argv, optIdx, load);
+	config.num_workers = std::max<uint32_t>(std::stoul(argv[1]), 1);
+	// the generator calls into the enclave while the workers run
+	if (!CheckEnclaveWorkers(config.num_workers, 1))
+	{
+		return -1;
+	}
+
+	std::vector<uint8_t> wasmFiles;
+	std::vector<uint64_t> fileSizes;
+	ReadFiles2Buffer(modulePaths, wasmFiles, fileSizes);
+
+	// the same load for both sides
+	const std::vector<LoadGenArrival> arrivals =
+		GenerateLoadGenLoad(load, modulePaths.size());
+
+	std::vector<std::vector<uint8_t> > eventIds;
+	for (uint32_t i = 0; i < load.numEventIds; ++i)
+	{
+		// the first one is the id the other benchmarks use
+		if (i == 0)
+		{
+			eventIds.push_back(GetDefaultEventId());
+			continue;
+		}
+		const std::string eventId = "Decent-" + std::to_string(i);
+		eventIds.emplace_back(eventId.begin(), eventId.end());
+		eventIds.back().push_back('\0');
+	}
+	// a payload of n bytes is the last n bytes, so it always ends with '\0'
+	std::vector<uint8_t> payloads(load.payloadMaxBytes, 'E');
+	payloads.back() = '\0';
+	auto getPayload = [&payloads](const LoadGenArrival& arrival) {
+		return payloads.data() + (payloads.size() - arrival.payloadSize);
+	};
+
+	if (!DecentWasmLoadGenBenchStart(
+		wasmFiles.data(), fileSizes.data(), fileSizes.size(), config
+	))
+	{
+		return -1;
+	}
+	RunLoadGenLoad(
+		arrivals,
+		config.num_workers,
+		DecentWasmLoadGenBenchWork,
+		[&](const LoadGenArrival& arrival, uint64_t arrivalUs) {
+			const std::vector<uint8_t>& eventId = eventIds[arrival.eventIdIdx];
+			DecentWasmLoadGenBenchSubmit(
+				arrival.moduleIdx,
+				eventId.data(), eventId.size(),
+				getPayload(arrival), arrival.payloadSize,
+				arrivalUs
+			);
+		},
+		DecentWasmLoadGenBenchClose
+	);
+	DecentWasmLoadGenBenchFinish();
+
+	sgx_enclave_id_t eid = 0;
+	enclave_init(&eid);
+
+	int retval = -1;
+	auto ret = ecall_decent_wasm_loadgen_start(
+		eid,
+		&retval,
+		wasmFiles.data(), wasmFiles.size(),
+		fileSizes.data(), fileSizes.size(),
+		&config
+	);
+	if ((ret != SGX_SUCCESS) || (retval != 0))
+	{
+		std::cerr << "ERROR: "
+			<< "Failed to run ecall_decent_wasm_loadgen_start." << std::endl;
+	}
+	else
+	{
+		RunLoadGenLoad(
+			arrivals,
+			config.num_workers,
+			[eid](uint32_t workerIdx) {
+				if (ecall_decent_wasm_loadgen_work(eid, workerIdx) != SGX_SUCCESS)
+				{
+					std::cerr << "ERROR: "
+						<< "Failed to run ecall_decent_wasm_loadgen_work." << std::endl;
+				}
+			},
+			[&](const LoadGenArrival& arrival, uint64_t arrivalUs) {
+				const std::vector<uint8_t>& eventId = eventIds[arrival.eventIdIdx];
+				int accepted = 0;
+				ecall_decent_wasm_loadgen_submit(
+					eid,
+					&accepted,
+					arrival.moduleIdx,
+					eventId.data(), eventId.size(),
+					getPayload(arrival), arrival.payloadSize,
+					arrivalUs
+				);
+			},
+			[eid]() {
+				ecall_decent_wasm_loadgen_close(eid);
+			}
+		);
+		ecall_decent_wasm_loadgen_finish(eid);
+	}
+
+	sgx_destroy_enclave(eid);
+
+	return 0;
+}
@@ -2,14 +2,22 @@
 
 #include <chrono>
 #include <iostream>
-#include <vector>
-#include <stdexcept>
 #include <string>
 
 #include <sgx_urts.h>
 #include <sgx_edger8r.h>
 
-#include "DecentMain.hpp"
+#include "AsyncDriver.hpp"
+#include "BundleDriver.hpp"
+#include "DeadlineDriver.hpp"
+#include "DensityDriver.hpp"
+#include "LoadGenDriver.hpp"
+#include "MainDriver.hpp"
+#include "MicroDriver.hpp"
+#include "PoolDriver.hpp"
+#include "SchedDriver.hpp"
+#include "ServerDriver.hpp"
+#include "WatchdogDriver.hpp"
 
 extern "C" {
 
@@ -27,155 +35,90 @@ extern "C" uint64_t ocall_decent_untrusted_timestamp_us()
 	return static_cast<uint64_t>(nowUs.count());
 }
 
-extern sgx_status_t ecall_decent_wasm_main(
-	sgx_enclave_id_t eid,
-	const uint8_t *wasm_file, size_t wasm_file_size,
-	const uint8_t *wasm_nopt_file, size_t wasm_nopt_file_size
-);
+extern "C" void ocall_decent_noop()
+{}
 
 } // extern "C"
 
-static std::vector<uint8_t> ReadFile2Buffer(const std::string& filename)
+int main(int argc, char**argv)
 {
-	FILE *file;
-	size_t file_size, read_size;
-
-	if ((file = fopen(filename.c_str(), "rb")) == nullptr)
+	if ((argc >= 2) && (std::string(argv[1]) == "density"))
 	{
-		throw std::runtime_error(
-			"Read file to buffer failed: open file " + filename + " failed");
+		return DensityMain(argc - 1, argv + 1);
 	}
-
-	fseek(file, 0, SEEK_END);
-	file_size = ftell(file);
-	fseek(file, 0, SEEK_SET);
-
-	std::vector<uint8_t> buffer(file_size);
-
-	read_size = fread(buffer.data(), 1, file_size, file);
-	fclose(file);
-
-	if (read_size < file_size)
+	if ((argc >= 2) && (std::string(argv[1]) == "micro"))
 	{
-		throw std::runtime_error(
-			"Read file " + filename + " to buffer failed: read file content failed");
+		return MicroMain(argc - 1, argv + 1);
 	}
-
-	return buffer;
-}
-
-static void WriteBuffer2File(
-	const std::string& filename, const std::vector<uint8_t>& buffer)
-{
-	FILE *file;
-	size_t writeSize = 0;
-
-	if ((file = fopen(filename.c_str(), "wb")) == nullptr)
+	if ((argc >= 2) && (std::string(argv[1]) == "bundle"))
 	{
-		throw std::runtime_error(
-			"write buffer to file failed: open file " + filename + " failed");
+		return BundleMain(argc - 1, argv + 1);
 	}
-
-	writeSize = fwrite(buffer.data(), 1, buffer.size(), file);
-	fclose(file);
-
-	if(writeSize < buffer.size())
+	if ((argc >= 2) && (std::string(argv[1]) == "server"))
 	{
-		throw std::runtime_error(
-			"write buffer to file " + filename + " failed: write file content failed");
+		return ServerMain(argc - 1, argv + 1);
 	}
-}
-
-static void enclave_init(sgx_enclave_id_t *p_eid)
-{
-	sgx_launch_token_t token = { 0 };
-	sgx_status_t ret = SGX_ERROR_UNEXPECTED;
-	int updated = 0;
-
-	std::vector<uint8_t> tokenBuf;
-	try
+	if ((argc >= 2) && (std::string(argv[1]) == "pool"))
 	{
-		tokenBuf = ReadFile2Buffer(DECENT_ENCLAVE_PLATFORM_SGX_TOKEN);
+		return PoolMain(argc - 1, argv + 1);
 	}
-	catch(const std::runtime_error&)
-	{}
-
-	ret = sgx_create_enclave(
-		DECENT_ENCLAVE_PLATFORM_SGX_IMAGE,
-		1 /*SGX_DEBUG_FLAG*/,
-		&token,
-		&updated,
-		p_eid,
-		nullptr);
-
-	if (ret != SGX_SUCCESS) {
-		throw std::runtime_error("Failed to create enclave");
+	if ((argc >= 2) && (std::string(argv[1]) == "sched"))
+	{
+		return SchedMain(argc - 1, argv + 1);
 	}
-
-	if (updated == 1)
+	if ((argc >= 2) && (std::string(argv[1]) == "deadline"))
 	{
-		tokenBuf.resize(std::distance(std::begin(token), std::end(token)));
-		std::copy(std::begin(token), std::end(token), tokenBuf.begin());
-		WriteBuffer2File(DECENT_ENCLAVE_PLATFORM_SGX_TOKEN, tokenBuf);
+		return DeadlineMain(argc - 1, argv + 1);
 	}
-}
-
-static bool BenchmarkOnUntrusted(
-	const std::vector<uint8_t>& wasmBytecode,
-	const std::vector<uint8_t>& noptWasmBytecode
-)
-{
-	return DecentWasmMain(
-		wasmBytecode.data(), wasmBytecode.size(),
-		noptWasmBytecode.data(), noptWasmBytecode.size()
-	);
-}
-
-static void BenchmarkOnEnclave(
-	const std::vector<uint8_t>& wasmBytecode,
-	const std::vector<uint8_t>& noptWasmBytecode
-)
-{
-	// init enclave
-	sgx_enclave_id_t eid = 0;
-	enclave_init(&eid);
-
-	// iwasm main
-	auto ret = ecall_decent_wasm_main(
-		eid,
-		wasmBytecode.data(), wasmBytecode.size(),
-		noptWasmBytecode.data(), noptWasmBytecode.size()
-	);
-	if(ret != SGX_SUCCESS)
+	if ((argc >= 2) && (std::string(argv[1]) == "watchdog"))
 	{
-		std::cerr << "ERROR: "
-			<< "Failed to run ecall_decent_wasm_main." << std::endl;
+		return WatchdogMain(argc - 1, argv + 1);
 	}
-
-	// destroy enclave
-	sgx_destroy_enclave(eid);
-}
-
-int main(int argc, char**argv)
-{
-	if (argc < 3)
+	if ((argc >= 2) && (std::string(argv[1]) == "async"))
 	{
-		std::cerr << "Usage: "
-			<< argv[0] << " <wasm file> <inst. wasm file>" << std::endl;
-		return -1;
+		return AsyncMain(argc - 1, argv + 1);
+	}
+	if ((argc >= 2) && (std::string(argv[1]) == "loadgen"))
+	{
+		return LoadGenMain(argc - 1, argv + 1);
 	}
 
-	const std::string wasmFilenamePath = argv[1];
-	const std::string instWasmFilenamePath = argv[2];
-
-	auto wasmBytecode = ReadFile2Buffer(wasmFilenamePath);
-	auto instWasmBytecode = ReadFile2Buffer(instWasmFilenamePath);
-
-	if (!BenchmarkOnUntrusted(wasmBytecode, instWasmBytecode))
+	if (argc < 3)
 	{
+		std::cerr << "Usage: "
+			<< argv[0] << " <wasm file> <inst. wasm file>"
+			<< " [--init-mem <bytes>]"
+			<< " [--auto-size <margin percent>]"
+			<< " [--prefault] [--populate] [--thp] [--huge-pages]"
+			<< " [--mode <interp|fast-jit|llvm-jit|multi-tier-jit>]"
+			<< " [--aot-cache <dir>] [--sgx-aot-cache <dir>] [--no-aot-cache]"
+			<< std::endl;
+		std::cerr << "       "
+			<< argv[0] << " density <wasm file> [options]" << std::endl;
+		std::cerr << "       "
+			<< argv[0] << " micro <wasm file> [options]" << std::endl;
+		std::cerr << "       "
+			<< argv[0] << " bundle [<module id> [options]]" << std::endl;
+		std::cerr << "       "
+			<< argv[0] << " server <socket path> [options]" << std::endl;
+		std::cerr << "       "
+			<< argv[0] << " pool <max enclaves> <num jobs> <wasm file>..."
+			<< " [options]" << std::endl;
+		std::cerr << "       "
+			<< argv[0] << " sched <num workers> <num events> <wasm file>..."
+			<< " [options]" << std::endl;
+		std::cerr << "       "
+			<< argv[0] << " deadline <num workers> <events per second> <num events>"
+			<< " <instrumented wasm file>... [options]" << std::endl;
+		std::cerr << "       "
+			<< argv[0] << " watchdog <wasm file> <inst. wasm file> [options]"
+			<< std::endl;
+		std::cerr << "       "
+			<< argv[0] << " async <wasm file> <num runs> [options]" << std::endl;
+		std::cerr << "       "
+			<< argv[0] << " loadgen <num workers> <wasm file>... [options]"
+			<< std::endl;
 		return -1;
 	}
-	BenchmarkOnEnclave(wasmBytecode, instWasmBytecode);
-
-	return 0;
+	return BenchmarkMain(argc, argv);
 }
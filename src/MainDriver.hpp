@@ -0,0 +1,495 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstdint>
+#include <cstring>
+
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sgx_urts.h>
+#include <DecentWasmRuntime/Internal/Sha256.hpp>
+
+#include "DecentMain.hpp"
+#include "HostUtils.hpp"
+#include "MappedFile.hpp"
+#include "decent_wasm_config.h"
+
+
+extern "C" {
+
+extern sgx_status_t ecall_decent_wasm_main(
+	sgx_enclave_id_t eid,
+	const uint8_t *wasm_file, size_t wasm_file_size,
+	const uint8_t *wasm_nopt_file, size_t wasm_nopt_file_size,
+	const decent_wasm_main_config_t *config
+);
+
+extern sgx_status_t ecall_decent_wasm_main_mapped(
+	sgx_enclave_id_t eid,
+	const uint8_t *wasm_file, size_t wasm_file_size,
+	const uint8_t *wasm_nopt_file, size_t wasm_nopt_file_size,
+	const decent_wasm_main_config_t *config
+);
+
+extern sgx_status_t ecall_decent_wasm_aot_sealed_size(
+	sgx_enclave_id_t eid,
+	size_t *retval,
+	size_t aot_file_size
+);
+
+extern sgx_status_t ecall_decent_wasm_aot_seal(
+	sgx_enclave_id_t eid,
+	int *retval,
+	const uint8_t *wasm_file, size_t wasm_file_size,
+	const uint8_t *aot_file, size_t aot_file_size,
+	uint8_t *sealed_buf, size_t sealed_buf_size
+);
+
+extern sgx_status_t ecall_decent_wasm_aot_load_sealed(
+	sgx_enclave_id_t eid,
+	int *retval,
+	const uint8_t *sealed, size_t sealed_size
+);
+
+} // extern "C"
+
+
+#if !defined(DECENT_WASM_AOT_CACHE_KEY) || !defined(DECENT_WASM_SGX_AOT_CACHE_KEY)
+#error "DECENT_WASM_AOT_CACHE_KEY and DECENT_WASM_SGX_AOT_CACHE_KEY must be set by decent_wasm_aot_cache_key()"
+#endif // !DECENT_WASM_AOT_CACHE_KEY || !DECENT_WASM_SGX_AOT_CACHE_KEY
+
+/**
+ * @brief Options only used by the untrusted side.
+ *
+ */
+struct HostOptions
+{
+	/**
+	 * @brief Directory of precompiled AOT modules (see
+	 *        cmake/DecentWasmAot.cmake), e.g., `<build dir>/aot-cache`;
+	 *        empty (the default) to always run the bytecode.
+	 */
+	std::string aotCacheDir;
+
+	/**
+	 * @brief Directory of AOT modules compiled for the enclave
+	 *        (`wamrc --sgx`), e.g., `<build dir>/aot-cache-sgx`, where the
+	 *        enclave's sealed copies (`.sealed`) are kept as well;
+	 *        empty (the default) to always run the bytecode in the enclave.
+	 */
+	std::string sgxAotCacheDir;
+}; // struct HostOptions
+
+/**
+ * @brief Get the path of the artifact of the given module in an AOT cache,
+ *        without the extension, i.e., `<dir>/<SHA-256 of the bytecode>-<key>`.
+ *        The key is given by the build for the wamrc, the WAMR version, the
+ *        target, and the wamrc flags the cache is filled with (see
+ *        cmake/DecentWasmAot.cmake), so artifacts compiled otherwise are
+ *        never picked up.
+ *
+ */
+inline std::string GetAotCacheBasePath(
+	const std::string& aotCacheDir,
+	const char* cacheKey,
+	const uint8_t* wasmBytecode, size_t wasmBytecodeSize
+)
+{
+	using namespace DecentWasmRuntime::Internal;
+
+	return aotCacheDir + "/" +
+		Sha256::ToHex(Sha256::Hash(wasmBytecode, wasmBytecodeSize)) + "-" +
+		cacheKey;
+}
+
+/**
+ * @brief Look up the AOT module of the given module in the cache.
+ *
+ * @return The AOT module, or an empty buffer on a cache miss.
+ */
+inline std::vector<uint8_t> LookupAotCache(
+	const std::string& aotCacheDir,
+	const std::vector<uint8_t>& wasmBytecode
+)
+{
+	if (aotCacheDir.empty())
+	{
+		return std::vector<uint8_t>();
+	}
+
+	const std::string aotPath = GetAotCacheBasePath(
+		aotCacheDir,
+		DECENT_WASM_AOT_CACHE_KEY,
+		wasmBytecode.data(), wasmBytecode.size()
+	) + ".aot";
+	try
+	{
+		std::vector<uint8_t> aot = ReadFile2Buffer(aotPath);
+		std::cout << "AOT cache hit: " << aotPath << std::endl;
+		return aot;
+	}
+	catch(const std::runtime_error&)
+	{
+		std::cout << "AOT cache miss: " << aotPath << std::endl;
+		return std::vector<uint8_t>();
+	}
+}
+
+/**
+ * @brief Map the AOT module of the given module from the cache.
+ *
+ * @return The mapped AOT module, or nullptr on a cache miss.
+ */
+inline std::unique_ptr<MappedFile> MapAotCache(
+	const std::string& aotCacheDir,
+	const MappedFile& wasm
+)
+{
+	if (aotCacheDir.empty())
+	{
+		return nullptr;
+	}
+
+	const std::string aotPath = GetAotCacheBasePath(
+		aotCacheDir,
+		DECENT_WASM_AOT_CACHE_KEY,
+		wasm.data(), wasm.size()
+	) + ".aot";
+	try
+	{
+		std::unique_ptr<MappedFile> aot(new MappedFile(aotPath));
+		std::cout << "AOT cache hit: " << aotPath << std::endl;
+		return aot;
+	}
+	catch(const std::runtime_error&)
+	{
+		std::cout << "AOT cache miss: " << aotPath << std::endl;
+		return nullptr;
+	}
+}
+
+/**
+ * @brief Get the buffer of a module to be loaded in place, which is its AOT
+ *        module if there is one, falling back to the bytecode if the AOT
+ *        module fails to load.
+ *
+ */
+inline MainModuleBuffer GetInPlaceModuleBuffer(
+	MappedFile& wasm,
+	const std::unique_ptr<MappedFile>& aot
+)
+{
+	MainModuleBuffer wasmBuf = MainModuleBuffer::InPlace(wasm.data(), wasm.size());
+	return aot == nullptr ?
+		wasmBuf :
+		MainModuleBuffer::InPlace(aot->data(), aot->size()).WithFallback(wasmBuf);
+}
+
+inline decent_wasm_main_config_t ParseMainConfig(
+	int argc, char** argv, int startIdx, HostOptions& hostOpts
+)
+{
+	decent_wasm_main_config_t config;
+	std::memset(&config, 0, sizeof(config));
+
+	for (int i = startIdx; i < argc; ++i)
+	{
+		const std::string opt = argv[i];
+		if (opt == "--aot-cache" && (i + 1) < argc)
+		{
+			hostOpts.aotCacheDir = argv[++i];
+		}
+		else if (opt == "--sgx-aot-cache" && (i + 1) < argc)
+		{
+			hostOpts.sgxAotCacheDir = argv[++i];
+		}
+		else if (opt == "--no-aot-cache")
+		{
+			hostOpts.aotCacheDir.clear();
+			hostOpts.sgxAotCacheDir.clear();
+		}
+		else if (opt == "--init-mem" && (i + 1) < argc)
+		{
+			config.init_linear_mem_size =
+				static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (opt == "--auto-size" && (i + 1) < argc)
+		{
+			config.auto_size = 1;
+			config.auto_size_margin =
+				static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (opt == "--prefault")
+		{
+			config.prefault = 1;
+		}
+		else if (opt == "--populate")
+		{
+			config.pool_populate = 1;
+		}
+		else if (opt == "--thp")
+		{
+			config.pool_huge_page_hint = 1;
+		}
+		else if (opt == "--huge-pages")
+		{
+			config.pool_huge_pages = 1;
+		}
+		else if (opt == "--mode" && (i + 1) < argc)
+		{
+			config.running_mode = static_cast<uint32_t>(
+				DecentWasmRuntime::ParseRunningMode(argv[++i])
+			);
+			// an explicit tier is asked, so don't run precompiled code
+			hostOpts.aotCacheDir.clear();
+			hostOpts.sgxAotCacheDir.clear();
+		}
+		else
+		{
+			throw std::invalid_argument("Unknown option " + opt);
+		}
+	}
+
+	return config;
+}
+
+/**
+ * @brief Run the modules (or their AOT modules from the cache) loaded in
+ *        place from their file mappings, which are written by the loads,
+ *        and thus shouldn't be used afterwards.
+ *
+ */
+inline bool BenchmarkOnUntrusted(
+	MappedFile& wasmFile,
+	MappedFile& noptWasmFile,
+	const decent_wasm_main_config_t& config,
+	const HostOptions& hostOpts
+)
+{
+	std::unique_ptr<MappedFile> wasmAot =
+		MapAotCache(hostOpts.aotCacheDir, wasmFile);
+	std::unique_ptr<MappedFile> noptWasmAot =
+		MapAotCache(hostOpts.aotCacheDir, noptWasmFile);
+
+	return DecentWasmMain(
+		GetInPlaceModuleBuffer(wasmFile, wasmAot),
+		GetInPlaceModuleBuffer(noptWasmFile, noptWasmAot),
+		config
+	);
+}
+
+inline bool LoadSealedAotIntoEnclave(
+	sgx_enclave_id_t eid,
+	const std::string& sealedPath
+)
+{
+	std::vector<uint8_t> sealed;
+	try
+	{
+		sealed = ReadFile2Buffer(sealedPath);
+	}
+	catch(const std::runtime_error&)
+	{
+		return false;
+	}
+
+	int retval = -1;
+	uint64_t startUs = GetSteadyTimeUs();
+	auto ret = ecall_decent_wasm_aot_load_sealed(
+		eid,
+		&retval,
+		sealed.data(), sealed.size()
+	);
+	uint64_t endUs = GetSteadyTimeUs();
+	if ((ret != SGX_SUCCESS) || (retval != 0))
+	{
+		// e.g., sealed by another enclave build; it'll be sealed again
+		std::cout << "Enclave AOT cache: rejected " << sealedPath << std::endl;
+		return false;
+	}
+
+	std::cout << "Enclave AOT cache: loaded " << sealedPath
+		<< " in " << (endUs - startUs) << " us" << std::endl;
+	return true;
+}
+
+inline void SealAotByEnclave(
+	sgx_enclave_id_t eid,
+	const uint8_t* wasmBytecode, size_t wasmBytecodeSize,
+	const std::string& aotPath,
+	const std::string& sealedPath
+)
+{
+	std::vector<uint8_t> aot;
+	try
+	{
+		aot = ReadFile2Buffer(aotPath);
+	}
+	catch(const std::runtime_error&)
+	{
+		std::cout << "Enclave AOT cache: miss " << aotPath << std::endl;
+		return;
+	}
+
+	size_t sealedSize = 0;
+	auto ret = ecall_decent_wasm_aot_sealed_size(eid, &sealedSize, aot.size());
+	if ((ret != SGX_SUCCESS) || (sealedSize == 0))
+	{
+		std::cerr << "ERROR: "
+			<< "Failed to get the sealed size of " << aotPath << std::endl;
+		return;
+	}
+
+	std::vector<uint8_t> sealed(sealedSize);
+	int retval = -1;
+	ret = ecall_decent_wasm_aot_seal(
+		eid,
+		&retval,
+		wasmBytecode, wasmBytecodeSize,
+		aot.data(), aot.size(),
+		sealed.data(), sealed.size()
+	);
+	if ((ret != SGX_SUCCESS) || (retval != 0))
+	{
+		std::cerr << "ERROR: " << "Failed to seal " << aotPath << std::endl;
+		return;
+	}
+
+	WriteBuffer2File(sealedPath, sealed);
+	std::cout << "Enclave AOT cache: sealed " << sealedPath << std::endl;
+}
+
+/**
+ * @brief Load the enclave's AOT artifact of the given module into the
+ *        enclave, from its sealed copy if there is one, or otherwise let
+ *        the enclave seal the artifact for the next runs.
+ *
+ */
+inline void PrepareEnclaveAotCache(
+	sgx_enclave_id_t eid,
+	const std::string& sgxAotCacheDir,
+	const uint8_t* wasmBytecode, size_t wasmBytecodeSize
+)
+{
+#ifndef DECENT_WASM_SGX_AOT
+	// the enclave always runs the bytecode
+	(void)eid;
+	(void)sgxAotCacheDir;
+	(void)wasmBytecode;
+	(void)wasmBytecodeSize;
+#else
+	if (sgxAotCacheDir.empty())
+	{
+		return;
+	}
+
+	const std::string basePath = GetAotCacheBasePath(
+		sgxAotCacheDir,
+		DECENT_WASM_SGX_AOT_CACHE_KEY,
+		wasmBytecode, wasmBytecodeSize
+	);
+	if (!LoadSealedAotIntoEnclave(eid, basePath + ".sealed"))
+	{
+		SealAotByEnclave(
+			eid,
+			wasmBytecode, wasmBytecodeSize,
+			basePath + ".aot",
+			basePath + ".sealed"
+		);
+	}
+#endif // !DECENT_WASM_SGX_AOT
+}
+
+inline void PrepareEnclaveAotCache(
+	sgx_enclave_id_t eid,
+	const std::string& sgxAotCacheDir,
+	const std::vector<uint8_t>& wasmBytecode
+)
+{
+	PrepareEnclaveAotCache(
+		eid,
+		sgxAotCacheDir,
+		wasmBytecode.data(), wasmBytecode.size()
+	);
+}
+
+/**
+ * @brief Run the modules in the enclave, which reads them straight from
+ *        their file mappings.
+ *
+ */
+inline void BenchmarkOnEnclave(
+	const MappedFile& wasmFile,
+	const MappedFile& noptWasmFile,
+	const decent_wasm_main_config_t& config,
+	const HostOptions& hostOpts
+)
+{
+	// init enclave
+	sgx_enclave_id_t eid = 0;
+	enclave_init(&eid);
+
+	PrepareEnclaveAotCache(
+		eid, hostOpts.sgxAotCacheDir, wasmFile.data(), wasmFile.size()
+	);
+	PrepareEnclaveAotCache(
+		eid, hostOpts.sgxAotCacheDir, noptWasmFile.data(), noptWasmFile.size()
+	);
+
+	// iwasm main
+	auto ret = ecall_decent_wasm_main_mapped(
+		eid,
+		wasmFile.data(), wasmFile.size(),
+		noptWasmFile.data(), noptWasmFile.size(),
+		&config
+	);
+	if(ret != SGX_SUCCESS)
+	{
+		std::cerr << "ERROR: "
+			<< "Failed to run ecall_decent_wasm_main_mapped." << std::endl;
+	}
+
+	// destroy enclave
+	sgx_destroy_enclave(eid);
+}
+
+/**
+ * @brief Run the main benchmark, with a program and its instrumented build,
+ *        on the untrusted side and in the enclave.
+ *
+ */
+inline int BenchmarkMain(int argc, char**argv)
+{
+	const std::string wasmFilenamePath = argv[1];
+	const std::string instWasmFilenamePath = argv[2];
+	HostOptions hostOpts;
+	const decent_wasm_main_config_t config =
+		ParseMainConfig(argc, argv, 3, hostOpts);
+
+	{
+		MappedFile wasmFile(wasmFilenamePath);
+		MappedFile instWasmFile(instWasmFilenamePath);
+		if (!BenchmarkOnUntrusted(wasmFile, instWasmFile, config, hostOpts))
+		{
+			return -1;
+		}
+	}
+	// mapped again, since the untrusted run has written to its mappings
+	BenchmarkOnEnclave(
+		MappedFile(wasmFilenamePath),
+		MappedFile(instWasmFilenamePath),
+		config,
+		hostOpts
+	);
+
+	return 0;
+}
@@ -0,0 +1,116 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+/**
+ * @brief A private, writable mapping of a whole file (untrusted side only).
+ *
+ *        Pages are read from the page cache only when touched, and copied
+ *        only when written, e.g., by WAMR loading a module in place; writes
+ *        never reach the file, nor any other mapping of it.
+ *
+ */
+class MappedFile
+{
+public:
+
+	explicit MappedFile(const std::string& filename) :
+		m_data(nullptr),
+		m_size(0)
+	{
+		int fd = open(filename.c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			throw std::runtime_error(
+				"Map file failed: open file " + filename + " failed");
+		}
+
+		struct stat st;
+		if (fstat(fd, &st) != 0)
+		{
+			close(fd);
+			throw std::runtime_error(
+				"Map file failed: stat file " + filename + " failed");
+		}
+		m_size = static_cast<size_t>(st.st_size);
+
+		if (m_size > 0)
+		{
+			void* ptr = mmap(
+				nullptr,
+				m_size,
+				PROT_READ | PROT_WRITE,
+				MAP_PRIVATE,
+				fd,
+				0
+			);
+			if (ptr == MAP_FAILED)
+			{
+				close(fd);
+				throw std::runtime_error(
+					"Map file failed: map file " + filename + " failed");
+			}
+			m_data = static_cast<uint8_t*>(ptr);
+			// modules are mostly read front to back, when loaded or copied
+			madvise(m_data, m_size, MADV_SEQUENTIAL);
+		}
+		// the mapping stays valid after the file is closed
+		close(fd);
+	}
+
+	MappedFile(const MappedFile&) = delete;
+
+	MappedFile(MappedFile&& other) noexcept :
+		m_data(other.m_data),
+		m_size(other.m_size)
+	{
+		other.m_data = nullptr;
+		other.m_size = 0;
+	}
+
+	~MappedFile()
+	{
+		if (m_data != nullptr)
+		{
+			munmap(m_data, m_size);
+		}
+	}
+
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	uint8_t* data() noexcept
+	{
+		return m_data;
+	}
+
+	const uint8_t* data() const noexcept
+	{
+		return m_data;
+	}
+
+	size_t size() const noexcept
+	{
+		return m_size;
+	}
+
+private:
+
+	uint8_t* m_data;
+	size_t m_size;
+}; // class MappedFile
+
@@ -0,0 +1,87 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sgx_urts.h>
+
+#include "DecentMain.hpp"
+#include "HostUtils.hpp"
+#include "MainDriver.hpp"
+#include "decent_wasm_config.h"
+
+
+extern "C" {
+
+extern sgx_status_t ecall_decent_wasm_micro(
+	sgx_enclave_id_t eid,
+	const uint8_t *wasm_file, size_t wasm_file_size,
+	const decent_wasm_main_config_t *config
+);
+
+} // extern "C"
+
+
+/**
+ * @brief Run a microbenchmark module on the untrusted side and in the
+ *        enclave.
+ *
+ */
+inline int MicroMain(int argc, char**argv)
+{
+	if (argc < 2)
+	{
+		std::cerr << "Usage: "
+			<< argv[0] << " <wasm file> [options]" << std::endl;
+		return -1;
+	}
+
+	const std::string wasmFilenamePath = argv[1];
+	HostOptions hostOpts;
+	const decent_wasm_main_config_t config =
+		ParseMainConfig(argc, argv, 2, hostOpts);
+
+	auto wasmBytecode = ReadFile2Buffer(wasmFilenamePath);
+	auto aot = LookupAotCache(hostOpts.aotCacheDir, wasmBytecode);
+
+	MainModuleBuffer wasmBuf =
+		MainModuleBuffer::Copied(wasmBytecode.data(), wasmBytecode.size());
+	if (!aot.empty())
+	{
+		wasmBuf = MainModuleBuffer::Copied(aot.data(), aot.size())
+			.WithFallback(wasmBuf);
+	}
+	if (!DecentWasmMicroMain(wasmBuf, config))
+	{
+		return -1;
+	}
+
+	sgx_enclave_id_t eid = 0;
+	enclave_init(&eid);
+
+	PrepareEnclaveAotCache(eid, hostOpts.sgxAotCacheDir, wasmBytecode);
+
+	auto ret = ecall_decent_wasm_micro(
+		eid,
+		wasmBytecode.data(), wasmBytecode.size(),
+		&config
+	);
+	if(ret != SGX_SUCCESS)
+	{
+		std::cerr << "ERROR: "
+			<< "Failed to run ecall_decent_wasm_micro." << std::endl;
+	}
+
+	sgx_destroy_enclave(eid);
+
+	return 0;
+}
@@ -0,0 +1,44 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstddef>
+#include <cstdint>
+
+
+/**
+ * @brief A WASM (or AOT) module embedded in the binary at compile time.
+ *        The table of them, `g_decentWasmBundledModules`, is generated by
+ *        `decent_wasm_add_module_bundle()` (see cmake/DecentWasmBundle.cmake).
+ *
+ */
+struct DecentWasmBundledModule
+{
+	/**
+	 * @brief File name of the module, without the extension.
+	 */
+	const char* name;
+
+	/**
+	 * @brief SHA-256 of the module content, in hex.
+	 */
+	const char* sha256;
+
+	/**
+	 * @brief Content of the module; WAMR may modify the buffer it loads a
+	 *        module from, so it must be copied for every load.
+	 */
+	const uint8_t* data;
+
+	size_t size;
+}; // struct DecentWasmBundledModule
+
+
+extern const DecentWasmBundledModule g_decentWasmBundledModules[];
+
+extern const size_t g_decentWasmBundledModuleCount;
+
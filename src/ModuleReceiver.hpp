@@ -0,0 +1,111 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <stdexcept>
+#include <vector>
+
+#include <sgx_trts.h>
+
+#include <DecentWasmRuntime/Internal/Sha256.hpp>
+
+
+/**
+ * @brief Receives a module from the untrusted side (enclave side only).
+ *
+ *        The bytes are copied straight into the buffer the module is loaded
+ *        from, and hashed piece by piece right after each piece is copied,
+ *        while it's still in the cache; thus they are read from untrusted
+ *        memory only once, and the hash is of exactly the bytes loaded.
+ *
+ */
+class ModuleReceiver
+{
+public: // static members
+
+	using Sha256 = DecentWasmRuntime::Internal::Sha256;
+	using Digest = Sha256::Digest;
+
+	static constexpr size_t sk_pieceSize = 64 * 1024;
+
+public:
+
+	/**
+	 * @param size The size of the whole module.
+	 */
+	explicit ModuleReceiver(size_t size) :
+		m_buf(),
+		m_size(size),
+		m_hasher()
+	{
+		m_buf.reserve(size);
+	}
+
+	/**
+	 * @brief Append bytes already inside the enclave (e.g., marshaled by an
+	 *        `[in]` ecall parameter).
+	 *
+	 */
+	void Append(const uint8_t* data, size_t size)
+	{
+		if (size > (m_size - m_buf.size()))
+		{
+			throw std::out_of_range("More bytes than the size of the module");
+		}
+
+		for (size_t pos = 0; pos < size; pos += sk_pieceSize)
+		{
+			const size_t pieceSize =
+				(size - pos) < sk_pieceSize ? (size - pos) : sk_pieceSize;
+			const size_t bufPos = m_buf.size();
+			m_buf.insert(m_buf.end(), data + pos, data + pos + pieceSize);
+			m_hasher.Update(m_buf.data() + bufPos, pieceSize);
+		}
+	}
+
+	/**
+	 * @brief Append bytes from untrusted memory (e.g., an `[user_check]`
+	 *        ecall parameter pointing to a file mapping).
+	 *
+	 */
+	void AppendUntrusted(const uint8_t* data, size_t size)
+	{
+		if ((size > 0) && (sgx_is_outside_enclave(data, size) != 1))
+		{
+			throw std::invalid_argument("The buffer is not outside the enclave");
+		}
+		Append(data, size);
+	}
+
+	bool IsComplete() const noexcept
+	{
+		return m_buf.size() == m_size;
+	}
+
+	/**
+	 * @brief Take the received module, and the SHA-256 of it.
+	 *
+	 */
+	std::vector<uint8_t> Finalize(Digest& hash)
+	{
+		if (!IsComplete())
+		{
+			throw std::length_error("The module has not been fully received");
+		}
+		hash = m_hasher.Finalize();
+		return std::move(m_buf);
+	}
+
+private:
+
+	std::vector<uint8_t> m_buf;
+	size_t m_size;
+	Sha256 m_hasher;
+}; // class ModuleReceiver
+
@@ -0,0 +1,272 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <future>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sgx_urts.h>
+
+#include "BenchUtils.hpp"
+#include "EnclavePool.hpp"
+#include "HostUtils.hpp"
+#include "MainDriver.hpp"
+#include "MappedFile.hpp"
+#include "ServerDriver.hpp"
+#include "decent_wasm_config.h"
+
+
+/**
+ * @brief Run a burst of jobs of the given modules on a pool of enclaves, for
+ *        each number of enclaves from 1 up to the given one (doubling), and
+ *        report the throughput and latencies.
+ *
+ *        The modules are picked with Zipf-like weights (the k-th module is
+ *        picked 1/k as often as the first), so a few modules are hot.
+ *
+ */
+inline int PoolMain(int argc, char**argv)
+{
+	if (argc < 4)
+	{
+		std::cerr << "Usage: "
+			<< argv[0] << " <max enclaves> <num jobs> <wasm file> [<wasm file>...]"
+			<< " [options]" << std::endl;
+		return -1;
+	}
+
+	const size_t maxShards = std::max<size_t>(std::stoul(argv[1]), 1);
+	const size_t numJobs = std::stoul(argv[2]);
+	int optIdx = 3;
+	std::vector<std::string> modulePaths;
+	for (; (optIdx < argc) && (std::string(argv[optIdx]).rfind("--", 0) != 0); ++optIdx)
+	{
+		modulePaths.push_back(argv[optIdx]);
+	}
+	HostOptions hostOpts;
+	const decent_wasm_main_config_t config =
+		ParseMainConfig(argc, argv, optIdx, hostOpts);
+
+	std::vector<MappedFile> modules;
+	for (const auto& path : modulePaths)
+	{
+		modules.emplace_back(path);
+	}
+	const std::vector<double> weights = GetZipfWeights(modules.size());
+
+	// the same job sequence for every pool size
+	std::vector<size_t> jobModules(numJobs);
+	std::mt19937 rng(0);
+	std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+	for (auto& mod : jobModules)
+	{
+		mod = pick(rng);
+	}
+
+	static const std::vector<uint8_t>& sk_eventId = GetDefaultEventId();
+	static const std::vector<uint8_t>& sk_eventData = GetDefaultEventData();
+
+	std::vector<size_t> shardCounts;
+	for (size_t numShards = 1; numShards < maxShards; numShards *= 2)
+	{
+		shardCounts.push_back(numShards);
+	}
+	shardCounts.push_back(maxShards);
+
+	for (size_t numShards : shardCounts)
+	{
+		struct JobRecord
+		{
+			uint64_t submitUs = 0;
+			uint64_t latencyUs = 0;
+			uint64_t runUs = 0;
+			bool ok = false;
+			bool warm = false;
+			bool loaded = false;
+		}; // struct JobRecord
+		std::vector<JobRecord> records(numJobs);
+		// module handles in each enclave; only touched by its own thread
+		std::vector<std::vector<uint32_t> > shardHandles(
+			numShards,
+			std::vector<uint32_t>(modules.size(), 0)
+		);
+
+		EnclavePool pool(
+			numShards,
+			[]() {
+				sgx_enclave_id_t eid = 0;
+				enclave_init(&eid);
+				return eid;
+			},
+			[](sgx_enclave_id_t eid) {
+				ecall_decent_wasm_server_stop(eid);
+				sgx_destroy_enclave(eid);
+			}
+		);
+		std::atomic<bool> started(true);
+		const std::vector<std::exception_ptr> setupErrors = pool.Broadcast(
+			[&](size_t, sgx_enclave_id_t eid) {
+				int retval = -1;
+				auto ret = ecall_decent_wasm_server_start(eid, &retval, &config);
+				if ((ret != SGX_SUCCESS) || (retval != 0))
+				{
+					started = false;
+				}
+				for (const auto& mod : modules)
+				{
+					PrepareEnclaveAotCache(
+						eid, hostOpts.sgxAotCacheDir, mod.data(), mod.size()
+					);
+				}
+			}
+		);
+		for (size_t i = 0; i < setupErrors.size(); ++i)
+		{
+			if (setupErrors[i] == nullptr)
+			{
+				continue;
+			}
+			started = false;
+			try
+			{
+				std::rethrow_exception(setupErrors[i]);
+			}
+			catch (const std::exception& e)
+			{
+				std::cerr << "ERROR: Failed to set up enclave " << i << ": "
+					<< e.what() << std::endl;
+			}
+		}
+		if (!started)
+		{
+			std::cerr << "ERROR: "
+				<< "Failed to start the server in the enclaves." << std::endl;
+			return -1;
+		}
+
+		std::vector<std::future<void> > futures;
+		futures.reserve(numJobs);
+		uint64_t startUs = GetSteadyTimeUs();
+		for (size_t i = 0; i < numJobs; ++i)
+		{
+			const size_t modIdx = jobModules[i];
+			records[i].submitUs = GetSteadyTimeUs();
+			futures.push_back(pool.Submit(
+				modulePaths[modIdx],
+				[&, i, modIdx](size_t shardIdx, sgx_enclave_id_t eid) {
+					JobRecord& rec = records[i];
+					uint32_t& handle = shardHandles[shardIdx][modIdx];
+					decent_wasm_job_result_t res;
+					res.status = DECENT_WASM_JOB_UNKNOWN_MODULE;
+					// loaded on the first job, and again if it's been evicted
+					for (int attempt = 0;
+						(attempt < 2) && (res.status == DECENT_WASM_JOB_UNKNOWN_MODULE);
+						++attempt)
+					{
+						if ((handle == 0) || (attempt > 0))
+						{
+							rec.loaded = true;
+							if (!LoadIntoEnclaveServer(
+								eid,
+								modules[modIdx].data(), modules[modIdx].size(),
+								handle
+							))
+							{
+								handle = 0;
+								break;
+							}
+						}
+						auto ret = ecall_decent_wasm_server_run(
+							eid,
+							handle,
+							sk_eventId.data(), sk_eventId.size(),
+							sk_eventData.data(), sk_eventData.size(),
+							0,
+							&res
+						);
+						if (ret != SGX_SUCCESS)
+						{
+							break;
+						}
+					}
+					rec.latencyUs = GetSteadyTimeUs() - rec.submitUs;
+					rec.ok = (res.status == DECENT_WASM_JOB_OK);
+					rec.warm = rec.ok && (res.warm != 0);
+					rec.runUs = rec.ok ? res.run_time_us : 0;
+				}
+			));
+		}
+		pool.Drain();
+		uint64_t endUs = GetSteadyTimeUs();
+
+		// a job that threw is counted as failed, like one the enclave failed
+		for (size_t i = 0; i < numJobs; ++i)
+		{
+			try
+			{
+				futures[i].get();
+			}
+			catch (const std::exception& e)
+			{
+				records[i].ok = false;
+				std::cerr << "ERROR: Job " << i << " failed: "
+					<< e.what() << std::endl;
+			}
+		}
+
+		std::vector<uint64_t> latencies;
+		std::vector<uint64_t> runTimes;
+		size_t numFailed = 0;
+		size_t numWarm = 0;
+		size_t numLoads = 0;
+		for (const auto& rec : records)
+		{
+			numLoads += rec.loaded ? 1 : 0;
+			if (!rec.ok)
+			{
+				++numFailed;
+				continue;
+			}
+			numWarm += rec.warm ? 1 : 0;
+			latencies.push_back(rec.latencyUs);
+			runTimes.push_back(rec.runUs);
+		}
+		const EnclavePool::Stats stats = pool.GetStats();
+		const uint64_t timeUs = std::max<uint64_t>(endUs - startUs, 1);
+
+		std::string shardJobs;
+		for (auto jobs : stats.shardJobs)
+		{
+			shardJobs += (shardJobs.empty() ? "" : "/") + std::to_string(jobs);
+		}
+		std::cout << "Pool bench: "
+			<< "Enclaves: "      << numShards << ", "
+			<< "Jobs: "          << numJobs << ", "
+			<< "Failed: "        << numFailed << ", "
+			<< "Time: "          << timeUs << " us, "
+			<< "Throughput: "    << (latencies.size() * 1000000.0 / timeUs) << " jobs/s, "
+			<< "Latency p50: "   << GetPercentile(latencies, 50) << " us, "
+			<< "Latency p99: "   << GetPercentile(latencies, 99) << " us, "
+			<< "Run p50: "       << GetPercentile(runTimes, 50) << " us, "
+			<< "Run p99: "       << GetPercentile(runTimes, 99) << " us, "
+			<< "Warm: "          << numWarm << ", "
+			<< "Loads: "         << numLoads << ", "
+			<< "Affinity hits: " << stats.numAffinityHits << ", "
+			<< "Migrations: "    << stats.numMigrations << ", "
+			<< "Per enclave: "   << shardJobs << std::endl;
+	}
+
+	return 0;
+}
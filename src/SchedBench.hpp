@@ -0,0 +1,370 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <DecentWasmRuntime/Internal/make_unique.hpp>
+#include <DecentWasmRuntime/MainRunner.hpp>
+#include <DecentWasmRuntime/ThreadEnvGuard.hpp>
+#include <DecentWasmRuntime/WasmRuntimeStaticHeap.hpp>
+
+#include "BenchUtils.hpp"
+#include "SystemIO.hpp"
+#include "WorkStealingScheduler.hpp"
+#include "decent_wasm_config.h"
+
+
+/**
+ * @brief Run a burst of events of several modules on a set of worker
+ *        threads, scheduled by the given policy, and report how well the
+ *        events stay on the workers holding instances of their modules.
+ *
+ *        The modules are picked with Zipf-like weights (the k-th module is
+ *        picked 1/k as often as the first), so a few modules are hot.
+ *        Each worker keeps its own instances, which are only ever used by
+ *        the thread that created them.
+ *
+ *        The worker threads are given by the caller: each calls Work once,
+ *        which returns when all the events have run.
+ *
+ */
+class DecentWasmSchedBench
+{
+public: // static members
+
+	struct Event
+	{
+		size_t moduleIdx = 0;
+		uint64_t submitUs = 0;
+	}; // struct Event
+
+	using Scheduler = WorkStealingScheduler<Event>;
+
+	static const char* GetPolicyName(uint32_t policy)
+	{
+		return (policy == DECENT_WASM_SCHED_WORK_STEALING) ?
+			"work-stealing" : "shared-queue";
+	}
+
+public:
+
+	/**
+	 * @param wasmFiles The modules, one after another.
+	 * @param fileSizes The size of each module.
+	 */
+	DecentWasmSchedBench(
+		const uint8_t* wasmFiles,
+		const uint64_t* fileSizes, size_t numFiles,
+		const decent_wasm_sched_config_t& config
+	) :
+		m_config(config),
+		m_wasmRt(
+			DecentWasmRuntime::Internal::make_unique<
+				DecentWasmRuntime::WasmRuntimeStaticHeap
+			>(
+				PrintCStr,
+				config.pool_size,
+				GetTimestampUs
+			)
+		),
+		m_modules(),
+		m_sched(
+			config.num_workers,
+			(config.policy == DECENT_WASM_SCHED_WORK_STEALING) ?
+				Scheduler::Mode::WorkStealing :
+				Scheduler::Mode::SharedQueue
+		),
+		m_workers(config.num_workers),
+		m_startUs(0)
+	{
+		if ((numFiles == 0) ||
+			(config.num_workers == 0) ||
+			(config.max_worker_instances == 0))
+		{
+			throw std::invalid_argument(
+				"The scheduler benchmark needs modules, workers and instances");
+		}
+
+		for (size_t i = 0; i < numFiles; ++i)
+		{
+			m_modules.push_back(m_wasmRt.LoadModule(
+				std::vector<uint8_t>(wasmFiles, wasmFiles + fileSizes[i])
+			));
+			wasmFiles += fileSizes[i];
+		}
+		const std::vector<double> weights = GetZipfWeights(numFiles);
+
+		std::mt19937 rng(config.seed);
+		std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+		m_startUs = GetTimestampUs();
+		for (uint32_t i = 0; i < config.num_events; ++i)
+		{
+			Event event;
+			event.moduleIdx = pick(rng);
+			event.submitUs = m_startUs;
+			m_sched.Submit(event.moduleIdx, event);
+		}
+		m_sched.Close();
+	}
+
+	DecentWasmSchedBench(const DecentWasmSchedBench&) = delete;
+
+	DecentWasmSchedBench& operator=(const DecentWasmSchedBench&) = delete;
+
+	/**
+	 * @brief Run events on the calling thread as the given worker, until
+	 *        all the events have run.
+	 *
+	 */
+	void Work(size_t workerIdx)
+	{
+		using namespace DecentWasmRuntime;
+
+		static const std::vector<uint8_t>& sk_eventId = GetDefaultEventId();
+		static const std::vector<uint8_t>& sk_eventData = GetDefaultEventData();
+
+		if (workerIdx >= m_workers.size())
+		{
+			PrintStr("Invalid worker index " + std::to_string(workerIdx) + "\n");
+			return;
+		}
+
+		// WAMR needs every thread running WASM code to set up its own env
+		ThreadEnvGuard threadEnv;
+		if (!threadEnv.IsInited())
+		{
+			PrintStr("Failed to init the thread env of a worker\n");
+			return;
+		}
+
+		WorkerResult& res = m_workers[workerIdx];
+		{
+			// instances held by this worker, the most recently used last
+			std::vector<std::pair<size_t, std::unique_ptr<MainRunner> > > insts;
+
+			Event event;
+			while (m_sched.Next(workerIdx, event))
+			{
+				auto it = std::find_if(
+					insts.begin(),
+					insts.end(),
+					[&event](const std::pair<size_t, std::unique_ptr<MainRunner> >& inst) {
+						return inst.first == event.moduleIdx;
+					}
+				);
+				try
+				{
+					if (it == insts.end())
+					{
+						if (insts.size() >= m_config.max_worker_instances)
+						{
+							m_sched.SetHeld(workerIdx, insts.front().first, false);
+							insts.erase(insts.begin());
+						}
+						insts.emplace_back(
+							event.moduleIdx,
+							Internal::make_unique<MainRunner>(
+								m_modules[event.moduleIdx],
+								sk_eventId,
+								sk_eventData,
+								m_config.mod_stack_size,
+								m_config.mod_heap_size,
+								m_config.exec_stack_size
+							)
+						);
+						m_sched.SetHeld(workerIdx, event.moduleIdx, true);
+						++res.numInstantiations;
+					}
+					else
+					{
+						std::rotate(it, it + 1, insts.end());
+					}
+
+					uint64_t runStartUs = GetTimestampUs();
+					insts.back().second->RunPlain();
+					uint64_t endUs = GetTimestampUs();
+
+					res.runUs.push_back(endUs - runStartUs);
+					res.latencyUs.push_back(endUs - event.submitUs);
+					res.endUs = std::max(res.endUs, endUs);
+				}
+				catch (const std::exception& e)
+				{
+					PrintStr(
+						"Event of module " + std::to_string(event.moduleIdx) +
+						" failed: " + e.what() + "\n"
+					);
+					++res.numFailed;
+				}
+			}
+		}
+	}
+
+	/**
+	 * @brief Print the results; must only be called after every worker has
+	 *        returned from Work.
+	 *
+	 */
+	void Report() const
+	{
+		std::vector<uint64_t> latencyUs;
+		std::vector<uint64_t> runUs;
+		uint64_t numInstantiations = 0;
+		uint64_t numFailed = 0;
+		uint64_t endUs = m_startUs;
+		for (const auto& res : m_workers)
+		{
+			latencyUs.insert(latencyUs.end(), res.latencyUs.begin(), res.latencyUs.end());
+			runUs.insert(runUs.end(), res.runUs.begin(), res.runUs.end());
+			numInstantiations += res.numInstantiations;
+			numFailed += res.numFailed;
+			endUs = std::max(endUs, res.endUs);
+		}
+
+		const Scheduler::Stats stats = m_sched.GetStats();
+		const uint64_t timeUs = endUs - m_startUs;
+		const uint64_t numEvents = stats.numEvents;
+
+		std::string perWorker;
+		for (size_t i = 0; i < stats.workerEvents.size(); ++i)
+		{
+			perWorker += (i == 0 ? "" : "/") + std::to_string(stats.workerEvents[i]);
+		}
+
+		PrintStr(
+			"Sched bench: "
+			"Policy: "           + std::string(GetPolicyName(m_config.policy)) + ", "
+			"Workers: "          + std::to_string(m_config.num_workers) + ", "
+			"Modules: "          + std::to_string(m_modules.size()) + ", "
+			"Events: "           + std::to_string(numEvents) + ", "
+			"Failed: "           + std::to_string(numFailed) + ", "
+			"Time: "             + std::to_string(timeUs) + " us, "
+			"Throughput: "       + std::to_string(
+				timeUs == 0 ? 0 : (latencyUs.size() * 1000000 / timeUs)) + " events/s, "
+			"Latency p50: "      + std::to_string(GetPercentile(latencyUs, 50)) + " us, "
+			"Latency p99: "      + std::to_string(GetPercentile(latencyUs, 99)) + " us, "
+			"Run p50: "          + std::to_string(GetPercentile(runUs, 50)) + " us, "
+			"Run p99: "          + std::to_string(GetPercentile(runUs, 99)) + " us, "
+			"Instantiations: "   + std::to_string(numInstantiations) + ", "
+			"Affinity hits: "    + std::to_string(stats.numAffinityHits) + ", "
+			"Steals: "           + std::to_string(stats.numSteals) + ", "
+			"Stolen: "           + std::to_string(stats.numStolen) + ", "
+			"Queue depth avg: "  + std::to_string(
+				numEvents == 0 ? 0 : (stats.sumQueueDepth / numEvents)) + ", "
+			"Queue depth max: "  + std::to_string(stats.maxQueueDepth) + ", "
+			"Per worker: "       + perWorker + "\n"
+		);
+	}
+
+private:
+
+	// only touched by the worker's own thread, until Report
+	struct WorkerResult
+	{
+		std::vector<uint64_t> latencyUs;
+		std::vector<uint64_t> runUs;
+		uint64_t numInstantiations = 0;
+		uint64_t numFailed = 0;
+		uint64_t endUs = 0;
+	}; // struct WorkerResult
+
+	decent_wasm_sched_config_t m_config;
+	DecentWasmRuntime::SharedWasmRuntime m_wasmRt;
+	std::vector<DecentWasmRuntime::SharedWasmModule> m_modules;
+	Scheduler m_sched;
+	std::vector<WorkerResult> m_workers;
+	uint64_t m_startUs;
+}; // class DecentWasmSchedBench
+
+
+/**
+ * @brief The scheduler benchmark of this side of the enclave boundary;
+ *        there is at most one, created by DecentWasmSchedBenchStart.
+ */
+inline std::unique_ptr<DecentWasmSchedBench>& GetDecentWasmSchedBench()
+{
+	static std::unique_ptr<DecentWasmSchedBench> s_bench;
+	return s_bench;
+}
+
+
+inline std::mutex& GetDecentWasmSchedBenchMutex()
+{
+	static std::mutex s_mutex;
+	return s_mutex;
+}
+
+
+/**
+ * @brief Load the modules and queue the events; the events run once the
+ *        workers call DecentWasmSchedBenchWork.
+ *
+ */
+inline bool DecentWasmSchedBenchStart(
+	const uint8_t* wasmFiles,
+	const uint64_t* fileSizes, size_t numFiles,
+	const decent_wasm_sched_config_t& config
+)
+{
+	std::lock_guard<std::mutex> lock(GetDecentWasmSchedBenchMutex());
+	try
+	{
+		// the previous runtime must be gone before a new one is created
+		GetDecentWasmSchedBench().reset();
+		GetDecentWasmSchedBench() =
+			DecentWasmRuntime::Internal::make_unique<DecentWasmSchedBench>(
+				wasmFiles, fileSizes, numFiles, config
+			);
+		return true;
+	}
+	catch(const std::exception& e)
+	{
+		PrintStr(e.what());
+		PrintStr("\n");
+		return false;
+	}
+}
+
+
+/**
+ * @brief Run as one of the workers; the workers don't take the lock, since
+ *        the benchmark stays until DecentWasmSchedBenchFinish, which must
+ *        only be called after all of them have returned.
+ *
+ */
+inline void DecentWasmSchedBenchWork(size_t workerIdx)
+{
+	DecentWasmSchedBench* bench = GetDecentWasmSchedBench().get();
+	if (bench == nullptr)
+	{
+		PrintStr("The scheduler benchmark has not been started\n");
+		return;
+	}
+	bench->Work(workerIdx);
+}
+
+
+inline void DecentWasmSchedBenchFinish()
+{
+	std::lock_guard<std::mutex> lock(GetDecentWasmSchedBenchMutex());
+	if (GetDecentWasmSchedBench() != nullptr)
+	{
+		GetDecentWasmSchedBench()->Report();
+		GetDecentWasmSchedBench().reset();
+	}
+}
+
@@ -0,0 +1,209 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sgx_urts.h>
+
+#include "HostUtils.hpp"
+#include "SchedBench.hpp"
+#include "decent_wasm_config.h"
+
+
+extern "C" {
+
+extern sgx_status_t ecall_decent_wasm_sched_start(
+	sgx_enclave_id_t eid,
+	int *retval,
+	const uint8_t *wasm_files, size_t wasm_files_size,
+	const uint64_t *file_sizes, size_t num_files,
+	const decent_wasm_sched_config_t *config
+);
+
+extern sgx_status_t ecall_decent_wasm_sched_work(
+	sgx_enclave_id_t eid,
+	uint32_t worker_idx
+);
+
+extern sgx_status_t ecall_decent_wasm_sched_finish(sgx_enclave_id_t eid);
+
+} // extern "C"
+
+
+inline decent_wasm_sched_config_t ParseSchedConfig(
+	int argc, char** argv, int startIdx
+)
+{
+	decent_wasm_sched_config_t config;
+	config.pool_size            = 64 * 1024 * 1024; // 64 MB
+	config.num_workers          = 1;
+	config.num_events           = 0;
+	config.policy               = DECENT_WASM_SCHED_SHARED_QUEUE;
+	config.max_worker_instances = 2;
+	config.mod_stack_size       = 64 * 1024;        // 64 KB
+	config.mod_heap_size        = 1 * 1024 * 1024;  //  1 MB
+	config.exec_stack_size      = 64 * 1024;        // 64 KB
+	config.seed                 = 0;
+
+	for (int i = startIdx; i < argc; ++i)
+	{
+		const std::string opt = argv[i];
+		if ((i + 1) >= argc)
+		{
+			throw std::invalid_argument("Missing value for option " + opt);
+		}
+
+		uint32_t val = static_cast<uint32_t>(std::stoul(argv[++i]));
+		if (opt == "--pool")
+		{
+			config.pool_size = val;
+		}
+		else if (opt == "--max-inst")
+		{
+			config.max_worker_instances = val;
+		}
+		else if (opt == "--mod-stack")
+		{
+			config.mod_stack_size = val;
+		}
+		else if (opt == "--mod-heap")
+		{
+			config.mod_heap_size = val;
+		}
+		else if (opt == "--exec-stack")
+		{
+			config.exec_stack_size = val;
+		}
+		else if (opt == "--seed")
+		{
+			config.seed = val;
+		}
+		else
+		{
+			throw std::invalid_argument("Unknown option " + opt);
+		}
+	}
+
+	return config;
+}
+
+/**
+ * @brief Run the same skewed burst of events of the given modules with a
+ *        shared queue and with work stealing, on the untrusted side and in
+ *        the enclave, and report the scheduler metrics of each.
+ *
+ *        In the enclave, the workers are the threads calling into it, so
+ *        there can be at most as many workers as the enclave's TCSNum.
+ *
+ */
+inline int SchedMain(int argc, char**argv)
+{
+	if (argc < 4)
+	{
+		std::cerr << "Usage: "
+			<< argv[0] << " <num workers> <num events> <wasm file> [<wasm file>...]"
+			<< " [--pool <bytes>] [--max-inst <per worker>]"
+			<< " [--mod-stack <bytes>] [--mod-heap <bytes>]"
+			<< " [--exec-stack <bytes>] [--seed <seed>]" << std::endl;
+		return -1;
+	}
+
+	int optIdx = 3;
+	std::vector<std::string> modulePaths;
+	for (; (optIdx < argc) && (std::string(argv[optIdx]).rfind("--", 0) != 0); ++optIdx)
+	{
+		modulePaths.push_back(argv[optIdx]);
+	}
+	decent_wasm_sched_config_t config = ParseSchedConfig(argc, argv, optIdx);
+	config.num_workers = std::max<uint32_t>(std::stoul(argv[1]), 1);
+	config.num_events = static_cast<uint32_t>(std::stoul(argv[2]));
+	if (!CheckEnclaveWorkers(config.num_workers, 0))
+	{
+		return -1;
+	}
+
+	std::vector<uint8_t> wasmFiles;
+	std::vector<uint64_t> fileSizes;
+	ReadFiles2Buffer(modulePaths, wasmFiles, fileSizes);
+
+	static const uint32_t sk_policies[] = {
+		DECENT_WASM_SCHED_SHARED_QUEUE,
+		DECENT_WASM_SCHED_WORK_STEALING,
+	};
+
+	for (uint32_t policy : sk_policies)
+	{
+		config.policy = policy;
+		if (!DecentWasmSchedBenchStart(
+			wasmFiles.data(), fileSizes.data(), fileSizes.size(), config
+		))
+		{
+			return -1;
+		}
+		std::vector<std::thread> workers;
+		for (uint32_t i = 0; i < config.num_workers; ++i)
+		{
+			workers.emplace_back(DecentWasmSchedBenchWork, i);
+		}
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+		DecentWasmSchedBenchFinish();
+	}
+
+	sgx_enclave_id_t eid = 0;
+	enclave_init(&eid);
+
+	for (uint32_t policy : sk_policies)
+	{
+		config.policy = policy;
+		int retval = -1;
+		auto ret = ecall_decent_wasm_sched_start(
+			eid,
+			&retval,
+			wasmFiles.data(), wasmFiles.size(),
+			fileSizes.data(), fileSizes.size(),
+			&config
+		);
+		if ((ret != SGX_SUCCESS) || (retval != 0))
+		{
+			std::cerr << "ERROR: "
+				<< "Failed to run ecall_decent_wasm_sched_start." << std::endl;
+			break;
+		}
+		std::vector<std::thread> workers;
+		for (uint32_t i = 0; i < config.num_workers; ++i)
+		{
+			workers.emplace_back([eid, i]() {
+				auto workRet = ecall_decent_wasm_sched_work(eid, i);
+				if (workRet != SGX_SUCCESS)
+				{
+					std::cerr << "ERROR: "
+						<< "Failed to run ecall_decent_wasm_sched_work." << std::endl;
+				}
+			});
+		}
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+		ecall_decent_wasm_sched_finish(eid);
+	}
+
+	sgx_destroy_enclave(eid);
+
+	return 0;
+}
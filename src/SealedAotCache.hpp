@@ -0,0 +1,315 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstdint>
+#include <cstring>
+
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <sgx_tseal.h>
+#include <sgx_utils.h>
+
+#include <DecentWasmRuntime/Exception.hpp>
+#include <DecentWasmRuntime/Internal/Sha256.hpp>
+#include <DecentWasmRuntime/WasmModule.hpp>
+
+#ifdef DECENT_WASM_SGX_AOT
+#include "AotAllowlist.hpp"
+#endif // DECENT_WASM_SGX_AOT
+
+
+/**
+ * @brief In-enclave cache of AOT artifacts, keyed by the SHA-256 of the WASM
+ *        bytecode they are compiled from.
+ *
+ *        Artifacts are sealed for the untrusted side to keep on disk, with
+ *        the bytecode hash and the enclave's MRENCLAVE as the additional MAC
+ *        text, so a sealed artifact is only accepted by the same enclave
+ *        build, and only used in place of the same bytecode.
+ *        The sealing key is derived by the default (MRSIGNER) policy, thus
+ *        the MRENCLAVE in the MAC text is what rejects artifacts sealed by
+ *        another build (e.g., one with a different WAMR).
+ *
+ *        The AOT code itself is compiled outside of the enclave
+ *        (by `wamrc --sgx`), and handed in by the untrusted side, so an
+ *        artifact is only accepted if its SHA-256, paired with the SHA-256
+ *        of the bytecode, is in the list built into the enclave image
+ *        (see AotAllowlist.hpp); sealing then lets later runs skip hashing
+ *        it again.
+ *        Without `DECENT_WASM_SGX_AOT`, the cache accepts no artifact, and
+ *        the enclave always runs the bytecode.
+ *
+ */
+class SealedAotCache
+{
+public: // static members
+
+	using Sha256 = DecentWasmRuntime::Internal::Sha256;
+	using Digest = Sha256::Digest;
+
+	static constexpr size_t sk_macTextSize =
+		Sha256::sk_digestSize + sizeof(sgx_measurement_t);
+
+	static SealedAotCache& GetInstance()
+	{
+		static SealedAotCache s_inst;
+		return s_inst;
+	}
+
+	static constexpr bool IsEnabled() noexcept
+	{
+#ifdef DECENT_WASM_SGX_AOT
+		return true;
+#else
+		return false;
+#endif // DECENT_WASM_SGX_AOT
+	}
+
+	/**
+	 * @brief Check if the given AOT artifact is in the list of artifacts
+	 *        the enclave trusts, paired with the given WASM bytecode.
+	 *
+	 */
+	static bool IsTrusted(const Digest& wasmHash, const std::vector<uint8_t>& aot)
+	{
+#ifdef DECENT_WASM_SGX_AOT
+		const std::string wasmHashHex = Sha256::ToHex(wasmHash);
+		const std::string aotHashHex = Sha256::ToHex(Sha256::Hash(aot));
+		for (size_t i = 0; i < g_decentWasmTrustedAotCount; ++i)
+		{
+			if ((wasmHashHex == g_decentWasmTrustedAot[i].wasmHash) &&
+				(aotHashHex == g_decentWasmTrustedAot[i].aotHash))
+			{
+				return true;
+			}
+		}
+#else
+		(void)wasmHash;
+		(void)aot;
+#endif // DECENT_WASM_SGX_AOT
+		return false;
+	}
+
+	static size_t GetSealedSize(size_t aotSize)
+	{
+		if (aotSize > std::numeric_limits<uint32_t>::max())
+		{
+			return 0;
+		}
+		uint32_t res = sgx_calc_sealed_data_size(
+			static_cast<uint32_t>(sk_macTextSize),
+			static_cast<uint32_t>(aotSize)
+		);
+		return res == std::numeric_limits<uint32_t>::max() ? 0 : res;
+	}
+
+public:
+
+	SealedAotCache() = default;
+
+	/**
+	 * @brief Seal the AOT artifact compiled from the given WASM bytecode,
+	 *        and add it to the cache; the artifact must be trusted in place
+	 *        of that bytecode (see IsTrusted).
+	 *
+	 * @param wasm The WASM bytecode.
+	 * @param aot  The AOT artifact.
+	 * @return The sealed artifact.
+	 */
+	std::vector<uint8_t> Seal(
+		const std::vector<uint8_t>& wasm,
+		std::vector<uint8_t> aot
+	)
+	{
+		CheckEnabled();
+		if (!DecentWasmRuntime::WasmModule::IsAot(aot))
+		{
+			throw DecentWasmRuntime::Exception(
+				"The artifact to be sealed is not an AOT module"
+			);
+		}
+		Digest wasmHash = Sha256::Hash(wasm);
+		if (!IsTrusted(wasmHash, aot))
+		{
+			throw DecentWasmRuntime::Exception(
+				"The AOT artifact is not in the enclave's trusted list "
+				"for this bytecode"
+			);
+		}
+
+		uint8_t macText[sk_macTextSize];
+		BuildMacText(wasmHash, macText);
+
+		size_t sealedSize = GetSealedSize(aot.size());
+		if (sealedSize == 0)
+		{
+			throw DecentWasmRuntime::Exception("The AOT artifact is too large");
+		}
+
+		std::vector<uint8_t> sealed(sealedSize);
+		sgx_status_t ret = sgx_seal_data(
+			static_cast<uint32_t>(sk_macTextSize),
+			macText,
+			static_cast<uint32_t>(aot.size()),
+			aot.data(),
+			static_cast<uint32_t>(sealed.size()),
+			reinterpret_cast<sgx_sealed_data_t*>(sealed.data())
+		);
+		if (ret != SGX_SUCCESS)
+		{
+			throw DecentWasmRuntime::Exception("Failed to seal the AOT artifact");
+		}
+
+		Insert(wasmHash, std::move(aot));
+		return sealed;
+	}
+
+	/**
+	 * @brief Unseal an AOT artifact sealed by `Seal`, verify it, and add it
+	 *        to the cache.
+	 *        The artifact isn't checked against the trusted list again,
+	 *        since it can only be sealed by an enclave with the same
+	 *        MRENCLAVE, and thus the same list.
+	 *
+	 * @param sealed     Pointer to the sealed artifact (inside the enclave).
+	 * @param sealedSize Size of the sealed artifact.
+	 */
+	void LoadSealed(const uint8_t* sealed, size_t sealedSize)
+	{
+		CheckEnabled();
+		if (sealedSize < sizeof(sgx_sealed_data_t) ||
+			sealedSize > std::numeric_limits<uint32_t>::max())
+		{
+			throw DecentWasmRuntime::Exception("Invalid sealed AOT artifact size");
+		}
+		const sgx_sealed_data_t* sealedData =
+			reinterpret_cast<const sgx_sealed_data_t*>(sealed);
+
+		uint32_t macTextSize = sgx_get_add_mac_txt_len(sealedData);
+		uint32_t aotSize = sgx_get_encrypt_txt_len(sealedData);
+		if (macTextSize != sk_macTextSize ||
+			aotSize == std::numeric_limits<uint32_t>::max() ||
+			GetSealedSize(aotSize) != sealedSize)
+		{
+			throw DecentWasmRuntime::Exception("Malformed sealed AOT artifact");
+		}
+
+		uint8_t macText[sk_macTextSize];
+		std::vector<uint8_t> aot(aotSize);
+		// the MAC (covering both the MAC text and the artifact) is verified
+		// by sgx_unseal_data
+		sgx_status_t ret = sgx_unseal_data(
+			sealedData,
+			macText,
+			&macTextSize,
+			aot.data(),
+			&aotSize
+		);
+		if (ret != SGX_SUCCESS)
+		{
+			throw DecentWasmRuntime::Exception(
+				"Failed to unseal the AOT artifact (integrity check failed)"
+			);
+		}
+
+		Digest wasmHash;
+		std::memcpy(wasmHash.data(), macText, wasmHash.size());
+		uint8_t expMacText[sk_macTextSize];
+		BuildMacText(wasmHash, expMacText);
+		if (std::memcmp(macText, expMacText, sk_macTextSize) != 0)
+		{
+			throw DecentWasmRuntime::Exception(
+				"The AOT artifact is sealed by another enclave build"
+			);
+		}
+		if (!DecentWasmRuntime::WasmModule::IsAot(aot))
+		{
+			throw DecentWasmRuntime::Exception(
+				"The sealed artifact is not an AOT module"
+			);
+		}
+
+		Insert(wasmHash, std::move(aot));
+	}
+
+	/**
+	 * @brief Find the AOT artifact compiled from the given WASM bytecode.
+	 *
+	 * @return The artifact, or nullptr if it's not in the cache.
+	 */
+	std::shared_ptr<const std::vector<uint8_t> > Find(
+		const uint8_t* wasm,
+		size_t wasmSize
+	) const
+	{
+		if (!IsEnabled())
+		{
+			return nullptr;
+		}
+		return Find(Sha256::Hash(wasm, wasmSize));
+	}
+
+	/**
+	 * @brief Find the AOT artifact by the SHA-256 of the WASM bytecode,
+	 *        e.g., hashed while the bytecode is received.
+	 *
+	 * @return The artifact, or nullptr if it's not in the cache.
+	 */
+	std::shared_ptr<const std::vector<uint8_t> > Find(const Digest& wasmHash) const
+	{
+		if (!IsEnabled())
+		{
+			return nullptr;
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_artifacts.find(wasmHash);
+		return it == m_artifacts.end() ? nullptr : it->second;
+	}
+
+private:
+
+	static void CheckEnabled()
+	{
+		if (!IsEnabled())
+		{
+			throw DecentWasmRuntime::Exception(
+				"The enclave is built without AOT support (DECENT_WASM_SGX_AOT)"
+			);
+		}
+	}
+
+	static void BuildMacText(const Digest& wasmHash, uint8_t (&macText)[sk_macTextSize])
+	{
+		const sgx_report_t* report = sgx_self_report();
+		std::memcpy(macText, wasmHash.data(), wasmHash.size());
+		std::memcpy(
+			macText + wasmHash.size(),
+			&(report->body.mr_enclave),
+			sizeof(sgx_measurement_t)
+		);
+	}
+
+	void Insert(const Digest& wasmHash, std::vector<uint8_t> aot)
+	{
+		auto artifact = std::make_shared<const std::vector<uint8_t> >(std::move(aot));
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_artifacts[wasmHash] = std::move(artifact);
+	}
+
+	mutable std::mutex m_mutex;
+	std::map<Digest, std::shared_ptr<const std::vector<uint8_t> > > m_artifacts;
+
+}; // class SealedAotCache
+
@@ -0,0 +1,440 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <exception>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include <sgx_urts.h>
+#include <DecentWasmRuntime/Internal/Sha256.hpp>
+
+#include "HostUtils.hpp"
+#include "MainDriver.hpp"
+#include "MappedFile.hpp"
+#include "ServerHost.hpp"
+#include "ServerMain.hpp"
+#include "decent_wasm_config.h"
+
+
+extern "C" {
+
+extern sgx_status_t ecall_decent_wasm_server_start(
+	sgx_enclave_id_t eid,
+	int *retval,
+	const decent_wasm_main_config_t *config
+);
+
+extern sgx_status_t ecall_decent_wasm_server_stop(sgx_enclave_id_t eid);
+
+extern sgx_status_t ecall_decent_wasm_server_load(
+	sgx_enclave_id_t eid,
+	int *retval,
+	const uint8_t *wasm_file, size_t wasm_file_size,
+	uint32_t *handle
+);
+
+extern sgx_status_t ecall_decent_wasm_server_upload_begin(
+	sgx_enclave_id_t eid,
+	int *retval,
+	size_t wasm_file_size
+);
+
+extern sgx_status_t ecall_decent_wasm_server_upload_append(
+	sgx_enclave_id_t eid,
+	int *retval,
+	const uint8_t *chunk, size_t chunk_size
+);
+
+extern sgx_status_t ecall_decent_wasm_server_upload_finalize(
+	sgx_enclave_id_t eid,
+	int *retval,
+	uint32_t *handle
+);
+
+extern sgx_status_t ecall_decent_wasm_server_load_bundled(
+	sgx_enclave_id_t eid,
+	int *retval,
+	uint32_t module_id,
+	uint32_t *handle
+);
+
+extern sgx_status_t ecall_decent_wasm_server_run(
+	sgx_enclave_id_t eid,
+	uint32_t handle,
+	const uint8_t *event_id, size_t event_id_size,
+	const uint8_t *event_data, size_t event_data_size,
+	uint64_t threshold,
+	decent_wasm_job_result_t *result
+);
+
+} // extern "C"
+
+
+/**
+ * @brief Load a module into the server in the enclave. A module larger than
+ *        one chunk is uploaded chunk by chunk, so that the enclave only holds
+ *        the module being assembled plus one marshaled chunk, rather than
+ *        the whole module marshaled plus its copy.
+ *
+ */
+inline bool LoadIntoEnclaveServer(
+	sgx_enclave_id_t eid,
+	const uint8_t* wasm, size_t wasmSize,
+	uint32_t& handle
+)
+{
+	static constexpr size_t sk_chunkSize = 1024 * 1024;
+
+	int retval = -1;
+	if (wasmSize <= sk_chunkSize)
+	{
+		auto ret = ecall_decent_wasm_server_load(
+			eid, &retval, wasm, wasmSize, &handle
+		);
+		return (ret == SGX_SUCCESS) && (retval == 0);
+	}
+
+	auto ret = ecall_decent_wasm_server_upload_begin(eid, &retval, wasmSize);
+	if ((ret != SGX_SUCCESS) || (retval != 0))
+	{
+		return false;
+	}
+	for (size_t pos = 0; pos < wasmSize; pos += sk_chunkSize)
+	{
+		const size_t chunkSize =
+			(wasmSize - pos) < sk_chunkSize ? (wasmSize - pos) : sk_chunkSize;
+		ret = ecall_decent_wasm_server_upload_append(
+			eid, &retval, wasm + pos, chunkSize
+		);
+		if ((ret != SGX_SUCCESS) || (retval != 0))
+		{
+			return false;
+		}
+	}
+	ret = ecall_decent_wasm_server_upload_finalize(eid, &retval, &handle);
+	return (ret == SGX_SUCCESS) && (retval == 0);
+}
+
+/**
+ * @brief The host side of the server mode: keeps the enclave (and the
+ *        untrusted runtime) alive, and remembers which module files have been
+ *        loaded into each, so that a job of a known module goes straight to
+ *        its warm instance.
+ *
+ */
+class ServerHostState
+{
+public:
+
+	ServerHostState(sgx_enclave_id_t eid, const HostOptions& hostOpts) :
+		m_eid(eid),
+		m_hostOpts(hostOpts)
+	{}
+
+	std::string HandleRequest(const std::string& line, bool& quit)
+	{
+		try
+		{
+			ServerHost::Request req = ServerHost::ParseRequest(line);
+			if (req.cmd == "run")
+			{
+				return HandleRun(req);
+			}
+			else if (req.cmd == "stats")
+			{
+				return "status=ok "
+					"jobs="  + std::to_string(m_numJobs) + " "
+					"loads=" + std::to_string(m_numLoads) + " "
+					"warm="  + std::to_string(m_numWarmJobs);
+			}
+			else if (req.cmd == "quit")
+			{
+				quit = true;
+				return "status=ok";
+			}
+			return ServerHost::FormatError("Unknown command " + req.cmd);
+		}
+		catch(const std::exception& e)
+		{
+			return ServerHost::FormatError(e.what());
+		}
+	}
+
+private:
+
+	struct ModuleFile
+	{
+		off_t size = 0;
+		// with nanoseconds, so that a rewrite within the same second is
+		// noticed
+		struct timespec mtime = {};
+		uint32_t handle = 0;
+	}; // struct ModuleFile
+
+	std::string HandleRun(const ServerHost::Request& req)
+	{
+		static const std::string sk_empty;
+
+		const std::string env = req.Get("env", "enclave");
+		if ((env != "enclave") && (env != "untrusted"))
+		{
+			throw std::invalid_argument("Unknown env " + env);
+		}
+		const bool inEnclave = (env == "enclave");
+		const std::vector<uint8_t> eventId =
+			ServerHost::HexToBytes(req.Get("event_id", sk_empty));
+		const std::vector<uint8_t> eventData =
+			ServerHost::HexToBytes(req.Get("event_data", sk_empty));
+		const uint64_t threshold = std::stoull(req.Get("threshold", "0"));
+
+		uint64_t startUs = GetSteadyTimeUs();
+		decent_wasm_job_result_t res;
+		uint64_t loadUs = 0;
+		// a handle found in the cache may have been evicted by the server;
+		// then the module is loaded again, once
+		for (int attempt = 0; attempt < 2; ++attempt)
+		{
+			bool loaded = false;
+			uint32_t handle = ResolveModule(req, inEnclave, attempt > 0, loaded);
+			loadUs = loaded ? (GetSteadyTimeUs() - startUs) : loadUs;
+
+			if (inEnclave)
+			{
+				auto ret = ecall_decent_wasm_server_run(
+					m_eid,
+					handle,
+					eventId.data(), eventId.size(),
+					eventData.data(), eventData.size(),
+					threshold,
+					&res
+				);
+				if (ret != SGX_SUCCESS)
+				{
+					throw std::runtime_error("Failed to run ecall_decent_wasm_server_run");
+				}
+			}
+			else
+			{
+				DecentWasmServerRun(handle, eventId, eventData, threshold, res);
+			}
+
+			if ((res.status != DECENT_WASM_JOB_UNKNOWN_MODULE) || loaded)
+			{
+				break;
+			}
+		}
+		uint64_t endUs = GetSteadyTimeUs();
+
+		if (res.status == DECENT_WASM_JOB_UNKNOWN_MODULE)
+		{
+			return ServerHost::FormatError("The module is not loaded");
+		}
+		if (res.status != DECENT_WASM_JOB_OK)
+		{
+			return ServerHost::FormatError("The job failed; see the server output");
+		}
+
+		++m_numJobs;
+		m_numWarmJobs += res.warm;
+		return "status=ok env=" + env + " " +
+			ServerHost::FormatJobResult(res) + " "
+			"load_us="  + std::to_string(loadUs) + " "
+			"total_us=" + std::to_string(endUs - startUs);
+	}
+
+	/**
+	 * @param reload True to load the module even if it's in the cache.
+	 * @param loaded Set to true if the module is (re)loaded.
+	 * @return The handle of the module.
+	 */
+	uint32_t ResolveModule(
+		const ServerHost::Request& req,
+		bool inEnclave,
+		bool reload,
+		bool& loaded
+	)
+	{
+		static const std::string sk_empty;
+
+		const std::string& bundle = req.Get("bundle", sk_empty);
+		if (!bundle.empty())
+		{
+			if (!inEnclave)
+			{
+				throw std::invalid_argument("Bundled modules are only in the enclave");
+			}
+			const uint32_t moduleId = static_cast<uint32_t>(std::stoul(bundle));
+			uint32_t& handle = m_bundleHandles[moduleId];
+			if ((handle == 0) || reload)
+			{
+				int retval = -1;
+				auto ret = ecall_decent_wasm_server_load_bundled(
+					m_eid, &retval, moduleId, &handle
+				);
+				if ((ret != SGX_SUCCESS) || (retval != 0))
+				{
+					handle = 0;
+					throw std::runtime_error("Failed to load bundled module " + bundle);
+				}
+				loaded = true;
+				++m_numLoads;
+			}
+			return handle;
+		}
+
+		const std::string& path = req.Get("module", sk_empty);
+		if (path.empty())
+		{
+			throw std::invalid_argument("Either module or bundle must be given");
+		}
+		struct stat st;
+		if (stat(path.c_str(), &st) != 0)
+		{
+			throw std::invalid_argument("Failed to access " + path);
+		}
+
+		// a module file changed since it was loaded is loaded again
+		ModuleFile& file = (inEnclave ? m_enclaveModules : m_untrustedModules)[path];
+		if ((file.handle != 0) && !reload &&
+			(file.size == st.st_size) &&
+			(file.mtime.tv_sec == st.st_mtim.tv_sec) &&
+			(file.mtime.tv_nsec == st.st_mtim.tv_nsec))
+		{
+			return file.handle;
+		}
+
+		file.handle = 0;
+		if (inEnclave)
+		{
+			const MappedFile wasm(path);
+			PrepareEnclaveAotCache(
+				m_eid, m_hostOpts.sgxAotCacheDir, wasm.data(), wasm.size()
+			);
+			if (!LoadIntoEnclaveServer(m_eid, wasm.data(), wasm.size(), file.handle))
+			{
+				file.handle = 0;
+				throw std::runtime_error("Failed to load " + path + " into the enclave");
+			}
+		}
+		else
+		{
+			using namespace DecentWasmRuntime::Internal;
+
+			const std::vector<uint8_t> wasm = ReadFile2Buffer(path);
+			const std::vector<uint8_t> aot =
+				LookupAotCache(m_hostOpts.aotCacheDir, wasm);
+			const std::string key = Sha256::ToHex(Sha256::Hash(wasm));
+			bool res = false;
+			if (!aot.empty())
+			{
+				res = DecentWasmServerLoad(key, aot.data(), aot.size(), file.handle);
+				if (!res)
+				{
+					std::cout << "Failed to load the AOT module of " << path
+						<< "; loading the bytecode instead" << std::endl;
+				}
+			}
+			if (!res &&
+				!DecentWasmServerLoad(key, wasm.data(), wasm.size(), file.handle))
+			{
+				file.handle = 0;
+				throw std::runtime_error("Failed to load " + path);
+			}
+		}
+		file.size = st.st_size;
+		file.mtime = st.st_mtim;
+		loaded = true;
+		++m_numLoads;
+		return file.handle;
+	}
+
+	sgx_enclave_id_t m_eid;
+	HostOptions m_hostOpts;
+
+	// module file path -> the module loaded from it
+	std::map<std::string, ModuleFile> m_enclaveModules;
+	std::map<std::string, ModuleFile> m_untrustedModules;
+	// bundled module ID -> handle
+	std::map<uint32_t, uint32_t> m_bundleHandles;
+
+	uint64_t m_numJobs = 0;
+	uint64_t m_numLoads = 0;
+	uint64_t m_numWarmJobs = 0;
+}; // class ServerHostState
+
+/**
+ * @brief Serve jobs over a Unix domain socket, with the enclave created
+ *        once, and the modules and instances kept warm across jobs
+ *        (see ServerHost.hpp for the protocol).
+ *
+ */
+inline int ServerMain(int argc, char**argv)
+{
+	if (argc < 2)
+	{
+		std::cerr << "Usage: "
+			<< argv[0] << " <socket path> [options]" << std::endl;
+		return -1;
+	}
+
+	const std::string socketPath = argv[1];
+	HostOptions hostOpts;
+	const decent_wasm_main_config_t config =
+		ParseMainConfig(argc, argv, 2, hostOpts);
+
+	if (!DecentWasmServerStart(config))
+	{
+		return -1;
+	}
+
+	sgx_enclave_id_t eid = 0;
+	enclave_init(&eid);
+
+	int retval = -1;
+	auto ret = ecall_decent_wasm_server_start(eid, &retval, &config);
+	if ((ret != SGX_SUCCESS) || (retval != 0))
+	{
+		std::cerr << "ERROR: "
+			<< "Failed to start the server in the enclave." << std::endl;
+		sgx_destroy_enclave(eid);
+		return -1;
+	}
+
+	int exitCode = 0;
+	try
+	{
+		ServerHostState state(eid, hostOpts);
+		ServerHost::UnixSocketServer server(socketPath);
+		std::cout << "Server listening on " << socketPath << std::endl;
+		server.Serve(
+			[&state](const std::string& line, bool& quit)
+			{
+				return state.HandleRequest(line, quit);
+			}
+		);
+	}
+	catch (const std::exception& e)
+	{
+		// the enclave and the untrusted server are still torn down below
+		std::cerr << "ERROR: " << e.what() << std::endl;
+		exitCode = -1;
+	}
+
+	ecall_decent_wasm_server_stop(eid);
+	sgx_destroy_enclave(eid);
+	DecentWasmServerStop();
+
+	return exitCode;
+}
@@ -0,0 +1,296 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstdint>
+#include <cstring>
+
+#include <functional>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "decent_wasm_config.h"
+
+
+/**
+ * @brief The protocol of the server mode (untrusted side only).
+ *
+ *        Requests and responses are single lines of space-separated
+ *        `key=value` pairs; a request starts with its command:
+ *
+ *          run module=<path>|bundle=<id> [env=enclave|untrusted]
+ *              [event_id=<hex>] [event_data=<hex>] [threshold=<n>]
+ *          stats
+ *          quit
+ *
+ *        A response starts with `status=ok` or `status=error`; an error
+ *        ends with `msg=<text>`, which takes the rest of the line.
+ *
+ */
+namespace ServerHost
+{
+
+
+struct Request
+{
+	std::string cmd;
+	std::map<std::string, std::string> args;
+
+	const std::string& Get(const std::string& key, const std::string& def) const
+	{
+		auto it = args.find(key);
+		return it == args.end() ? def : it->second;
+	}
+}; // struct Request
+
+
+inline Request ParseRequest(const std::string& line)
+{
+	Request req;
+	size_t pos = 0;
+	while (pos < line.size())
+	{
+		size_t start = line.find_first_not_of(" \t\r", pos);
+		if (start == std::string::npos)
+		{
+			break;
+		}
+		size_t end = line.find_first_of(" \t\r", start);
+		end = (end == std::string::npos) ? line.size() : end;
+		const std::string token = line.substr(start, end - start);
+		pos = end;
+
+		if (req.cmd.empty())
+		{
+			req.cmd = token;
+			continue;
+		}
+		size_t eq = token.find('=');
+		if (eq == std::string::npos)
+		{
+			throw std::invalid_argument("Malformed argument " + token);
+		}
+		req.args[token.substr(0, eq)] = token.substr(eq + 1);
+	}
+	return req;
+}
+
+
+inline std::vector<uint8_t> HexToBytes(const std::string& hex)
+{
+	auto nibble = [&hex](char ch) -> uint8_t
+	{
+		if ((ch >= '0') && (ch <= '9')) return static_cast<uint8_t>(ch - '0');
+		if ((ch >= 'a') && (ch <= 'f')) return static_cast<uint8_t>(ch - 'a' + 10);
+		if ((ch >= 'A') && (ch <= 'F')) return static_cast<uint8_t>(ch - 'A' + 10);
+		throw std::invalid_argument("Malformed hex string " + hex);
+	};
+
+	if ((hex.size() % 2) != 0)
+	{
+		throw std::invalid_argument("Malformed hex string " + hex);
+	}
+	std::vector<uint8_t> res(hex.size() / 2);
+	for (size_t i = 0; i < res.size(); ++i)
+	{
+		res[i] = static_cast<uint8_t>(
+			(nibble(hex[i * 2]) << 4) | nibble(hex[(i * 2) + 1])
+		);
+	}
+	return res;
+}
+
+
+inline std::string FormatJobResult(const decent_wasm_job_result_t& res)
+{
+	return
+		"ret="            + std::to_string(res.ret_val) + " "
+		"warm="           + std::to_string(res.warm) + " "
+		"instantiate_us=" + std::to_string(res.instantiate_time_us) + " "
+		"run_us="         + std::to_string(res.run_time_us) + " "
+		"counter="        + std::to_string(res.counter);
+}
+
+
+inline std::string FormatError(const std::string& msg)
+{
+	std::string oneLine = msg;
+	for (auto& ch : oneLine)
+	{
+		ch = ((ch == '\n') || (ch == '\r')) ? ' ' : ch;
+	}
+	return "status=error msg=" + oneLine;
+}
+
+
+/**
+ * @brief A Unix domain socket server handling the connected clients one
+ *        request at a time; requests of different clients are interleaved
+ *        line by line.
+ *
+ */
+class UnixSocketServer
+{
+public: // static members
+
+	/**
+	 * @brief Handles a request line and returns the response line; sets
+	 *        `quit` to stop serving.
+	 */
+	using Handler = std::function<std::string(const std::string&, bool&)>;
+
+public:
+
+	explicit UnixSocketServer(const std::string& path) :
+		m_path(path),
+		m_listenFd(-1)
+	{
+		sockaddr_un addr;
+		std::memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		if (path.size() >= sizeof(addr.sun_path))
+		{
+			throw std::invalid_argument("The socket path is too long");
+		}
+		std::memcpy(addr.sun_path, path.c_str(), path.size());
+
+		m_listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (m_listenFd < 0)
+		{
+			throw std::runtime_error("Failed to create the server socket");
+		}
+		// a socket file left by a previous server; anything else at that
+		// path is not ours to remove
+		struct stat st;
+		if (lstat(path.c_str(), &st) == 0)
+		{
+			if (!S_ISSOCK(st.st_mode))
+			{
+				close(m_listenFd);
+				throw std::runtime_error(
+					path + " exists and is not a socket"
+				);
+			}
+			unlink(path.c_str());
+		}
+		if ((bind(m_listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) ||
+			(listen(m_listenFd, 16) != 0))
+		{
+			close(m_listenFd);
+			throw std::runtime_error("Failed to listen on " + path);
+		}
+	}
+
+	UnixSocketServer(const UnixSocketServer&) = delete;
+
+	~UnixSocketServer()
+	{
+		for (const auto& client : m_clients)
+		{
+			close(client.first);
+		}
+		close(m_listenFd);
+		unlink(m_path.c_str());
+	}
+
+	UnixSocketServer& operator=(const UnixSocketServer&) = delete;
+
+	void Serve(Handler handler)
+	{
+		bool quit = false;
+		while (!quit)
+		{
+			std::vector<pollfd> fds;
+			fds.push_back(pollfd{ m_listenFd, POLLIN, 0 });
+			for (const auto& client : m_clients)
+			{
+				fds.push_back(pollfd{ client.first, POLLIN, 0 });
+			}
+
+			if (poll(fds.data(), fds.size(), -1) < 0)
+			{
+				continue; // e.g., interrupted by a signal
+			}
+
+			if (fds[0].revents & POLLIN)
+			{
+				int fd = accept(m_listenFd, nullptr, nullptr);
+				if (fd >= 0)
+				{
+					m_clients[fd] = std::string();
+				}
+			}
+			for (size_t i = 1; (i < fds.size()) && !quit; ++i)
+			{
+				if (fds[i].revents & (POLLIN | POLLHUP | POLLERR))
+				{
+					quit = ServeClient(fds[i].fd, handler);
+				}
+			}
+		}
+	}
+
+private:
+
+	/**
+	 * @return True to stop serving.
+	 */
+	bool ServeClient(int fd, const Handler& handler)
+	{
+		char buf[4096];
+		ssize_t readSize = read(fd, buf, sizeof(buf));
+		if (readSize <= 0)
+		{
+			close(fd);
+			m_clients.erase(fd);
+			return false;
+		}
+
+		std::string& pending = m_clients[fd];
+		pending.append(buf, static_cast<size_t>(readSize));
+
+		bool quit = false;
+		size_t lineEnd = std::string::npos;
+		while (!quit && ((lineEnd = pending.find('\n')) != std::string::npos))
+		{
+			const std::string line = pending.substr(0, lineEnd);
+			pending.erase(0, lineEnd + 1);
+
+			const std::string resp = handler(line, quit) + "\n";
+			size_t sent = 0;
+			while (sent < resp.size())
+			{
+				ssize_t sendSize = send(
+					fd, resp.data() + sent, resp.size() - sent, MSG_NOSIGNAL
+				);
+				if (sendSize <= 0)
+				{
+					break; // the client is gone; cleaned up at the next read
+				}
+				sent += static_cast<size_t>(sendSize);
+			}
+		}
+		return quit;
+	}
+
+	std::string m_path;
+	int m_listenFd;
+	// client socket -> the bytes received after its last complete line
+	std::map<int, std::string> m_clients;
+}; // class UnixSocketServer
+
+
+} // namespace ServerHost
+
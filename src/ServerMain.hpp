@@ -0,0 +1,415 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstdint>
+#include <cstring>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <DecentWasmRuntime/Internal/make_unique.hpp>
+#include <DecentWasmRuntime/MainRunner.hpp>
+
+#include "DecentMain.hpp"
+#include "SystemIO.hpp"
+#include "decent_wasm_config.h"
+
+
+/**
+ * @brief What the server mode keeps across jobs: one runtime, the modules
+ *        loaded so far, and a warm instance of each module, which runs every
+ *        job of that module.
+ *
+ *        Modules are keyed by the caller (e.g., by the SHA-256 of their
+ *        bytecode), so loading the same module again gives the same handle.
+ *        At most sk_maxModules modules are kept; the least recently used one
+ *        is evicted to make room for a new one. Instances are evicted the
+ *        same way whenever the memory pool can't fit a new one.
+ *
+ */
+class DecentWasmServer
+{
+public: // static members
+
+	static constexpr size_t sk_maxModules = 16;
+
+public:
+
+	explicit DecentWasmServer(const decent_wasm_main_config_t& config) :
+		m_wasmRt(CreateMainRuntime(config)),
+		m_sizing(GetDefaultInstanceSizing(config)),
+		m_prefault(config.prefault != 0),
+		m_hugePage(config.pool_huge_pages != 0),
+		m_modules(),
+		m_handles(),
+		m_nextHandle(1),
+		m_useTick(0)
+	{}
+
+	/**
+	 * @brief Load a module, or find the one already loaded with the same key.
+	 *
+	 * @return The handle of the module, for running jobs on it.
+	 */
+	uint32_t Load(const std::string& key, const uint8_t* data, size_t size)
+	{
+		uint32_t handle = Find(key);
+		return handle != 0 ?
+			handle :
+			Load(key, std::vector<uint8_t>(data, data + size));
+	}
+
+	/**
+	 * @brief The same as above, but the module is loaded from the given
+	 *        buffer, which is moved into the module instead of copied.
+	 *
+	 */
+	uint32_t Load(const std::string& key, std::vector<uint8_t>&& wasm)
+	{
+		uint32_t existing = Find(key);
+		if (existing != 0)
+		{
+			return existing;
+		}
+
+		if (m_modules.size() >= sk_maxModules)
+		{
+			EvictLruModule();
+		}
+
+		uint64_t startUs = GetTimestampUs();
+		DecentWasmRuntime::SharedWasmModule mod = m_wasmRt.LoadModule(std::move(wasm));
+		mod->SetInitLinearMemSize(m_sizing.initLinearMemSize);
+		uint64_t endUs = GetTimestampUs();
+		mod->SetPrefaultLinearMem(m_prefault);
+		mod->SetHugePageLinearMem(m_hugePage);
+		PrintModuleLoad("server", mod, endUs - startUs);
+
+		const uint32_t handle = m_nextHandle++;
+		m_modules.emplace(handle, WarmModule(key, std::move(mod), ++m_useTick));
+		m_handles[key] = handle;
+
+		return handle;
+	}
+
+	/**
+	 * @brief Run a job on the warm instance of a module, creating the
+	 *        instance first if there is none.
+	 *
+	 * @param threshold The instruction threshold of an instrumented run
+	 *                  (`decent_wasm_injected_main`); 0 for a plain run
+	 *                  (`decent_wasm_main`).
+	 */
+	void Run(
+		uint32_t handle,
+		const std::vector<uint8_t>& eventId,
+		const std::vector<uint8_t>& eventData,
+		uint64_t threshold,
+		decent_wasm_job_result_t& res
+	)
+	{
+		std::memset(&res, 0, sizeof(res));
+
+		auto it = m_modules.find(handle);
+		if (it == m_modules.end())
+		{
+			res.status = DECENT_WASM_JOB_UNKNOWN_MODULE;
+			return;
+		}
+		WarmModule& warm = it->second;
+		warm.lastUse = ++m_useTick;
+
+		try
+		{
+			if (warm.runner == nullptr)
+			{
+				uint64_t startUs = GetTimestampUs();
+				Instantiate(handle, warm, eventId, eventData);
+				res.instantiate_time_us = GetTimestampUs() - startUs;
+			}
+			else
+			{
+				warm.runner->SetEvent(eventId, eventData);
+				res.warm = 1;
+			}
+
+			uint64_t startUs = GetTimestampUs();
+			if (threshold == 0)
+			{
+				res.ret_val = warm.runner->RunPlain();
+			}
+			else
+			{
+				res.ret_val = warm.runner->RunInstrumented(threshold);
+				res.counter = warm.runner->GetCounter();
+				warm.runner->ResetThresholdAndCounter();
+			}
+			res.run_time_us = GetTimestampUs() - startUs;
+			res.status = DECENT_WASM_JOB_OK;
+		}
+		catch(const std::exception& e)
+		{
+			// a trap can leave the instance in any state, so the next job of
+			// this module gets a new one
+			warm.runner.reset();
+			PrintStr(e.what());
+			PrintStr("\n");
+			res.status = DECENT_WASM_JOB_ERROR;
+		}
+	}
+
+	size_t GetNumModules() const noexcept
+	{
+		return m_modules.size();
+	}
+
+private:
+
+	struct WarmModule
+	{
+		WarmModule(
+			const std::string& key,
+			DecentWasmRuntime::SharedWasmModule mod,
+			uint64_t lastUse
+		) :
+			key(key),
+			mod(std::move(mod)),
+			runner(),
+			lastUse(lastUse)
+		{}
+
+		std::string key;
+		DecentWasmRuntime::SharedWasmModule mod;
+		std::unique_ptr<DecentWasmRuntime::MainRunner> runner;
+		uint64_t lastUse;
+	}; // struct WarmModule
+
+	/**
+	 * @return The handle of the module loaded with the given key, or 0.
+	 */
+	uint32_t Find(const std::string& key)
+	{
+		auto keyIt = m_handles.find(key);
+		if (keyIt == m_handles.end())
+		{
+			return 0;
+		}
+		m_modules.at(keyIt->second).lastUse = ++m_useTick;
+		return keyIt->second;
+	}
+
+	void Instantiate(
+		uint32_t handle,
+		WarmModule& warm,
+		const std::vector<uint8_t>& eventId,
+		const std::vector<uint8_t>& eventData
+	)
+	{
+		using namespace DecentWasmRuntime;
+
+		while (true)
+		{
+			try
+			{
+				warm.runner = Internal::make_unique<MainRunner>(
+					warm.mod,
+					eventId,
+					eventData,
+					m_sizing.modStackSize,
+					m_sizing.modHeapSize,
+					m_sizing.execStackSize
+				);
+				return;
+			}
+			catch(const std::exception&)
+			{
+				// most likely the pool is full; retry once the instance of
+				// another module is freed
+				if (!EvictLruInstance(handle))
+				{
+					throw;
+				}
+			}
+		}
+	}
+
+	bool EvictLruInstance(uint32_t exceptHandle)
+	{
+		auto lruIt = m_modules.end();
+		for (auto it = m_modules.begin(); it != m_modules.end(); ++it)
+		{
+			if ((it->first != exceptHandle) && (it->second.runner != nullptr) &&
+				((lruIt == m_modules.end()) ||
+					(it->second.lastUse < lruIt->second.lastUse)))
+			{
+				lruIt = it;
+			}
+		}
+		if (lruIt == m_modules.end())
+		{
+			return false;
+		}
+		lruIt->second.runner.reset();
+		return true;
+	}
+
+	void EvictLruModule()
+	{
+		auto lruIt = m_modules.begin();
+		for (auto it = m_modules.begin(); it != m_modules.end(); ++it)
+		{
+			if (it->second.lastUse < lruIt->second.lastUse)
+			{
+				lruIt = it;
+			}
+		}
+		if (lruIt != m_modules.end())
+		{
+			m_handles.erase(lruIt->second.key);
+			m_modules.erase(lruIt);
+		}
+	}
+
+	DecentWasmRuntime::SharedWasmRuntime m_wasmRt;
+	DecentWasmRuntime::InstanceSizing m_sizing;
+	bool m_prefault;
+	bool m_hugePage;
+
+	std::map<uint32_t, WarmModule> m_modules;
+	std::map<std::string, uint32_t> m_handles;
+	uint32_t m_nextHandle;
+	uint64_t m_useTick;
+}; // class DecentWasmServer
+
+
+/**
+ * @brief The server of this side of the enclave boundary; there is at most
+ *        one, created by DecentWasmServerStart.
+ */
+inline std::unique_ptr<DecentWasmServer>& GetDecentWasmServer()
+{
+	static std::unique_ptr<DecentWasmServer> s_server;
+	return s_server;
+}
+
+
+inline std::mutex& GetDecentWasmServerMutex()
+{
+	static std::mutex s_mutex;
+	return s_mutex;
+}
+
+
+inline bool DecentWasmServerStart(const decent_wasm_main_config_t& config)
+{
+	std::lock_guard<std::mutex> lock(GetDecentWasmServerMutex());
+	try
+	{
+		if (!IsMainRunningModeSupported(config))
+		{
+			return false;
+		}
+		GetDecentWasmServer() =
+			DecentWasmRuntime::Internal::make_unique<DecentWasmServer>(config);
+		return true;
+	}
+	catch(const std::exception& e)
+	{
+		PrintStr(e.what());
+		PrintStr("\n");
+		return false;
+	}
+}
+
+
+inline void DecentWasmServerStop()
+{
+	std::lock_guard<std::mutex> lock(GetDecentWasmServerMutex());
+	GetDecentWasmServer().reset();
+}
+
+
+/**
+ * @brief Load a module into the server.
+ *
+ * @param key    Identifies the module, e.g., the SHA-256 of its bytecode.
+ * @param handle Set to the handle of the module, if it's loaded.
+ */
+inline bool DecentWasmServerLoad(
+	const std::string& key,
+	const uint8_t* data, size_t size,
+	uint32_t& handle
+)
+{
+	std::lock_guard<std::mutex> lock(GetDecentWasmServerMutex());
+	try
+	{
+		if (GetDecentWasmServer() == nullptr)
+		{
+			PrintStr("The server has not been started\n");
+			return false;
+		}
+		handle = GetDecentWasmServer()->Load(key, data, size);
+		return true;
+	}
+	catch(const std::exception& e)
+	{
+		PrintStr(e.what());
+		PrintStr("\n");
+		return false;
+	}
+}
+
+
+inline bool DecentWasmServerLoad(
+	const std::string& key,
+	std::vector<uint8_t>&& wasm,
+	uint32_t& handle
+)
+{
+	std::lock_guard<std::mutex> lock(GetDecentWasmServerMutex());
+	try
+	{
+		if (GetDecentWasmServer() == nullptr)
+		{
+			PrintStr("The server has not been started\n");
+			return false;
+		}
+		handle = GetDecentWasmServer()->Load(key, std::move(wasm));
+		return true;
+	}
+	catch(const std::exception& e)
+	{
+		PrintStr(e.what());
+		PrintStr("\n");
+		return false;
+	}
+}
+
+
+inline void DecentWasmServerRun(
+	uint32_t handle,
+	const std::vector<uint8_t>& eventId,
+	const std::vector<uint8_t>& eventData,
+	uint64_t threshold,
+	decent_wasm_job_result_t& res
+)
+{
+	std::lock_guard<std::mutex> lock(GetDecentWasmServerMutex());
+	if (GetDecentWasmServer() == nullptr)
+	{
+		std::memset(&res, 0, sizeof(res));
+		res.status = DECENT_WASM_JOB_UNKNOWN_MODULE;
+		return;
+	}
+	GetDecentWasmServer()->Run(handle, eventId, eventData, threshold, res);
+}
+
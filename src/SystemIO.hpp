@@ -18,11 +18,13 @@
 
 extern "C" sgx_status_t ocall_print(const char* str);
 extern "C" sgx_status_t ocall_decent_untrusted_timestamp_us(uint64_t* ret_val);
+extern "C" sgx_status_t ocall_decent_noop();
 
 #else // !DECENT_ENCLAVE_PLATFORM_SGX_TRUSTED
 
 extern "C" void ocall_print(const char* str);
 extern "C" uint64_t ocall_decent_untrusted_timestamp_us();
+extern "C" void ocall_decent_noop();
 
 #endif // DECENT_ENCLAVE_PLATFORM_SGX_TRUSTED
 
@@ -72,6 +74,18 @@ inline uint64_t GetTimestampUs()
 	return ret;
 }
 
+/**
+ * @brief Make an empty call to the untrusted side, i.e., an OCALL in the
+ *        enclave, and a plain function call outside of it.
+ */
+inline void CallUntrustedNoop()
+{
+	if (ocall_decent_noop() != SGX_SUCCESS)
+	{
+		throw std::runtime_error("Failed to make the no-op ocall");
+	}
+}
+
 #else // !DECENT_ENCLAVE_PLATFORM_SGX_TRUSTED
 
 inline void PrintStr(const std::string& str)
@@ -84,6 +98,11 @@ inline uint64_t GetTimestampUs()
 	return ocall_decent_untrusted_timestamp_us();
 }
 
+inline void CallUntrustedNoop()
+{
+	ocall_decent_noop();
+}
+
 #endif // DECENT_ENCLAVE_PLATFORM_SGX_TRUSTED
 
 
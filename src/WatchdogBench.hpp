@@ -0,0 +1,226 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <DecentWasmRuntime/Exception.hpp>
+#include <DecentWasmRuntime/Internal/make_unique.hpp>
+#include <DecentWasmRuntime/MainRunner.hpp>
+#include <DecentWasmRuntime/Watchdog.hpp>
+#include <DecentWasmRuntime/WasmRuntimeStaticHeap.hpp>
+
+#include "BenchUtils.hpp"
+#include "SystemIO.hpp"
+#include "decent_wasm_config.h"
+
+
+/**
+ * @brief Run the given function `repeatTime` times, and return the average
+ *        time of a run; the slowest is stored in `maxUs`.
+ *
+ */
+template<typename _RunFunc>
+inline uint64_t DecentWasmWatchdogTimeRuns(
+	DecentWasmRuntime::MainRunner& runner,
+	size_t repeatTime,
+	uint64_t& maxUs,
+	_RunFunc runFunc
+)
+{
+	uint64_t totalUs = 0;
+	maxUs = 0;
+	for (size_t i = 0; i < repeatTime; ++i)
+	{
+		uint64_t startUs = GetTimestampUs();
+		runFunc(runner);
+		uint64_t runUs = GetTimestampUs() - startUs;
+
+		totalUs += runUs;
+		maxUs = std::max(maxUs, runUs);
+	}
+	return repeatTime == 0 ? 0 : (totalUs / repeatTime);
+}
+
+
+/**
+ * @brief Compare the ways of bounding the time of a run: the plain program
+ *        alone (not bounded at all), the plain program with the watchdog,
+ *        and the instrumented program, with a threshold it never reaches.
+ *        Then run the plain program with a timeout of half its run time, to
+ *        check that it's terminated, and how late.
+ *
+ *        The watchdog must be driven by the caller: by the thread in
+ *        Watchdog::Run on the untrusted side, or by calls to Expire in the
+ *        enclave; how late a run is terminated depends on how often that is.
+ *
+ */
+inline bool DecentWasmWatchdogBench(
+	const uint8_t *wasm_file, size_t wasm_file_size,
+	const uint8_t *wasm_nopt_file, size_t wasm_nopt_file_size,
+	const decent_wasm_watchdog_config_t& config,
+	DecentWasmRuntime::Watchdog& watchdog
+)
+{
+	using namespace DecentWasmRuntime;
+
+	try
+	{
+		auto wasmRt = SharedWasmRuntime(
+			Internal::make_unique<WasmRuntimeStaticHeap>(
+				PrintCStr,
+				70 * 1024 * 1024, // 70 MB
+				GetTimestampUs
+			)
+		);
+
+		const std::vector<uint8_t>& eventId = GetDefaultEventId();
+		const std::vector<uint8_t>& msgContent = GetDefaultEventData();
+		const size_t repeatTime = std::max<size_t>(config.repeat_time, 1);
+
+		auto plainMod = wasmRt.LoadModule(
+			std::vector<uint8_t>(wasm_file, wasm_file + wasm_file_size)
+		);
+		auto instMod = wasmRt.LoadModule(
+			std::vector<uint8_t>(wasm_nopt_file, wasm_nopt_file + wasm_nopt_file_size)
+		);
+
+		uint64_t plainUs = 0;
+		uint64_t plainMaxUs = 0;
+		uint64_t watchdogUs = 0;
+		uint64_t watchdogMaxUs = 0;
+		uint64_t timeoutUs = config.timeout_us;
+		bool terminable = false;
+		{
+			MainRunner runner(
+				plainMod,
+				eventId,
+				msgContent,
+				1 * 1024 * 1024,  // mod stack:  1 MB
+				64 * 1024 * 1024, // mod heap:  64 MB
+				1 * 1024 * 1024   // exec stack: 1 MB
+			);
+			// warm up, so the first run of each kind isn't the only one
+			// paying for faulting in the linear memory
+			runner.RunPlain();
+
+			plainUs = DecentWasmWatchdogTimeRuns(
+				runner, repeatTime, plainMaxUs,
+				[](MainRunner& r) { r.RunPlain(); }
+			);
+
+			if (timeoutUs == 0)
+			{
+				timeoutUs = std::max<uint64_t>(plainMaxUs * 10, 1000);
+			}
+			// the watchdog refuses runs it can't terminate
+			terminable = runner.GetModuleInstance()->IsTerminable();
+			if (terminable)
+			{
+				watchdogUs = DecentWasmWatchdogTimeRuns(
+					runner, repeatTime, watchdogMaxUs,
+					[&watchdog, timeoutUs](MainRunner& r) {
+						r.RunPlain(watchdog, timeoutUs);
+					}
+				);
+			}
+		}
+
+		uint64_t instUs = 0;
+		uint64_t instMaxUs = 0;
+		{
+			MainRunner runner(
+				instMod,
+				eventId,
+				msgContent,
+				1 * 1024 * 1024,  // mod stack:  1 MB
+				64 * 1024 * 1024, // mod heap:  64 MB
+				1 * 1024 * 1024   // exec stack: 1 MB
+			);
+			runner.SetPrintCounter(false);
+			const uint64_t threshold = std::numeric_limits<uint64_t>::max() / 2;
+			runner.RunInstrumented(threshold);
+			runner.ResetThresholdAndCounter();
+
+			instUs = DecentWasmWatchdogTimeRuns(
+				runner, repeatTime, instMaxUs,
+				[threshold](MainRunner& r) {
+					r.RunInstrumented(threshold);
+					r.ResetThresholdAndCounter();
+				}
+			);
+		}
+
+		const uint64_t runawayTimeoutUs = std::max<uint64_t>(plainUs / 2, 1);
+		bool terminated = false;
+		uint64_t overrunUs = 0;
+		if (!terminable)
+		{
+			// without the thread manager (or, for AOT modules, without
+			// --enable-multi-thread), WAMR never checks for termination,
+			// so the runaway run would just run to its end
+			PrintStr(
+				"Watchdog bench: runs can't be terminated in this build "
+				"(e.g., DECENT_WASM_WATCHDOG=OFF); "
+				"skipping the watchdog runs\n"
+			);
+		}
+		else
+		{
+			// a fresh instance, since a terminated run may leave the linear
+			// memory at any point of the program
+			MainRunner runner(
+				plainMod,
+				eventId,
+				msgContent,
+				1 * 1024 * 1024,  // mod stack:  1 MB
+				64 * 1024 * 1024, // mod heap:  64 MB
+				1 * 1024 * 1024   // exec stack: 1 MB
+			);
+			uint64_t startUs = GetTimestampUs();
+			try
+			{
+				runner.RunPlain(watchdog, runawayTimeoutUs);
+			}
+			catch (const WasmTimeoutException& e)
+			{
+				PrintStr(std::string("Runaway run: ") + e.what() + "\n");
+				terminated = true;
+			}
+			uint64_t runUs = GetTimestampUs() - startUs;
+			overrunUs = runUs > runawayTimeoutUs ? (runUs - runawayTimeoutUs) : 0;
+		}
+
+		PrintStr(
+			"Watchdog bench: "
+			"Repeat: "                + std::to_string(repeatTime) + ", "
+			"Plain avg: "             + std::to_string(plainUs) + " us, "
+			"Plain max: "             + std::to_string(plainMaxUs) + " us, "
+			"Plain+watchdog avg: "    + std::to_string(watchdogUs) + " us, "
+			"Plain+watchdog max: "    + std::to_string(watchdogMaxUs) + " us, "
+			"Instrumented avg: "      + std::to_string(instUs) + " us, "
+			"Instrumented max: "      + std::to_string(instMaxUs) + " us, "
+			"Timeout: "               + std::to_string(timeoutUs) + " us, "
+			"Runaway timeout: "       + std::to_string(runawayTimeoutUs) + " us, "
+			"Runaway terminated: "    + (terminated ? "yes" : "no") + ", "
+			"Runaway overrun: "       + std::to_string(overrunUs) + " us\n"
+		);
+
+		return true;
+	}
+	catch(const std::exception& e)
+	{
+		PrintStr(e.what());
+		PrintStr("\n");
+		return false;
+	}
+}
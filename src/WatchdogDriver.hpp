@@ -0,0 +1,165 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sgx_urts.h>
+#include <DecentWasmRuntime/Watchdog.hpp>
+
+#include "HostUtils.hpp"
+#include "WatchdogBench.hpp"
+#include "decent_wasm_config.h"
+
+
+extern "C" {
+
+extern sgx_status_t ecall_decent_wasm_watchdog_bench(
+	sgx_enclave_id_t eid,
+	const uint8_t *wasm_file, size_t wasm_file_size,
+	const uint8_t *wasm_nopt_file, size_t wasm_nopt_file_size,
+	const decent_wasm_watchdog_config_t *config
+);
+
+extern sgx_status_t ecall_decent_wasm_watchdog_tick(sgx_enclave_id_t eid);
+
+} // extern "C"
+
+
+inline decent_wasm_watchdog_config_t ParseWatchdogConfig(
+	int argc, char** argv, int startIdx,
+	uint64_t& tickUs
+)
+{
+	decent_wasm_watchdog_config_t config;
+	config.repeat_time = 5;
+	config.timeout_us  = 0;
+
+	for (int i = startIdx; i < argc; ++i)
+	{
+		const std::string opt = argv[i];
+		if ((i + 1) >= argc)
+		{
+			throw std::invalid_argument("Missing value for option " + opt);
+		}
+
+		const std::string val = argv[++i];
+		if (opt == "--repeat")
+		{
+			config.repeat_time = static_cast<uint32_t>(std::stoul(val));
+		}
+		else if (opt == "--timeout")
+		{
+			config.timeout_us = std::stoull(val);
+		}
+		else if (opt == "--tick")
+		{
+			tickUs = std::max<uint64_t>(std::stoull(val), 1);
+		}
+		else
+		{
+			throw std::invalid_argument("Unknown option " + opt);
+		}
+	}
+
+	return config;
+}
+
+/**
+ * @brief Compare the plain program alone, the plain program bounded by the
+ *        watchdog, and the instrumented program, on the untrusted side and
+ *        in the enclave.
+ *
+ *        The enclave's watchdog is ticked by a host thread, every `--tick`
+ *        microseconds, since a thread in the enclave can't wait for a given
+ *        time; thus a run there is terminated up to a tick late.
+ *
+ */
+inline int WatchdogMain(int argc, char**argv)
+{
+	if (argc < 3)
+	{
+		std::cerr << "Usage: "
+			<< argv[0] << " <wasm file> <inst. wasm file>"
+			<< " [--repeat <num>] [--timeout <us>] [--tick <us>]" << std::endl;
+		return -1;
+	}
+
+	const std::string wasmFilenamePath = argv[1];
+	const std::string instWasmFilenamePath = argv[2];
+	uint64_t tickUs = 1000;
+	const decent_wasm_watchdog_config_t config =
+		ParseWatchdogConfig(argc, argv, 3, tickUs);
+
+	auto wasmBytecode = ReadFile2Buffer(wasmFilenamePath);
+	auto instWasmBytecode = ReadFile2Buffer(instWasmFilenamePath);
+
+	{
+		DecentWasmRuntime::Watchdog watchdog;
+		std::thread watchdogThread([&watchdog]() {
+			watchdog.Run(GetTimestampUs);
+		});
+		const bool succeeded = DecentWasmWatchdogBench(
+			wasmBytecode.data(), wasmBytecode.size(),
+			instWasmBytecode.data(), instWasmBytecode.size(),
+			config,
+			watchdog
+		);
+		watchdog.Stop();
+		watchdogThread.join();
+		if (!succeeded)
+		{
+			return -1;
+		}
+	}
+
+	sgx_enclave_id_t eid = 0;
+	enclave_init(&eid);
+
+	{
+		std::atomic<bool> benchDone(false);
+		std::thread tickThread([eid, tickUs, &benchDone]() {
+			while (!benchDone)
+			{
+				std::this_thread::sleep_for(std::chrono::microseconds(tickUs));
+				if (ecall_decent_wasm_watchdog_tick(eid) != SGX_SUCCESS)
+				{
+					std::cerr << "ERROR: "
+						<< "Failed to run ecall_decent_wasm_watchdog_tick." << std::endl;
+					break;
+				}
+			}
+		});
+
+		auto ret = ecall_decent_wasm_watchdog_bench(
+			eid,
+			wasmBytecode.data(), wasmBytecode.size(),
+			instWasmBytecode.data(), instWasmBytecode.size(),
+			&config
+		);
+		benchDone = true;
+		tickThread.join();
+		if(ret != SGX_SUCCESS)
+		{
+			std::cerr << "ERROR: "
+				<< "Failed to run ecall_decent_wasm_watchdog_bench." << std::endl;
+		}
+	}
+
+	sgx_destroy_enclave(eid);
+
+	return 0;
+}
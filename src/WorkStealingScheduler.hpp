@@ -0,0 +1,407 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+
+/**
+ * @brief Hands out events to a fixed set of worker threads, keeping the
+ *        events of a module on the worker holding an instance of it.
+ *
+ *        Every worker owns a deque. Events of a module are queued at the
+ *        module's home worker (the worker with the shortest deque when the
+ *        module is first seen). A worker takes events from the front of its
+ *        own deque, preferring, among the first sk_scanWindow events, one of
+ *        a module it holds an instance of. An idle worker steals a batch of
+ *        events of one module from the back of the longest deque, with the
+ *        same preference, so the events it takes are the ones that would
+ *        have waited the longest.
+ *
+ *        In SharedQueue mode, all workers take events in order from a single
+ *        deque instead, for comparison.
+ *
+ *        The scheduler doesn't create threads, so it works the same way for
+ *        threads started inside the enclave by ecalls.
+ *
+ */
+template<typename _EventType>
+class WorkStealingScheduler
+{
+public: // static members
+
+	static constexpr size_t sk_scanWindow = 8;
+
+	enum class Mode
+	{
+		SharedQueue,
+		WorkStealing,
+	}; // enum class Mode
+
+	struct Stats
+	{
+		uint64_t numEvents = 0;
+		// times events are moved from another worker's deque
+		uint64_t numSteals = 0;
+		// events moved by those
+		uint64_t numStolen = 0;
+		// events taken by a worker already holding an instance of its module
+		uint64_t numAffinityHits = 0;
+		// the longest any deque has been
+		uint64_t maxQueueDepth = 0;
+		// sum of the depths of the deques events are taken from
+		uint64_t sumQueueDepth = 0;
+		std::vector<uint64_t> workerEvents;
+	}; // struct Stats
+
+public:
+
+	WorkStealingScheduler(size_t numWorkers, Mode mode) :
+		m_mode(mode),
+		m_workers(numWorkers),
+		m_homeMutex(),
+		m_homes(),
+		m_idleMutex(),
+		m_idleCond(),
+		m_pending(0),
+		m_closed(false)
+	{}
+
+	WorkStealingScheduler(const WorkStealingScheduler&) = delete;
+
+	WorkStealingScheduler& operator=(const WorkStealingScheduler&) = delete;
+
+	size_t GetNumWorkers() const noexcept
+	{
+		return m_workers.size();
+	}
+
+	Mode GetMode() const noexcept
+	{
+		return m_mode;
+	}
+
+	void Submit(size_t moduleIdx, _EventType event)
+	{
+		Worker& worker = m_workers[Route(moduleIdx)];
+		{
+			std::lock_guard<std::mutex> lock(worker.mutex);
+			worker.deque.emplace_back(moduleIdx, std::move(event));
+
+			const uint64_t depth = worker.deque.size();
+			worker.depth = depth;
+			if (depth > worker.maxDepth)
+			{
+				worker.maxDepth = depth;
+			}
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_idleMutex);
+			++m_pending;
+		}
+		m_idleCond.notify_all();
+	}
+
+	/**
+	 * @brief No more events will be submitted; workers return from Next
+	 *        once all the queued events are taken.
+	 *
+	 */
+	void Close()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_idleMutex);
+			m_closed = true;
+		}
+		m_idleCond.notify_all();
+	}
+
+	/**
+	 * @brief Take the next event for a worker, waiting for one if needed.
+	 *
+	 * @return false once the scheduler is closed and no event is left.
+	 */
+	bool Next(size_t workerIdx, _EventType& event)
+	{
+		while (true)
+		{
+			if (TakeOwn(workerIdx, event) || Steal(workerIdx, event))
+			{
+				return true;
+			}
+
+			std::unique_lock<std::mutex> lock(m_idleMutex);
+			m_idleCond.wait(lock, [this]() {
+				return (m_pending > 0) || m_closed;
+			});
+			if ((m_pending == 0) && m_closed)
+			{
+				return false;
+			}
+		}
+	}
+
+	/**
+	 * @brief Tell the scheduler whether a worker holds an instance of a
+	 *        module; must only be called by the worker's own thread.
+	 *
+	 */
+	void SetHeld(size_t workerIdx, size_t moduleIdx, bool held)
+	{
+		std::vector<bool>& heldMods = m_workers[workerIdx].held;
+		if (moduleIdx >= heldMods.size())
+		{
+			heldMods.resize(moduleIdx + 1, false);
+		}
+		heldMods[moduleIdx] = held;
+	}
+
+	Stats GetStats() const
+	{
+		Stats stats;
+		for (const auto& worker : m_workers)
+		{
+			std::lock_guard<std::mutex> lock(worker.mutex);
+			stats.numEvents += worker.numEvents;
+			stats.numSteals += worker.numSteals;
+			stats.numStolen += worker.numStolen;
+			stats.numAffinityHits += worker.numAffinityHits;
+			stats.sumQueueDepth += worker.sumQueueDepth;
+			if (worker.maxDepth > stats.maxQueueDepth)
+			{
+				stats.maxQueueDepth = worker.maxDepth;
+			}
+			stats.workerEvents.push_back(worker.numEvents);
+		}
+		return stats;
+	}
+
+private:
+
+	using QueuedEvent = std::pair<size_t, _EventType>;
+
+	struct Worker
+	{
+		// guards the deque and the stats below
+		mutable std::mutex mutex;
+		std::deque<QueuedEvent> deque;
+		// the size of the deque, for picking one without locking them all
+		std::atomic<uint64_t> depth{ 0 };
+		uint64_t maxDepth = 0;
+
+		// only touched by the worker's own thread
+		std::vector<bool> held;
+
+		// stats of the events this worker takes, guarded by its own mutex
+		uint64_t numEvents = 0;
+		uint64_t numSteals = 0;
+		uint64_t numStolen = 0;
+		uint64_t numAffinityHits = 0;
+		uint64_t sumQueueDepth = 0;
+	}; // struct Worker
+
+	bool IsHeld(const Worker& worker, size_t moduleIdx) const
+	{
+		return (moduleIdx < worker.held.size()) && worker.held[moduleIdx];
+	}
+
+	size_t GetShortest() const
+	{
+		size_t shortest = 0;
+		for (size_t i = 1; i < m_workers.size(); ++i)
+		{
+			if (m_workers[i].depth < m_workers[shortest].depth)
+			{
+				shortest = i;
+			}
+		}
+		return shortest;
+	}
+
+	size_t Route(size_t moduleIdx)
+	{
+		if (m_mode == Mode::SharedQueue)
+		{
+			return 0;
+		}
+
+		std::lock_guard<std::mutex> lock(m_homeMutex);
+		auto it = m_homes.find(moduleIdx);
+		if (it == m_homes.end())
+		{
+			it = m_homes.emplace(moduleIdx, GetShortest()).first;
+		}
+		return it->second;
+	}
+
+	/**
+	 * @brief Take an event from the front of a worker's own deque (or the
+	 *        shared queue): the first one within the scan window of a module
+	 *        the worker holds, or otherwise the first one.
+	 *
+	 */
+	bool TakeOwn(size_t workerIdx, _EventType& event)
+	{
+		Worker& taker = m_workers[workerIdx];
+		// every worker takes from the front of the shared queue, in order
+		const bool isShared = (m_mode == Mode::SharedQueue);
+		Worker& owner = isShared ? m_workers[0] : taker;
+
+		uint64_t depth = 0;
+		bool isHit = false;
+		{
+			std::lock_guard<std::mutex> lock(owner.mutex);
+			std::deque<QueuedEvent>& dq = owner.deque;
+			if (dq.empty())
+			{
+				return false;
+			}
+			depth = dq.size();
+
+			size_t pos = 0;
+			const size_t window = isShared ? 1 :
+				(dq.size() < sk_scanWindow ? dq.size() : sk_scanWindow);
+			for (size_t i = 0; i < window; ++i)
+			{
+				if (IsHeld(taker, dq[i].first))
+				{
+					pos = i;
+					break;
+				}
+			}
+			isHit = IsHeld(taker, dq[pos].first);
+
+			event = std::move(dq[pos].second);
+			dq.erase(dq.begin() + pos);
+			owner.depth = dq.size();
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_idleMutex);
+			--m_pending;
+		}
+
+		std::lock_guard<std::mutex> lock(taker.mutex);
+		++taker.numEvents;
+		taker.sumQueueDepth += depth;
+		if (isHit)
+		{
+			++taker.numAffinityHits;
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Move events from the back of the longest deque to the thief's
+	 *        own: up to half of that deque, all of the same module, which is
+	 *        the last one within the scan window of a module the thief holds,
+	 *        or otherwise the last one. Thus the thief keeps running the
+	 *        stolen module, instead of coming back for every event.
+	 *
+	 */
+	bool Steal(size_t thiefIdx, _EventType& event)
+	{
+		if (m_mode == Mode::SharedQueue)
+		{
+			return false;
+		}
+
+		size_t victimIdx = thiefIdx;
+		uint64_t victimDepth = 0;
+		for (size_t i = 0; i < m_workers.size(); ++i)
+		{
+			const uint64_t depth = m_workers[i].depth;
+			if ((i != thiefIdx) && (depth > victimDepth))
+			{
+				victimIdx = i;
+				victimDepth = depth;
+			}
+		}
+		if (victimIdx == thiefIdx)
+		{
+			return false;
+		}
+
+		Worker& thief = m_workers[thiefIdx];
+		Worker& victim = m_workers[victimIdx];
+		std::deque<QueuedEvent> stolen;
+		{
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			std::deque<QueuedEvent>& dq = victim.deque;
+			if (dq.empty())
+			{
+				return false;
+			}
+
+			size_t moduleIdx = dq.back().first;
+			const size_t window =
+				dq.size() < sk_scanWindow ? dq.size() : sk_scanWindow;
+			for (size_t i = 0; i < window; ++i)
+			{
+				if (IsHeld(thief, dq[dq.size() - 1 - i].first))
+				{
+					moduleIdx = dq[dq.size() - 1 - i].first;
+					break;
+				}
+			}
+
+			const size_t maxStolen = (dq.size() + 1) / 2;
+			std::deque<QueuedEvent> kept;
+			while (!dq.empty())
+			{
+				if ((dq.back().first == moduleIdx) && (stolen.size() < maxStolen))
+				{
+					stolen.push_front(std::move(dq.back()));
+				}
+				else
+				{
+					kept.push_front(std::move(dq.back()));
+				}
+				dq.pop_back();
+			}
+			dq.swap(kept);
+			victim.depth = dq.size();
+		}
+		{
+			std::lock_guard<std::mutex> lock(thief.mutex);
+			++thief.numSteals;
+			thief.numStolen += stolen.size();
+			for (auto& queued : stolen)
+			{
+				thief.deque.push_back(std::move(queued));
+			}
+			const uint64_t depth = thief.deque.size();
+			thief.depth = depth;
+			if (depth > thief.maxDepth)
+			{
+				thief.maxDepth = depth;
+			}
+		}
+		return TakeOwn(thiefIdx, event);
+	}
+
+	Mode m_mode;
+	std::vector<Worker> m_workers;
+
+	std::mutex m_homeMutex;
+	// module index -> index of the worker its events are queued at
+	std::map<size_t, size_t> m_homes;
+
+	std::mutex m_idleMutex;
+	std::condition_variable m_idleCond;
+	// events submitted but not yet taken
+	size_t m_pending;
+	bool m_closed;
+}; // class WorkStealingScheduler
+
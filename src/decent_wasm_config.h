@@ -0,0 +1,228 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#pragma once
+
+
+#include <stdint.h>
+
+
+/**
+ * Configuration of a Decent WASM main run, shared by the untrusted side
+ * and the enclave (see `ecall_decent_wasm_main`).
+ */
+typedef struct decent_wasm_main_config
+{
+	/* Linear memory size (in bytes) reserved for each instance right after
+	   the instantiation; 0 to keep the size declared by the module */
+	uint32_t init_linear_mem_size;
+
+	/* Non-zero to pick the instance sizes from the memory usage observed
+	   in a profiling run, plus `auto_size_margin` percent */
+	uint32_t auto_size;
+	uint32_t auto_size_margin;
+
+	/* Non-zero to touch every page of the memory pool at start-up, and
+	   every page of the linear memory right after each instantiation */
+	uint32_t prefault;
+
+	/* Non-zero to map the memory pool with `MAP_POPULATE` /
+	   to advise transparent huge pages for it;
+	   only effective on the untrusted side */
+	uint32_t pool_populate;
+	uint32_t pool_huge_page_hint;
+
+	/* Non-zero to back the memory pool with explicit huge pages, falling
+	   back to transparent huge pages and then regular pages;
+	   only effective on the untrusted side */
+	uint32_t pool_huge_pages;
+
+	/* The WAMR `RunningMode` set as the runtime's default;
+	   0 to keep WAMR's default */
+	uint32_t running_mode;
+} decent_wasm_main_config_t;
+
+
+/**
+ * Configuration of an instance density benchmark
+ * (see `ecall_decent_wasm_density`).
+ */
+typedef struct decent_wasm_density_config
+{
+	/* Size of the memory pool given to the WASM runtime */
+	uint32_t pool_size;
+
+	/* The number of instances is doubled at each density level,
+	   until it reaches `max_instances` */
+	uint32_t max_instances;
+
+	/* Sizes given to each instance */
+	uint32_t mod_stack_size;
+	uint32_t mod_heap_size;
+	uint32_t exec_stack_size;
+} decent_wasm_density_config_t;
+
+
+/* Scheduling policies of the scheduler benchmark */
+#define DECENT_WASM_SCHED_SHARED_QUEUE  0
+#define DECENT_WASM_SCHED_WORK_STEALING 1
+
+
+/**
+ * Configuration of a scheduler benchmark
+ * (see `ecall_decent_wasm_sched_start`).
+ */
+typedef struct decent_wasm_sched_config
+{
+	/* Size of the memory pool given to the WASM runtime */
+	uint32_t pool_size;
+
+	/* The number of worker threads, and of events run by them */
+	uint32_t num_workers;
+	uint32_t num_events;
+
+	/* One of DECENT_WASM_SCHED_* */
+	uint32_t policy;
+
+	/* The number of instances each worker keeps; the least recently used
+	   one is destroyed to make room for a new one */
+	uint32_t max_worker_instances;
+
+	/* Sizes given to each instance */
+	uint32_t mod_stack_size;
+	uint32_t mod_heap_size;
+	uint32_t exec_stack_size;
+
+	/* Seed of the random event mix */
+	uint32_t seed;
+} decent_wasm_sched_config_t;
+
+
+/* Scheduling policies of the deadline benchmark */
+#define DECENT_WASM_DEADLINE_FIFO               0
+#define DECENT_WASM_DEADLINE_EARLIEST_DEADLINE  1
+#define DECENT_WASM_DEADLINE_SHORTEST_PREDICTED 2
+
+
+/**
+ * Configuration of a deadline scheduling benchmark
+ * (see `ecall_decent_wasm_deadline_start`).
+ */
+typedef struct decent_wasm_deadline_config
+{
+	/* Size of the memory pool given to the WASM runtime */
+	uint32_t pool_size;
+
+	/* The number of worker threads */
+	uint32_t num_workers;
+
+	/* One of DECENT_WASM_DEADLINE_* */
+	uint32_t policy;
+
+	/* Sizes given to each instance */
+	uint32_t mod_stack_size;
+	uint32_t mod_heap_size;
+	uint32_t exec_stack_size;
+
+	/* Predicted time of a run of a module which hasn't been run yet;
+	 * 0 to always admit its events */
+	uint32_t unknown_cost_us;
+
+	/* Non-zero to run each module once before the load, so its cost is
+	 * known from the first event */
+	uint32_t calibrate;
+} decent_wasm_deadline_config_t;
+
+
+/**
+ * Configuration of a watchdog benchmark
+ * (see `ecall_decent_wasm_watchdog_bench`).
+ */
+typedef struct decent_wasm_watchdog_config
+{
+	/* The number of runs of each kind */
+	uint32_t repeat_time;
+
+	/* Timeout given to the runs with the watchdog; 0 to use 10 times the
+	   slowest plain run, which none of them should hit */
+	uint64_t timeout_us;
+} decent_wasm_watchdog_config_t;
+
+
+/**
+ * Configuration of an asynchronous run benchmark
+ * (see `ecall_decent_wasm_async_start`).
+ */
+typedef struct decent_wasm_async_config
+{
+	/* Size of the memory pool given to the WASM runtime */
+	uint32_t pool_size;
+
+	/* The number of executor workers; in the enclave, they are host threads
+	   calling `ecall_decent_wasm_async_work` */
+	uint32_t num_workers;
+
+	/* The number of runners, i.e., of runs kept in flight */
+	uint32_t num_runners;
+
+	/* The number of runs, split among the runners */
+	uint32_t num_events;
+
+	/* Sizes given to each instance */
+	uint32_t mod_stack_size;
+	uint32_t mod_heap_size;
+	uint32_t exec_stack_size;
+} decent_wasm_async_config_t;
+
+
+/**
+ * Configuration of a load generator run
+ * (see `ecall_decent_wasm_loadgen_start`).
+ */
+typedef struct decent_wasm_loadgen_config
+{
+	/* Size of the memory pool given to the WASM runtime */
+	uint32_t pool_size;
+
+	/* The number of worker threads; each keeps an instance of every module
+	   it has run */
+	uint32_t num_workers;
+
+	/* Sizes given to each instance */
+	uint32_t mod_stack_size;
+	uint32_t mod_heap_size;
+	uint32_t exec_stack_size;
+} decent_wasm_loadgen_config_t;
+
+
+/* Status of a job run by the server mode (see `ecall_decent_wasm_server_run`) */
+#define DECENT_WASM_JOB_OK             0
+#define DECENT_WASM_JOB_ERROR          1
+#define DECENT_WASM_JOB_UNKNOWN_MODULE 2
+
+
+/**
+ * Result of a job run by the server mode.
+ */
+typedef struct decent_wasm_job_result
+{
+	/* One of DECENT_WASM_JOB_*; UNKNOWN_MODULE if the module handle is not
+	   (or no longer) loaded, e.g., after being evicted */
+	uint32_t status;
+
+	/* The value returned by the module's main function */
+	int32_t ret_val;
+
+	/* Non-zero if the job ran on an instance kept warm from a previous job */
+	uint32_t warm;
+
+	/* Time spent on instantiating the module (0 if warm), and on running it */
+	uint64_t instantiate_time_us;
+	uint64_t run_time_us;
+
+	/* The instruction counter at the end of an instrumented run;
+	   0 for a plain run */
+	uint64_t counter;
+} decent_wasm_job_result_t;
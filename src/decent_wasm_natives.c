@@ -9,20 +9,38 @@
 #include <wasm_export.h>
 
 typedef void (*os_print_function_t)(const char *message);
-extern void emscripten_memcpy_js(
+extern void decent_wasm_reg_raw_natives(os_print_function_t os_print);
+#ifdef DECENT_WASM_HOST_KERNELS
+extern void decent_wasm_reg_kernel_natives(os_print_function_t os_print);
+#endif // DECENT_WASM_HOST_KERNELS
+extern void decent_wasm_memcpy(
 	wasm_exec_env_t exec_env,
 	void* dest,
 	const void* src,
-	size_t n
+	uint32_t n
 );
+extern void decent_wasm_memmove(
+	wasm_exec_env_t exec_env,
+	void* dest,
+	const void* src,
+	uint32_t n
+);
+extern void decent_wasm_memset(
+	wasm_exec_env_t exec_env,
+	void* dest,
+	int val,
+	uint32_t n
+);
+extern uint64_t decent_wasm_timestamp_us(wasm_exec_env_t exec_env);
 extern int decent_wasm_sum(wasm_exec_env_t exec_env , int a, int b);
+extern void decent_wasm_noop(wasm_exec_env_t exec_env);
+extern uint32_t decent_wasm_buf_peek(wasm_exec_env_t exec_env, const void* buf, uint32_t len);
+extern uint32_t decent_wasm_strlen(wasm_exec_env_t exec_env, const char* str);
+extern void decent_wasm_ocall_noop(wasm_exec_env_t exec_env);
 extern void decent_wasm_print_string(wasm_exec_env_t exec_env, const char * msg);
 extern void decent_wasm_start_benchmark(wasm_exec_env_t exec_env);
 extern void decent_wasm_stop_benchmark(wasm_exec_env_t exec_env);
 extern void decent_wasm_exit(wasm_exec_env_t exec_env, int exit_code);
-extern void decent_wasm_counter_exceed(wasm_exec_env_t exec_env);
-extern uint32_t decent_wasm_get_event_id_len(wasm_exec_env_t exec_env);
-extern uint32_t decent_wasm_get_event_data_len(wasm_exec_env_t exec_env);
 extern uint32_t decent_wasm_get_event_id(wasm_exec_env_t exec_env, void* wasmPtr, uint32_t len);
 extern uint32_t decent_wasm_get_event_data(wasm_exec_env_t exec_env, uint32_t wasmPtr, uint32_t len);
 
@@ -30,17 +48,59 @@ extern uint32_t decent_wasm_get_event_data(wasm_exec_env_t exec_env, uint32_t wa
 static NativeSymbol gs_DecentWasmNatives[] =
 {
 	{
-		"emscripten_memcpy_js", // WASM function name
-		emscripten_memcpy_js,   // the native function pointer
+		"decent_wasm_memcpy", // WASM function name
+		decent_wasm_memcpy,   // the native function pointer
+		"(**~)",              // the function prototype signature
+		NULL,
+	},
+	{
+		"decent_wasm_memmove", // WASM function name
+		decent_wasm_memmove,   // the native function pointer
 		"(**~)",               // the function prototype signature
 		NULL,
 	},
+	{
+		"decent_wasm_memset", // WASM function name
+		decent_wasm_memset,   // the native function pointer
+		"(*ii)",              // the function prototype signature
+		NULL,
+	},
+	{
+		"decent_wasm_timestamp_us", // WASM function name
+		decent_wasm_timestamp_us,   // the native function pointer
+		"()I",                      // the function prototype signature
+		NULL,
+	},
 	{
 		"decent_wasm_sum", // WASM function name
 		decent_wasm_sum,   // the native function pointer
 		"(ii)i",           // the function prototype signature
 		NULL,
 	},
+	{
+		"decent_wasm_noop", // WASM function name
+		decent_wasm_noop,   // the native function pointer
+		"()",               // the function prototype signature
+		NULL,
+	},
+	{
+		"decent_wasm_buf_peek", // WASM function name
+		decent_wasm_buf_peek,   // the native function pointer
+		"(*~)i",                // the function prototype signature
+		NULL,
+	},
+	{
+		"decent_wasm_strlen", // WASM function name
+		decent_wasm_strlen,   // the native function pointer
+		"($)i",               // the function prototype signature
+		NULL,
+	},
+	{
+		"decent_wasm_ocall_noop", // WASM function name
+		decent_wasm_ocall_noop,   // the native function pointer
+		"()",                     // the function prototype signature
+		NULL,
+	},
 	{
 		"decent_wasm_print", // WASM function name
 		decent_wasm_print_string,   // the native function pointer
@@ -65,18 +125,6 @@ static NativeSymbol gs_DecentWasmNatives[] =
 		"()",               // the function prototype signature
 		NULL,
 	},
-	{
-		"decent_wasm_get_event_id_len", // WASM function name
-		decent_wasm_get_event_id_len,   // the native function pointer
-		"()i",               // the function prototype signature
-		NULL,
-	},
-	{
-		"decent_wasm_get_event_data_len", // WASM function name
-		decent_wasm_get_event_data_len,   // the native function pointer
-		"()i",               // the function prototype signature
-		NULL,
-	},
 	{
 		"decent_wasm_get_event_id", // WASM function name
 		decent_wasm_get_event_id,   // the native function pointer
@@ -95,12 +143,6 @@ static NativeSymbol gs_DecentWasmNatives[] =
 		"(i)",               // the function prototype signature
 		NULL,
 	},
-	{
-		"decent_wasm_counter_exceed", // WASM function name
-		decent_wasm_counter_exceed,   // the native function pointer
-		"()",               // the function prototype signature
-		NULL,
-	},
 };
 
 
@@ -116,4 +158,9 @@ void decent_wasm_reg_natives(os_print_function_t os_print)
 	{
 		os_print("ERROR: Failed to register Decent WASM native symbols!");
 	}
+
+	decent_wasm_reg_raw_natives(os_print);
+#ifdef DECENT_WASM_HOST_KERNELS
+	decent_wasm_reg_kernel_natives(os_print);
+#endif // DECENT_WASM_HOST_KERNELS
 }
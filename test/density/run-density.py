@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+# -*- coding:utf-8 -*-
+###
+# Copyright (c) 2024 Haofan Zheng
+# Use of this source code is governed by an MIT-style
+# license that can be found in the LICENSE file or at
+# https://opensource.org/licenses/MIT.
+###
+
+
+import json
+import os
+import re
+import subprocess
+import sys
+
+from typing import Dict, List
+
+
+NICE_ADJUST = -20
+AFFINITY = { 3,}
+
+CURR_DIR = os.path.dirname(os.path.abspath(__file__))
+PROJ_BUILD_DIR = os.path.join(CURR_DIR, os.pardir, os.pardir, 'build-release')
+BENCHMARK_BUILD_DIR = os.path.join(PROJ_BUILD_DIR, 'src')
+BENCHMARKER_BIN = 'decent_wasm_test'
+DEFAULT_MODULE = os.path.join(CURR_DIR, os.pardir, 'wasm', 'test-04', 'test.wasm')
+
+POOL_SIZE       = 70 * 1024 * 1024
+MAX_INSTANCES   = 1024
+MOD_STACK_SIZE  = 64 * 1024
+MOD_HEAP_SIZE   = 1 * 1024 * 1024
+EXEC_STACK_SIZE = 64 * 1024
+
+LEVEL_FIELDS = [
+	# (label, unit)
+	('Instances',       ''),
+	('Instantiate avg', 'us'),
+	('Instantiate max', 'us'),
+	('Run avg',         'us'),
+	('Run max',         'us'),
+	('Pool used',       'bytes'),
+	('Pool peak',       'bytes'),
+]
+
+
+def ParseDensityPrintout(printoutLines: List[str]) -> Dict[str, dict]:
+	LEVEL_REGEX = r'\[(\w+)\]\s*Density level\s*:' + \
+		','.join([ f'\\s*{x}\\s*:\\s*(\\d+)\\s*{u}\\s*' for x, u in LEVEL_FIELDS ])
+	LIMIT_REGEX = r'\[(\w+)\]\s*Density limit reached at\s*(\d+)\s*instances\s*\((.*)\)'
+
+	res = {}
+	for line in printoutLines:
+		m = re.search(LEVEL_REGEX, line)
+		if m is not None:
+			env = res.setdefault(m.group(1), { 'levels': [], 'limit': None, })
+			env['levels'].append([ int(m.group(i + 2)) for i in range(len(LEVEL_FIELDS)) ])
+			continue
+
+		m = re.search(LIMIT_REGEX, line)
+		if m is not None:
+			env = res.setdefault(m.group(1), { 'levels': [], 'limit': None, })
+			env['limit'] = [ int(m.group(2)), m.group(3) ]
+			continue
+
+	return res
+
+
+def PrintDensityTable(res: Dict[str, dict]) -> None:
+	MB = 1024 * 1024
+
+	header = '| Env | ' + ' | '.join([
+		(f'{x} ({u})' if u != 'bytes' else f'{x} (MB)') if u != '' else x
+			for x, u in LEVEL_FIELDS
+	]) + ' |'
+	print(header)
+	print('|' + '---|' * (len(LEVEL_FIELDS) + 1))
+	for env, envRes in res.items():
+		for level in envRes['levels']:
+			cols = [
+				(f'{v / MB:.3f}' if u == 'bytes' else str(v))
+					for v, (_, u) in zip(level, LEVEL_FIELDS)
+			]
+			print(f'| {env} | ' + ' | '.join(cols) + ' |')
+	for env, envRes in res.items():
+		if envRes['limit'] is not None:
+			print(f'{env}: limit reached at {envRes["limit"][0]} instances ({envRes["limit"][1]})')
+
+
+def SetPriorityAndAffinity() -> None:
+	os.nice(NICE_ADJUST)
+	os.sched_setaffinity(0, AFFINITY)
+
+
+def main() -> None:
+	modulePath = sys.argv[1] if len(sys.argv) > 1 else DEFAULT_MODULE
+
+	cmd = [
+		os.path.join(BENCHMARK_BUILD_DIR, BENCHMARKER_BIN),
+		'density',
+		modulePath,
+		'--pool',       str(POOL_SIZE),
+		'--max-inst',   str(MAX_INSTANCES),
+		'--mod-stack',  str(MOD_STACK_SIZE),
+		'--mod-heap',   str(MOD_HEAP_SIZE),
+		'--exec-stack', str(EXEC_STACK_SIZE),
+	]
+	print(f'Running: {" ".join(cmd)}')
+
+	proc = subprocess.run(
+		cmd,
+		stdout=subprocess.PIPE,
+		stderr=subprocess.PIPE,
+		cwd=BENCHMARK_BUILD_DIR,
+		preexec_fn=lambda : SetPriorityAndAffinity(),
+	)
+	stdout = proc.stdout.decode('utf-8', errors='replace')
+	if proc.returncode != 0:
+		print(stdout)
+		print(proc.stderr.decode('utf-8', errors='replace'))
+		raise RuntimeError('Density benchmark failed')
+
+	res = ParseDensityPrintout(stdout.splitlines())
+	with open(os.path.join(PROJ_BUILD_DIR, 'density.json'), 'w') as f:
+		json.dump({ 'measurement': res, 'raw': stdout, }, f, indent='\t')
+
+	PrintDensityTable(res)
+
+
+if __name__ == '__main__':
+	main()
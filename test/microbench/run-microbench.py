@@ -0,0 +1,383 @@
+#!/usr/bin/env python3
+# -*- coding:utf-8 -*-
+###
+# Copyright (c) 2024 Haofan Zheng
+# Use of this source code is governed by an MIT-style
+# license that can be found in the LICENSE file or at
+# https://opensource.org/licenses/MIT.
+###
+
+
+import json
+import os
+import re
+import statistics
+import subprocess
+import sys
+
+from typing import Dict, List
+
+
+NICE_ADJUST = -20
+AFFINITY = { 3,}
+
+CURR_DIR = os.path.dirname(os.path.abspath(__file__))
+PROJ_BUILD_DIR = os.environ.get(
+	'DECENT_WASM_BUILD_DIR',
+	os.path.join(CURR_DIR, os.pardir, os.pardir, 'build-release')
+)
+BENCHMARK_BUILD_DIR = os.path.join(PROJ_BUILD_DIR, 'src')
+BENCHMARKER_BIN = 'decent_wasm_test'
+WASM_TEST_DIR = os.path.join(CURR_DIR, os.pardir, 'wasm')
+COPY_MODULE = os.path.join(WASM_TEST_DIR, 'test-05', 'test.wasm')
+HOST_CALL_MODULE = os.path.join(WASM_TEST_DIR, 'test-06', 'test.wasm')
+KERNEL_MODULE = os.path.join(WASM_TEST_DIR, 'test-07', 'test.wasm')
+# built with `-msimd128` (`make -C test/wasm simd`)
+KERNEL_SIMD_MODULE = os.path.join(WASM_TEST_DIR, 'test-07', 'test.simd.wasm')
+POLYBENCH_DIR = os.path.join(CURR_DIR, os.pardir, 'polybench')
+AOT_CACHE_DIR = os.path.join(PROJ_BUILD_DIR, 'aot-cache')
+SGX_AOT_CACHE_DIR = os.path.join(PROJ_BUILD_DIR, 'aot-cache-sgx')
+
+# tiers to run each microbenchmark in; 'aot' runs the precompiled module
+# from the AOT caches (`make microbench_aot microbench_aot_sgx`); an env that
+# loaded the bytecode instead (e.g., an enclave built without
+# DECENT_WASM_SGX_AOT) is left out of that tier
+TIERS = [ 'interp', 'fast-jit', 'aot' ]
+# the kernel bench runs PolyBench LARGE_DATASET sizes, which take far too long
+# in the interpreter; 'aot-simd' runs the SIMD build in the AOT tier, the only
+# one that executes SIMD
+KERNEL_TIERS = [ 'fast-jit', 'aot', 'aot-simd' ]
+# runs of each native PolyBench `.app` the kernel bench is compared against
+NATIVE_REPEAT_TIMES = 3
+
+
+def SetPriorityAndAffinity() -> None:
+	os.nice(NICE_ADJUST)
+	os.sched_setaffinity(0, AFFINITY)
+
+
+def RunMicro(modulePath: str, tier: str) -> str:
+	cmd = [
+		os.path.join(BENCHMARK_BUILD_DIR, BENCHMARKER_BIN),
+		'micro',
+		modulePath,
+	]
+	if tier.startswith('aot'):
+		cmd += [
+			'--aot-cache', AOT_CACHE_DIR,
+			'--sgx-aot-cache', SGX_AOT_CACHE_DIR,
+		]
+	else:
+		cmd += [ '--mode', tier ]
+	print(f'Running: {" ".join(cmd)}')
+
+	proc = subprocess.run(
+		cmd,
+		stdout=subprocess.PIPE,
+		stderr=subprocess.PIPE,
+		cwd=BENCHMARK_BUILD_DIR,
+		preexec_fn=lambda : SetPriorityAndAffinity(),
+	)
+	stdout = proc.stdout.decode('utf-8', errors='replace')
+	if proc.returncode != 0:
+		print(stdout)
+		print(proc.stderr.decode('utf-8', errors='replace'))
+		raise RuntimeError('Microbenchmark failed')
+
+	return stdout
+
+
+def ParseModuleFormats(printoutLines: List[str]) -> Dict[str, str]:
+	FORMAT_REGEX = r'\[(\w+)\]\s*Module load \(type=plain\)\s*:\s*' + \
+		r'Format\s*:\s*(\w+)'
+
+	# env -> format of the module it loaded
+	res = {}
+	for line in printoutLines:
+		m = re.search(FORMAT_REGEX, line)
+		if m is not None:
+			res[m.group(1)] = m.group(2)
+
+	return res
+
+
+def DropNonAotEnvs(tier: str, stdout: str, res: Dict[str, dict]) -> Dict[str, dict]:
+	if not tier.startswith('aot'):
+		return res
+
+	formats = ParseModuleFormats(stdout.splitlines())
+	for env in list(res.keys()):
+		if formats.get(env) != 'aot':
+			print(f'Skipped tier={tier}, env={env}: it loaded {formats.get(env, "no module")}')
+			del res[env]
+
+	return res
+
+
+def ParseCopyPrintout(printoutLines: List[str]) -> Dict[str, dict]:
+	COPY_REGEX = r'\[(\w+)\]\s*Copy bench\s*:\s*' + \
+		r'Op\s*:\s*(\w+)\s*,\s*' + \
+		r'Method\s*:\s*(\w+)\s*,\s*' + \
+		r'Size\s*:\s*(\d+)\s*bytes\s*,\s*' + \
+		r'Iterations\s*:\s*(\d+)\s*,\s*' + \
+		r'Time\s*:\s*(\d+)\s*us'
+
+	# env -> op -> method -> size -> [ throughput (MB/s) of each run ]
+	res = {}
+	for line in printoutLines:
+		m = re.search(COPY_REGEX, line)
+		if m is None:
+			continue
+		size = int(m.group(4))
+		iterations = int(m.group(5))
+		timeUs = max(int(m.group(6)), 1)
+		throughput = (size * iterations) / timeUs # bytes/us == MB/s
+		res.setdefault(m.group(1), {}) \
+			.setdefault(m.group(2), {}) \
+			.setdefault(m.group(3), {}) \
+			.setdefault(str(size), []) \
+			.append(throughput)
+
+	return res
+
+
+def ReportCopy(tierResults: Dict[str, dict]) -> None:
+	for tier, res in tierResults.items():
+		for env, ops in res.items():
+			for op, methods in ops.items():
+				print()
+				print(f'{op} throughput (MB/s, median of runs), tier={tier}, env={env}:')
+				methodNames = list(methods.keys())
+				print(f'{"Size (bytes)":>12}: ' + ', '.join([ f'{x:>10}' for x in methodNames ]))
+				sizes = sorted({ int(s) for x in methods.values() for s in x.keys() })
+				for size in sizes:
+					cols = []
+					for method in methodNames:
+						runs = methods[method].get(str(size), [])
+						cols.append(
+							f'{statistics.median(runs):10.1f}' if len(runs) > 0 else f'{"n/a":>10}'
+						)
+					print(f'{size:12}: ' + ', '.join(cols))
+
+
+def RunCopyBench() -> None:
+	tierResults = {}
+	raw = {}
+	for tier in TIERS:
+		stdout = RunMicro(COPY_MODULE, tier)
+		raw[tier] = stdout
+		tierResults[tier] = DropNonAotEnvs(
+			tier, stdout, ParseCopyPrintout(stdout.splitlines())
+		)
+
+	with open(os.path.join(PROJ_BUILD_DIR, 'microbench.copy.json'), 'w') as f:
+		json.dump({ 'measurement': tierResults, 'raw': raw, }, f, indent='\t')
+
+	ReportCopy(tierResults)
+
+
+def ReportCopyFromFile(jsonFilePath: str) -> None:
+	with open(jsonFilePath, 'r') as f:
+		jsonFile = json.load(f)
+
+	ReportCopy(jsonFile['measurement'])
+
+
+def ParseHostCallPrintout(printoutLines: List[str]) -> Dict[str, dict]:
+	HOST_CALL_REGEX = r'\[(\w+)\]\s*Host call bench\s*:\s*' + \
+		r'Native\s*:\s*(\w+)\s*,\s*' + \
+		r'Calls\s*:\s*(\d+)\s*,\s*' + \
+		r'Time\s*:\s*(\d+)\s*us'
+
+	# env -> native -> [ round-trip time (ns/call) of each run ]
+	res = {}
+	for line in printoutLines:
+		m = re.search(HOST_CALL_REGEX, line)
+		if m is None:
+			continue
+		calls = max(int(m.group(3)), 1)
+		nsPerCall = int(m.group(4)) * 1000 / calls
+		res.setdefault(m.group(1), {}) \
+			.setdefault(m.group(2), []) \
+			.append(nsPerCall)
+
+	return res
+
+
+def ReportHostCall(tierResults: Dict[str, dict]) -> None:
+	print()
+	print('Host call round-trip (ns/call, median of runs):')
+	natives = []
+	for res in tierResults.values():
+		for envRes in res.values():
+			natives += [ x for x in envRes.keys() if x not in natives ]
+	print(f'{"Tier":10} {"Env":10}: ' + ', '.join([ f'{x:>10}' for x in natives ]))
+	for tier, res in tierResults.items():
+		for env, envRes in res.items():
+			cols = []
+			for native in natives:
+				runs = envRes.get(native, [])
+				cols.append(
+					f'{statistics.median(runs):10.1f}' if len(runs) > 0 else f'{"n/a":>10}'
+				)
+			print(f'{tier:10} {env:10}: ' + ', '.join(cols))
+
+
+def RunHostCallBench() -> None:
+	tierResults = {}
+	raw = {}
+	for tier in TIERS:
+		stdout = RunMicro(HOST_CALL_MODULE, tier)
+		raw[tier] = stdout
+		tierResults[tier] = DropNonAotEnvs(
+			tier, stdout, ParseHostCallPrintout(stdout.splitlines())
+		)
+
+	with open(os.path.join(PROJ_BUILD_DIR, 'microbench.hostcall.json'), 'w') as f:
+		json.dump({ 'measurement': tierResults, 'raw': raw, }, f, indent='\t')
+
+	ReportHostCall(tierResults)
+
+
+def ReportHostCallFromFile(jsonFilePath: str) -> None:
+	with open(jsonFilePath, 'r') as f:
+		jsonFile = json.load(f)
+
+	ReportHostCall(jsonFile['measurement'])
+
+
+def ParseKernelPrintout(printoutLines: List[str]) -> Dict[str, dict]:
+	KERNEL_REGEX = r'\[(\w+)\]\s*Kernel bench\s*:\s*' + \
+		r'Kernel\s*:\s*([\w-]+)\s*,\s*' + \
+		r'Method\s*:\s*(\w+)\s*,\s*' + \
+		r'Time\s*:\s*(\d+)\s*us'
+
+	# env -> kernel -> method -> [ time (us) of each run ]
+	res = {}
+	for line in printoutLines:
+		m = re.search(KERNEL_REGEX, line)
+		if m is None:
+			continue
+		res.setdefault(m.group(1), {}) \
+			.setdefault(m.group(2), {}) \
+			.setdefault(m.group(3), []) \
+			.append(int(m.group(4)))
+
+	return res
+
+
+def RunNativeKernel(kernel: str) -> List[int]:
+	NATIVE_TIME_REGEX = r'\[Native\]\s*Benchmark stopped.*spent\s*(\d+)\s*us'
+
+	nativePath = os.path.join(POLYBENCH_DIR, kernel + '.app')
+	if not os.path.isfile(nativePath):
+		print(f'Skipped native {kernel}: {nativePath} does not exist')
+		return []
+
+	res = []
+	for _ in range(NATIVE_REPEAT_TIMES):
+		proc = subprocess.run(
+			[ nativePath ],
+			stdout=subprocess.PIPE,
+			stderr=subprocess.PIPE,
+			cwd=POLYBENCH_DIR,
+			preexec_fn=lambda : SetPriorityAndAffinity(),
+		)
+		stdout = proc.stdout.decode('utf-8', errors='replace')
+		for line in stdout.splitlines():
+			m = re.search(NATIVE_TIME_REGEX, line)
+			if m is not None:
+				res.append(int(m.group(1)))
+
+	return res
+
+
+def ReportKernel(tierResults: Dict[str, dict], nativeResults: Dict[str, list]) -> None:
+	for tier, res in tierResults.items():
+		for env, kernels in res.items():
+			print()
+			print(f'Kernel time (ms, median of runs), tier={tier}, env={env}:')
+			print(
+				f'{"Kernel":>10}: {"WASM":>10}, {"Host":>10}, {"Native":>10}, '
+				f'{"WASM/Nat":>9}, {"Host/Nat":>9}'
+			)
+			for kernel, methods in kernels.items():
+				wasmRuns = methods.get('wasm', [])
+				hostRuns = methods.get('host', [])
+				nativeRuns = nativeResults.get(kernel, [])
+				wasm = statistics.median(wasmRuns) if len(wasmRuns) > 0 else None
+				host = statistics.median(hostRuns) if len(hostRuns) > 0 else None
+				native = statistics.median(nativeRuns) if len(nativeRuns) > 0 else None
+
+				cols = []
+				for x in [ wasm, host, native ]:
+					cols.append(f'{x / 1000:10.3f}' if x is not None else f'{"n/a":>10}')
+				for x in [ wasm, host ]:
+					cols.append(
+						f'{x / native:8.2f}x' if (x is not None) and native else f'{"n/a":>9}'
+					)
+				print(f'{kernel:>10}: ' + ', '.join(cols))
+
+
+def RunKernelBench() -> None:
+	tierResults = {}
+	raw = {}
+	for tier in KERNEL_TIERS:
+		module = KERNEL_SIMD_MODULE if tier == 'aot-simd' else KERNEL_MODULE
+		if not os.path.isfile(module):
+			print(f'Skipped tier={tier}: {module} does not exist')
+			continue
+		stdout = RunMicro(module, tier)
+		raw[tier] = stdout
+		tierResults[tier] = DropNonAotEnvs(
+			tier, stdout, ParseKernelPrintout(stdout.splitlines())
+		)
+
+	kernels = []
+	for res in tierResults.values():
+		for envRes in res.values():
+			kernels += [ x for x in envRes.keys() if x not in kernels ]
+	nativeResults = { x: RunNativeKernel(x) for x in kernels }
+
+	with open(os.path.join(PROJ_BUILD_DIR, 'microbench.kernels.json'), 'w') as f:
+		json.dump(
+			{
+				'measurement': { 'tiers': tierResults, 'native': nativeResults, },
+				'raw': raw,
+			},
+			f,
+			indent='\t'
+		)
+
+	ReportKernel(tierResults, nativeResults)
+
+
+def ReportKernelFromFile(jsonFilePath: str) -> None:
+	with open(jsonFilePath, 'r') as f:
+		jsonFile = json.load(f)
+
+	ReportKernel(jsonFile['measurement']['tiers'], jsonFile['measurement']['native'])
+
+
+def main() -> None:
+	if len(sys.argv) > 1 and sys.argv[1] == 'copy':
+		if len(sys.argv) > 2:
+			ReportCopyFromFile(sys.argv[2])
+		else:
+			RunCopyBench()
+	elif len(sys.argv) > 1 and sys.argv[1] == 'hostcall':
+		if len(sys.argv) > 2:
+			ReportHostCallFromFile(sys.argv[2])
+		else:
+			RunHostCallBench()
+	elif len(sys.argv) > 1 and sys.argv[1] == 'kernels':
+		if len(sys.argv) > 2:
+			ReportKernelFromFile(sys.argv[2])
+		else:
+			RunKernelBench()
+	else:
+		print('Usage: run-microbench.py <copy|hostcall|kernels> [<saved json>]')
+
+
+if __name__ == '__main__':
+	main()
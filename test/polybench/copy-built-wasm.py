@@ -58,6 +58,11 @@ FILENAME_FORMATS = [
 	(os.path.join('wasm', '{testname}.wasm'),      '{testname}.wasm'),
 	(os.path.join('wasm', '{testname}.nopt.wasm'), '{testname}.nopt.wasm'),
 ]
+# built with `-msimd128`; copied only if they exist
+OPTIONAL_FILENAME_FORMATS = [
+	(os.path.join('wasm', '{testname}.simd.wasm'),      '{testname}.simd.wasm'),
+	(os.path.join('wasm', '{testname}.simd.nopt.wasm'), '{testname}.simd.nopt.wasm'),
+]
 
 
 TEST_CASES_FILES = [ (ySrc.format(testname=x), yDst.format(testname=x)) for ySrc, yDst in FILENAME_FORMATS for x in TEST_CASES ]
@@ -67,5 +72,16 @@ for srcFilebase, dstFilebase in TEST_CASES_FILES:
 	dst = os.path.join(CURR_DIR, dstFilebase)
 	shutil.copy(src, dst)
 
+OPTIONAL_FILES = [ (ySrc.format(testname=x), yDst.format(testname=x)) for ySrc, yDst in OPTIONAL_FILENAME_FORMATS for x in TEST_CASES ]
+
+numOptionalCopied = 0
+for srcFilebase, dstFilebase in OPTIONAL_FILES:
+	src = os.path.join(COUNTER_POLY_DIR, srcFilebase)
+	dst = os.path.join(CURR_DIR, dstFilebase)
+	if os.path.isfile(src):
+		shutil.copy(src, dst)
+		numOptionalCopied += 1
+
 print(f'Copied {len(TEST_CASES_FILES)} files from {COUNTER_POLY_DIR} to {CURR_DIR}')
+print(f'Copied {numOptionalCopied} optional (SIMD) files')
 
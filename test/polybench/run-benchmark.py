@@ -10,20 +10,64 @@
 
 import json
 import os
+import queue
 import re
+import statistics
 import subprocess
 import sys
+import threading
 import time
 
 from typing import Dict, List, Tuple
 
 NICE_ADJUST = -20
 AFFINITY = { 3,}
+SETTLE_TIME = 5 # seconds to wait after each run for the system to settle down
+# isolated cores (e.g., by `isolcpus=`) used by the `parallel` command, one
+# benchmark process per core at a time
+PARALLEL_CORES = [ 2, 3, 4, 5 ]
+PARALLEL_GOVERNOR = 'performance' # cpufreq governor set on each of them; None to leave as is
+# test cases re-run one at a time after a parallel sweep, to tell whether
+# the concurrent runs interfered with each other
+INTERFERENCE_PROBES = [ 'gemm', 'atax', 'jacobi-2d' ]
+INTERFERENCE_THRESHOLD = 0.05 # slowdown beyond run-to-run noise counted as interference
+WARMUP_TIMES = 2 # should match the one in plot-graph.py
+INIT_LINEAR_MEM_SIZE = 0 # bytes to pre-reserve in linear memory; 0 to disable
+AUTO_SIZE_MARGIN = None # safety margin (%) for auto-sizing instances; None to disable
+PREFAULT = False # touch every page of the pool and linear memories before the runs
+POOL_POPULATE = False # map the pool with MAP_POPULATE (untrusted only)
+POOL_THP = False # advise transparent huge pages for the pool (untrusted only)
+POOL_HUGE_PAGES = False # back the pool with explicit huge pages, or THP as fallback (untrusted only)
+RUNNING_MODE = None # WAMR running mode (e.g., 'interp', 'fast-jit'); None for the default
+RUNNING_MODES = [ 'interp', 'fast-jit', 'aot' ] # tiers compared by the `tiers` command
+SIMD_RUNNING_MODE = 'aot' # tier used by the `simd` command; only AOT (and LLVM JIT) executes SIMD
+PERF_DTLB = False # count dTLB events of the decent_wasm_test process with `perf stat`
+PERF_EVENTS = [
+	'dTLB-loads',
+	'dTLB-load-misses',
+	'dTLB-stores',
+	'dTLB-store-misses',
+]
 
 CURR_DIR = os.path.dirname(os.path.abspath(__file__))
 PROJ_BUILD_DIR = os.path.join(CURR_DIR, os.pardir, os.pardir, 'build-release')
 BENCHMARK_BUILD_DIR = os.path.join(PROJ_BUILD_DIR, 'src')
+# filled by `make decent_wasm_test_hw_bound_check`
+HW_BOUND_CHECK_BUILD_DIR = os.path.join(PROJ_BUILD_DIR, 'hw-bound-check', 'src')
+# filled by `make decent_wasm_test_sw_bound_check`
+SW_BOUND_CHECK_BUILD_DIR = os.path.join(PROJ_BUILD_DIR, 'sw-bound-check', 'src')
+AOT_CACHE_DIR = os.path.join(PROJ_BUILD_DIR, 'aot-cache') # filled by `make polybench_aot`
+SGX_AOT_CACHE_DIR = os.path.join(PROJ_BUILD_DIR, 'aot-cache-sgx') # filled by `make polybench_aot_sgx`
 BENCHMARKER_BIN = 'decent_wasm_test'
+MEM_USAGE_FIELDS = [
+	'Pool total',
+	'Pool used',
+	'Pool peak',
+	'Instance',
+	'Exec env',
+	'Linear memory',
+	'App heap peak',
+]
 TEST_CASES = [
 	# datamining - 2
 	'correlation',
@@ -192,6 +236,9 @@ def TryParseTimeLine(state: dict, line: str) -> bool:
 	if m is None:
 		return False
 	else:
+		if state['currEnv'] == '':
+			# printed by a run that is not measured (e.g., auto-sizing)
+			return True
 		# found the line with time printout
 		if len(state['measurements']) > 0:
 			raise ValueError('Found multiple time printouts in a single test run')
@@ -213,6 +260,9 @@ def TryParseCounterLine(state: dict, line: str) -> bool:
 	if m is None:
 		return False
 	else:
+		if state['currEnv'] == '':
+			# printed by a run that is not measured (e.g., auto-sizing)
+			return True
 		# found the line with counter printout
 		if len(state['measurements']) != 3:
 			raise ValueError('Found counter printout without time printout')
@@ -226,6 +276,98 @@ def TryParseCounterLine(state: dict, line: str) -> bool:
 		return True
 
 
+def TryParseLinearMemLine(state: dict, line: str) -> bool:
+	LINEAR_MEM_REGEX = r'\[(\w+)\]\s*Linear memory:\s*Size\s*:\s*(\d+)\s*bytes\s*,\s*(?:Runs grown|Grows)\s*:\s*(\d+)\s*,\s*Grown\s*:\s*(\d+)\s*bytes\s*,\s*Grow time\s*:\s*(\d+)\s*us'
+
+	m = re.search(LINEAR_MEM_REGEX, line)
+	if m is None:
+		return False
+	else:
+		if state['currEnv'] == '':
+			# printed right after the instantiation, outside of any test run
+			return True
+		assert state['currEnv'] == m.group(1), f'Env mismatch: {state["currEnv"]} != {m.group(1)}'
+		state['linearMem'] = [
+			int(m.group(2)), # size
+			int(m.group(3)), # number of runs that grew it
+			int(m.group(4)), # bytes grown
+			int(m.group(5)), # grow time
+		]
+		return True
+
+
+def TryParseMemUsageLine(state: dict, line: str) -> bool:
+	MEM_USAGE_REGEX = r'\[(\w+)\]\s*Memory usage\s*\(type=(\w+)\)\s*:' + \
+		''.join([ f'\\s*{x}\\s*:\\s*(\\d+)\\s*bytes\\s*,?' for x in MEM_USAGE_FIELDS ])
+
+	m = re.search(MEM_USAGE_REGEX, line)
+	if m is None:
+		return False
+	else:
+		state['res'][m.group(1)]['mem_usage'][m.group(2)] = [
+			int(m.group(i + 3)) for i in range(len(MEM_USAGE_FIELDS))
+		]
+		return True
+
+
+def TryParsePrefaultLine(state: dict, line: str) -> bool:
+	PREFAULT_REGEX = r'\[(\w+)\]\s*Pre-fault\s*\(type=(\w+)\)\s*:\s*(\w+)\s*:\s*(\d+)\s*us'
+
+	m = re.search(PREFAULT_REGEX, line)
+	if m is None:
+		return False
+	else:
+		state['res'][m.group(1)]['prefault'][m.group(2)] = int(m.group(4))
+		return True
+
+
+def TryParsePoolBackingLine(state: dict, line: str) -> bool:
+	POOL_BACKING_REGEX = r'\[(\w+)\]\s*Pool backing\s*:\s*(\w+)'
+
+	m = re.search(POOL_BACKING_REGEX, line)
+	if m is None:
+		return False
+	else:
+		state['res'][m.group(1)]['pool_backing'] = m.group(2)
+		return True
+
+
+def TryParseBoundCheckLine(state: dict, line: str) -> bool:
+	BOUND_CHECK_REGEX = r'\[(\w+)\]\s*Bound check\s*:\s*(\w+)'
+
+	m = re.search(BOUND_CHECK_REGEX, line)
+	if m is None:
+		return False
+	else:
+		state['res'][m.group(1)]['bound_check'] = m.group(2)
+		return True
+
+
+def TryParseRunningModeLine(state: dict, line: str) -> bool:
+	RUNNING_MODE_REGEX = r'\[(\w+)\]\s*Running mode\s*\(type=(\w+)\)\s*:\s*([\w-]+)'
+
+	m = re.search(RUNNING_MODE_REGEX, line)
+	if m is None:
+		return False
+	else:
+		state['res'][m.group(1)]['running_mode'][m.group(2)] = m.group(3)
+		return True
+
+
+def TryParseModuleLoadLine(state: dict, line: str) -> bool:
+	MODULE_LOAD_REGEX = r'\[(\w+)\]\s*Module load\s*\(type=(\w+)\)\s*:\s*Format\s*:\s*(\w+)\s*,\s*Time\s*:\s*(\d+)\s*us'
+
+	m = re.search(MODULE_LOAD_REGEX, line)
+	if m is None:
+		return False
+	else:
+		state['res'][m.group(1)]['module_load'][m.group(2)] = [
+			m.group(3), # format
+			int(m.group(4)), # load time
+		]
+		return True
+
+
 def TryParseEndLine(state: dict, line: str) -> bool:
 	PTYPE_REGEX     = r'\[(\w+)\]\s*Finished to run Decent WASM program\s*\(type=(\w+)\)\.\.\.'
 
@@ -244,11 +386,14 @@ def TryParseEndLine(state: dict, line: str) -> bool:
 		if state['currPType'] == 'instrumented' and len(state['measurements']) != 4:
 			raise ValueError('Found an instrumented test run without counter printout')
 		state['res'][state['currEnv']][state['currPType']].append(state['measurements'])
+		if len(state['linearMem']) > 0:
+			state['res'][state['currEnv']]['linear_mem'][state['currPType']].append(state['linearMem'])
 
 		# reset state
 		state['currEnv'] = ''
 		state['currPType'] = ''
 		state['measurements'] = []
+		state['linearMem'] = []
 
 		return True
 
@@ -263,10 +408,20 @@ def ParseAllEnvTimePrintout(
 			'Untrusted': {
 				'plain': [],
 				'instrumented': [],
+				'linear_mem': { 'plain': [], 'instrumented': [], },
+				'mem_usage': { 'plain': [], 'instrumented': [], },
+				'prefault': {},
+				'running_mode': {},
+				'module_load': {},
 			},
 			'Enclave': {
 				'plain': [],
 				'instrumented': [],
+				'linear_mem': { 'plain': [], 'instrumented': [], },
+				'mem_usage': { 'plain': [], 'instrumented': [], },
+				'prefault': {},
+				'running_mode': {},
+				'module_load': {},
 			},
 			'Native': {
 				'plain': [],
@@ -277,6 +432,7 @@ def ParseAllEnvTimePrintout(
 		'currPType': '',
 
 		'measurements': [],
+		'linearMem': [],
 	}
 
 	for line in printoutLines:
@@ -286,13 +442,74 @@ def ParseAllEnvTimePrintout(
 			continue
 		elif TryParseCounterLine(state, line):
 			continue
+		elif TryParseLinearMemLine(state, line):
+			continue
+		elif TryParseMemUsageLine(state, line):
+			continue
+		elif TryParsePrefaultLine(state, line):
+			continue
+		elif TryParsePoolBackingLine(state, line):
+			continue
+		elif TryParseBoundCheckLine(state, line):
+			continue
+		elif TryParseRunningModeLine(state, line):
+			continue
+		elif TryParseModuleLoadLine(state, line):
+			continue
 		elif TryParseEndLine(state, line):
 			continue
 
 	return state['res']
 
 
-def SetPriorityAndAffinity() -> None:
+def ParsePerfStatPrintout(printoutLines: List[str]) -> Dict[str, int]:
+	# `perf stat -x ,` prints "<count>,<unit>,<event>,..." per event
+	res = {}
+	for line in printoutLines:
+		fields = line.split(',')
+		if len(fields) < 3 or fields[2] not in PERF_EVENTS:
+			continue
+		try:
+			res[fields[2]] = int(fields[0])
+		except ValueError:
+			# <not supported> or <not counted>
+			pass
+	return res
+
+
+def ReportWarmupCost(measurements: dict) -> None:
+	print()
+	print('First iteration vs. steady state '
+		f'(steady state = median after {WARMUP_TIMES} warmup iterations):')
+	for testCase, results in measurements.items():
+		for env, groups in results[0].items():
+			for group in [ 'plain', 'instrumented' ]:
+				if group not in groups or len(groups[group]) <= WARMUP_TIMES:
+					continue
+
+				durations = [ x[2] for x in groups[group] ]
+				steady = statistics.median(durations[WARMUP_TIMES:])
+				first = durations[0]
+				hidden = sum(durations[:WARMUP_TIMES]) - (steady * WARMUP_TIMES)
+
+				outStr = (
+					f'{testCase:20} {env:10} {group:13}: '
+					f'First {first / 1000:10.3f}ms, '
+					f'Steady {steady / 1000:10.3f}ms, '
+					f'Ratio {first / steady:6.2f}, '
+					f'Hidden by warmup {hidden / 1000:10.3f}ms'
+				)
+
+				linearMem = groups.get('linear_mem', {}).get(group, [])
+				if len(linearMem) > 0:
+					outStr += (
+						f', First grown {linearMem[0][2]:10d} bytes, '
+						f'Later grown {sum([ x[2] for x in linearMem[1:] ]):10d} bytes'
+					)
+				print(outStr)
+
+
+def SetPriorityAndAffinity(affinity: set = AFFINITY) -> None:
 	# Set nice
 	os.nice(NICE_ADJUST)
 
@@ -301,25 +518,29 @@ def SetPriorityAndAffinity() -> None:
 	os.sched_setscheduler(0, os.SCHED_FIFO, schedParam)
 
 	# Set affinity
-	os.sched_setaffinity(0, AFFINITY)
+	os.sched_setaffinity(0, affinity)
 
 
-def RunProgram(cmd: List[str]) -> Tuple[str, str, int]:
+def RunProgram(
+	cmd: List[str],
+	cwd: str = BENCHMARK_BUILD_DIR,
+	affinity: set = AFFINITY,
+) -> Tuple[str, str, int]:
 	cmdStr = ' '.join(cmd)
-	print(f'Running: {cmdStr}')
+	print(f'Running (cores {sorted(affinity)}): {cmdStr}')
 
 	with subprocess.Popen(
 		cmd,
 		stdout=subprocess.PIPE,
 		stderr=subprocess.PIPE,
-		cwd=BENCHMARK_BUILD_DIR,
-		preexec_fn=lambda : SetPriorityAndAffinity(),
+		cwd=cwd,
+		preexec_fn=lambda : SetPriorityAndAffinity(affinity),
 	) as proc:
 		stdout, stderr = proc.communicate()
 		stdout = stdout.decode('utf-8', errors='replace')
 		stderr = stderr.decode('utf-8', errors='replace')
 
-		time.sleep(5) # Wait for the system to settle down
+		time.sleep(SETTLE_TIME) # Wait for the system to settle down
 
 		if proc.returncode != 0:
 			print('Benchmark failed')
@@ -341,32 +562,78 @@ def RunProgram(cmd: List[str]) -> Tuple[str, str, int]:
 		return stdout, stderr, proc.returncode
 
 
-def RunTestsAndCollectData() -> None:
+def BuildDecentCmd(
+	wasmPath: str,
+	runningMode: str,
+	buildDir: str,
+) -> List[str]:
+	decentCmd = [
+		os.path.join(buildDir, BENCHMARKER_BIN),
+		wasmPath + '.wasm',
+		wasmPath + '.nopt.wasm',
+	]
+	if INIT_LINEAR_MEM_SIZE > 0:
+		decentCmd += [ '--init-mem', str(INIT_LINEAR_MEM_SIZE) ]
+	if AUTO_SIZE_MARGIN is not None:
+		decentCmd += [ '--auto-size', str(AUTO_SIZE_MARGIN) ]
+	if PREFAULT:
+		decentCmd += [ '--prefault' ]
+	if POOL_POPULATE:
+		decentCmd += [ '--populate' ]
+	if POOL_THP:
+		decentCmd += [ '--thp' ]
+	if POOL_HUGE_PAGES:
+		decentCmd += [ '--huge-pages' ]
+	if runningMode == 'aot':
+		decentCmd += [
+			'--aot-cache', AOT_CACHE_DIR,
+			'--sgx-aot-cache', SGX_AOT_CACHE_DIR,
+		]
+	elif runningMode is not None:
+		decentCmd += [ '--mode', runningMode ]
+	if PERF_DTLB:
+		# NOTE: the counts cover the whole process, i.e., both the
+		# untrusted and the enclave runs
+		decentCmd = [
+			'perf', 'stat', '-x', ',', '-e', ','.join(PERF_EVENTS), '--',
+		] + decentCmd
+
+	return decentCmd
+
+
+def RunTestsAndCollectData(
+	runningMode: str = RUNNING_MODE,
+	outputFileName: str = 'benchmark.json',
+	buildDir: str = BENCHMARK_BUILD_DIR,
+	wasmVariant: str = '',
+) -> dict:
 	REPEAT_TIMES = 1
 
 	output = {
 		'measurement': {},
 		'raw': {},
+		'perf': {},
 	}
 
 	for testCase in TEST_CASES:
 		testCasePath = os.path.join(CURR_DIR, testCase)
-		benchmarkPath = os.path.join(BENCHMARK_BUILD_DIR, BENCHMARKER_BIN)
+		wasmPath = testCasePath + wasmVariant
 		nativePath = os.path.join(CURR_DIR, testCase + '.app')
 
+		if not os.path.isfile(wasmPath + '.wasm'):
+			# e.g., no SIMD variant is built for this test case
+			print(f'Skipped {testCase}: {wasmPath}.wasm does not exist')
+			continue
+
 		output['raw'][testCase] = []
 		output['measurement'][testCase] = []
+		output['perf'][testCase] = []
 
-		decentCmd = [
-			benchmarkPath,
-			testCasePath + '.wasm',
-			testCasePath + '.nopt.wasm',
-		]
-
+		decentCmd = BuildDecentCmd(wasmPath, runningMode, buildDir)
 		nativeCmd = [ nativePath ]
 
 		for i in range(REPEAT_TIMES):
-				decentStdout, decentStderr, decentRetcode = RunProgram(decentCmd)
+				decentStdout, decentStderr, decentRetcode = RunProgram(decentCmd, buildDir)
 				nativeStdout, nativeStderr, nativeRetcode = RunProgram(nativeCmd)
 
 				stdout = decentStdout + '\n' + nativeStdout
@@ -380,11 +647,20 @@ def RunTestsAndCollectData() -> None:
 				})
 				printoutLines = stdout.splitlines()
 				output['measurement'][testCase].append(ParseAllEnvTimePrintout(printoutLines))
+				output['perf'][testCase].append(
+					ParsePerfStatPrintout(decentStderr.splitlines())
+				)
 
 
-		with open(os.path.join(PROJ_BUILD_DIR, 'benchmark.json'), 'w') as f:
+		with open(os.path.join(PROJ_BUILD_DIR, outputFileName), 'w') as f:
 			json.dump(output, f, indent='\t')
 
+	ReportWarmupCost(output['measurement'])
+	ReportMemUsage(output['measurement'])
+	ReportStartupCost(output['measurement'])
+
+	return output
+
 
 def ReProcRawData(jsonFilePath: str) -> None:
 	with open(jsonFilePath, 'r') as f:
@@ -393,24 +669,607 @@ def ReProcRawData(jsonFilePath: str) -> None:
 	rawData = jsonFile['raw']
 
 	newMeasurements = {}
+	newPerf = {}
 
 	for testCase, results in rawData.items():
 		newMeasurements[testCase] = []
+		newPerf[testCase] = []
 		for repeatRes in results:
 			printoutLines = repeatRes['stdout'].splitlines()
 			newMeasurements[testCase].append(ParseAllEnvTimePrintout(printoutLines))
+			newPerf[testCase].append(
+				ParsePerfStatPrintout(repeatRes['stderr'].splitlines())
+			)
 
 	jsonFile['measurement'] = newMeasurements
+	jsonFile['perf'] = newPerf
 
 	with open(jsonFilePath, 'w') as f:
 		json.dump(jsonFile, f, indent='\t')
 
 
+def ReportWarmupFromFile(jsonFilePath: str) -> None:
+	with open(jsonFilePath, 'r') as f:
+		jsonFile = json.load(f)
+
+	ReportWarmupCost(jsonFile['measurement'])
+
+
+def ReportMemUsage(measurements: dict) -> None:
+	MB = 1024 * 1024
+
+	print()
+	print('Memory usage summary (MB):')
+	header = f'{"":20} {"":10} {"":13}: ' + ', '.join([ f'{x:>13}' for x in MEM_USAGE_FIELDS ])
+	print(header)
+	peakPool = 0
+	for testCase, results in measurements.items():
+		for env, groups in results[0].items():
+			for group, usage in groups.get('mem_usage', {}).items():
+				if len(usage) == 0:
+					continue
+				peakPool = max(peakPool, usage[MEM_USAGE_FIELDS.index('Pool peak')])
+				print(
+					f'{testCase:20} {env:10} {group:13}: ' +
+					', '.join([ f'{x / MB:13.3f}' for x in usage ])
+				)
+	print(f'Highest pool peak across all test cases: {peakPool / MB:.3f} MB')
+
+
+def ReportMemUsageFromFile(jsonFilePath: str) -> None:
+	with open(jsonFilePath, 'r') as f:
+		jsonFile = json.load(f)
+
+	ReportMemUsage(jsonFile['measurement'])
+
+
+def ReportStartupCost(measurements: dict) -> None:
+	print()
+	print('Pre-fault start-up cost (ms):')
+	for testCase, results in measurements.items():
+		for env, groups in results[0].items():
+			prefault = groups.get('prefault', {})
+			if len(prefault) == 0:
+				continue
+			print(
+				f'{testCase:20} {env:10}: ' +
+				', '.join([ f'{k} {v / 1000:10.3f}' for k, v in prefault.items() ]) +
+				f', Total {sum(prefault.values()) / 1000:10.3f}'
+			)
+
+
+def ReportStartupCostFromFile(jsonFilePath: str) -> None:
+	with open(jsonFilePath, 'r') as f:
+		jsonFile = json.load(f)
+
+	ReportStartupCost(jsonFile['measurement'])
+
+
+def ReportTierComparison(tierMeasurements: Dict[str, dict]) -> None:
+	tiers = list(tierMeasurements.keys())
+	testCases = list(tierMeasurements[tiers[0]].keys())
+
+	def SteadyState(envRes: dict, group: str) -> float:
+		runs = envRes[group]
+		return statistics.median([ x[2] for x in runs[WARMUP_TIMES:] ])
+
+	def EndToEnd(envRes: dict, group: str) -> float:
+		# module load (incl. JIT compilation) + the first, cold, run
+		runs = envRes[group]
+		load = envRes.get('module_load', {}).get(group, [ '', 0 ])
+		return load[1] + runs[0][2]
+
+	for title, func in [
+		('Steady state runtime', SteadyState),
+		('End-to-end latency (module load + first run)', EndToEnd),
+	]:
+		print()
+		print(f'{title} (ms) per execution tier:')
+		print(f'{"":20} {"":10} {"":13}: ' + ', '.join([ f'{x:>16}' for x in tiers ]))
+		for testCase in testCases:
+			for env in [ 'Untrusted', 'Enclave' ]:
+				for group in [ 'plain', 'instrumented' ]:
+					cols = []
+					for tier in tiers:
+						results = tierMeasurements[tier].get(testCase, [])
+						envRes = results[0][env] if len(results) > 0 else { group: [] }
+						if len(envRes[group]) <= WARMUP_TIMES:
+							cols.append(f'{"n/a":>16}')
+							continue
+						# the tier that actually ran, as reported by the runtime
+						ran = envRes.get('running_mode', {}).get(group, '?')
+						mark = '' if ran == tier else '*'
+						cols.append((f'{func(envRes, group) / 1000:.3f}' + mark).rjust(16))
+					print(f'{testCase:20} {env:10} {group:13}: ' + ', '.join(cols))
+		print('(* the runtime reported a running mode different from the one requested)')
+
+
+def RunTiersAndCompare() -> None:
+	tierMeasurements = {}
+	for tier in RUNNING_MODES:
+		output = RunTestsAndCollectData(tier, f'benchmark.{tier}.json')
+		tierMeasurements[tier] = output['measurement']
+
+	ReportTierComparison(tierMeasurements)
+
+
+def ReportTiersFromFiles(jsonFilePaths: List[str]) -> None:
+	tierMeasurements = {}
+	for jsonFilePath in jsonFilePaths:
+		with open(jsonFilePath, 'r') as f:
+			jsonFile = json.load(f)
+		# benchmark.<tier>.json
+		tier = os.path.basename(jsonFilePath).split('.')[-2]
+		tierMeasurements[tier] = jsonFile['measurement']
+
+	ReportTierComparison(tierMeasurements)
+
+
+def ReportHugePageDelta(baseJsonPath: str, hugeJsonPath: str) -> None:
+	# compares two benchmark.json files, e.g., one run without and one
+	# with POOL_HUGE_PAGES
+	with open(baseJsonPath, 'r') as f:
+		base = json.load(f)
+	with open(hugeJsonPath, 'r') as f:
+		huge = json.load(f)
+
+	print()
+	print('Huge page pool vs. regular pool (steady state runtime, dTLB misses):')
+	for testCase, hugeResults in huge['measurement'].items():
+		if testCase not in base['measurement']:
+			continue
+		baseResults = base['measurement'][testCase]
+		for env in [ 'Untrusted', 'Enclave' ]:
+			for group in [ 'plain', 'instrumented' ]:
+				baseRuns = baseResults[0][env][group]
+				hugeRuns = hugeResults[0][env][group]
+				if len(baseRuns) <= WARMUP_TIMES or len(hugeRuns) <= WARMUP_TIMES:
+					continue
+				baseSteady = statistics.median([ x[2] for x in baseRuns[WARMUP_TIMES:] ])
+				hugeSteady = statistics.median([ x[2] for x in hugeRuns[WARMUP_TIMES:] ])
+				print(
+					f'{testCase:20} {env:10} {group:13}: '
+					f'Regular {baseSteady / 1000:10.3f}ms, '
+					f'Huge {hugeSteady / 1000:10.3f}ms, '
+					f'Delta {(hugeSteady - baseSteady) * 100 / baseSteady:7.2f}%, '
+					f'Backing {hugeResults[0][env].get("pool_backing", "?")}'
+				)
+
+		basePerf = base.get('perf', {}).get(testCase, [])
+		hugePerf = huge.get('perf', {}).get(testCase, [])
+		if len(basePerf) == 0 or len(hugePerf) == 0:
+			continue
+		for event in PERF_EVENTS:
+			if event not in basePerf[0] or event not in hugePerf[0]:
+				continue
+			baseCount = basePerf[0][event]
+			hugeCount = hugePerf[0][event]
+			reduction = ((baseCount - hugeCount) * 100 / baseCount) if baseCount > 0 else 0.0
+			print(
+				f'{testCase:20} {event:20}: '
+				f'Regular {baseCount:15d}, Huge {hugeCount:15d}, '
+				f'Reduction {reduction:7.2f}%'
+			)
+
+
+def ReportBoundCheckSpeedup(swMeasurements: dict, hwMeasurements: dict) -> None:
+	# only the untrusted runtime differs between the two builds
+	print()
+	print('Hardware vs. software bounds checks (Untrusted, steady state runtime):')
+	speedups = { 'plain': [], 'instrumented': [] }
+	for testCase, hwResults in hwMeasurements.items():
+		if testCase not in swMeasurements:
+			continue
+		swRes = swMeasurements[testCase][0]['Untrusted']
+		hwRes = hwResults[0]['Untrusted']
+		for group in [ 'plain', 'instrumented' ]:
+			swRuns = swRes[group]
+			hwRuns = hwRes[group]
+			if len(swRuns) <= WARMUP_TIMES or len(hwRuns) <= WARMUP_TIMES:
+				continue
+			swSteady = statistics.median([ x[2] for x in swRuns[WARMUP_TIMES:] ])
+			hwSteady = statistics.median([ x[2] for x in hwRuns[WARMUP_TIMES:] ])
+			speedup = swSteady / hwSteady
+			speedups[group].append(speedup)
+			print(
+				f'{testCase:20} {group:13}: '
+				f'SW ({swRes.get("bound_check", "?")}) {swSteady / 1000:10.3f}ms, '
+				f'HW ({hwRes.get("bound_check", "?")}) {hwSteady / 1000:10.3f}ms, '
+				f'Speedup {speedup:6.3f}x'
+			)
+	for group, values in speedups.items():
+		if len(values) == 0:
+			continue
+		print(f'Geometric mean speedup ({group}): {statistics.geometric_mean(values):6.3f}x')
+
+
+def RunBoundChecksAndCompare() -> None:
+	swOutput = RunTestsAndCollectData(
+		RUNNING_MODE,
+		'benchmark.sw-bound-check.json',
+		SW_BOUND_CHECK_BUILD_DIR,
+	)
+	hwOutput = RunTestsAndCollectData(
+		RUNNING_MODE,
+		'benchmark.hw-bound-check.json',
+		HW_BOUND_CHECK_BUILD_DIR,
+	)
+
+	ReportBoundCheckSpeedup(swOutput['measurement'], hwOutput['measurement'])
+
+
+def ReportBoundChecksFromFiles(swJsonPath: str, hwJsonPath: str) -> None:
+	with open(swJsonPath, 'r') as f:
+		sw = json.load(f)
+	with open(hwJsonPath, 'r') as f:
+		hw = json.load(f)
+
+	ReportBoundCheckSpeedup(sw['measurement'], hw['measurement'])
+
+
+def ReportSimdComparison(scalarMeasurements: dict, simdMeasurements: dict) -> None:
+	def SteadyState(runs: list) -> float:
+		return statistics.median([ x[2] for x in runs[WARMUP_TIMES:] ])
+
+	print()
+	print('Scalar vs. SIMD WASM vs. native (steady state runtime of the plain program):')
+	for testCase, simdResults in simdMeasurements.items():
+		if testCase not in scalarMeasurements:
+			continue
+		scalarRes = scalarMeasurements[testCase][0]
+		simdRes = simdResults[0]
+		nativeRuns = simdRes['Native']['plain']
+		native = SteadyState(nativeRuns) if len(nativeRuns) > WARMUP_TIMES else None
+		for env in [ 'Untrusted', 'Enclave' ]:
+			# e.g., an enclave built without DECENT_WASM_SGX_AOT loads the
+			# bytecode, so its runs aren't comparable, or aren't SIMD at all
+			formats = [
+				x[env]['module_load'].get('plain', [ 'none' ])[0]
+				for x in [ scalarRes, simdRes ]
+			]
+			if formats != [ 'aot', 'aot' ]:
+				print(
+					f'{testCase:20} {env:10}: skipped, '
+					f'loaded scalar={formats[0]}, SIMD={formats[1]}'
+				)
+				continue
+			scalarRuns = scalarRes[env]['plain']
+			simdRuns = simdRes[env]['plain']
+			if len(scalarRuns) <= WARMUP_TIMES or len(simdRuns) <= WARMUP_TIMES:
+				continue
+			scalar = SteadyState(scalarRuns)
+			simd = SteadyState(simdRuns)
+			line = (
+				f'{testCase:20} {env:10}: '
+				f'Scalar {scalar / 1000:10.3f}ms, '
+				f'SIMD {simd / 1000:10.3f}ms, '
+				f'Speedup {scalar / simd:6.3f}x'
+			)
+			if native is not None:
+				line += (
+					f', Native {native / 1000:10.3f}ms, '
+					f'SIMD/Native {simd / native:6.3f}x'
+				)
+			print(line)
+
+
+def RunSimdAndCompare() -> None:
+	scalarOutput = RunTestsAndCollectData(
+		SIMD_RUNNING_MODE,
+		'benchmark.scalar.json',
+	)
+	simdOutput = RunTestsAndCollectData(
+		SIMD_RUNNING_MODE,
+		'benchmark.simd.json',
+		wasmVariant='.simd',
+	)
+
+	ReportSimdComparison(scalarOutput['measurement'], simdOutput['measurement'])
+
+
+def ReportSimdFromFiles(scalarJsonPath: str, simdJsonPath: str) -> None:
+	with open(scalarJsonPath, 'r') as f:
+		scalar = json.load(f)
+	with open(simdJsonPath, 'r') as f:
+		simd = json.load(f)
+
+	ReportSimdComparison(scalar['measurement'], simd['measurement'])
+
+
+def ParseCpuList(cpuList: str) -> set:
+	# e.g., "2-5,7" as in /sys/devices/system/cpu/isolated
+	res = set()
+	for part in cpuList.strip().split(','):
+		if part == '':
+			continue
+		bounds = part.split('-')
+		res.update(range(int(bounds[0]), int(bounds[-1]) + 1))
+	return res
+
+
+def ReadCoreFreqState(core: int) -> Dict[str, str]:
+	cpufreqDir = f'/sys/devices/system/cpu/cpu{core}/cpufreq'
+	res = {}
+	for name in [
+		'scaling_governor',
+		'scaling_cur_freq',
+		'scaling_min_freq',
+		'scaling_max_freq',
+	]:
+		try:
+			with open(os.path.join(cpufreqDir, name), 'r') as f:
+				res[name] = f.read().strip()
+		except OSError:
+			res[name] = None
+	return res
+
+
+def PrepareParallelCores() -> Dict[str, dict]:
+	try:
+		with open('/sys/devices/system/cpu/isolated', 'r') as f:
+			isolated = ParseCpuList(f.read())
+	except OSError:
+		isolated = set()
+	notIsolated = [ x for x in PARALLEL_CORES if x not in isolated ]
+	if len(notIsolated) > 0:
+		print(f'WARNING: cores {notIsolated} are not isolated (see isolcpus=); '
+			'other tasks may be scheduled on them')
+
+	if PARALLEL_GOVERNOR is not None:
+		for core in PARALLEL_CORES:
+			governorPath = \
+				f'/sys/devices/system/cpu/cpu{core}/cpufreq/scaling_governor'
+			try:
+				with open(governorPath, 'w') as f:
+					f.write(PARALLEL_GOVERNOR)
+			except OSError:
+				print(f'WARNING: failed to set the governor of core {core}')
+
+	return { str(x): ReadCoreFreqState(x) for x in PARALLEL_CORES }
+
+
+def ParallelWorker(
+	core: int,
+	jobs: queue.Queue,
+	results: dict,
+	errors: list,
+) -> None:
+	while True:
+		try:
+			testCase, kind, cmd, cwd = jobs.get_nowait()
+		except queue.Empty:
+			return
+		try:
+			freqBefore = ReadCoreFreqState(core)['scaling_cur_freq']
+			stdout, stderr, retcode = RunProgram(cmd, cwd, { core, })
+			results[(testCase, kind)] = {
+				'stdout': stdout,
+				'stderr': stderr,
+				'returncode': retcode,
+				'core': core,
+				'freq_before': freqBefore,
+				'freq_after': ReadCoreFreqState(core)['scaling_cur_freq'],
+			}
+		except Exception as e:
+			errors.append(f'{testCase} ({kind}) on core {core}: {e}')
+
+
+def SteadyStateRuns(runs: list) -> List[int]:
+	return [ x[2] for x in runs[WARMUP_TIMES:] ]
+
+
+def DetectInterference(
+	parallelMeasurements: dict,
+	isolatedMeasurements: dict,
+) -> Dict[str, dict]:
+	# a probe is interfered with if it ran slower in the parallel sweep than
+	# alone, by more than both the threshold and its own run-to-run noise
+	res = {}
+	for testCase, isolatedResults in isolatedMeasurements.items():
+		if testCase not in parallelMeasurements:
+			continue
+		for env, groups in isolatedResults[0].items():
+			for group in [ 'plain', 'instrumented' ]:
+				isolatedRuns = SteadyStateRuns(groups.get(group, []))
+				parallelRuns = SteadyStateRuns(
+					parallelMeasurements[testCase][0][env].get(group, [])
+				)
+				if len(isolatedRuns) == 0 or len(parallelRuns) == 0:
+					continue
+				isolated = statistics.median(isolatedRuns)
+				parallel = statistics.median(parallelRuns)
+				noise = (max(isolatedRuns) - min(isolatedRuns)) / isolated
+				slowdown = (parallel - isolated) / isolated
+				res.setdefault(testCase, {}).setdefault(env, {})[group] = {
+					'isolated': isolated,
+					'parallel': parallel,
+					'slowdown': slowdown,
+					'noise': noise,
+					'interfered': slowdown > max(INTERFERENCE_THRESHOLD, noise),
+				}
+	return res
+
+
+def ReportInterference(interference: Dict[str, dict]) -> None:
+	print()
+	print(f'Interference of the parallel sweep on {PARALLEL_CORES} '
+		'(steady state runtime, parallel vs. alone):')
+	interfered = 0
+	total = 0
+	for testCase, envs in interference.items():
+		for env, groups in envs.items():
+			for group, res in groups.items():
+				total += 1
+				interfered += 1 if res['interfered'] else 0
+				print(
+					f'{testCase:20} {env:10} {group:13}: '
+					f'Alone {res["isolated"] / 1000:10.3f}ms, '
+					f'Parallel {res["parallel"] / 1000:10.3f}ms, '
+					f'Slowdown {res["slowdown"] * 100:7.2f}%, '
+					f'Noise {res["noise"] * 100:6.2f}%' +
+					(' INTERFERED' if res['interfered'] else '')
+				)
+	if interfered > 0:
+		print(f'Interference detected in {interfered} of {total} probes; '
+			'use fewer cores, or cores that share less (e.g., no SMT siblings)')
+	else:
+		print(f'No measurable interference in {total} probes')
+
+
+def RunParallelSweep(
+	runningMode: str = RUNNING_MODE,
+	outputFileName: str = 'benchmark.parallel.json',
+	buildDir: str = BENCHMARK_BUILD_DIR,
+) -> dict:
+	coreState = PrepareParallelCores()
+
+	jobs = queue.Queue()
+	testCases = []
+	# the decent runs go first, since they take longer than the native ones
+	for kind in [ 'decent', 'native' ]:
+		for testCase in TEST_CASES:
+			wasmPath = os.path.join(CURR_DIR, testCase)
+			if not os.path.isfile(wasmPath + '.wasm'):
+				print(f'Skipped {testCase}: {wasmPath}.wasm does not exist')
+				continue
+			if kind == 'decent':
+				testCases.append(testCase)
+				jobs.put((testCase, kind, BuildDecentCmd(wasmPath, runningMode, buildDir), buildDir))
+			else:
+				jobs.put((testCase, kind, [ wasmPath + '.app' ], BENCHMARK_BUILD_DIR))
+
+	results = {}
+	errors = []
+	startTime = time.time()
+	workers = [
+		threading.Thread(target=ParallelWorker, args=(x, jobs, results, errors))
+		for x in PARALLEL_CORES
+	]
+	for worker in workers:
+		worker.start()
+	for worker in workers:
+		worker.join()
+	sweepTime = time.time() - startTime
+	if len(errors) > 0:
+		raise RuntimeError('Benchmark failed: ' + '; '.join(errors))
+
+	# merged into the same schema as a sequential sweep
+	output = {
+		'measurement': {},
+		'raw': {},
+		'perf': {},
+		'parallel': {
+			'cores': coreState,
+			'cores_after': { str(x): ReadCoreFreqState(x) for x in PARALLEL_CORES },
+			'sweep_time': sweepTime,
+			'runs': {},
+		},
+	}
+	for testCase in testCases:
+		decent = results[(testCase, 'decent')]
+		native = results[(testCase, 'native')]
+		stdout = decent['stdout'] + '\n' + native['stdout']
+		output['raw'][testCase] = [ {
+			'stdout': stdout,
+			'stderr': decent['stderr'] + '\n' + native['stderr'],
+			'returncode': decent['returncode'],
+		} ]
+		output['measurement'][testCase] = [ ParseAllEnvTimePrintout(stdout.splitlines()) ]
+		output['perf'][testCase] = [ ParsePerfStatPrintout(decent['stderr'].splitlines()) ]
+		output['parallel']['runs'][testCase] = {
+			kind: {
+				'core': res['core'],
+				'freq_before': res['freq_before'],
+				'freq_after': res['freq_after'],
+			}
+			for kind, res in [ ('decent', decent), ('native', native) ]
+		}
+
+	# the probes again, one at a time, with the other cores idle
+	isolated = { 'measurement': {}, 'raw': {}, }
+	for testCase in INTERFERENCE_PROBES:
+		if testCase not in testCases:
+			continue
+		wasmPath = os.path.join(CURR_DIR, testCase)
+		decentStdout, _, _ = RunProgram(
+			BuildDecentCmd(wasmPath, runningMode, buildDir),
+			buildDir,
+			{ PARALLEL_CORES[0], },
+		)
+		nativeStdout, _, _ = RunProgram(
+			[ wasmPath + '.app' ],
+			BENCHMARK_BUILD_DIR,
+			{ PARALLEL_CORES[0], },
+		)
+		stdout = decentStdout + '\n' + nativeStdout
+		isolated['raw'][testCase] = stdout
+		isolated['measurement'][testCase] = [ ParseAllEnvTimePrintout(stdout.splitlines()) ]
+	output['parallel']['isolated'] = isolated
+	output['parallel']['interference'] = DetectInterference(
+		output['measurement'],
+		isolated['measurement'],
+	)
+
+	with open(os.path.join(PROJ_BUILD_DIR, outputFileName), 'w') as f:
+		json.dump(output, f, indent='\t')
+
+	print()
+	print(f'Parallel sweep on {len(PARALLEL_CORES)} cores took {sweepTime:.1f} s')
+	ReportWarmupCost(output['measurement'])
+	ReportInterference(output['parallel']['interference'])
+
+	return output
+
+
+def ReportParallelFromFile(jsonFilePath: str) -> None:
+	with open(jsonFilePath, 'r') as f:
+		jsonFile = json.load(f)
+
+	print(f'Parallel sweep took {jsonFile["parallel"]["sweep_time"]:.1f} s')
+	ReportInterference(jsonFile['parallel']['interference'])
+
+
 def main() -> None:
 	if len(sys.argv) > 1:
 		if sys.argv[1] == 'reproc':
 			ReProcRawData(sys.argv[2])
 			return
+		elif sys.argv[1] == 'warmup':
+			ReportWarmupFromFile(sys.argv[2])
+			return
+		elif sys.argv[1] == 'memusage':
+			ReportMemUsageFromFile(sys.argv[2])
+			return
+		elif sys.argv[1] == 'tiers':
+			if len(sys.argv) > 2:
+				ReportTiersFromFiles(sys.argv[2:])
+			else:
+				RunTiersAndCompare()
+			return
+		elif sys.argv[1] == 'hugepage':
+			ReportHugePageDelta(sys.argv[2], sys.argv[3])
+			return
+		elif sys.argv[1] == 'boundcheck':
+			if len(sys.argv) > 3:
+				ReportBoundChecksFromFiles(sys.argv[2], sys.argv[3])
+			else:
+				RunBoundChecksAndCompare()
+			return
+		elif sys.argv[1] == 'simd':
+			if len(sys.argv) > 3:
+				ReportSimdFromFiles(sys.argv[2], sys.argv[3])
+			else:
+				RunSimdAndCompare()
+			return
+		elif sys.argv[1] == 'parallel':
+			if len(sys.argv) > 2:
+				ReportParallelFromFile(sys.argv[2])
+			else:
+				RunParallelSweep()
+			return
+		elif sys.argv[1] == 'startup':
+			ReportStartupCostFromFile(sys.argv[2])
+			return
 		else:
 			print('Unknown command')
 			return
@@ -0,0 +1,234 @@
+#!/usr/bin/env python3
+# -*- coding:utf-8 -*-
+###
+# Copyright (c) 2024 Haofan Zheng
+# Use of this source code is governed by an MIT-style
+# license that can be found in the LICENSE file or at
+# https://opensource.org/licenses/MIT.
+###
+
+
+import json
+import os
+import socket
+import statistics
+import sys
+import threading
+import time
+
+from typing import Dict, List
+
+
+CURR_DIR = os.path.dirname(os.path.abspath(__file__))
+PROJ_BUILD_DIR = os.environ.get(
+	'DECENT_WASM_BUILD_DIR',
+	os.path.join(CURR_DIR, os.pardir, os.pardir, 'build-release')
+)
+# the socket given to `decent_wasm_test server <socket path>`
+SERVER_SOCKET = os.environ.get(
+	'DECENT_WASM_SERVER_SOCKET',
+	os.path.join(PROJ_BUILD_DIR, 'src', 'decent_wasm_server.sock')
+)
+
+DEFAULT_ENV = 'enclave'
+DEFAULT_NUM_JOBS = 1000
+DEFAULT_NUM_CLIENTS = 1
+
+
+class ServerConnection(object):
+
+	def __init__(self, path: str) -> None:
+		self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+		self.sock.connect(path)
+		self.pending = b''
+
+	def Close(self) -> None:
+		self.sock.close()
+
+	def Request(self, line: str) -> Dict[str, str]:
+		self.sock.sendall(line.encode('utf-8') + b'\n')
+		while b'\n' not in self.pending:
+			data = self.sock.recv(4096)
+			if len(data) == 0:
+				raise RuntimeError('The server closed the connection')
+			self.pending += data
+		respLine, self.pending = self.pending.split(b'\n', 1)
+		return ParseResponse(respLine.decode('utf-8', errors='replace'))
+
+
+def ParseResponse(line: str) -> Dict[str, str]:
+	# `msg` takes the rest of the line
+	msgIdx = line.find(' msg=')
+	msg = None
+	if msgIdx >= 0:
+		msg = line[msgIdx + len(' msg='):]
+		line = line[:msgIdx]
+
+	res = dict([ x.split('=', 1) for x in line.split() ])
+	if msg is not None:
+		res['msg'] = msg
+	return res
+
+
+def BuildRunRequest(module: str, env: str) -> str:
+	if module.startswith('bundle:'):
+		target = f'bundle={module[len("bundle:"):]}'
+	else:
+		target = f'module={os.path.abspath(module)}'
+	return f'run {target} env={env}'
+
+
+def CheckResponse(resp: Dict[str, str]) -> Dict[str, str]:
+	if resp.get('status') != 'ok':
+		raise RuntimeError(f'Server error: {resp.get("msg", "unknown")}')
+	return resp
+
+
+def RunOne(module: str, env: str) -> None:
+	conn = ServerConnection(SERVER_SOCKET)
+	try:
+		resp = CheckResponse(conn.Request(BuildRunRequest(module, env)))
+	finally:
+		conn.Close()
+	for key, value in resp.items():
+		print(f'{key:>15}: {value}')
+
+
+def LoadClient(
+	request: str,
+	numJobs: int,
+	latencies: List[float],
+	results: List[Dict[str, str]],
+	errors: List[str],
+) -> None:
+	conn = ServerConnection(SERVER_SOCKET)
+	try:
+		for _ in range(numJobs):
+			startTime = time.perf_counter()
+			resp = conn.Request(request)
+			endTime = time.perf_counter()
+			if resp.get('status') != 'ok':
+				errors.append(resp.get('msg', 'unknown'))
+				continue
+			latencies.append((endTime - startTime) * 1e6)
+			results.append(resp)
+	finally:
+		conn.Close()
+
+
+def Percentile(values: List[float], percent: float) -> float:
+	values = sorted(values)
+	idx = min(int(len(values) * percent / 100.0), len(values) - 1)
+	return values[idx]
+
+
+def RunLoad(module: str, env: str, numJobs: int, numClients: int) -> None:
+	request = BuildRunRequest(module, env)
+
+	# the first job loads the module and creates its instance
+	conn = ServerConnection(SERVER_SOCKET)
+	try:
+		startTime = time.perf_counter()
+		coldResp = CheckResponse(conn.Request(request))
+		coldLatency = (time.perf_counter() - startTime) * 1e6
+	finally:
+		conn.Close()
+
+	jobsPerClient = max(numJobs // numClients, 1)
+	latencies = [ [] for _ in range(numClients) ]
+	results = [ [] for _ in range(numClients) ]
+	errors = []
+	threads = [
+		threading.Thread(
+			target=LoadClient,
+			args=(request, jobsPerClient, latencies[i], results[i], errors),
+		)
+		for i in range(numClients)
+	]
+	startTime = time.perf_counter()
+	for t in threads:
+		t.start()
+	for t in threads:
+		t.join()
+	wallTime = time.perf_counter() - startTime
+
+	measurement = {
+		'module': module,
+		'env': env,
+		'clients': numClients,
+		'cold': {
+			'latency_us': coldLatency,
+			'response': coldResp,
+		},
+		'latency_us': [ x for l in latencies for x in l ],
+		'run_us': [ int(r['run_us']) for l in results for r in l ],
+		'warm': sum([ int(r['warm']) for l in results for r in l ]),
+		'errors': len(errors),
+		'wall_time_s': wallTime,
+	}
+	with open(os.path.join(PROJ_BUILD_DIR, 'server.load.json'), 'w') as f:
+		json.dump({ 'measurement': measurement, 'raw': errors, }, f, indent='\t')
+
+	ReportLoad(measurement)
+
+
+def ReportLoad(measurement: dict) -> None:
+	latencies = measurement['latency_us']
+	cold = measurement['cold']
+	print()
+	print(f'Module: {measurement["module"]}, env: {measurement["env"]}, '
+		f'clients: {measurement["clients"]}')
+	print(f'{"Cold job":>20}: {cold["latency_us"]:10.1f} us '
+		f'(load {cold["response"]["load_us"]} us, '
+		f'instantiate {cold["response"]["instantiate_us"]} us, '
+		f'run {cold["response"]["run_us"]} us)')
+	if len(latencies) == 0:
+		print(f'No job succeeded; {measurement["errors"]} errors')
+		return
+	print(f'{"Jobs":>20}: {len(latencies)} '
+		f'({measurement["warm"]} warm, {measurement["errors"]} errors)')
+	print(f'{"Latency p50":>20}: {Percentile(latencies, 50):10.1f} us')
+	print(f'{"Latency p99":>20}: {Percentile(latencies, 99):10.1f} us')
+	print(f'{"Latency max":>20}: {max(latencies):10.1f} us')
+	print(f'{"Run time (median)":>20}: {statistics.median(measurement["run_us"]):10.1f} us')
+	print(f'{"Throughput":>20}: {len(latencies) / measurement["wall_time_s"]:10.1f} jobs/s')
+
+
+def ReportLoadFromFile(jsonFilePath: str) -> None:
+	with open(jsonFilePath, 'r') as f:
+		jsonFile = json.load(f)
+
+	ReportLoad(jsonFile['measurement'])
+
+
+def SimpleRequest(cmd: str) -> None:
+	conn = ServerConnection(SERVER_SOCKET)
+	try:
+		resp = CheckResponse(conn.Request(cmd))
+	finally:
+		conn.Close()
+	print(' '.join([ f'{k}={v}' for k, v in resp.items() ]))
+
+
+def main() -> None:
+	if len(sys.argv) > 2 and sys.argv[1] == 'run':
+		env = sys.argv[3] if len(sys.argv) > 3 else DEFAULT_ENV
+		RunOne(sys.argv[2], env)
+	elif len(sys.argv) > 2 and sys.argv[1] == 'load':
+		env = sys.argv[3] if len(sys.argv) > 3 else DEFAULT_ENV
+		numJobs = int(sys.argv[4]) if len(sys.argv) > 4 else DEFAULT_NUM_JOBS
+		numClients = int(sys.argv[5]) if len(sys.argv) > 5 else DEFAULT_NUM_CLIENTS
+		RunLoad(sys.argv[2], env, numJobs, numClients)
+	elif len(sys.argv) > 2 and sys.argv[1] == 'report':
+		ReportLoadFromFile(sys.argv[2])
+	elif len(sys.argv) > 1 and sys.argv[1] in [ 'stats', 'quit' ]:
+		SimpleRequest(sys.argv[1])
+	else:
+		print('Usage: decent-wasm-client.py run <module|bundle:<id>> [<env>]')
+		print('       decent-wasm-client.py load <module|bundle:<id>> [<env> [<jobs> [<clients>]]]')
+		print('       decent-wasm-client.py report <saved json>')
+		print('       decent-wasm-client.py <stats|quit>')
+
+
+if __name__ == '__main__':
+	main()
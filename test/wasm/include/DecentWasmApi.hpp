@@ -7,3 +7,59 @@
 #pragma once
 
 #include "decent_wasm_api.h"
+
+#include <cstddef>
+
+
+namespace DecentWasm
+{
+
+
+/**
+ * @brief Copies below this size are done inline, by `memory.copy` (or
+ *        `memory.fill`) when built with `-mbulk-memory`; larger ones go to
+ *        the host, which uses streaming stores for very large sizes.
+ */
+static constexpr size_t sk_nativeMemOpMinSize = 64 * 1024;
+
+
+inline void MemCopy(void* dest, const void* src, size_t n)
+{
+	if (n < sk_nativeMemOpMinSize)
+	{
+		__builtin_memcpy(dest, src, n);
+	}
+	else
+	{
+		decent_wasm_memcpy(dest, src, n);
+	}
+}
+
+
+inline void MemMove(void* dest, const void* src, size_t n)
+{
+	if (n < sk_nativeMemOpMinSize)
+	{
+		__builtin_memmove(dest, src, n);
+	}
+	else
+	{
+		decent_wasm_memmove(dest, src, n);
+	}
+}
+
+
+inline void MemSet(void* dest, int val, size_t n)
+{
+	if (n < sk_nativeMemOpMinSize)
+	{
+		__builtin_memset(dest, val, n);
+	}
+	else
+	{
+		decent_wasm_memset(dest, val, n);
+	}
+}
+
+
+} // namespace DecentWasm
@@ -19,8 +19,20 @@ extern "C" {
 void decent_wasm_exit(int status);
 
 int decent_wasm_sum(int a, int b);
+int decent_wasm_sum_raw(int a, int b);
+
+void decent_wasm_noop(void);
+void decent_wasm_noop_raw(void);
+unsigned int decent_wasm_buf_peek(const void * buf, size_t len);
+unsigned int decent_wasm_strlen(const char * str);
+void decent_wasm_ocall_noop(void);
 void decent_wasm_print(const char * msg);
 
+void decent_wasm_memcpy(void * dest, const void * src, size_t n);
+void decent_wasm_memmove(void * dest, const void * src, size_t n);
+void decent_wasm_memset(void * dest, int val, size_t n);
+unsigned long long decent_wasm_timestamp_us(void);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -0,0 +1,57 @@
+// Copyright (c) 2024 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#ifndef DECENT_WASM_KERNELS_HEADER
+#define DECENT_WASM_KERNELS_HEADER
+
+// ========================================
+// Decent WASM host kernel natives
+// ========================================
+//
+// Dense double-precision kernels run natively by the host, on arrays in the
+// linear memory. Matrices are row-major and contiguous, and every array must
+// be aligned to 8 bytes. Output arrays must not overlap the inputs (except
+// `x` and `y` of decent_wasm_daxpy being the same array). The host traps the
+// module on out-of-bounds, misaligned, or overlapping arguments.
+//
+// Only available when the runtime is built with DECENT_WASM_HOST_KERNELS.
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// C = alpha * A * B + beta * C; A is m x k, B is k x n, C is m x n
+void decent_wasm_dgemm(
+	unsigned int m, unsigned int n, unsigned int k,
+	double alpha, const double * a, const double * b,
+	double beta, double * c
+);
+
+// y = alpha * A * x + beta * y (trans == 0; x has n elements, y m), or
+// y = alpha * A^T * x + beta * y (trans != 0; x has m elements, y n);
+// A is m x n
+void decent_wasm_dgemv(
+	unsigned int trans, unsigned int m, unsigned int n,
+	double alpha, const double * a, const double * x,
+	double beta, double * y
+);
+
+double decent_wasm_ddot(unsigned int n, const double * x, const double * y);
+
+// y += alpha * x
+void decent_wasm_daxpy(unsigned int n, double alpha, const double * x, double * y);
+
+// out[i][j] = coef * (in[i][j] + in[i][j-1] + in[i][j+1] + in[i+1][j] + in[i-1][j])
+// over the interior of a rows x cols grid; the border of `out` is untouched
+void decent_wasm_dstencil2d(
+	unsigned int rows, unsigned int cols,
+	double coef, const double * in, double * out
+);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* DECENT_WASM_KERNELS_HEADER */
@@ -0,0 +1,150 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <string>
+
+#include "DecentWasmApi.hpp"
+#include "DecentWasmImpl.hpp"
+
+// Copy (and fill) throughput across sizes, for each way a module can copy
+// memory:
+//   - inline: `memory.copy` / `memory.fill` (bulk memory)
+//   - native: always calling the host
+//   - tiered: DecentWasm::MemCopy / MemSet, i.e., inline below
+//             DecentWasm::sk_nativeMemOpMinSize and native above
+
+static constexpr size_t sk_maxSize = 4 * 1024 * 1024;     // 4 MB
+static constexpr size_t sk_bytesPerCase = 32 * 1024 * 1024; // 32 MB
+
+// keeps the compiler from dropping the copies
+static volatile uint8_t gs_sink = 0;
+
+enum class Method
+{
+	Inline,
+	Native,
+	Tiered,
+};
+
+static const char* GetMethodName(Method method)
+{
+	switch (method)
+	{
+	case Method::Inline:
+		return "inline";
+	case Method::Native:
+		return "native";
+	case Method::Tiered:
+	default:
+		return "tiered";
+	}
+}
+
+static void DoCopy(Method method, uint8_t* dest, const uint8_t* src, size_t n)
+{
+	switch (method)
+	{
+	case Method::Inline:
+		__builtin_memcpy(dest, src, n);
+		break;
+	case Method::Native:
+		decent_wasm_memcpy(dest, src, n);
+		break;
+	case Method::Tiered:
+	default:
+		DecentWasm::MemCopy(dest, src, n);
+		break;
+	}
+}
+
+static void DoFill(Method method, uint8_t* dest, int val, size_t n)
+{
+	switch (method)
+	{
+	case Method::Inline:
+		__builtin_memset(dest, val, n);
+		break;
+	case Method::Native:
+		decent_wasm_memset(dest, val, n);
+		break;
+	case Method::Tiered:
+	default:
+		DecentWasm::MemSet(dest, val, n);
+		break;
+	}
+}
+
+static void PrintResult(
+	const char* op,
+	Method method,
+	size_t size,
+	size_t iterations,
+	uint64_t timeUs
+)
+{
+	std::string outStr =
+		"Copy bench: "
+		"Op: "         + std::string(op) + ", "
+		"Method: "     + GetMethodName(method) + ", "
+		"Size: "       + std::to_string(size) + " bytes, "
+		"Iterations: " + std::to_string(iterations) + ", "
+		"Time: "       + std::to_string(timeUs) + " us\n";
+	decent_wasm_print(outStr.c_str());
+}
+
+extern "C" int32_t decent_wasm_injected_main(
+	const uint8_t* eIdSec, uint32_t eIdSecSize,
+	const uint8_t* msgSec, uint32_t msgSecSize,
+	uint64_t threshold
+)
+{
+	(void)eIdSec;
+	(void)eIdSecSize;
+	(void)msgSec;
+	(void)msgSecSize;
+	(void)threshold;
+
+	uint8_t* src = static_cast<uint8_t*>(malloc(sk_maxSize));
+	uint8_t* dest = static_cast<uint8_t*>(malloc(sk_maxSize));
+	if (src == nullptr || dest == nullptr)
+	{
+		decent_wasm_print("Copy bench: failed to allocate the buffers\n");
+		return -1;
+	}
+	for (size_t i = 0; i < sk_maxSize; ++i)
+	{
+		src[i] = static_cast<uint8_t>(i);
+	}
+
+	for (Method method : { Method::Inline, Method::Native, Method::Tiered })
+	{
+		for (size_t size = 16; size <= sk_maxSize; size *= 4)
+		{
+			const size_t iterations = sk_bytesPerCase / size;
+
+			uint64_t startUs = decent_wasm_timestamp_us();
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				DoCopy(method, dest, src, size);
+				gs_sink = dest[i % size];
+			}
+			uint64_t endUs = decent_wasm_timestamp_us();
+			PrintResult("copy", method, size, iterations, endUs - startUs);
+
+			startUs = decent_wasm_timestamp_us();
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				DoFill(method, dest, static_cast<int>(i), size);
+				gs_sink = dest[i % size];
+			}
+			endUs = decent_wasm_timestamp_us();
+			PrintResult("fill", method, size, iterations, endUs - startUs);
+		}
+	}
+
+	free(dest);
+	free(src);
+
+	return 0;
+}
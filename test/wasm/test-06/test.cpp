@@ -0,0 +1,92 @@
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+
+#include "DecentWasmApi.hpp"
+#include "DecentWasmImpl.hpp"
+
+// Round-trip cost of host calls, i.e., calling natives that do (almost)
+// nothing, one kind of transition at a time:
+//   - noop:       no arguments
+//   - noop_raw:   the same, registered through the raw API
+//   - sum:        integer arguments and result, marshalled by WAMR per the
+//                 signature string
+//   - sum_raw:    the same function registered through the raw API, with the
+//                 arguments unpacked by code generated at compile time
+//   - buf:        a pointer validated by WAMR (`*~`)
+//   - str:        a string validated by WAMR (`$`), i.e., scanned for its end
+//   - ocall_noop: a native that makes an empty OCALL in the enclave
+//                 (a plain function call on the untrusted side)
+
+static constexpr size_t sk_numCalls = 1000000;
+static constexpr size_t sk_numOcalls = 100000;
+
+static void PrintResult(const char* native, size_t calls, uint64_t timeUs)
+{
+	std::string outStr =
+		"Host call bench: "
+		"Native: " + std::string(native) + ", "
+		"Calls: "  + std::to_string(calls) + ", "
+		"Time: "   + std::to_string(timeUs) + " us\n";
+	decent_wasm_print(outStr.c_str());
+}
+
+template<typename _Func>
+static int BenchCalls(const char* native, size_t calls, _Func func)
+{
+	int acc = 0;
+	uint64_t startUs = decent_wasm_timestamp_us();
+	for (size_t i = 0; i < calls; ++i)
+	{
+		acc = func(acc, static_cast<int>(i));
+	}
+	uint64_t endUs = decent_wasm_timestamp_us();
+	PrintResult(native, calls, endUs - startUs);
+	return acc;
+}
+
+extern "C" int32_t decent_wasm_injected_main(
+	const uint8_t* eIdSec, uint32_t eIdSecSize,
+	const uint8_t* msgSec, uint32_t msgSecSize,
+	uint64_t threshold
+)
+{
+	(void)eIdSec;
+	(void)eIdSecSize;
+	(void)msgSec;
+	(void)msgSecSize;
+	(void)threshold;
+
+	static const uint8_t sk_buf[64] = { 1, };
+	static const char sk_str[] = "Decent WASM host call benchmark";
+
+	BenchCalls("noop", sk_numCalls, [](int acc, int) {
+		decent_wasm_noop();
+		return acc;
+	});
+	BenchCalls("noop_raw", sk_numCalls, [](int acc, int) {
+		decent_wasm_noop_raw();
+		return acc;
+	});
+	int sum = BenchCalls("sum", sk_numCalls, decent_wasm_sum);
+	int sumRaw = BenchCalls("sum_raw", sk_numCalls, decent_wasm_sum_raw);
+	BenchCalls("buf", sk_numCalls, [](int acc, int) {
+		return acc + static_cast<int>(decent_wasm_buf_peek(sk_buf, sizeof(sk_buf)));
+	});
+	BenchCalls("str", sk_numCalls, [](int acc, int) {
+		return acc + static_cast<int>(decent_wasm_strlen(sk_str));
+	});
+	BenchCalls("ocall_noop", sk_numOcalls, [](int acc, int) {
+		decent_wasm_ocall_noop();
+		return acc;
+	});
+
+	if (sum != sumRaw)
+	{
+		decent_wasm_print("Host call bench: results of sum and sum_raw differ\n");
+		return -1;
+	}
+
+	return 0;
+}
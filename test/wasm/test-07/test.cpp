@@ -0,0 +1,454 @@
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <initializer_list>
+
+#include <string>
+
+#include "DecentWasmApi.hpp"
+#include "DecentWasmImpl.hpp"
+#include "decent_wasm_kernels.h"
+
+// The PolyBench kernels dominated by dense loops, run both in WASM (the
+// loops of PolyBench/C 4.2) and through the host kernel natives:
+//   - gemm:      decent_wasm_dgemm
+//   - gemver:    decent_wasm_daxpy and decent_wasm_dgemv
+//   - mvt:       decent_wasm_dgemv, non-transposed and transposed
+//   - atax:      decent_wasm_dgemv, non-transposed and transposed
+//   - jacobi-2d: decent_wasm_dstencil2d
+// Sizes and initial values are those of LARGE_DATASET, the default of
+// PolyBench, so the times compare with the native `.app` of test/polybench.
+// The results of the two methods are checked against each other.
+
+static constexpr double sk_maxRelDiff = 1e-9;
+
+static void PrintResult(const char* kernel, const char* method, uint64_t timeUs)
+{
+	std::string outStr =
+		"Kernel bench: "
+		"Kernel: " + std::string(kernel) + ", "
+		"Method: " + std::string(method) + ", "
+		"Time: "   + std::to_string(timeUs) + " us\n";
+	decent_wasm_print(outStr.c_str());
+}
+
+class Array
+{
+public:
+	explicit Array(size_t n) :
+		m_size(n),
+		m_data(static_cast<double*>(malloc(n * sizeof(double))))
+	{}
+
+	~Array()
+	{
+		free(m_data);
+	}
+
+	Array(const Array&) = delete;
+	Array& operator=(const Array&) = delete;
+
+	bool IsValid() const { return m_data != nullptr; }
+
+	size_t Size() const { return m_size; }
+
+	double* Data() { return m_data; }
+	const double* Data() const { return m_data; }
+
+	double& operator[](size_t i) { return m_data[i]; }
+	const double& operator[](size_t i) const { return m_data[i]; }
+
+private:
+	size_t m_size;
+	double* m_data;
+}; // class Array
+
+static bool AllValid(std::initializer_list<const Array*> arrays)
+{
+	for (const Array* array : arrays)
+	{
+		if (!array->IsValid())
+		{
+			decent_wasm_print("Kernel bench: failed to allocate the arrays\n");
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool CheckSame(const char* kernel, const Array& expected, const Array& actual)
+{
+	double maxDiff = 0.0;
+	for (size_t i = 0; i < expected.Size(); ++i)
+	{
+		double scale = std::fabs(expected[i]) > 1.0 ? std::fabs(expected[i]) : 1.0;
+		double diff = std::fabs(expected[i] - actual[i]) / scale;
+		maxDiff = diff > maxDiff ? diff : maxDiff;
+	}
+	if (!(maxDiff <= sk_maxRelDiff))
+	{
+		std::string outStr =
+			"Kernel bench: results of " + std::string(kernel) + " differ "
+			"(max relative difference: " + std::to_string(maxDiff) + ")\n";
+		decent_wasm_print(outStr.c_str());
+		return false;
+	}
+	return true;
+}
+
+// ========================================
+// gemm
+// ========================================
+
+static constexpr size_t sk_gemmNi = 1000;
+static constexpr size_t sk_gemmNj = 1100;
+static constexpr size_t sk_gemmNk = 1200;
+
+static void InitGemm(Array& a, Array& b, Array& c)
+{
+	const size_t ni = sk_gemmNi;
+	const size_t nj = sk_gemmNj;
+	const size_t nk = sk_gemmNk;
+	for (size_t i = 0; i < ni; ++i)
+		for (size_t j = 0; j < nj; ++j)
+			c[i * nj + j] = static_cast<double>((i * j + 1) % ni) / ni;
+	for (size_t i = 0; i < ni; ++i)
+		for (size_t j = 0; j < nk; ++j)
+			a[i * nk + j] = static_cast<double>((i * (j + 1)) % nk) / nk;
+	for (size_t i = 0; i < nk; ++i)
+		for (size_t j = 0; j < nj; ++j)
+			b[i * nj + j] = static_cast<double>((i * (j + 2)) % nj) / nj;
+}
+
+static bool BenchGemm()
+{
+	const size_t ni = sk_gemmNi;
+	const size_t nj = sk_gemmNj;
+	const size_t nk = sk_gemmNk;
+	const double alpha = 1.5;
+	const double beta = 1.2;
+
+	Array a(ni * nk);
+	Array b(nk * nj);
+	Array c(ni * nj);
+	Array cHost(ni * nj);
+	if (!AllValid({ &a, &b, &c, &cHost }))
+	{
+		return false;
+	}
+
+	InitGemm(a, b, c);
+	std::memcpy(cHost.Data(), c.Data(), c.Size() * sizeof(double));
+
+	uint64_t startUs = decent_wasm_timestamp_us();
+	for (size_t i = 0; i < ni; ++i)
+	{
+		for (size_t j = 0; j < nj; ++j)
+			c[i * nj + j] *= beta;
+		for (size_t k = 0; k < nk; ++k)
+			for (size_t j = 0; j < nj; ++j)
+				c[i * nj + j] += alpha * a[i * nk + k] * b[k * nj + j];
+	}
+	uint64_t endUs = decent_wasm_timestamp_us();
+	PrintResult("gemm", "wasm", endUs - startUs);
+
+	startUs = decent_wasm_timestamp_us();
+	decent_wasm_dgemm(ni, nj, nk, alpha, a.Data(), b.Data(), beta, cHost.Data());
+	endUs = decent_wasm_timestamp_us();
+	PrintResult("gemm", "host", endUs - startUs);
+
+	return CheckSame("gemm", c, cHost);
+}
+
+// ========================================
+// gemver
+// ========================================
+
+static constexpr size_t sk_gemverN = 2000;
+
+struct GemverData
+{
+	GemverData() :
+		a(sk_gemverN * sk_gemverN),
+		u1(sk_gemverN), v1(sk_gemverN), u2(sk_gemverN), v2(sk_gemverN),
+		w(sk_gemverN), x(sk_gemverN), y(sk_gemverN), z(sk_gemverN)
+	{}
+
+	bool IsValid() const
+	{
+		return AllValid({ &a, &u1, &v1, &u2, &v2, &w, &x, &y, &z });
+	}
+
+	void Init()
+	{
+		const size_t n = sk_gemverN;
+		const double fn = static_cast<double>(n);
+		for (size_t i = 0; i < n; ++i)
+		{
+			u1[i] = static_cast<double>(i);
+			u2[i] = ((i + 1) / fn) / 2.0;
+			v1[i] = ((i + 1) / fn) / 4.0;
+			v2[i] = ((i + 1) / fn) / 6.0;
+			y[i] = ((i + 1) / fn) / 8.0;
+			z[i] = ((i + 1) / fn) / 9.0;
+			x[i] = 0.0;
+			w[i] = 0.0;
+			for (size_t j = 0; j < n; ++j)
+				a[i * n + j] = static_cast<double>((i * j) % n) / n;
+		}
+	}
+
+	Array a;
+	Array u1, v1, u2, v2;
+	Array w, x, y, z;
+}; // struct GemverData
+
+static bool BenchGemver()
+{
+	const size_t n = sk_gemverN;
+	const double alpha = 1.5;
+	const double beta = 1.2;
+
+	GemverData wasm;
+	GemverData host;
+	if (!wasm.IsValid() || !host.IsValid())
+	{
+		return false;
+	}
+	wasm.Init();
+	host.Init();
+
+	uint64_t startUs = decent_wasm_timestamp_us();
+	for (size_t i = 0; i < n; ++i)
+		for (size_t j = 0; j < n; ++j)
+			wasm.a[i * n + j] = wasm.a[i * n + j] +
+				wasm.u1[i] * wasm.v1[j] + wasm.u2[i] * wasm.v2[j];
+	for (size_t i = 0; i < n; ++i)
+		for (size_t j = 0; j < n; ++j)
+			wasm.x[i] = wasm.x[i] + beta * wasm.a[j * n + i] * wasm.y[j];
+	for (size_t i = 0; i < n; ++i)
+		wasm.x[i] = wasm.x[i] + wasm.z[i];
+	for (size_t i = 0; i < n; ++i)
+		for (size_t j = 0; j < n; ++j)
+			wasm.w[i] = wasm.w[i] + alpha * wasm.a[i * n + j] * wasm.x[j];
+	uint64_t endUs = decent_wasm_timestamp_us();
+	PrintResult("gemver", "wasm", endUs - startUs);
+
+	startUs = decent_wasm_timestamp_us();
+	for (size_t i = 0; i < n; ++i)
+	{
+		decent_wasm_daxpy(n, host.u1[i], host.v1.Data(), host.a.Data() + i * n);
+		decent_wasm_daxpy(n, host.u2[i], host.v2.Data(), host.a.Data() + i * n);
+	}
+	decent_wasm_dgemv(1, n, n, beta, host.a.Data(), host.y.Data(), 1.0, host.x.Data());
+	decent_wasm_daxpy(n, 1.0, host.z.Data(), host.x.Data());
+	decent_wasm_dgemv(0, n, n, alpha, host.a.Data(), host.x.Data(), 1.0, host.w.Data());
+	endUs = decent_wasm_timestamp_us();
+	PrintResult("gemver", "host", endUs - startUs);
+
+	return CheckSame("gemver", wasm.w, host.w);
+}
+
+// ========================================
+// mvt
+// ========================================
+
+static constexpr size_t sk_mvtN = 2000;
+
+static void InitMvt(Array& x1, Array& x2, Array& y1, Array& y2, Array& a)
+{
+	const size_t n = sk_mvtN;
+	for (size_t i = 0; i < n; ++i)
+	{
+		x1[i] = static_cast<double>(i % n) / n;
+		x2[i] = static_cast<double>((i + 1) % n) / n;
+		y1[i] = static_cast<double>((i + 3) % n) / n;
+		y2[i] = static_cast<double>((i + 4) % n) / n;
+		for (size_t j = 0; j < n; ++j)
+			a[i * n + j] = static_cast<double>((i * j) % n) / n;
+	}
+}
+
+static bool BenchMvt()
+{
+	const size_t n = sk_mvtN;
+
+	Array x1(n), x2(n), y1(n), y2(n), a(n * n);
+	Array x1Host(n), x2Host(n);
+	if (!AllValid({ &x1, &x2, &y1, &y2, &a, &x1Host, &x2Host }))
+	{
+		return false;
+	}
+	InitMvt(x1, x2, y1, y2, a);
+	std::memcpy(x1Host.Data(), x1.Data(), n * sizeof(double));
+	std::memcpy(x2Host.Data(), x2.Data(), n * sizeof(double));
+
+	uint64_t startUs = decent_wasm_timestamp_us();
+	for (size_t i = 0; i < n; ++i)
+		for (size_t j = 0; j < n; ++j)
+			x1[i] = x1[i] + a[i * n + j] * y1[j];
+	for (size_t i = 0; i < n; ++i)
+		for (size_t j = 0; j < n; ++j)
+			x2[i] = x2[i] + a[j * n + i] * y2[j];
+	uint64_t endUs = decent_wasm_timestamp_us();
+	PrintResult("mvt", "wasm", endUs - startUs);
+
+	startUs = decent_wasm_timestamp_us();
+	decent_wasm_dgemv(0, n, n, 1.0, a.Data(), y1.Data(), 1.0, x1Host.Data());
+	decent_wasm_dgemv(1, n, n, 1.0, a.Data(), y2.Data(), 1.0, x2Host.Data());
+	endUs = decent_wasm_timestamp_us();
+	PrintResult("mvt", "host", endUs - startUs);
+
+	return CheckSame("mvt", x1, x1Host) && CheckSame("mvt", x2, x2Host);
+}
+
+// ========================================
+// atax
+// ========================================
+
+static constexpr size_t sk_ataxM = 1900;
+static constexpr size_t sk_ataxN = 2100;
+
+static bool BenchAtax()
+{
+	const size_t m = sk_ataxM;
+	const size_t n = sk_ataxN;
+
+	Array a(m * n), x(n), y(n), tmp(m);
+	Array yHost(n), tmpHost(m);
+	if (!AllValid({ &a, &x, &y, &tmp, &yHost, &tmpHost }))
+	{
+		return false;
+	}
+	const double fn = static_cast<double>(n);
+	for (size_t i = 0; i < n; ++i)
+		x[i] = 1 + (i / fn);
+	for (size_t i = 0; i < m; ++i)
+		for (size_t j = 0; j < n; ++j)
+			a[i * n + j] = static_cast<double>((i + j) % n) / (5 * m);
+
+	uint64_t startUs = decent_wasm_timestamp_us();
+	for (size_t i = 0; i < n; ++i)
+		y[i] = 0;
+	for (size_t i = 0; i < m; ++i)
+	{
+		tmp[i] = 0.0;
+		for (size_t j = 0; j < n; ++j)
+			tmp[i] = tmp[i] + a[i * n + j] * x[j];
+		for (size_t j = 0; j < n; ++j)
+			y[j] = y[j] + a[i * n + j] * tmp[i];
+	}
+	uint64_t endUs = decent_wasm_timestamp_us();
+	PrintResult("atax", "wasm", endUs - startUs);
+
+	startUs = decent_wasm_timestamp_us();
+	decent_wasm_dgemv(0, m, n, 1.0, a.Data(), x.Data(), 0.0, tmpHost.Data());
+	decent_wasm_dgemv(1, m, n, 1.0, a.Data(), tmpHost.Data(), 0.0, yHost.Data());
+	endUs = decent_wasm_timestamp_us();
+	PrintResult("atax", "host", endUs - startUs);
+
+	return CheckSame("atax", y, yHost);
+}
+
+// ========================================
+// jacobi-2d
+// ========================================
+
+static constexpr size_t sk_jacobiSteps = 500;
+static constexpr size_t sk_jacobiN = 1300;
+
+static void InitJacobi2d(Array& a, Array& b)
+{
+	const size_t n = sk_jacobiN;
+	for (size_t i = 0; i < n; ++i)
+	{
+		for (size_t j = 0; j < n; ++j)
+		{
+			a[i * n + j] = (static_cast<double>(i) * (j + 2) + 2) / n;
+			b[i * n + j] = (static_cast<double>(i) * (j + 3) + 3) / n;
+		}
+	}
+}
+
+static bool BenchJacobi2d()
+{
+	const size_t n = sk_jacobiN;
+
+	// the WASM result is kept in `expected`, so that the host run reuses
+	// the arrays, which are the largest of all kernels
+	Array expected(n * n);
+	if (!AllValid({ &expected }))
+	{
+		return false;
+	}
+
+	{
+		Array a(n * n), b(n * n);
+		if (!AllValid({ &a, &b }))
+		{
+			return false;
+		}
+		InitJacobi2d(a, b);
+
+		uint64_t startUs = decent_wasm_timestamp_us();
+		for (size_t t = 0; t < sk_jacobiSteps; ++t)
+		{
+			for (size_t i = 1; i < n - 1; ++i)
+				for (size_t j = 1; j < n - 1; ++j)
+					b[i * n + j] = 0.2 * (a[i * n + j] + a[i * n + j - 1] +
+						a[i * n + 1 + j] + a[(1 + i) * n + j] + a[(i - 1) * n + j]);
+			for (size_t i = 1; i < n - 1; ++i)
+				for (size_t j = 1; j < n - 1; ++j)
+					a[i * n + j] = 0.2 * (b[i * n + j] + b[i * n + j - 1] +
+						b[i * n + 1 + j] + b[(1 + i) * n + j] + b[(i - 1) * n + j]);
+		}
+		uint64_t endUs = decent_wasm_timestamp_us();
+		PrintResult("jacobi-2d", "wasm", endUs - startUs);
+
+		std::memcpy(expected.Data(), a.Data(), n * n * sizeof(double));
+	}
+
+	Array a(n * n), b(n * n);
+	if (!AllValid({ &a, &b }))
+	{
+		return false;
+	}
+	InitJacobi2d(a, b);
+
+	uint64_t startUs = decent_wasm_timestamp_us();
+	for (size_t t = 0; t < sk_jacobiSteps; ++t)
+	{
+		decent_wasm_dstencil2d(n, n, 0.2, a.Data(), b.Data());
+		decent_wasm_dstencil2d(n, n, 0.2, b.Data(), a.Data());
+	}
+	uint64_t endUs = decent_wasm_timestamp_us();
+	PrintResult("jacobi-2d", "host", endUs - startUs);
+
+	return CheckSame("jacobi-2d", expected, a);
+}
+
+extern "C" int32_t decent_wasm_injected_main(
+	const uint8_t* eIdSec, uint32_t eIdSecSize,
+	const uint8_t* msgSec, uint32_t msgSecSize,
+	uint64_t threshold
+)
+{
+	(void)eIdSec;
+	(void)eIdSecSize;
+	(void)msgSec;
+	(void)msgSecSize;
+	(void)threshold;
+
+	// one kernel at a time, so that the arrays of only one are allocated
+	bool ok =
+		BenchGemm() &&
+		BenchGemver() &&
+		BenchMvt() &&
+		BenchAtax() &&
+		BenchJacobi2d();
+
+	return ok ? 0 : -1;
+}